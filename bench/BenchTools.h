@@ -0,0 +1,504 @@
+//
+// File: BenchTools.h
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef BENCH_BENCHTOOLS_H
+#define BENCH_BENCHTOOLS_H
+
+#include <Bpp/Exceptions.h>
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/SiteContainer.h>
+#include <Bpp/Seq/GeneticCode/StandardGeneticCode.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/DataFlow.h>
+#include <Bpp/Phyl/Likelihood/NonHomogeneousSubstitutionProcess.h>
+#include <Bpp/Phyl/Likelihood/RateAcrossSitesSubstitutionProcess.h>
+#include <Bpp/Phyl/Model/Codon/YN98.h>
+#include <Bpp/Phyl/Model/FrequencySet/CodonFrequencySet.h>
+#include <Bpp/Phyl/Model/FrequencySet/NucleotideFrequencySet.h>
+#include <Bpp/Phyl/Model/MixtureOfSubstitutionModels.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/Protein/JTT92.h>
+#include <Bpp/Phyl/Model/RateDistribution/ConstantRateDistribution.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/Simulation/SimpleSubstitutionProcessSequenceSimulator.h>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <utility>
+#include <vector>
+
+/*
+ * Shared helpers of the benchmark programs (see bench/CMakeLists.txt).
+ *
+ * Every benchmark runs a list of synthetic workloads (a random tree, a
+ * model and data simulated along them, all derived from a seed) and
+ * prints one JSON object per measurement on stdout, and in the file
+ * given with --output if any.
+ */
+namespace bpp
+{
+namespace bench
+{
+/**
+ * @brief Command line options, given as "--key value" pairs.
+ */
+class Options
+{
+private:
+  std::map<std::string, std::string> values_;
+
+public:
+  Options (int argc, char** argv)
+    : values_ ()
+  {
+    for (int i = 1; i < argc; ++i)
+    {
+      std::string key (argv[i]);
+      if (key.compare (0, 2, "--") != 0 || i + 1 >= argc)
+        throw Exception ("Usage: " + std::string (argv[0]) + " [--key value]...");
+      values_[key.substr (2)] = argv[++i];
+    }
+  }
+
+  std::string get (const std::string& key, const std::string& defaultValue) const
+  {
+    auto it = values_.find (key);
+    return it != values_.end () ? it->second : defaultValue;
+  }
+
+  std::size_t getSize (const std::string& key, std::size_t defaultValue) const
+  {
+    auto it = values_.find (key);
+    return it != values_.end () ? static_cast<std::size_t>(std::stoul (it->second)) : defaultValue;
+  }
+
+  bool getBool (const std::string& key, bool defaultValue) const
+  {
+    auto it = values_.find (key);
+    if (it == values_.end ())
+      return defaultValue;
+    return it->second == "1" || it->second == "yes" || it->second == "true";
+  }
+};
+
+/**
+ * @brief Description of a synthetic workload.
+ */
+struct Workload
+{
+  std::string alphabet{"dna"}; // dna, protein or codon
+  std::size_t nbTaxa{16};
+  std::size_t nbSites{1000};
+  std::size_t nbRateClasses{1}; // 1: no rate variation across sites
+  bool mixture{false};
+  bool nonHomogeneous{false};
+
+  std::string name () const
+  {
+    std::string n = alphabet + "_t" + std::to_string (nbTaxa) + "_s" + std::to_string (nbSites);
+    if (nbRateClasses > 1)
+      n += "_g" + std::to_string (nbRateClasses);
+    if (mixture)
+      n += "_mix";
+    if (nonHomogeneous)
+      n += "_nh";
+    return n;
+  }
+};
+
+inline Workload makeWorkload (const std::string& alphabet, std::size_t nbTaxa, std::size_t nbSites, std::size_t nbRateClasses, bool mixture = false, bool nonHomogeneous = false)
+{
+  Workload w;
+  w.alphabet = alphabet;
+  w.nbTaxa = nbTaxa;
+  w.nbSites = nbSites;
+  w.nbRateClasses = nbRateClasses;
+  w.mixture = mixture;
+  w.nonHomogeneous = nonHomogeneous;
+  return w;
+}
+
+/**
+ * @brief Workloads selected by --suite.
+ *
+ * "quick" (default) runs in seconds, "full" covers 16 to 2000 taxa and
+ * 1e3 to 1e6 sites, "custom" runs the single workload described by
+ * --alphabet, --taxa, --sites, --gamma, --mixture and --nh.
+ */
+inline std::vector<Workload> getWorkloads (const Options& options)
+{
+  std::string suite = options.get ("suite", "quick");
+  std::vector<Workload> workloads;
+  if (suite == "custom")
+  {
+    workloads.push_back (makeWorkload (options.get ("alphabet", "dna"), options.getSize ("taxa", 16), options.getSize ("sites", 1000), options.getSize ("gamma", 1), options.getBool ("mixture", false), options.getBool ("nh", false)));
+    return workloads;
+  }
+  if (suite != "quick" && suite != "full")
+    throw Exception ("bench::getWorkloads: unknown suite '" + suite + "'.");
+
+  workloads.push_back (makeWorkload ("dna", 16, 1000, 1));
+  workloads.push_back (makeWorkload ("dna", 16, 1000, 4));
+  workloads.push_back (makeWorkload ("dna", 16, 1000, 1, true));
+  workloads.push_back (makeWorkload ("dna", 16, 1000, 1, false, true));
+  workloads.push_back (makeWorkload ("dna", 64, 10000, 4));
+  workloads.push_back (makeWorkload ("protein", 16, 1000, 4));
+  workloads.push_back (makeWorkload ("codon", 16, 1000, 1));
+  if (suite == "full")
+  {
+    workloads.push_back (makeWorkload ("dna", 128, 100000, 4));
+    workloads.push_back (makeWorkload ("dna", 128, 100000, 4, true));
+    workloads.push_back (makeWorkload ("dna", 512, 10000, 4, false, true));
+    workloads.push_back (makeWorkload ("dna", 64, 1000000, 4));
+    workloads.push_back (makeWorkload ("dna", 2000, 10000, 4));
+    workloads.push_back (makeWorkload ("protein", 128, 10000, 4));
+    workloads.push_back (makeWorkload ("protein", 512, 10000, 4, true));
+    workloads.push_back (makeWorkload ("codon", 64, 10000, 4));
+  }
+  return workloads;
+}
+
+/**
+ * @brief Random unrooted tree in Newick format.
+ *
+ * Subtrees are joined two by two at random until three are left, branch
+ * lengths are exponentially distributed.
+ */
+inline std::string randomNewickTree (std::size_t nbTaxa, unsigned int seed, double meanBranchLength = 0.05)
+{
+  if (nbTaxa < 3)
+    throw Exception ("bench::randomNewickTree: at least 3 taxa are needed.");
+  std::mt19937 generator (seed);
+  std::exponential_distribution<double> branchLength (1. / meanBranchLength);
+  auto withLength = [&](const std::string& subtree) {
+                      std::ostringstream oss;
+                      oss << subtree << ":" << std::setprecision (6) << branchLength (generator);
+                      return oss.str ();
+                    };
+
+  std::vector<std::string> subtrees;
+  for (std::size_t i = 0; i < nbTaxa; ++i)
+    subtrees.push_back ("T" + std::to_string (i + 1));
+  while (subtrees.size () > 3)
+  {
+    std::uniform_int_distribution<std::size_t> pick (0, subtrees.size () - 1);
+    std::size_t i = pick (generator);
+    std::size_t j = pick (generator);
+    if (i == j)
+      continue;
+    std::string joined = "(" + withLength (subtrees[i]) + "," + withLength (subtrees[j]) + ")";
+    subtrees[std::min (i, j)] = joined;
+    subtrees.erase (subtrees.begin () + static_cast<std::ptrdiff_t>(std::max (i, j)));
+  }
+  return "(" + withLength (subtrees[0]) + "," + withLength (subtrees[1]) + "," + withLength (subtrees[2]) + ");";
+}
+
+/**
+ * @brief Tree, model and substitution process of a workload.
+ */
+class Setup
+{
+public:
+  Workload workload;
+  const Alphabet* alphabet;
+  std::shared_ptr<GeneticCode> geneticCode;
+  std::string newick;
+  std::shared_ptr<PhyloTree> tree;
+  std::shared_ptr<TransitionModel> model;
+  std::shared_ptr<DiscreteDistribution> rateDistribution;
+  std::shared_ptr<SubstitutionProcess> process;
+
+public:
+  Setup (const Workload& w, unsigned int seed)
+    : workload (w), alphabet (0), geneticCode (), newick (randomNewickTree (w.nbTaxa, seed)), tree (), model (), rateDistribution (), process ()
+  {
+    Newick reader;
+    tree.reset (reader.parenthesisToPhyloTree (newick, false, "", false, false));
+
+    if (workload.alphabet == "dna")
+      alphabet = &AlphabetTools::DNA_ALPHABET;
+    else if (workload.alphabet == "protein")
+      alphabet = &AlphabetTools::PROTEIN_ALPHABET;
+    else if (workload.alphabet == "codon")
+    {
+      geneticCode = std::make_shared<StandardGeneticCode>(AlphabetTools::DNA_ALPHABET);
+      alphabet = geneticCode->getSourceAlphabet ();
+    }
+    else
+      throw Exception ("bench::Setup: unknown alphabet '" + workload.alphabet + "'.");
+
+    if (workload.mixture)
+    {
+      std::vector<std::shared_ptr<TransitionModel>> components = {createModel_ (0), createModel_ (1)};
+      model = std::make_shared<MixtureOfSubstitutionModels>(alphabet, components);
+    }
+    else
+      model = createModel_ (0);
+
+    if (workload.nbRateClasses > 1)
+      rateDistribution = std::make_shared<GammaDiscreteRateDistribution>(workload.nbRateClasses, 0.5);
+    else
+      rateDistribution = std::make_shared<ConstantRateDistribution>();
+
+    if (workload.nonHomogeneous)
+    {
+      // One theta per branch, kappa shared.
+      if (workload.alphabet != "dna" || workload.mixture)
+        throw Exception ("bench::Setup: non-homogeneous workloads are only available for non-mixture DNA models.");
+      auto rootFreqs = std::make_shared<GCFrequencySet>(&AlphabetTools::DNA_ALPHABET);
+      process.reset (NonHomogeneousSubstitutionProcess::createNonHomogeneousSubstitutionProcess (model, rateDistribution, tree, rootFreqs, {"T92.kappa"}));
+    }
+    else
+      process = std::make_shared<RateAcrossSitesSubstitutionProcess>(model, rateDistribution, tree);
+  }
+
+  /**
+   * @brief Sites simulated along the process, reproducible given the seed.
+   */
+  std::shared_ptr<SiteContainer> simulate (unsigned int seed) const
+  {
+    RandomTools::setSeed (static_cast<long>(seed));
+    SimpleSubstitutionProcessSequenceSimulator simulator (*process);
+    return simulator.simulate (workload.nbSites);
+  }
+
+  /**
+   * @brief Name of a model parameter of the process, used for update
+   * benchmarks.
+   */
+  std::string getModelParameterName (const ParameterList& parameters) const
+  {
+    for (std::size_t i = 0; i < parameters.size (); ++i)
+      if (parameters[i].getName ().compare (0, model->getNamespace ().size (), model->getNamespace ()) == 0)
+        return parameters[i].getName ();
+    throw Exception ("bench::Setup: no parameter for model " + model->getName () + ".");
+  }
+
+  /**
+   * @brief Name of a branch length parameter, used for update benchmarks.
+   */
+  static std::string getBranchLengthParameterName (const ParameterList& parameters)
+  {
+    for (std::size_t i = 0; i < parameters.size (); ++i)
+      if (parameters[i].getName ().compare (0, 5, "BrLen") == 0)
+        return parameters[i].getName ();
+    throw Exception ("bench::Setup: no branch length parameter.");
+  }
+
+private:
+  std::shared_ptr<TransitionModel> createModel_ (std::size_t variant) const
+  {
+    double shift = static_cast<double>(variant);
+    if (workload.alphabet == "dna")
+      return std::make_shared<T92>(&AlphabetTools::DNA_ALPHABET, 2. + 3. * shift, 0.45 + 0.1 * shift);
+    if (workload.alphabet == "protein")
+    {
+      auto jtt = std::make_shared<JTT92>(&AlphabetTools::PROTEIN_ALPHABET);
+      jtt->setRate (1. + shift);
+      return jtt;
+    }
+    auto yn98 = std::make_shared<YN98>(geneticCode.get (), CodonFrequencySet::getFrequencySetForCodons (CodonFrequencySet::F3X4, geneticCode.get ()));
+    yn98->setParameterValue ("omega", 0.2 + shift);
+    return yn98;
+  }
+};
+
+/**
+ * @brief Wall clock timer.
+ */
+class Chrono
+{
+private:
+  std::chrono::steady_clock::time_point start_;
+
+public:
+  Chrono ()
+    : start_ (std::chrono::steady_clock::now ()) {}
+
+  void restart () { start_ = std::chrono::steady_clock::now (); }
+
+  double seconds () const
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now () - start_).count ();
+  }
+};
+
+/**
+ * @brief Peak resident set size of the process, in MiB.
+ */
+inline double getPeakRSSMegabytes ()
+{
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return static_cast<double>(usage.ru_maxrss) / (1024. * 1024.); // bytes
+#else
+  return static_cast<double>(usage.ru_maxrss) / 1024.; // kilobytes
+#endif
+}
+
+/**
+ * @brief One measurement, output as a single line JSON object.
+ */
+class Record
+{
+private:
+  std::vector<std::pair<std::string, std::string>> fields_; // key, JSON value
+
+public:
+  Record (const std::string& benchmark, const Workload& workload)
+    : fields_ ()
+  {
+    set ("benchmark", benchmark);
+    set ("workload", workload.name ());
+    set ("alphabet", workload.alphabet);
+    set ("taxa", workload.nbTaxa);
+    set ("sites", workload.nbSites);
+    set ("rateClasses", workload.nbRateClasses);
+    set ("mixture", workload.mixture);
+    set ("nonHomogeneous", workload.nonHomogeneous);
+  }
+
+  static std::string quote (const std::string& s)
+  {
+    std::ostringstream oss;
+    oss << '"';
+    for (char c : s)
+    {
+      if (c == '"' || c == '\\')
+        oss << '\\' << c;
+      else if (static_cast<unsigned char>(c) < 0x20)
+        oss << "\\u" << std::hex << std::setw (4) << std::setfill ('0') << static_cast<int>(c) << std::dec;
+      else
+        oss << c;
+    }
+    oss << '"';
+    return oss.str ();
+  }
+
+  static std::string number (double d)
+  {
+    if (!std::isfinite (d))
+      return "null";
+    std::ostringstream oss;
+    oss << std::setprecision (10) << d;
+    return oss.str ();
+  }
+
+  Record& set (const std::string& key, const std::string& value) { return setRaw (key, quote (value)); }
+  Record& set (const std::string& key, const char* value) { return setRaw (key, quote (value)); }
+  Record& set (const std::string& key, double value) { return setRaw (key, number (value)); }
+  Record& set (const std::string& key, std::size_t value) { return setRaw (key, std::to_string (value)); }
+  Record& set (const std::string& key, bool value) { return setRaw (key, value ? "true" : "false"); }
+
+  Record& setRaw (const std::string& key, const std::string& json)
+  {
+    fields_.emplace_back (key, json);
+    return *this;
+  }
+
+  /**
+   * @brief Add the peak RSS and the per node type times gathered by
+   * NodeTimings since the last reset.
+   */
+  Record& setResources ()
+  {
+    set ("peakRSSMegabytes", getPeakRSSMegabytes ());
+    std::string timings = "{";
+    for (const auto& entry : NodeTimings::getEntries ())
+    {
+      if (timings.size () > 1)
+        timings += ",";
+      timings += quote (entry.first) + ":{\"computations\":" + std::to_string (entry.second.nbComputations) + ",\"seconds\":" + number (entry.second.seconds)
+                 + ",\"flops\":" + number (entry.second.flops) + ",\"bytes\":" + number (entry.second.bytes) + "}";
+    }
+    return setRaw ("nodeTimings", timings + "}");
+  }
+
+  std::string toJson () const
+  {
+    std::string json = "{";
+    for (std::size_t i = 0; i < fields_.size (); ++i)
+      json += (i ? "," : "") + quote (fields_[i].first) + ":" + fields_[i].second;
+    return json + "}";
+  }
+};
+
+/**
+ * @brief Writes records to stdout and to the --output file (JSON lines).
+ */
+class Reporter
+{
+private:
+  std::ofstream output_;
+
+public:
+  explicit Reporter (const Options& options)
+    : output_ ()
+  {
+    std::string path = options.get ("output", "");
+    if (!path.empty ())
+    {
+      output_.open (path.c_str (), std::ios::out);
+      if (!output_)
+        throw Exception ("bench::Reporter: can not open " + path + ".");
+    }
+  }
+
+  void write (const Record& record)
+  {
+    std::string json = record.toJson ();
+    std::cout << json << std::endl;
+    if (output_.is_open ())
+      output_ << json << std::endl;
+  }
+};
+} // namespace bench
+} // namespace bpp
+#endif // BENCH_BENCHTOOLS_H
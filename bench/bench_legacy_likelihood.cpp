@@ -0,0 +1,121 @@
+//
+// File: bench_legacy_likelihood.cpp
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+/*
+ * Evaluation throughput of the legacy DRHomogeneousTreeLikelihood, on
+ * the same workloads as bench_likelihood for comparison. Mixture and
+ * non-homogeneous workloads are skipped.
+ *
+ * Options: --suite quick|full|custom (see BenchTools.h), --evaluations n,
+ * --seed n, --output file.
+ */
+
+#include <Bpp/Phyl/Legacy/Likelihood/DRHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Tree/TreeTemplateTools.h>
+
+#include "BenchTools.h"
+
+using namespace bpp;
+using namespace std;
+
+static double timeUpdates (DRHomogeneousTreeLikelihood& tl, const string& name, size_t nbEvaluations, bool derivative)
+{
+  double v0 = tl.getParameter (name).getValue ();
+  double v1 = v0 > 0 ? v0 * 1.05 : 0.01;
+  bench::Chrono chrono;
+  for (size_t i = 0; i < nbEvaluations; ++i)
+  {
+    ParameterList pl;
+    pl.addParameter (Parameter (name, i % 2 ? v0 : v1));
+    tl.matchParametersValues (pl);
+    if (derivative)
+      tl.getFirstOrderDerivative (name);
+    else
+      tl.getValue ();
+  }
+  return static_cast<double>(nbEvaluations) / chrono.seconds ();
+}
+
+int main (int argc, char** argv)
+{
+  try
+  {
+    bench::Options options (argc, argv);
+    bench::Reporter reporter (options);
+    size_t nbEvaluations = options.getSize ("evaluations", 20);
+    unsigned int seed = static_cast<unsigned int>(options.getSize ("seed", 1));
+
+    for (const auto& workload : bench::getWorkloads (options))
+    {
+      if (workload.mixture || workload.nonHomogeneous)
+        continue;
+      bench::Setup setup (workload, seed);
+      auto sites = setup.simulate (seed);
+      unique_ptr<TreeTemplate<Node>> tree (TreeTemplateTools::parenthesisToTree (setup.newick));
+
+      bench::Chrono chrono;
+      DRHomogeneousTreeLikelihood tl (*tree, *sites, setup.model->clone (), setup.rateDistribution->clone (), true, false);
+      tl.initialize ();
+      double logLikelihood = -tl.getValue ();
+      double buildSeconds = chrono.seconds ();
+
+      ParameterList parameters = tl.getParameters ();
+      string modelParameter = setup.getModelParameterName (parameters);
+      string branchParameter = bench::Setup::getBranchLengthParameterName (parameters);
+
+      bench::Record record ("legacy_likelihood", workload);
+      record.set ("logLikelihood", logLikelihood)
+      .set ("buildSeconds", buildSeconds)
+      .set ("modelParameter", modelParameter)
+      .set ("modelUpdatesPerSecond", timeUpdates (tl, modelParameter, nbEvaluations, false))
+      .set ("branchParameter", branchParameter)
+      .set ("branchUpdatesPerSecond", timeUpdates (tl, branchParameter, nbEvaluations, false))
+      .set ("branchDerivativesPerSecond", timeUpdates (tl, branchParameter, nbEvaluations, true))
+      .setResources ();
+      reporter.write (record);
+    }
+  }
+  catch (Exception& ex)
+  {
+    cerr << ex.what () << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,126 @@
+//
+// File: bench_likelihood.cpp
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+/*
+ * Evaluation throughput of the dataflow likelihood
+ * (LikelihoodCalculationSingleProcess): construction and first
+ * evaluation, then alternated updates of a model parameter and of a
+ * branch length, and first order derivatives wrt a branch length.
+ *
+ * Options: --suite quick|full|custom (see BenchTools.h), --evaluations n,
+ * --threads n, --seed n, --output file.
+ */
+
+#include <Bpp/Phyl/Likelihood/DataFlow/LikelihoodCalculationSingleProcess.h>
+#include <Bpp/Phyl/Likelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
+
+#include "BenchTools.h"
+
+using namespace bpp;
+using namespace std;
+
+static double timeUpdates (SingleProcessPhyloLikelihood& llh, const string& name, size_t nbEvaluations, bool derivative)
+{
+  double v0 = llh.getParameter (name).getValue ();
+  double v1 = v0 > 0 ? v0 * 1.05 : 0.01;
+  bench::Chrono chrono;
+  for (size_t i = 0; i < nbEvaluations; ++i)
+  {
+    ParameterList pl;
+    pl.addParameter (Parameter (name, i % 2 ? v0 : v1));
+    llh.matchParametersValues (pl);
+    if (derivative)
+      llh.getFirstOrderDerivative (name);
+    else
+      llh.getValue ();
+  }
+  return static_cast<double>(nbEvaluations) / chrono.seconds ();
+}
+
+int main (int argc, char** argv)
+{
+  try
+  {
+    bench::Options options (argc, argv);
+    bench::Reporter reporter (options);
+    size_t nbEvaluations = options.getSize ("evaluations", 20);
+    size_t nbThreads = options.getSize ("threads", 1);
+    unsigned int seed = static_cast<unsigned int>(options.getSize ("seed", 1));
+
+    NodeTimings::enable (true);
+    for (const auto& workload : bench::getWorkloads (options))
+    {
+      bench::Setup setup (workload, seed);
+      auto sites = setup.simulate (seed);
+      NodeTimings::reset ();
+
+      bench::Chrono chrono;
+      Context context;
+      if (nbThreads > 1)
+        context.setNumberOfThreads (nbThreads);
+      auto lik = make_shared<LikelihoodCalculationSingleProcess>(context, *sites, *setup.process);
+      SingleProcessPhyloLikelihood llh (context, lik);
+      double logLikelihood = -llh.getValue ();
+      double buildSeconds = chrono.seconds ();
+
+      ParameterList parameters = llh.getParameters ();
+      string modelParameter = setup.getModelParameterName (parameters);
+      string branchParameter = bench::Setup::getBranchLengthParameterName (parameters);
+
+      bench::Record record ("dataflow_likelihood", workload);
+      record.set ("threads", nbThreads)
+      .set ("logLikelihood", logLikelihood)
+      .set ("buildSeconds", buildSeconds)
+      .set ("modelParameter", modelParameter)
+      .set ("modelUpdatesPerSecond", timeUpdates (llh, modelParameter, nbEvaluations, false))
+      .set ("branchParameter", branchParameter)
+      .set ("branchUpdatesPerSecond", timeUpdates (llh, branchParameter, nbEvaluations, false))
+      .set ("branchDerivativesPerSecond", timeUpdates (llh, branchParameter, nbEvaluations, true))
+      .setResources ();
+      reporter.write (record);
+    }
+  }
+  catch (Exception& ex)
+  {
+    cerr << ex.what () << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,95 @@
+//
+// File: bench_simulation.cpp
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+/*
+ * Simulation throughput: SimpleSubstitutionProcessSequenceSimulator on
+ * whole alignments, and SimpleSubstitutionProcessSiteSimulator with
+ * detailed substitution histories.
+ *
+ * Options: --suite quick|full|custom (see BenchTools.h),
+ * --detailed-sites n, --seed n, --output file.
+ */
+
+#include <Bpp/Phyl/Simulation/SimpleSubstitutionProcessSiteSimulator.h>
+
+#include "BenchTools.h"
+
+using namespace bpp;
+using namespace std;
+
+int main (int argc, char** argv)
+{
+  try
+  {
+    bench::Options options (argc, argv);
+    bench::Reporter reporter (options);
+    size_t nbDetailedSites = options.getSize ("detailed-sites", 1000);
+    unsigned int seed = static_cast<unsigned int>(options.getSize ("seed", 1));
+
+    for (const auto& workload : bench::getWorkloads (options))
+    {
+      bench::Setup setup (workload, seed);
+
+      bench::Chrono chrono;
+      auto sites = setup.simulate (seed);
+      double sitesPerSecond = static_cast<double>(sites->getNumberOfSites ()) / chrono.seconds ();
+
+      SimpleSubstitutionProcessSiteSimulator simulator (*setup.process);
+      chrono.restart ();
+      for (size_t i = 0; i < nbDetailedSites; ++i)
+      {
+        unique_ptr<SiteSimulationResult> result (simulator.dSimulateSite ());
+      }
+      double detailedSitesPerSecond = static_cast<double>(nbDetailedSites) / chrono.seconds ();
+
+      bench::Record record ("simulation", workload);
+      record.set ("sitesPerSecond", sitesPerSecond)
+      .set ("detailedSitesPerSecond", detailedSitesPerSecond)
+      .setResources ();
+      reporter.write (record);
+    }
+  }
+  catch (Exception& ex)
+  {
+    cerr << ex.what () << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,399 @@
+//
+// File: IndexedTreeFile.cpp
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Exceptions.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "IndexedTreeFile.h"
+
+using namespace bpp;
+using namespace std;
+
+namespace
+{
+/*
+ * Index file layout: header, then the offsets of the ends of the
+ * descriptions, all in native byte order.
+ */
+
+const char indexMagic[8] = {'B', 'P', 'P', 'T', 'R', 'I', 'D', 'X'};
+const uint32_t indexVersion = 1;
+const uint32_t byteOrderMark = 0x01020304;
+
+struct IndexHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint64_t fileSize;
+  uint64_t nbTrees;
+};
+}
+
+/******************************************************************************/
+
+/**
+ * @brief The reader parsing the descriptions.
+ */
+class IndexedTreeFile::Format
+{
+public:
+  virtual ~Format() {}
+
+  virtual ParenthesisParser getParser() const = 0;
+
+  virtual TreeTemplate<Node>* readTree(const char*& position, const char* end) const = 0;
+
+  virtual PhyloTree* readPhyloTree(const char*& position, const char* end) const = 0;
+};
+
+/******************************************************************************/
+
+template<class F>
+class IndexedTreeFile::FormatOf :
+  public IndexedTreeFile::Format
+{
+private:
+  F reader_;
+
+public:
+  FormatOf(const F& reader) : reader_(reader) {}
+
+  ParenthesisParser getParser() const { return reader_.getParser(); }
+
+  TreeTemplate<Node>* readTree(const char*& position, const char* end) const
+  {
+    return reader_.readTree(position, end);
+  }
+
+  PhyloTree* readPhyloTree(const char*& position, const char* end) const
+  {
+    return reader_.readPhyloTree(position, end);
+  }
+};
+
+/******************************************************************************/
+
+IndexedTreeFile::IndexedTreeFile(const string& path, const Newick& reader, const string& indexPath) :
+  path_(path),
+  format_(new FormatOf<Newick>(reader)),
+  data_(0),
+  size_(0),
+  buffer_(),
+  ends_()
+{
+  init_(indexPath);
+}
+
+IndexedTreeFile::IndexedTreeFile(const string& path, const Nhx& reader, const string& indexPath) :
+  path_(path),
+  format_(new FormatOf<Nhx>(reader)),
+  data_(0),
+  size_(0),
+  buffer_(),
+  ends_()
+{
+  init_(indexPath);
+}
+
+IndexedTreeFile::~IndexedTreeFile()
+{
+  unmap_();
+}
+
+/******************************************************************************/
+
+void IndexedTreeFile::init_(const string& indexPath)
+{
+  map_();
+  try
+  {
+    if (indexPath.empty())
+      buildIndex_();
+    else if (!loadIndex_(indexPath))
+    {
+      buildIndex_();
+      saveIndex(indexPath);
+    }
+  }
+  catch (...)
+  {
+    unmap_();
+    throw;
+  }
+}
+
+/******************************************************************************/
+
+void IndexedTreeFile::map_()
+{
+#if defined(_WIN32)
+  ifstream in(path_.c_str(), ios::in | ios::binary);
+  if (!in)
+    throw IOException("IndexedTreeFile: can not open file " + path_);
+  buffer_.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+#else
+  int fd = open(path_.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw IOException("IndexedTreeFile: can not open file " + path_);
+  struct stat info;
+  if (fstat(fd, &info) != 0)
+  {
+    close(fd);
+    throw IOException("IndexedTreeFile: can not read the size of file " + path_);
+  }
+  size_ = static_cast<size_t>(info.st_size);
+  if (size_ > 0)
+  {
+    void* data = mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+      close(fd);
+      size_ = 0;
+      throw IOException("IndexedTreeFile: can not map file " + path_);
+    }
+    data_ = static_cast<const char*>(data);
+  }
+  close(fd);
+#endif
+}
+
+/******************************************************************************/
+
+void IndexedTreeFile::unmap_()
+{
+#if !defined(_WIN32)
+  if (data_ && size_ > 0)
+    munmap(const_cast<char*>(data_), size_);
+#endif
+  data_ = 0;
+  size_ = 0;
+  buffer_.clear();
+}
+
+/******************************************************************************/
+
+void IndexedTreeFile::buildIndex_()
+{
+  ParenthesisParser parser = format_->getParser();
+  const char* end = data_ + size_;
+  const char* position = data_;
+  ends_.clear();
+  while (position != end)
+  {
+    const char* semi = parser.findEnd(position, end);
+    if (semi == end)
+      break;
+    position = semi + 1;
+    ends_.push_back(static_cast<size_t>(position - data_));
+  }
+}
+
+/******************************************************************************/
+
+bool IndexedTreeFile::loadIndex_(const string& indexPath)
+{
+  ifstream in(indexPath.c_str(), ios::in | ios::binary);
+  if (!in)
+    return false;
+  IndexHeader header;
+  in.read(reinterpret_cast<char*>(&header), sizeof(IndexHeader));
+  if (!in
+      || memcmp(header.magic, indexMagic, sizeof(indexMagic)) != 0
+      || header.version != indexVersion
+      || header.byteOrder != byteOrderMark
+      || header.fileSize != size_
+      || header.nbTrees > size_)
+    return false;
+  vector<uint64_t> ends(static_cast<size_t>(header.nbTrees));
+  in.read(reinterpret_cast<char*>(ends.data()), static_cast<streamsize>(ends.size() * sizeof(uint64_t)));
+  if (!in)
+    return false;
+  // Reject indices that do not fit the file:
+  for (size_t i = 0; i < ends.size(); ++i)
+  {
+    if (ends[i] == 0 || ends[i] > size_ || (i > 0 && ends[i] <= ends[i - 1]) || data_[ends[i] - 1] != ';')
+      return false;
+  }
+  ends_.assign(ends.begin(), ends.end());
+  return true;
+}
+
+/******************************************************************************/
+
+void IndexedTreeFile::saveIndex(const string& indexPath) const
+{
+  ofstream out(indexPath.c_str(), ios::out | ios::binary);
+  if (!out)
+    throw IOException("IndexedTreeFile::saveIndex: can not open file " + indexPath);
+  IndexHeader header;
+  memcpy(header.magic, indexMagic, sizeof(indexMagic));
+  header.version = indexVersion;
+  header.byteOrder = byteOrderMark;
+  header.fileSize = size_;
+  header.nbTrees = ends_.size();
+  out.write(reinterpret_cast<const char*>(&header), sizeof(IndexHeader));
+  vector<uint64_t> ends(ends_.begin(), ends_.end());
+  out.write(reinterpret_cast<const char*>(ends.data()), static_cast<streamsize>(ends.size() * sizeof(uint64_t)));
+  if (!out)
+    throw IOException("IndexedTreeFile::saveIndex: write error.");
+}
+
+/******************************************************************************/
+
+const char* IndexedTreeFile::begin_(size_t index) const
+{
+  return data_ + (index == 0 ? 0 : ends_[index - 1]);
+}
+
+/******************************************************************************/
+
+string IndexedTreeFile::getDescription(size_t index) const
+{
+  if (index >= ends_.size())
+    throw IndexOutOfBoundsException("IndexedTreeFile::getDescription().", index, 0, ends_.size() - 1);
+  const char* begin = begin_(index);
+  return string(begin, data_ + ends_[index]);
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* IndexedTreeFile::readTree(size_t index) const
+{
+  if (index >= ends_.size())
+    throw IndexOutOfBoundsException("IndexedTreeFile::readTree().", index, 0, ends_.size() - 1);
+  const char* position = begin_(index);
+  return format_->readTree(position, data_ + ends_[index]);
+}
+
+/******************************************************************************/
+
+PhyloTree* IndexedTreeFile::readPhyloTree(size_t index) const
+{
+  if (index >= ends_.size())
+    throw IndexOutOfBoundsException("IndexedTreeFile::readPhyloTree().", index, 0, ends_.size() - 1);
+  const char* position = begin_(index);
+  return format_->readPhyloTree(position, data_ + ends_[index]);
+}
+
+/******************************************************************************/
+
+template<class T, class Read>
+void IndexedTreeFile::readRange_(vector<T*>& trees, size_t burnin, size_t thinning, size_t nbThreads, Read read) const
+{
+  if (thinning == 0)
+    throw Exception("IndexedTreeFile::readTrees. Thinning must be positive.");
+  size_t nbRead = burnin < ends_.size() ? (ends_.size() - burnin + thinning - 1) / thinning : 0;
+  vector<T*> parsed(nbRead, 0);
+
+  atomic<size_t> next(0);
+  mutex errorMutex;
+  exception_ptr error;
+  auto parseTrees = [&]() {
+      for (size_t i = next++; i < nbRead; i = next++)
+      {
+        try
+        {
+          parsed[i] = read(burnin + i * thinning);
+        }
+        catch (...)
+        {
+          lock_guard<mutex> lock(errorMutex);
+          if (!error)
+            error = current_exception();
+          next = nbRead;
+        }
+      }
+    };
+
+  vector<thread> workers;
+  for (size_t t = 1; t < std::min(nbThreads, nbRead); t++)
+  {
+    workers.push_back(thread(parseTrees));
+  }
+  parseTrees();
+  for (auto& worker : workers)
+  {
+    worker.join();
+  }
+
+  if (error)
+  {
+    for (auto tree : parsed)
+    {
+      delete tree;
+    }
+    rethrow_exception(error);
+  }
+  trees.insert(trees.end(), parsed.begin(), parsed.end());
+}
+
+/******************************************************************************/
+
+void IndexedTreeFile::readTrees(vector<Tree*>& trees, size_t burnin, size_t thinning, size_t nbThreads) const
+{
+  readRange_(trees, burnin, thinning, nbThreads, [this](size_t index) { return readTree(index); });
+}
+
+/******************************************************************************/
+
+void IndexedTreeFile::readPhyloTrees(vector<PhyloTree*>& trees, size_t burnin, size_t thinning, size_t nbThreads) const
+{
+  readRange_(trees, burnin, thinning, nbThreads, [this](size_t index) { return readPhyloTree(index); });
+}
+
+/******************************************************************************/
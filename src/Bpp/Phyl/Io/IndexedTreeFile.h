@@ -0,0 +1,175 @@
+//
+// File: IndexedTreeFile.h
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef BPP_PHYL_IO_INDEXEDTREEFILE_H
+#define BPP_PHYL_IO_INDEXEDTREEFILE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../Tree/PhyloTree.h"
+#include "../Tree/TreeTemplate.h"
+#include "Newick.h"
+#include "Nhx.h"
+
+namespace bpp
+{
+/**
+ * @brief Random access to the trees of a large Newick or NHX file.
+ *
+ * The file is mapped in memory and scanned once to find the semicolons
+ * ending the tree descriptions. Trees are then parsed only on demand,
+ * by index or by ranges with a burn-in and a thinning, possibly over
+ * several threads, so that a thinned subset of a large posterior sample
+ * can be read without loading all its trees.
+ *
+ * The offsets of the descriptions can be saved in an index file, and
+ * read back instead of scanning the tree file again. An index is only
+ * used if it was built from a file of the same size.
+ *
+ * Trees are parsed with the options of the Newick or Nhx reader given
+ * to the constructor. Only plain tree files are supported, not Nexus.
+ *
+ * @see ParenthesisParser
+ */
+class IndexedTreeFile
+{
+private:
+  class Format;
+  template<class F> class FormatOf;
+
+  std::string path_;
+  std::unique_ptr<Format> format_;
+  const char* data_;
+  size_t size_;
+  // Copy of the file when it can not be mapped:
+  std::vector<char> buffer_;
+  // Offsets of the characters after the semicolons ending the descriptions:
+  std::vector<size_t> ends_;
+
+public:
+  /**
+   * @brief Open a tree file.
+   *
+   * @param path The tree file.
+   * @param reader The reader whose options are used to parse the trees.
+   * @param indexPath An index file, read if it matches the tree file,
+   * written otherwise. No index file is used if empty.
+   * @throw IOException If a file can not be read or written.
+   */
+  IndexedTreeFile(const std::string& path, const Newick& reader, const std::string& indexPath = "");
+
+  IndexedTreeFile(const std::string& path, const Nhx& reader, const std::string& indexPath = "");
+
+  IndexedTreeFile(const IndexedTreeFile&) = delete;
+  IndexedTreeFile& operator=(const IndexedTreeFile&) = delete;
+
+  virtual ~IndexedTreeFile();
+
+public:
+  const std::string& getPath() const { return path_; }
+
+  size_t getNumberOfTrees() const { return ends_.size(); }
+
+  /**
+   * @return The text of a tree description, with its ending semicolon.
+   * @throw IndexOutOfBoundsException If there is no such tree.
+   */
+  std::string getDescription(size_t index) const;
+
+  /**
+   * @brief Parse one tree.
+   *
+   * @param index The position of the tree in the file, starting from 0.
+   * @return A new tree, to be deleted by the caller.
+   * @throw IndexOutOfBoundsException If there is no such tree.
+   * @throw IOException If the description is not well formed.
+   */
+  TreeTemplate<Node>* readTree(size_t index) const;
+
+  PhyloTree* readPhyloTree(size_t index) const;
+
+  /**
+   * @brief Parse the trees burnin, burnin + thinning, burnin + 2 * thinning...
+   *
+   * The trees are appended to trees in the order of the file. They
+   * are distributed over nbThreads threads, each tree being parsed
+   * independently.
+   *
+   * @param trees The vector the new trees are appended to.
+   * @param burnin The number of trees to skip at the beginning of the file.
+   * @param thinning The step between two read trees.
+   * @param nbThreads The number of threads parsing the trees.
+   * @throw Exception If thinning is 0.
+   * @throw IOException If a description is not well formed. No tree is appended then.
+   */
+  void readTrees(std::vector<Tree*>& trees, size_t burnin = 0, size_t thinning = 1, size_t nbThreads = 1) const;
+
+  void readPhyloTrees(std::vector<PhyloTree*>& trees, size_t burnin = 0, size_t thinning = 1, size_t nbThreads = 1) const;
+
+  /**
+   * @brief Write the offsets of the descriptions to an index file.
+   *
+   * @throw IOException If the file can not be written.
+   */
+  void saveIndex(const std::string& indexPath) const;
+
+private:
+  void init_(const std::string& indexPath);
+
+  void map_();
+
+  void unmap_();
+
+  void buildIndex_();
+
+  /**
+   * @return false if the index file does not exist or does not match the tree file.
+   */
+  bool loadIndex_(const std::string& indexPath);
+
+  const char* begin_(size_t index) const;
+
+  template<class T, class Read>
+  void readRange_(std::vector<T*>& trees, size_t burnin, size_t thinning, size_t nbThreads, Read read) const;
+};
+} // end of namespace bpp.
+#endif // BPP_PHYL_IO_INDEXEDTREEFILE_H
@@ -40,7 +40,6 @@
 
 #include <Bpp/BppString.h>
 #include <Bpp/Numeric/Number.h>
-#include <Bpp/Text/NestedStringTokenizer.h>
 #include <Bpp/Text/StringTokenizer.h>
 #include <Bpp/Text/TextTools.h>
 #include <Bpp/Text/TextTools.h>
@@ -85,26 +84,13 @@ TreeTemplate<Node>* Newick::readTree(istream& in) const
     throw IOException ("Newick::read: failed to read from stream");
   }
 
-  // We concatenate all line in file till we reach the ending semi colon:
-  string temp, description;// Initialization
-  // Main loop : for all file lines
-  while (getline(in, temp, '\n'))
-  {
-    string::size_type index = temp.find(";");
-    if (index != string::npos)
-    {
-      description += temp.substr(0, index + 1);
-      break;
-    }
-    else
-      description += temp;
-  }
-
-  if (allowComments_)
-    description = TextTools::removeSubstrings(description, '[', ']');
-  if (TextTools::isEmpty(description))
+  // We read all characters till we reach the ending semi colon:
+  ParenthesisParser parser(allowComments_);
+  string description;
+  if (!parser.readDescription(in, description))
     throw IOException("Newick::read: no tree was found!");
-  return TreeTemplateTools::parenthesisToTree(description, useBootstrap_, bootstrapPropertyName_, false, verbose_);
+  const char* position = description.data();
+  return TreeTemplateTools::parenthesisToTree(parser, position, description.data() + description.size(), useBootstrap_, bootstrapPropertyName_, false, verbose_);
 }
 
 /*********************************************************************************/
@@ -117,26 +103,27 @@ PhyloTree* Newick::readPhyloTree(istream& in) const
     throw IOException ("Newick::readPhyloTree: failed to read from stream");
   }
 
-  // We concatenate all line in file till we reach the ending semi colon:
-  string temp, description;// Initialization
-  // Main loop : for all file lines
-  while (getline(in, temp, '\n'))
-  {
-    string::size_type index = temp.find(";");
-    if (index != string::npos)
-    {
-      description += temp.substr(0, index + 1);
-      break;
-    }
-    else
-      description += temp;
-  }
-
-  if (allowComments_)
-    description = TextTools::removeSubstrings(description, '[', ']');
-  if (TextTools::isEmpty(description))
+  // We read all characters till we reach the ending semi colon:
+  ParenthesisParser parser(allowComments_);
+  string description;
+  if (!parser.readDescription(in, description))
     throw IOException("Newick::read: no tree was found!");
-  return parenthesisToPhyloTree(description, useBootstrap_, bootstrapPropertyName_, false, verbose_);
+  const char* position = description.data();
+  return parenthesisToPhyloTree(parser, position, description.data() + description.size(), useBootstrap_, bootstrapPropertyName_, false, verbose_);
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* Newick::readTree(const char*& position, const char* end) const
+{
+  return TreeTemplateTools::parenthesisToTree(getParser(), position, end, useBootstrap_, bootstrapPropertyName_, false, verbose_);
+}
+
+/******************************************************************************/
+
+PhyloTree* Newick::readPhyloTree(const char*& position, const char* end) const
+{
+  return parenthesisToPhyloTree(getParser(), position, end, useBootstrap_, bootstrapPropertyName_, false, verbose_);
 }
 
 /******************************************************************************/
@@ -149,23 +136,13 @@ void Newick::readTrees(istream& in, vector<Tree*>& trees) const
     throw IOException ("Newick::readTrees(vector): failed to read from stream");
   }
 
-  // Main loop : for all file lines
-  string temp, description;// Initialization
-  string::size_type index;
-  // We concatenate all line in file till we reach the ending semi colon:
-  while (getline(in, temp, '\n'))
+  // Main loop : for all descriptions, each one being read once
+  ParenthesisParser parser(allowComments_);
+  string description;
+  while (parser.readDescription(in, description))
   {
-    index = temp.find(";");
-    if (index != string::npos)
-    {
-      description += temp.substr(0, index + 1);
-      if (allowComments_)
-        description = TextTools::removeSubstrings(description, '[', ']');
-      trees.push_back(TreeTemplateTools::parenthesisToTree(description, useBootstrap_, bootstrapPropertyName_, false, verbose_));
-      description = temp.substr(index + 1);
-    }
-    else
-      description += temp;
+    const char* position = description.data();
+    trees.push_back(TreeTemplateTools::parenthesisToTree(parser, position, description.data() + description.size(), useBootstrap_, bootstrapPropertyName_, false, verbose_));
   }
   // In case the file is empty, the method will not add any neww tree to the vector.
 }
@@ -180,23 +157,13 @@ void Newick::readPhyloTrees(istream& in, vector<PhyloTree*>& trees) const
     throw IOException ("Newick::readTrees(vector): failed to read from stream");
   }
 
-  // Main loop : for all file lines
-  string temp, description;// Initialization
-  string::size_type index;
-  // We concatenate all line in file till we reach the ending semi colon:
-  while (getline(in, temp, '\n'))
+  // Main loop : for all descriptions, each one being read once
+  ParenthesisParser parser(allowComments_);
+  string description;
+  while (parser.readDescription(in, description))
   {
-    index = temp.find(";");
-    if (index != string::npos)
-    {
-      description += temp.substr(0, index + 1);
-      if (allowComments_)
-        description = TextTools::removeSubstrings(description, '[', ']');
-      trees.push_back(parenthesisToPhyloTree(description, useBootstrap_, bootstrapPropertyName_, false, verbose_));
-      description = temp.substr(index + 1);
-    }
-    else
-      description += temp;
+    const char* position = description.data();
+    trees.push_back(parenthesisToPhyloTree(parser, position, description.data() + description.size(), useBootstrap_, bootstrapPropertyName_, false, verbose_));
   }
   // In case the file is empty, the method will not add any neww tree to the vector.
 }
@@ -266,106 +233,120 @@ IOTree::Element Newick::getElement(const string& elt) const
 
 /************************************************************/
 
-shared_ptr<PhyloNode>  Newick::parenthesisToNode(PhyloTree& tree, shared_ptr<PhyloNode>  father, const string& description, unsigned int& nodeCounter, bool bootstrap, const string& propertyName, bool withId, bool verbose) const
+namespace
 {
-//  cout << "NODE: " << description << endl;
-  IOTree::Element elt = getElement(description);
-
-  // New node:
-  std::shared_ptr<PhyloNode> node(new PhyloNode());
-
-  shared_ptr<PhyloBranch> branch(father ? new PhyloBranch() : 0);
-
-  if (father)
-  {
-    tree.createNode(father, node, branch);
-
-    if (!TextTools::isEmpty(elt.length))
-      branch->setLength(TextTools::toDouble(elt.length));
-  }
-  else
-    tree.createNode(node);
-
-  if (!TextTools::isEmpty(elt.annotation))
-  {
-    if (withId)
+/**
+ * @brief Build the nodes and branches of a PhyloTree from a ParenthesisParser.
+ */
+class PhyloNodeBuilder :
+  public ParenthesisParser::Handler
+{
+private:
+  PhyloTree& tree_;
+  bool bootstrap_;
+  const string& propertyName_;
+  bool withId_;
+  bool verbose_;
+  unsigned int nodeCounter_;
+  shared_ptr<PhyloNode> root_;
+  // Started and not complete nodes, with their branch to their father:
+  vector< pair<shared_ptr<PhyloNode>, shared_ptr<PhyloBranch> > > nodes_;
+
+public:
+  PhyloNodeBuilder(PhyloTree& tree, bool bootstrap, const string& propertyName, bool withId, bool verbose) :
+    tree_(tree),
+    bootstrap_(bootstrap),
+    propertyName_(propertyName),
+    withId_(withId),
+    verbose_(verbose),
+    nodeCounter_(0),
+    root_(),
+    nodes_()
+  {}
+
+public:
+  shared_ptr<PhyloNode> getRoot() const { return root_; }
+
+  void startNode()
+  {
+    shared_ptr<PhyloNode> node(new PhyloNode());
+    shared_ptr<PhyloBranch> branch;
+    if (nodes_.empty())
     {
-      auto id = static_cast<PhyloTree::NodeIndex>(TextTools::toInt(elt.annotation));
-      tree.setNodeIndex(node, id);
-      if (branch)
-        tree.setEdgeIndex(branch, id);
+      tree_.createNode(node);
+      root_ = node;
     }
     else
     {
-      if (bootstrap)
-      {
-        if (branch)
-          branch->setProperty("bootstrap", Number<double>(TextTools::toDouble(elt.annotation)));
-        // cout << "NODE: BOOTSTRAP: " << * elt.bootstrap << endl;
-      }
-      else
-      {
-        if (branch)
-          branch->setProperty(propertyName, BppString(elt.annotation));
-      }
+      branch.reset(new PhyloBranch());
+      tree_.createNode(nodes_.back().first, node, branch);
     }
+    nodes_.push_back(make_pair(node, branch));
   }
 
-  NestedStringTokenizer nt(elt.content, "(", ")", ",");
-  vector<string> elements;
-  while (nt.hasMoreToken())
+  void endNode(const string& label, const string& length, const string& annotation, bool isLeaf)
   {
-    elements.push_back(nt.nextToken());
-  }
+    shared_ptr<PhyloNode> node = nodes_.back().first;
+    shared_ptr<PhyloBranch> branch = nodes_.back().second;
+    nodes_.pop_back();
 
-  if (elt.isLeaf)
-  {
-    // This is a leaf:
-    string name = TextTools::removeSurroundingWhiteSpaces(elements[0]);
-    if (withId)
+    if (branch && !TextTools::isEmpty(length))
+      branch->setLength(TextTools::toDouble(length));
+
+    if (isLeaf)
     {
-      StringTokenizer st(name, "_", true, true);
-      ostringstream realName;
-      for (size_t i = 0; i < st.numberOfRemainingTokens() - 1; ++i)
+      if (withId_)
       {
-        if (i != 0)
+        StringTokenizer st(label, "_", true, true);
+        ostringstream realName;
+        for (size_t i = 0; i < st.numberOfRemainingTokens() - 1; ++i)
         {
-          realName << "_";
+          if (i != 0)
+          {
+            realName << "_";
+          }
+          realName << st.getToken(i);
         }
-        realName << st.getToken(i);
+        node->setName(realName.str());
+        auto id = static_cast<PhyloTree::NodeIndex>(TextTools::toInt(st.getToken(st.numberOfRemainingTokens() - 1)));
+        tree_.setNodeIndex(node, id);
+        if (branch)
+          tree_.setEdgeIndex(branch, id);
       }
-      node->setName(realName.str());
-      tree.setNodeIndex(node, static_cast<PhyloTree::NodeIndex>(
-                          TextTools::toInt(st.getToken(st.numberOfRemainingTokens() - 1))));
-      if (branch)
-        tree.setEdgeIndex(branch, static_cast<PhyloTree::NodeIndex>(
-                            TextTools::toInt(st.getToken(st.numberOfRemainingTokens() - 1))));
+      else
+        node->setName(label);
     }
-    else
-      node->setName(name);
-  }
-  else
-  {
-    // This is a node:
-    for (size_t i = 0; i < elements.size(); i++)
+    else if (!TextTools::isEmpty(label))
     {
-      //    cout << "NODE: SUBNODE: " << i << ", " << elements[i] << endl;
-      parenthesisToNode(tree, node, elements[i], nodeCounter, bootstrap, propertyName, withId, verbose);
+      if (withId_)
+      {
+        auto id = static_cast<PhyloTree::NodeIndex>(TextTools::toInt(label));
+        tree_.setNodeIndex(node, id);
+        if (branch)
+          tree_.setEdgeIndex(branch, id);
+      }
+      else if (branch)
+      {
+        if (bootstrap_)
+          branch->setProperty("bootstrap", Number<double>(TextTools::toDouble(label)));
+        else
+          branch->setProperty(propertyName_, BppString(label));
+      }
     }
-  }
 
-  if (!withId)
-  {
-    tree.setNodeIndex(node, nodeCounter);
-    if (branch)
-      tree.setEdgeIndex(branch, nodeCounter);
-  }
+    if (!withId_)
+    {
+      tree_.setNodeIndex(node, nodeCounter_);
+      if (branch)
+        tree_.setEdgeIndex(branch, nodeCounter_);
+    }
 
-  nodeCounter++;
-  if (verbose)
-    ApplicationTools::displayUnlimitedGauge(nodeCounter);
-  return node;
-}
+    nodeCounter_++;
+    if (verbose_)
+      ApplicationTools::displayUnlimitedGauge(nodeCounter_);
+  }
+};
+} // namespace
 
 /******************************************************************************/
 
@@ -374,12 +355,20 @@ PhyloTree* Newick::parenthesisToPhyloTree(const string& description, bool bootst
   string::size_type semi = description.rfind(';');
   if (semi == string::npos)
     throw Exception("Newick::parenthesisToTree(). Bad format: no semi-colon found.");
-  string content = description.substr(0, semi);
-  unsigned int nodeCounter = 0;
-  PhyloTree* tree = new PhyloTree();
-  shared_ptr<PhyloNode>  root = parenthesisToNode(*tree, 0, content, nodeCounter, bootstrap, propertyName, withId, verbose);
+  const char* position = description.data();
+  ParenthesisParser parser;
+  return parenthesisToPhyloTree(parser, position, description.data() + semi + 1, bootstrap, propertyName, withId, verbose);
+}
+
+/******************************************************************************/
+
+PhyloTree* Newick::parenthesisToPhyloTree(const ParenthesisParser& parser, const char*& position, const char* end, bool bootstrap, const string& propertyName, bool withId, bool verbose) const
+{
+  unique_ptr<PhyloTree> tree(new PhyloTree());
+  PhyloNodeBuilder builder(*tree, bootstrap, propertyName, withId, verbose);
+  position = parser.parse(position, end, builder);
 
-  tree->rootAt(root);
+  tree->rootAt(builder.getRoot());
 
   if (verbose)
   {
@@ -387,7 +376,7 @@ PhyloTree* Newick::parenthesisToPhyloTree(const string& description, bool bootst
     ApplicationTools::message->endLine();
   }
 
-  return tree;
+  return tree.release();
 }
 
 /**********************************************************/
@@ -42,6 +42,7 @@
 #define BPP_PHYL_IO_NEWICK_H
 
 
+#include "../Tree/ParenthesisParser.h"
 #include "../Tree/PhyloTree.h"
 #include "../Tree/TreeTemplate.h"
 #include "IoTree.h"
@@ -158,12 +159,35 @@ public:
 
   PhyloTree* readPhyloTree(std::istream& in) const;
 
-private:
-  std::shared_ptr<PhyloNode> parenthesisToNode(PhyloTree& tree, std::shared_ptr<PhyloNode> father, const std::string& description, unsigned int& nodeCounter, bool bootstrap, const std::string& propertyName, bool withId, bool verbose) const;
+  /**
+   * @brief Read the next tree of a buffer, with the options of this reader.
+   *
+   * @param position [in, out] The beginning of the description, set after its ending semicolon.
+   * @param end The end of the buffer.
+   * @throw IOException If the description is not well formed.
+   */
+  TreeTemplate<Node>* readTree(const char*& position, const char* end) const;
+
+  PhyloTree* readPhyloTree(const char*& position, const char* end) const;
+
+  /**
+   * @return A parser of the descriptions read by this reader.
+   */
+  ParenthesisParser getParser() const { return ParenthesisParser(allowComments_); }
 
 public:
   PhyloTree* parenthesisToPhyloTree(const std::string& description, bool bootstrap = false, const std::string& propertyName = "", bool withId = false, bool verbose = false) const;
 
+  /**
+   * @brief Parse the next tree of a buffer, in a single pass.
+   *
+   * @param parser The parser to use.
+   * @param position [in, out] The beginning of the description, set after its ending semicolon.
+   * @param end The end of the buffer.
+   * @see TreeTemplateTools::parenthesisToTree(const ParenthesisParser&, const char*&, const char*, bool, const std::string&, bool, bool)
+   */
+  PhyloTree* parenthesisToPhyloTree(const ParenthesisParser& parser, const char*& position, const char* end, bool bootstrap = false, const std::string& propertyName = "", bool withId = false, bool verbose = false) const;
+
 
 /** @} */
 
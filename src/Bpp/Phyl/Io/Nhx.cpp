@@ -44,6 +44,7 @@
 #include "../Tree/PhyloNode.h"
 #include "../Tree/Tree.h"
 #include "../Tree/TreeTemplate.h"
+#include "../Tree/TreeTemplateTools.h"
 #include "Nhx.h"
 
 // From bpp-core:
@@ -65,8 +66,7 @@ using namespace std;
 
 Nhx::Nhx(bool useTagsAsPptNames) :
   supportedProperties_(),
-  useTagsAsPropertyNames_(useTagsAsPptNames),
-  hasIds_(false)
+  useTagsAsPropertyNames_(useTagsAsPptNames)
 {
   registerProperty(Property("Gene name", "GN", false, 0));
   registerProperty(Property("Sequence accession", "AC", false, 0));
@@ -113,25 +113,13 @@ TreeTemplate<Node>* Nhx::readTree(istream& in) const
     throw IOException ("Nhx ::read: failed to read from stream");
   }
 
-  // We concatenate all line in file till we reach the ending semi colon:
-  string temp, description;// Initialization
-  // Main loop : for all file lines
-  while (!in.eof())
-  {
-    getline(in, temp, '\n');  // Copy current line in temporary string
-    string::size_type index = temp.find(";");
-    if (index != string::npos)
-    {
-      description += temp.substr(0, index + 1);
-      break;
-    }
-    else
-      description += temp;
-  }
-  vector<string> beginnings, endings;
-  beginnings.push_back("[&&NHX:");
-  description = TextTools::removeSubstrings(description, '[', ']', beginnings, endings);
-  return parenthesisToTree(description);
+  // We read all characters till we reach the ending semi colon:
+  ParenthesisParser parser(true, true);
+  string description;
+  if (!parser.readDescription(in, description))
+    throw IOException("Nhx::read: no tree was found!");
+  const char* position = description.data();
+  return parenthesisToTree(parser, position, description.data() + description.size());
 }
 
 /******************************************************************************/
@@ -144,25 +132,27 @@ PhyloTree* Nhx::readPhyloTree(istream& in) const
     throw IOException ("Nhx ::read: failed to read from stream");
   }
 
-  // We concatenate all line in file till we reach the ending semi colon:
-  string temp, description;// Initialization
-  // Main loop : for all file lines
-  while (!in.eof())
-  {
-    getline(in, temp, '\n');  // Copy current line in temporary string
-    string::size_type index = temp.find(";");
-    if (index != string::npos)
-    {
-      description += temp.substr(0, index + 1);
-      break;
-    }
-    else
-      description += temp;
-  }
-  vector<string> beginnings, endings;
-  beginnings.push_back("[&&NHX:");
-  description = TextTools::removeSubstrings(description, '[', ']', beginnings, endings);
-  return parenthesisToPhyloTree(description);
+  // We read all characters till we reach the ending semi colon:
+  ParenthesisParser parser(true, true);
+  string description;
+  if (!parser.readDescription(in, description))
+    throw IOException("Nhx::read: no tree was found!");
+  const char* position = description.data();
+  return parenthesisToPhyloTree(parser, position, description.data() + description.size());
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* Nhx::readTree(const char*& position, const char* end) const
+{
+  return parenthesisToTree(getParser(), position, end);
+}
+
+/******************************************************************************/
+
+PhyloTree* Nhx::readPhyloTree(const char*& position, const char* end) const
+{
+  return parenthesisToPhyloTree(getParser(), position, end);
 }
 
 /******************************************************************************/
@@ -175,28 +165,13 @@ void Nhx::readTrees(istream& in, vector<Tree*>& trees) const
     throw IOException ("Nhx::read: failed to read from stream");
   }
 
-  // Main loop : for all file lines
-  string temp, description;// Initialization
-  string::size_type index;
-  vector<string > beginnings, endings;
-  beginnings.push_back("[&&NHX:");
-  while (!in.eof())
+  // Main loop : for all descriptions, each one being read once
+  ParenthesisParser parser(true, true);
+  string description;
+  while (parser.readDescription(in, description))
   {
-    // We concatenate all line in file till we reach the ending semi colon:
-    while (!in.eof())
-    {
-      getline(in, temp, '\n');  // Copy current line in temporary string
-      index = temp.find(";");
-      if (index != string::npos)
-      {
-        description += temp.substr(0, index + 1);
-        description = TextTools::removeSubstrings(description, '[', ']', beginnings, endings);
-        trees.push_back(parenthesisToTree(description));
-        description = temp.substr(index + 1);
-      }
-      else
-        description += temp;
-    }
+    const char* position = description.data();
+    trees.push_back(parenthesisToTree(parser, position, description.data() + description.size()));
   }
 }
 
@@ -210,28 +185,13 @@ void Nhx::readPhyloTrees(istream& in, vector<PhyloTree*>& trees) const
     throw IOException ("Nhx::read: failed to read from stream");
   }
 
-  // Main loop : for all file lines
-  string temp, description;// Initialization
-  string::size_type index;
-  vector<string > beginnings, endings;
-  beginnings.push_back("[&&NHX:");
-  while (!in.eof())
+  // Main loop : for all descriptions, each one being read once
+  ParenthesisParser parser(true, true);
+  string description;
+  while (parser.readDescription(in, description))
   {
-    // We concatenate all line in file till we reach the ending semi colon:
-    while (!in.eof())
-    {
-      getline(in, temp, '\n');  // Copy current line in temporary string
-      index = temp.find(";");
-      if (index != string::npos)
-      {
-        description += temp.substr(0, index + 1);
-        description = TextTools::removeSubstrings(description, '[', ']', beginnings, endings);
-        trees.push_back(parenthesisToPhyloTree(description));
-        description = temp.substr(index + 1);
-      }
-      else
-        description += temp;
-    }
+    const char* position = description.data();
+    trees.push_back(parenthesisToPhyloTree(parser, position, description.data() + description.size()));
   }
 }
 
@@ -321,146 +281,207 @@ IOTree::Element Nhx::getElement(const string& elt) const
 
 /******************************************************************************/
 
-
-Node* Nhx::parenthesisToNode(const string& description) const
+/**
+ * @brief Build the nodes of a TreeTemplate from a ParenthesisParser.
+ */
+class Nhx::NodeBuilder :
+  public ParenthesisParser::Handler
 {
-  // cout << "NODE: " << description << endl;
-  Element elt = getElement(description);
+private:
+  const Nhx& nhx_;
+  Node* root_;
+  std::vector<Node*> nodes_; // Started and not complete.
+  size_t nbWithId_;
+  size_t nbWithoutId_;
+
+public:
+  NodeBuilder(const Nhx& nhx) :
+    nhx_(nhx),
+    root_(0),
+    nodes_(),
+    nbWithId_(0),
+    nbWithoutId_(0)
+  {}
+
+  ~NodeBuilder()
+  {
+    // Only if the parsing failed:
+    if (root_)
+    {
+      TreeTemplateTools::deleteSubtree(root_);
+      delete root_;
+    }
+  }
+
+  NodeBuilder(const NodeBuilder&) = delete;
+  NodeBuilder& operator=(const NodeBuilder&) = delete;
+
+public:
+  bool hasIds() const { return nbWithId_ > 0; }
 
-  // New node:
-  Node* node = new Node();
-  if (!TextTools::isEmpty(elt.length))
+  Node* release()
   {
-    node->setDistanceToFather(TextTools::toDouble(elt.length));
+    if (nbWithId_ > 0 && nbWithoutId_ > 0)
+      throw Exception("Nhx::parenthesisToTree. At least one node is missing an id (ND tag).");
+    Node* root = root_;
+    root_ = 0;
+    return root;
   }
-  if (!TextTools::isEmpty(elt.annotation))
+
+  void startNode()
   {
-    bool hasId = setNodeProperties(*node, elt.annotation);
-    hasIds_ |= hasId;
-    if (hasIds_ && !hasId)
-      throw Exception("Nhx::parenthesisToNode. At least one node is missing an id (ND tag).");
+    Node* node = new Node();
+    if (nodes_.empty())
+      root_ = node;
+    else
+      nodes_.back()->addSon(node);
+    nodes_.push_back(node);
   }
 
-  NestedStringTokenizer nt(elt.content, "(", ")", ",");
-  vector<string> elements;
-  while (nt.hasMoreToken())
+  void endNode(const string& label, const string& length, const string& annotation, bool isLeaf)
   {
-    elements.push_back(nt.nextToken());
+    Node* node = nodes_.back();
+    nodes_.pop_back();
+    if (!TextTools::isEmpty(length))
+    {
+      node->setDistanceToFather(TextTools::toDouble(length));
+    }
+    if (!TextTools::isEmpty(annotation))
+    {
+      bool hasId = nhx_.setNodeProperties(*node, annotation);
+      (hasId ? nbWithId_ : nbWithoutId_)++;
+    }
+    if (isLeaf)
+    {
+      node->setName(label);
+    }
   }
-  if (elt.isLeaf)
-  {
-    // This is a leaf:
-    string name = TextTools::removeSurroundingWhiteSpaces(elements[0]);
-    node->setName(name);
+};
+
+/******************************************************************************/
+
+/**
+ * @brief Build the nodes and branches of a PhyloTree from a ParenthesisParser.
+ */
+class Nhx::PhyloNodeBuilder :
+  public ParenthesisParser::Handler
+{
+private:
+  const Nhx& nhx_;
+  PhyloTree& tree_;
+  shared_ptr<PhyloNode> root_;
+  // Started and not complete nodes, with their branch to their father:
+  std::vector< pair<shared_ptr<PhyloNode>, shared_ptr<PhyloBranch> > > nodes_;
+  bool hasIds_;
+
+public:
+  PhyloNodeBuilder(const Nhx& nhx, PhyloTree& tree) :
+    nhx_(nhx),
+    tree_(tree),
+    root_(),
+    nodes_(),
+    hasIds_(false)
+  {}
+
+public:
+  shared_ptr<PhyloNode> getRoot() const { return root_; }
+
+  bool hasIds() const { return hasIds_; }
+
+  void startNode()
+  {
+    shared_ptr<PhyloNode> node(new PhyloNode());
+    shared_ptr<PhyloBranch> branch;
+    if (nodes_.empty())
+    {
+      tree_.createNode(node);
+      root_ = node;
+    }
+    else
+    {
+      branch.reset(new PhyloBranch());
+      tree_.createNode(nodes_.back().first, node, branch);
+    }
+    nodes_.push_back(make_pair(node, branch));
   }
-  else
+
+  void endNode(const string& label, const string& length, const string& annotation, bool isLeaf)
   {
-    // This is a node:
-    for (size_t i = 0; i < elements.size(); ++i)
+    shared_ptr<PhyloNode> node = nodes_.back().first;
+    shared_ptr<PhyloBranch> branch = nodes_.back().second;
+    nodes_.pop_back();
+    if (branch && !TextTools::isEmpty(length))
+    {
+      branch->setLength(TextTools::toDouble(length));
+    }
+    if (!TextTools::isEmpty(annotation))
+    {
+      hasIds_ |= nhx_.setNodeProperties(tree_, node, annotation);
+    }
+    if (isLeaf)
     {
-      // cout << "NODE: SUBNODE: " << i << ", " << elements[i] << endl;
-      Node* son = parenthesisToNode(elements[i]);
-      node->addSon(son);
+      node->setName(label);
     }
   }
-  return node;
-}
+};
 
 /******************************************************************************/
 
 TreeTemplate<Node>* Nhx::parenthesisToTree(const string& description) const
 {
-  hasIds_ = false;
   string::size_type semi = description.rfind(';');
   if (semi == string::npos)
     throw Exception("Nhx::parenthesisToTree(). Bad format: no semi-colon found.");
-  string content = description.substr(0, semi);
-  Node* node = parenthesisToNode(content);
-  TreeTemplate<Node>* tree = new TreeTemplate<Node>();
-  tree->setRootNode(node);
-  if (!hasIds_)
-  {
-    tree->resetNodesId();
-  }
-  return tree;
+  const char* position = description.data();
+  ParenthesisParser parser(true, true);
+  return parenthesisToTree(parser, position, description.data() + semi + 1);
 }
 
 /******************************************************************************/
 
-shared_ptr<PhyloNode>  Nhx::parenthesisToNode(PhyloTree& tree, shared_ptr<PhyloNode>  father, const string& description) const
+TreeTemplate<Node>* Nhx::parenthesisToTree(const ParenthesisParser& parser, const char*& position, const char* end) const
 {
-  IOTree::Element elt = getElement(description);
-
-  // New node:
-  shared_ptr<PhyloNode>  node(new PhyloNode());
-
-  if (father)
-  {
-    shared_ptr<PhyloBranch> branch(new PhyloBranch());
-
-    tree.createNode(father, node, branch);
-
-    if (!TextTools::isEmpty(elt.length))
-    {
-      branch->setLength(TextTools::toDouble(elt.length));
-    }
-  }
-  else
-    tree.createNode(node);
-
-  if (!TextTools::isEmpty(elt.annotation))
-  {
-    bool hasId = setNodeProperties(tree, node, elt.annotation);
-    hasIds_ |= hasId;
-  }
-
-  NestedStringTokenizer nt(elt.content, "(", ")", ",");
-  vector<string> elements;
-  while (nt.hasMoreToken())
-  {
-    elements.push_back(nt.nextToken());
-  }
-
-  if (elt.isLeaf)
-  {
-    // This is a leaf:
-    string name = TextTools::removeSurroundingWhiteSpaces(elements[0]);
-    node->setName(name);
-  }
-  else
+  NodeBuilder builder(*this);
+  position = parser.parse(position, end, builder);
+  bool hasIds = builder.hasIds();
+  Node* root = builder.release();
+  TreeTemplate<Node>* tree = new TreeTemplate<Node>();
+  tree->setRootNode(root);
+  if (!hasIds)
   {
-    // This is a node:
-    for (size_t i = 0; i < elements.size(); ++i)
-    {
-      parenthesisToNode(tree, node, elements[i]);
-    }
+    tree->resetNodesId();
   }
-
-  return node;
+  return tree;
 }
 
 /******************************************************************************/
 
 PhyloTree* Nhx::parenthesisToPhyloTree(const string& description) const
 {
-  hasIds_ = false;
   string::size_type semi = description.rfind(';');
   if (semi == string::npos)
     throw Exception("Nhx::parenthesisToPhyloTree(). Bad format: no semi-colon found.");
-  string content = description.substr(0, semi);
-  PhyloTree* tree = new PhyloTree();
+  const char* position = description.data();
+  ParenthesisParser parser(true, true);
+  return parenthesisToPhyloTree(parser, position, description.data() + semi + 1);
+}
+
+/******************************************************************************/
 
-  shared_ptr<PhyloNode> root = parenthesisToNode(*tree, 0, content);
+PhyloTree* Nhx::parenthesisToPhyloTree(const ParenthesisParser& parser, const char*& position, const char* end) const
+{
+  unique_ptr<PhyloTree> tree(new PhyloTree());
+  PhyloNodeBuilder builder(*this, *tree);
+  position = parser.parse(position, end, builder);
 
-  tree->rootAt(root);
+  tree->rootAt(builder.getRoot());
 
-  if (!hasIds_)
+  if (!builder.hasIds())
     tree->resetNodesId();
   else
     checkNodesId_(*tree);
 
-  Vuint vid = tree->getAllNodesIndexes();
-  return tree;
+  return tree.release();
 }
 
 /******************************************************************************/
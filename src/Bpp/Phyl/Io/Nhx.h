@@ -42,6 +42,7 @@
 #define BPP_PHYL_IO_NHX_H
 
 
+#include "../Tree/ParenthesisParser.h"
 #include "../Tree/PhyloTree.h"
 #include "../Tree/TreeTemplate.h"
 #include "IoTree.h"
@@ -130,7 +131,6 @@ public:
 private:
   std::set<Property> supportedProperties_;
   bool useTagsAsPropertyNames_;
-  mutable bool hasIds_;
 
 public:
   /**
@@ -172,6 +172,22 @@ public:
 
   PhyloTree* readPhyloTree(std::istream& in) const;
 
+  /**
+   * @brief Read the next tree of a buffer, with the options of this reader.
+   *
+   * @param position [in, out] The beginning of the description, set after its ending semicolon.
+   * @param end The end of the buffer.
+   * @throw IOException If the description is not well formed.
+   */
+  TreeTemplate<Node>* readTree(const char*& position, const char* end) const;
+
+  PhyloTree* readPhyloTree(const char*& position, const char* end) const;
+
+  /**
+   * @return A parser of the descriptions read by this reader.
+   */
+  ParenthesisParser getParser() const { return ParenthesisParser(true, true); }
+
   /** @} */
 
   /**
@@ -247,6 +263,18 @@ public:
 
   PhyloTree* parenthesisToPhyloTree(const std::string& description) const;
 
+  /**
+   * @brief Parse the next tree of a buffer, in a single pass.
+   *
+   * @param parser The parser to use, which must read NHX annotations.
+   * @param position [in, out] The beginning of the description, set after its ending semicolon.
+   * @param end The end of the buffer.
+   * @see ParenthesisParser
+   */
+  TreeTemplate<Node>* parenthesisToTree(const ParenthesisParser& parser, const char*& position, const char* end) const;
+
+  PhyloTree* parenthesisToPhyloTree(const ParenthesisParser& parser, const char*& position, const char* end) const;
+
   std::string treeToParenthesis(const TreeTemplate<Node>& tree) const;
 
   std::string treeToParenthesis(const PhyloTree& tree) const;
@@ -301,9 +329,8 @@ protected:
   IOTree::Element getElement(const std::string& elt) const;
 
 private:
-  Node* parenthesisToNode(const std::string& description) const;
-
-  std::shared_ptr<PhyloNode> parenthesisToNode(PhyloTree& tree, std::shared_ptr<PhyloNode> father, const std::string& description) const;
+  class NodeBuilder;
+  class PhyloNodeBuilder;
 
 public:
   std::string propertiesToParenthesis(const Node& node) const;
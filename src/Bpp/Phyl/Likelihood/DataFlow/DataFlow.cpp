@@ -41,18 +41,24 @@
 
 #include <Bpp/Exceptions.h>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <fstream> // debug
 #include <functional> // std::hash
 #include <iomanip>
 #include <iostream> // debug
+#include <mutex>
 #include <ostream> // debug
 #include <regex>
-#include <stack> // invalidate/compute recursively + debug
+#include <stack> // isTransitivelyDependentOn + debug
 #include <type_traits> // DotOptions flags
 #include <typeinfo>
 #include <unordered_set> // debug
 
 #include "DataFlow.h"
+#include "DataFlowScheduler.h"
 
 /* std::type_info::name() returns a "mangled" type name, not very readable.
  * Compilers can optionally provide an ABI header cxxabi.h.
@@ -174,8 +180,16 @@ Node_DF::Node_DF (NodeRefVec&& dependenciesArg) : dependencyNodes_ (std::move (d
   }
 }
 
+namespace
+{
+// Marks of the graph walks (see Node_DF::collectInvalidNodes_).
+std::atomic<std::uint64_t> visitEpochs{0};
+}
+
 Node_DF::~Node_DF ()
 {
+  if (timed_)
+    NodeTimings::erase (*this);
   for (auto& n : dependencyNodes_)
   {
     if (n)
@@ -202,6 +216,19 @@ std::string Node_DF::debugInfo () const { return {}; }
 
 bool Node_DF::hasNumericalProperty (NumericalProperty) const { return false; }
 
+bool Node_DF::isThreadSafe () const { return true; }
+
+double Node_DF::estimatedFlops () const
+{
+  return double(storageSize () / sizeof(double)) * double(nbDependencies ());
+}
+
+std::size_t Node_DF::storageSize () const { return 0; }
+
+void Node_DF::releaseStorage_ () {}
+
+void Node_DF::restoreStorage_ () {}
+
 bool Node_DF::compareAdditionalArguments (const Node_DF&) const { return false; }
 std::size_t Node_DF::hashAdditionalArguments () const { return 0; }
 
@@ -221,53 +248,151 @@ void Node_DF::computeRecursively ()
   if (isValid ())
     return;
 
-  // Discover then recompute needed nodes
-  std::stack<Node_DF*> nodesToVisit;
-  std::stack<Node_DF*> nodesToRecompute;
-  nodesToVisit.push (this);
-  while (!nodesToVisit.empty ())
+  // Parallel evaluation, unless already inside a parallel computation
+  if (scheduler_ && !DataFlowScheduler::isWorkerThread ())
   {
-    auto* n = nodesToVisit.top ();
-    nodesToVisit.pop ();
-    if (!n->isValid ())
-    {
-      nodesToRecompute.push (n);
-      for (auto& dep : n->dependencies ())
-      {
-        if (dep)
-          nodesToVisit.push (dep.get ());
-      }
-    }
+    scheduler_->computeRecursively (*this);
+    return;
   }
-  while (!nodesToRecompute.empty ())
+
+  // Discover then recompute needed nodes, dependencies first
+  std::vector<Node_DF*> nodesToRecompute;
+  collectInvalidNodes_ (nodesToRecompute);
+
+  std::unordered_set<const Node_DF*> pending; // Only with a memory budget
+  if (memoryBudget_)
+    pending.insert (nodesToRecompute.begin (), nodesToRecompute.end ());
+
+  for (auto* n : nodesToRecompute)
   {
-    auto* n = nodesToRecompute.top ();
-    nodesToRecompute.pop ();
     if (!n->isValid())
     {
-      n->compute ();
+      n->runCompute_ ();
       n->makeValid ();
+      if (memoryBudget_)
+        n->releaseConsumedDependencies_ (pending);
     }
   }
 }
 
+bool Node_DF::claimVisit_ (std::uint64_t epoch) noexcept
+{
+  // A concurrent walk may overwrite the mark: the node is then visited
+  // again, and listed twice, which is harmless as listed nodes are only
+  // computed if still invalid.
+  auto previous = visitEpoch_.load (std::memory_order_relaxed);
+  while (previous != epoch)
+  {
+    if (visitEpoch_.compare_exchange_weak (previous, epoch, std::memory_order_relaxed))
+      return true;
+  }
+  return false;
+}
+
+void Node_DF::collectInvalidNodes_ (std::vector<Node_DF*>& nodes)
+{
+  // Depth first post order walk of the invalid nodes. Nodes reachable
+  // from several paths (shared sub-expressions) are visited once,
+  // thanks to the epoch mark of this walk.
+  const auto epoch = visitEpochs.fetch_add (1) + 1;
+  std::vector<std::pair<Node_DF*, std::size_t> > path; // node, next dependency to visit
+  visitEpoch_.store (epoch, std::memory_order_relaxed);
+  path.emplace_back (this, 0);
+  while (!path.empty ())
+  {
+    auto* n = path.back ().first;
+    auto& next = path.back ().second;
+    if (next < n->dependencyNodes_.size ())
+    {
+      auto* dep = n->dependencyNodes_[next++].get ();
+      if (dep && !dep->isValid () && dep->claimVisit_ (epoch))
+        path.emplace_back (dep, 0);
+    }
+    else
+    {
+      nodes.push_back (n);
+      path.pop_back ();
+    }
+  }
+}
+
+bool Node_DF::releaseStorage ()
+{
+  if (!isValid () || dependencyNodes_.empty ())
+    return false;
+  const auto nbBytes = storageSize ();
+  if (nbBytes == 0)
+    return false;
+
+  releaseStorage_ ();
+  makeInvalid ();
+  storageReleased_ = true;
+  if (memoryBudget_)
+    memoryBudget_->update (nbBytes, 0);
+  return true;
+}
+
+void Node_DF::releaseConsumedDependencies_ (const std::unordered_set<const Node_DF*>& pending)
+{
+  for (auto& dep : dependencyNodes_)
+  {
+    if (!memoryBudget_->isExceeded ())
+      return;
+    if (!dep || !dep->isValid () || dep->storageSize () == 0)
+      continue;
+
+    // Still needed by this evaluation, or not recomputable in one
+    // step from stored values.
+    auto isReleasedOrPending = [&pending](const Node_DF* n) {
+        return n && (n->storageReleased_ || (!n->isValid () && pending.count (n)));
+      };
+    if (std::any_of (dep->dependentNodes_.begin (), dep->dependentNodes_.end (), isReleasedOrPending))
+      continue;
+    if (std::any_of (dep->dependencyNodes_.begin (), dep->dependencyNodes_.end (),
+                     [](const NodeRef& n) { return n && n->storageReleased_; }))
+      continue;
+
+    dep->releaseStorage ();
+  }
+}
+
+void Node_DF::runCompute_ ()
+{
+  const auto oldBytes = memoryBudget_ ? storageSize () : 0;
+  if (storageReleased_)
+  {
+    restoreStorage_ ();
+    storageReleased_ = false;
+  }
+
+  if (!NodeTimings::isEnabled ())
+    compute ();
+  else
+  {
+    auto start = std::chrono::steady_clock::now ();
+    compute ();
+    NodeTimings::record (*this, std::chrono::duration<double>(std::chrono::steady_clock::now () - start).count ());
+    timed_ = true;
+  }
+
+  if (memoryBudget_)
+    memoryBudget_->update (oldBytes, storageSize ());
+}
+
 void Node_DF::invalidateRecursively () noexcept
 {
-  if (!isValid ())
+  // A released node is invalid, but its dependents may be valid.
+  if (!isValid () && !storageReleased_)
     return;
-  std::stack<Node_DF*> nodesToInvalidate;
-  nodesToInvalidate.push (this);
+  std::vector<Node_DF*> nodesToInvalidate{this};
   while (!nodesToInvalidate.empty ())
   {
-    auto* n = nodesToInvalidate.top ();
-    nodesToInvalidate.pop ();
-    if (n->isValid ())
+    auto* n = nodesToInvalidate.back ();
+    nodesToInvalidate.pop_back ();
+    if (n->isValid () || n->storageReleased_)
     {
       n->makeInvalid ();
-      for (auto* dependent : n->dependentNodes_)
-      {
-        nodesToInvalidate.push (dependent);
-      }
+      nodesToInvalidate.insert (nodesToInvalidate.end (), n->dependentNodes_.begin (), n->dependentNodes_.end ());
     }
   }
 }
@@ -283,6 +408,152 @@ void Node_DF::unregisterNode (const Node_DF* n)
                          dependentNodes_.end ());
 }
 
+/*****************************************************************************
+ * NodeTimings.
+ */
+namespace
+{
+std::atomic<bool> nodeTimingsEnabled{false};
+std::mutex nodeTimingsMutex;
+std::map<const Node_DF*, NodeTimings::Entry> nodeTimingsNodeEntries;
+
+void addToEntry (NodeTimings::Entry& entry, double seconds, double flops, double bytes)
+{
+  entry.nbComputations++;
+  entry.seconds += seconds;
+  entry.flops += flops;
+  entry.bytes += bytes;
+}
+
+void addToEntry (NodeTimings::Entry& entry, const NodeTimings::Entry& other)
+{
+  entry.nbComputations += other.nbComputations;
+  entry.seconds += other.seconds;
+  entry.flops += other.flops;
+  entry.bytes += other.bytes;
+}
+
+// JSON string, with the needed escapes.
+std::string jsonQuote (const std::string& s)
+{
+  std::string result = "\"";
+  for (const char c : s)
+  {
+    if (c == '"' || c == '\\')
+      result.push_back ('\\');
+    result.push_back (c);
+  }
+  return result + "\"";
+}
+
+void writeJsonEntry (std::ostream& os, const NodeTimings::Entry& entry)
+{
+  os << "\"computations\":" << entry.nbComputations << ",\"seconds\":" << entry.seconds
+     << ",\"flops\":" << entry.flops << ",\"bytes\":" << entry.bytes;
+}
+}
+
+static std::string dotIdentifier (const Node_DF& node);
+
+void NodeTimings::enable (bool yn)
+{
+  nodeTimingsEnabled.store (yn);
+}
+
+bool NodeTimings::isEnabled () noexcept
+{
+  return nodeTimingsEnabled.load (std::memory_order_relaxed);
+}
+
+void NodeTimings::reset ()
+{
+  std::lock_guard<std::mutex> lock (nodeTimingsMutex);
+  nodeTimingsNodeEntries.clear ();
+}
+
+std::map<std::string, NodeTimings::Entry> NodeTimings::getEntries ()
+{
+  std::map<std::string, Entry> entries;
+  for (const auto& nodeEntry : getNodeEntries ())
+  {
+    addToEntry (entries[nodeEntry.second.description], nodeEntry.second.entry);
+  }
+  return entries;
+}
+
+std::map<const Node_DF*, NodeTimings::NodeEntry> NodeTimings::getNodeEntries ()
+{
+  std::map<const Node_DF*, NodeEntry> nodeEntries;
+  for (const auto& entry : getNodeEntriesOnly ())
+  {
+    nodeEntries.emplace (entry.first, NodeEntry{entry.first->description (), entry.second});
+  }
+  return nodeEntries;
+}
+
+std::map<const Node_DF*, NodeTimings::Entry> NodeTimings::getNodeEntriesOnly ()
+{
+  std::lock_guard<std::mutex> lock (nodeTimingsMutex);
+  return nodeTimingsNodeEntries;
+}
+
+void NodeTimings::erase (const Node_DF& node)
+{
+  std::lock_guard<std::mutex> lock (nodeTimingsMutex);
+  nodeTimingsNodeEntries.erase (&node);
+}
+
+void NodeTimings::record (const Node_DF& node, double seconds)
+{
+  const double flops = node.estimatedFlops ();
+  double bytes = double(node.storageSize ());
+  for (const auto& dep : node.dependencies ())
+  {
+    if (dep)
+      bytes += double(dep->storageSize ());
+  }
+
+  std::lock_guard<std::mutex> lock (nodeTimingsMutex);
+  addToEntry (nodeTimingsNodeEntries[&node], seconds, flops, bytes);
+}
+
+void NodeTimings::writeJson (std::ostream& os)
+{
+  const auto nodeEntries = getNodeEntries ();
+  std::map<std::string, Entry> entries;
+  for (const auto& nodeEntry : nodeEntries)
+  {
+    addToEntry (entries[nodeEntry.second.description], nodeEntry.second.entry);
+  }
+
+  os << "{\"descriptions\":{";
+  bool first = true;
+  for (const auto& entry : entries)
+  {
+    os << (first ? "" : ",") << jsonQuote (entry.first) << ":{";
+    writeJsonEntry (os, entry.second);
+    os << "}";
+    first = false;
+  }
+  os << "},\"nodes\":[";
+  first = true;
+  for (const auto& entry : nodeEntries)
+  {
+    os << (first ? "" : ",") << "{\"id\":" << jsonQuote (dotIdentifier (*entry.first))
+       << ",\"description\":" << jsonQuote (entry.second.description) << ",";
+    writeJsonEntry (os, entry.second.entry);
+    os << "}";
+    first = false;
+  }
+  os << "]}\n";
+}
+
+void NodeTimings::writeJson (const std::string& filename)
+{
+  std::ofstream file{filename};
+  writeJson (file);
+}
+
 /*****************************************************************************
  * Free functions.
  */
@@ -342,29 +613,178 @@ NodeRef recreateWithSubstitution (Context& c, const NodeRef& node,
 /*****************************************************************************
  * Context.
  */
+Context::Context ()
+  : nodeCache_ (), scheduler_ (), siteBlockSize_ (DataFlowScheduler::defaultSiteBlockSize), memoryBudget_ ()
+{}
+
 NodeRef Context::cached (NodeRef&& newNode)
 {
   assert (newNode != nullptr);
   // Try inserting it, which will fail if already present and return the old one
   auto r = nodeCache_.emplace (std::move (newNode));
+  if (r.second)
+  {
+    r.first->ref->scheduler_ = scheduler_;
+    r.first->ref->memoryBudget_ = memoryBudget_;
+  }
   return r.first->ref;
 }
 
 NodeRef Context::cached (NodeRef& newNode)
 {
   assert (newNode != nullptr);
-  // First remove this object from the set if it is already
-  for (auto it = nodeCache_.begin(); it != nodeCache_.end();)
+  // Try inserting it, which will fail if already present and return the old one
+  auto r = nodeCache_.emplace (newNode);
+  if (r.second)
   {
-    if (&it->ref == &newNode)
-      it = nodeCache_.erase(it);
+    r.first->ref->scheduler_ = scheduler_;
+    r.first->ref->memoryBudget_ = memoryBudget_;
+  }
+  return r.first->ref;
+}
+
+void Context::erase (const NodeRef& node)
+{
+  NodeRef ref (node);
+  auto it = nodeCache_.find (CachedNodeRef (ref));
+  if (it != nodeCache_.end () && it->ref == node)
+    nodeCache_.erase (it);
+}
+
+std::size_t Context::replaceNode (const NodeRef& from, const NodeRef& to)
+{
+  std::size_t nbMerged = 0;
+  std::vector<std::pair<NodeRef, NodeRef> > replacements{{from, to}};
+  while (!replacements.empty ())
+  {
+    auto replacement = replacements.back ();
+    replacements.pop_back ();
+    auto& oldNode = *replacement.first;
+    const auto& newNode = replacement.second;
+    if (&oldNode == newNode.get ())
+      continue;
+
+    auto dependents = oldNode.dependentNodes_;
+    std::sort (dependents.begin (), dependents.end ());
+    dependents.erase (std::unique (dependents.begin (), dependents.end ()), dependents.end ());
+
+    for (auto* dependent : dependents)
+    {
+      NodeRef dependentRef = dependent->shared_from_this ();
+      // The hash of the dependent changes with its dependencies.
+      erase (dependentRef);
+      for (auto& dep : dependent->dependencyNodes_)
+      {
+        if (dep.get () == &oldNode)
+        {
+          dep = newNode;
+          newNode->registerNode (dependent);
+        }
+      }
+      oldNode.unregisterNode (dependent);
+
+      // Keep the invariant: dependents of an invalid node are invalid.
+      if (!newNode->isValid () && !newNode->storageReleased_)
+        dependent->invalidateRecursively ();
+
+      auto merged = cached (dependentRef);
+      if (merged != dependentRef)
+      {
+        ++nbMerged;
+        replacements.emplace_back (dependentRef, merged);
+      }
+    }
+  }
+  return nbMerged;
+}
+
+std::size_t Context::removeUnreachable (const NodeRefVec& roots)
+{
+  std::unordered_set<const Node_DF*> reachable;
+  std::vector<const Node_DF*> nodesToVisit;
+  for (const auto& root : roots)
+  {
+    if (root && reachable.insert (root.get ()).second)
+      nodesToVisit.push_back (root.get ());
+  }
+  while (!nodesToVisit.empty ())
+  {
+    const auto* n = nodesToVisit.back ();
+    nodesToVisit.pop_back ();
+    for (const auto& dep : n->dependencies ())
+    {
+      if (dep && reachable.insert (dep.get ()).second)
+        nodesToVisit.push_back (dep.get ());
+    }
+  }
+
+  const auto oldSize = nodeCache_.size ();
+  for (auto it = nodeCache_.begin (); it != nodeCache_.end ();)
+  {
+    if (reachable.count (it->ref.get ()) == 0)
+      it = nodeCache_.erase (it);
     else
       ++it;
   }
+  return oldSize - nodeCache_.size ();
+}
 
-  // Try inserting it, which will fail if already present and return the old one
-  auto r = nodeCache_.emplace (newNode);
-  return r.first->ref;
+void Context::setNumberOfThreads (std::size_t nbThreads)
+{
+  if (nbThreads == getNumberOfThreads ())
+    return;
+
+  if (nbThreads <= 1)
+    scheduler_.reset ();
+  else
+    scheduler_ = std::make_shared<DataFlowScheduler>(nbThreads, siteBlockSize_);
+
+  for (const auto& cachedRef : nodeCache_)
+  {
+    cachedRef.ref->scheduler_ = scheduler_;
+  }
+}
+
+std::size_t Context::getNumberOfThreads () const
+{
+  return scheduler_ ? scheduler_->getNumberOfThreads () : 1;
+}
+
+void Context::setSiteBlockSize (std::size_t nbBytes)
+{
+  siteBlockSize_ = nbBytes;
+  if (scheduler_)
+    scheduler_->setSiteBlockSize (nbBytes);
+}
+
+void Context::setMemoryBudget (std::size_t nbBytes)
+{
+  if (nbBytes == getMemoryBudget ())
+    return;
+
+  if (nbBytes == 0)
+    memoryBudget_.reset ();
+  else
+    memoryBudget_ = std::make_shared<MemoryBudget>(nbBytes);
+
+  for (const auto& cachedRef : nodeCache_)
+  {
+    auto& node = *cachedRef.ref;
+    node.memoryBudget_ = memoryBudget_;
+    // Count the values already computed.
+    if (memoryBudget_ && node.isValid () && node.nbDependencies () > 0)
+      memoryBudget_->update (0, node.storageSize ());
+  }
+}
+
+std::size_t Context::getMemoryBudget () const
+{
+  return memoryBudget_ ? memoryBudget_->getBudget () : 0;
+}
+
+std::size_t Context::getStoredBytes () const
+{
+  return memoryBudget_ ? memoryBudget_->getStoredBytes () : 0;
 }
 
 /* Compare/hash the triplet (type, deps, additionalArgs).
@@ -433,20 +853,62 @@ static std::string dotIdentifier (const Node_DF& node)
   return 'N' + std::to_string (std::hash<const Node_DF*>{}(&node));
 }
 
+// Costs of the nodes for DotOptions::ShowTimings.
+struct DotTimings
+{
+  std::map<const Node_DF*, NodeTimings::Entry> entries;
+  double maxSeconds{0.};
+};
+
 // Write line with node representation
-static void writeDotNode (std::ostream& os, const Node_DF& node, DotOptions opt)
+static void writeDotNode (std::ostream& os, const Node_DF& node, DotOptions opt, const DotTimings& timings)
 {
+  // Cost of the node: fraction of the most costly one.
+  const NodeTimings::Entry* cost = nullptr;
+  if (opt & DotOptions::ShowTimings)
+  {
+    auto it = timings.entries.find (&node);
+    if (it != timings.entries.end ())
+      cost = &it->second;
+  }
+  std::string costInfo;
+  if (cost)
+  {
+    std::ostringstream info;
+    info << std::setprecision (3) << "n=" << cost->nbComputations << " t=" << cost->seconds * 1000. << "ms";
+    if (cost->flops > 0)
+      info << " flops=" << cost->flops;
+    costInfo = info.str ();
+  }
+
   os << '\t' << dotIdentifier (node);
   if (opt & DotOptions::DetailedNodeInfo)
   {
     os << " [style=filled, shape=Mrecord,label=\"{" << dotLabelEscape (node.description ())
-       << "| valid=" << node.isValid () << ' ' << dotLabelEscape (node.debugInfo ()) << "}\"";
+       << "| valid=" << node.isValid () << ' ' << dotLabelEscape (node.debugInfo ());
+    if (cost)
+      os << "| " << dotLabelEscape (costInfo);
+    os << "}\"";
   }
   else
   {
-    os << " [style=filled, shape=" << node.shape() << ",label=\"" << dotLabelEscape (node.description ()) << "\"";
+    os << " [style=filled, shape=" << node.shape() << ",label=\"" << dotLabelEscape (node.description ());
+    if (cost)
+      os << "\\n" << costInfo;
+    os << "\"";
+  }
+
+  if (opt & DotOptions::ShowTimings)
+  {
+    // From white (no cost) to red (most costly), bigger when costly.
+    const double fraction = (cost && timings.maxSeconds > 0) ? cost->seconds / timings.maxSeconds : 0.;
+    const int level = 255 - static_cast<int>(std::lround (255. * fraction));
+    std::ostringstream color;
+    color << "#ff" << std::hex << std::setfill ('0') << std::setw (2) << level << std::setw (2) << level;
+    os << ",fillcolor=\"" << color.str () << "\",fontsize=" << 14. + 28. * std::sqrt (fraction) << "]";
   }
-  os << ",fillcolor=\"" << node.color() << "\"]";
+  else
+    os << ",fillcolor=\"" << node.color() << "\"]";
   os << ";\n";
 }
 
@@ -479,6 +941,16 @@ static void writeDotEdge (std::ostream& os, const Node_DF& from, std::size_t dep
 static void writeGraphStructure (std::ostream& os, const std::vector<const Node_DF*>& entryPoints,
                                  DotOptions opt)
 {
+  DotTimings timings;
+  if (opt & DotOptions::ShowTimings)
+  {
+    timings.entries = NodeTimings::getNodeEntriesOnly ();
+    for (const auto& entry : timings.entries)
+    {
+      timings.maxSeconds = std::max (timings.maxSeconds, entry.second.seconds);
+    }
+  }
+
   std::stack<const Node_DF*> nodesToVisit;
   std::unordered_set<const Node_DF*> discoveredNodes;
 
@@ -503,7 +975,7 @@ static void writeGraphStructure (std::ostream& os, const std::vector<const Node_
     const auto* node = nodesToVisit.top ();
 
     nodesToVisit.pop ();
-    writeDotNode (os, *node, opt);
+    writeDotNode (os, *node, opt, timings);
 
     if (opt & DotOptions::FollowUpwardLinks)
     {
@@ -43,9 +43,12 @@
 #define BPP_PHYL_LIKELIHOOD_DATAFLOW_DATAFLOW_H
 
 #include <Bpp/Exceptions.h>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <sstream>
 #include <string>
@@ -76,6 +79,8 @@ template<typename T> void combineHash (std::size_t& seed, const T& t)
 class Node_DF;
 template<typename T> class Value;
 class Context;
+class DataFlowScheduler;
+class MemoryBudget;
 
 
 /////  Dot output
@@ -85,7 +90,8 @@ enum class DotOptions
   None = 0,
   DetailedNodeInfo = 1 << 0,
   FollowUpwardLinks = 1 << 1,
-  ShowDependencyIndex = 1 << 2
+  ShowDependencyIndex = 1 << 2,
+  ShowTimings = 1 << 3 // Colour and size nodes by their NodeTimings cost
 };
 
 DotOptions operator|(DotOptions a, DotOptions b);
@@ -258,12 +264,55 @@ public:
   /// Recreate the node with different dependencies.
   virtual NodeRef recreate (Context& c, NodeRefVec&& deps);
 
+  /** @brief Tell if compute() can run concurrently with the compute() of other nodes.
+   *
+   * Used by the parallel evaluation mode (see Context::setNumberOfThreads).
+   * Nodes whose computation reads or writes shared mutable state (for
+   * example the internal matrices of bpp models) must return false,
+   * they are then computed one at a time.
+   * The default is true.
+   */
+  virtual bool isThreadSafe () const;
+
+  /** @brief Estimation of the number of floating point operations of compute().
+   *
+   * Only used for profiling (see NodeTimings). The default is one
+   * operation per stored value (see storageSize) and dependency, which
+   * suits the component wise nodes; matrix products override it.
+   */
+  virtual double estimatedFlops () const;
+
   /** @brief Compute this node value, recomputing dependencies (transitively) as needed.
+   *
+   * If the node was created in a Context with several threads, the
+   * invalid dependencies are computed in parallel by the scheduler
+   * of this Context.
    *
    * Not thread safe !
    */
   void computeRecursively ();
 
+  /** @brief Size in bytes of the value storage that can be released
+   * (see releaseStorage).
+   *
+   * The default is 0 (nothing to release). Value<T> returns the heap
+   * storage of big matrices (see valueStorageSize).
+   */
+  virtual std::size_t storageSize () const;
+
+  /** @brief Release the storage of a computed value, which will be
+   * recomputed from the dependencies when needed again.
+   *
+   * The dependent nodes stay valid: the value is the same, it is only
+   * not stored anymore. Leaves (nodes without dependencies) can not
+   * be released. Returns false if nothing was released.
+   *
+   * Not thread safe !
+   */
+  bool releaseStorage ();
+
+  bool isStorageReleased () const noexcept { return storageReleased_; }
+
 protected:
   /** @brief Computation implementation.
    *
@@ -291,6 +340,19 @@ protected:
   void makeInvalid () noexcept { isValid_ = false; }
   void makeValid () noexcept { isValid_ = true; }
 
+  /** @brief Scheduler of the Context of this node (null if sequential).
+   *
+   * Can be used in compute() to split a heavy computation in parallel
+   * blocks (see DataFlowScheduler::parallelFor).
+   */
+  DataFlowScheduler* getScheduler_ () const noexcept { return scheduler_.get (); }
+
+  /// Free the storage counted by storageSize (default: nothing).
+  virtual void releaseStorage_ ();
+
+  /// Restore the storage freed by releaseStorage_, before compute().
+  virtual void restoreStorage_ ();
+
 protected:
   // void setDependencies_(NodeRefVec && dependenciesArg)
   // {
@@ -330,9 +392,153 @@ private:
   void registerNode (Node_DF* n);
   void unregisterNode (const Node_DF* n);
 
+  /// compute(), timed if NodeTimings are enabled.
+  void runCompute_ ();
+
+  /** Memory budget: release the dependencies of this (computed) node
+   * which are not needed by the nodes still pending in the current
+   * evaluation, while over budget.
+   */
+  void releaseConsumedDependencies_ (const std::unordered_set<const Node_DF*>& pending);
+
+  /// Invalid nodes needed to compute this one, in topological order
+  /// (dependencies first), each listed once (unless another walk
+  /// runs concurrently on the same nodes, see claimVisit_).
+  void collectInvalidNodes_ (std::vector<Node_DF*>& nodes);
+
+  /// Mark this node as visited by the walk epoch, false if already marked.
+  bool claimVisit_ (std::uint64_t epoch) noexcept;
+
+  // Nodes are allocated one by one (std::make_shared in the create()
+  // functions), and dependencies are held in a NodeRefVec, which is
+  // part of the node interface (dependencies (), recreate (), the
+  // create() checks). A per Context arena and intrusive dependency
+  // arrays are not used: nodes may outlive their Context through the
+  // references kept by the likelihoods, and the node classes would all
+  // have to be rewritten. The walks (see collectInvalidNodes_) and
+  // Context::cached are what is kept cheap instead.
   NodeRefVec dependencyNodes_{};         // Nodes that we depend on.
   std::vector<Node_DF*> dependentNodes_{}; // Nodes that depend on us.
   bool isValid_{false};
+
+  // Value released (invalid, but the dependent nodes may be valid).
+  bool storageReleased_{false};
+
+  // Mark of the last walk which visited this node (see
+  // collectInvalidNodes_), claimed atomically since several walks
+  // (nested evaluations in worker threads) may share nodes.
+  std::atomic<std::uint64_t> visitEpoch_{0};
+
+  // Has an entry in NodeTimings, removed when the node is destroyed.
+  bool timed_{false};
+
+  // Parallel evaluation, set by the Context which created the node (null if sequential).
+  std::shared_ptr<DataFlowScheduler> scheduler_{};
+
+  // Memory bounded evaluation, set by the Context which created the node (null if unbounded).
+  std::shared_ptr<MemoryBudget> memoryBudget_{};
+
+  friend class Context;
+  friend class DataFlowScheduler;
+};
+
+/** @brief Opt-in profiling of the node computations.
+ *
+ * When enabled, every compute() of a node, sequential or parallel,
+ * adds its wall time, its estimated floating point operations (see
+ * Node_DF::estimatedFlops) and the bytes of the values it reads and
+ * writes (see Node_DF::storageSize, which only counts the likelihood
+ * matrices) to the entry of the node. This is global to all the
+ * contexts, and costs a clock read and a lock per computation, so it
+ * is disabled by default. Used by the benchmarks (see bench/).
+ *
+ * The entry of a node is removed when the node is destroyed. The
+ * descriptions of the nodes are only computed when the entries are
+ * read, so the entries by description only cover the living nodes.
+ */
+class NodeTimings
+{
+public:
+  struct Entry
+  {
+    std::size_t nbComputations{0};
+    double seconds{0.};
+    double flops{0.};
+    double bytes{0.};
+  };
+
+  struct NodeEntry
+  {
+    std::string description;
+    Entry entry;
+  };
+
+  static void enable (bool yn);
+  static bool isEnabled () noexcept;
+
+  /// Clear all the entries.
+  static void reset ();
+
+  /// Entries by node description, summed over the nodes.
+  static std::map<std::string, Entry> getEntries ();
+
+  /// Entries by node, with their description.
+  static std::map<const Node_DF*, NodeEntry> getNodeEntries ();
+
+  /// Entries by node, without description.
+  static std::map<const Node_DF*, Entry> getNodeEntriesOnly ();
+
+  static void record (const Node_DF& node, double seconds);
+
+  /** @brief Write the entries as a JSON object, with fields
+   * "descriptions" (by description) and "nodes" (list of nodes, with
+   * the identifiers of writeGraphToDot).
+   */
+  static void writeJson (std::ostream& os);
+
+  static void writeJson (const std::string& filename);
+
+private:
+  /// Remove the entry of a node being destroyed.
+  static void erase (const Node_DF& node);
+
+  friend class Node_DF;
+};
+
+/** @brief Byte budget for the values stored by the nodes of a Context.
+ *
+ * See Context::setMemoryBudget. Counts the storageSize() of the
+ * computed nodes. When over budget, the storage of the intermediate
+ * nodes is released as soon as they are not needed by the current
+ * evaluation, and recomputed on demand. A node is only released if
+ * its dependencies and its dependent nodes are stored, so that the
+ * recomputation of a released node is a single compute() from stored
+ * values (checkpointing). The budget may thus not be reached: at most
+ * about half of the intermediate values can be released.
+ */
+class MemoryBudget
+{
+public:
+  explicit MemoryBudget (std::size_t nbBytes) : nbBytes_ (nbBytes), storedBytes_ (0) {}
+
+  std::size_t getBudget () const noexcept { return nbBytes_; }
+
+  std::size_t getStoredBytes () const noexcept { return storedBytes_.load (std::memory_order_relaxed); }
+
+  bool isExceeded () const noexcept { return getStoredBytes () > nbBytes_; }
+
+  /// Account for a change of the storage of a node.
+  void update (std::size_t oldBytes, std::size_t newBytes) noexcept
+  {
+    if (newBytes >= oldBytes)
+      storedBytes_.fetch_add (newBytes - oldBytes, std::memory_order_relaxed);
+    else
+      storedBytes_.fetch_sub (oldBytes - newBytes, std::memory_order_relaxed);
+  }
+
+private:
+  std::size_t nbBytes_;
+  std::atomic<std::size_t> storedBytes_;
 };
 
 /// Convert a node ref with runtime type check.
@@ -352,6 +558,22 @@ NodeRef recreateWithSubstitution (Context& c, const NodeRef& node,
                                   const std::unordered_map<const Node_DF*, NodeRef>& substitutions);
 
 
+/** @name Releasable value storage
+ *
+ * Used by Value<T> to release its value (see Node_DF::releaseStorage).
+ * The defaults release nothing. Types with big heap storage overload
+ * them in their namespace, found by argument dependent lookup (see
+ * ExtendedFloatEigen.h). compute() then gets a value of the same
+ * dimensions as before its release.
+ */
+///@{
+template<typename T> std::size_t valueStorageSize (const T&) { return 0; }
+
+template<typename T> std::pair<std::size_t, std::size_t> releaseValueStorage (T&) { return {}; }
+
+template<typename T> void restoreValueStorage (T&, const std::pair<std::size_t, std::size_t>&) {}
+///@}
+
 /** @brief Abstract Node storing a value of type T.
  *
  * Represents a DataFlow node containing a T value, but still abstract (no compute()).
@@ -382,7 +604,8 @@ public:
    *
    * Recompute the value if it is not up to date.
    * Then access it as const.
-   * Recomputation is single threaded and not thread safe.
+   * Recomputation is not thread safe, but may use the threads of the
+   * Context that created this node.
    */
   const T& getTargetValue ()
   {
@@ -422,13 +645,22 @@ public:
       this->makeValid ();
   }
 
+  std::size_t storageSize () const override { return valueStorageSize (value_); }
+
 protected:
   /// Raw value access (mutable). Should only be used by
   /// subclasses to implement compute().
   T& accessValueMutable () noexcept { return value_; }
 
+  void releaseStorage_ () override { releasedShape_ = releaseValueStorage (value_); }
+
+  void restoreStorage_ () override { restoreValueStorage (value_, releasedShape_); }
+
 private:
   T value_;
+
+  // Dimensions of the value before its release.
+  std::pair<std::size_t, std::size_t> releasedShape_{};
 };
 
 /// Helper: access value of Node as a Value<T> with unchecked
@@ -527,6 +759,15 @@ void checkDependencyRangeIsValue (const std::type_info& contextNodeType, const N
  * so they will not be destroyed unless the context is destroyed.
  * Multiple context can be used for independent computations.
  *
+ * The Context also holds the evaluation mode of its nodes: by
+ * default nodes are computed sequentially. With
+ * setNumberOfThreads(n), n > 1, the invalid dependencies of a node are
+ * computed in parallel by a pool of n threads (see DataFlowScheduler).
+ * The heaviest nodes (conditional likelihoods) also split their
+ * sites in blocks computed in parallel (see setSiteBlockSize).
+ * With setMemoryBudget(nbBytes), the stored values of intermediate
+ * nodes are released when over budget, and recomputed on demand.
+ *
  * Nodes are merged if they represent the same value.
  * As the value is not computed yet, two nodes are merged if they have:
  * - the same derived class type (same computation code),
@@ -538,7 +779,7 @@ void checkDependencyRangeIsValue (const std::type_info& contextNodeType, const N
 class Context
 {
 public:
-  Context () = default;
+  Context ();
 
   /** For a newly created node, return its equivalent from the cache.
    * If not already present in the cache, add it and return newNode.
@@ -551,6 +792,35 @@ public:
 
   NodeRef cached (NodeRef& newNode);
 
+  /** Remove a node from the cache, if it is there.
+   *
+   * Needed before a change of the dependencies of a cached node,
+   * which changes its hash. The node is cached again afterwards.
+   */
+  void erase (const NodeRef& node);
+
+  /** @brief Make all the dependents of from depend on to instead.
+   *
+   * to must represent the same value as from, with the same type.
+   * Dependents that become equal to another cached node are merged
+   * with it, recursively. from itself is not modified (it may still
+   * be used by external references).
+   * Returns the number of merged dependents.
+   *
+   * Not thread safe !
+   */
+  std::size_t replaceNode (const NodeRef& from, const NodeRef& to);
+
+  /** @brief Remove from the cache the nodes which are not needed to
+   * compute the given roots.
+   *
+   * The removed nodes are still valid if referenced elsewhere, but
+   * are not merged anymore with new equal nodes: this should be done
+   * once the graph is complete.
+   * Returns the number of removed nodes.
+   */
+  std::size_t removeUnreachable (const NodeRefVec& roots);
+
   size_t size() const
   {
     return nodeCache_.size();
@@ -563,8 +833,50 @@ public:
   void clear()
   {
     nodeCache_.clear();
+    if (memoryBudget_)
+      memoryBudget_ = std::make_shared<MemoryBudget>(memoryBudget_->getBudget ());
   }
 
+  /** @brief Set the number of threads used to compute the nodes of this context.
+   *
+   * With nbThreads <= 1, computations are sequential (default).
+   * Applies to the nodes already in the context, and to those created afterwards.
+   */
+  void setNumberOfThreads (std::size_t nbThreads);
+
+  std::size_t getNumberOfThreads () const;
+
+  /** @brief Set the size (in bytes) of the site blocks.
+   *
+   * With several threads, the conditional likelihood nodes compute
+   * their sites (columns) in blocks of about nbBytes per matrix, in
+   * parallel. Default is DataFlowScheduler::defaultSiteBlockSize.
+   * 0 disables site blocks (only independent nodes run in parallel).
+   */
+  void setSiteBlockSize (std::size_t nbBytes);
+
+  std::size_t getSiteBlockSize () const { return siteBlockSize_; }
+
+  /** @brief Set a budget (in bytes) for the values stored by the nodes of this context.
+   *
+   * When the values computed by the nodes (see
+   * Node_DF::storageSize) exceed nbBytes, the intermediate values are
+   * released once consumed, and recomputed on demand (see
+   * MemoryBudget). This trades computations for memory.
+   * 0 means no budget (default: all the values are stored).
+   * Applies to the nodes already in the context, and to those
+   * created afterwards.
+   *
+   * With a budget, a reference returned by Value<T>::getTargetValue
+   * is only guaranteed until the next computation in this context.
+   */
+  void setMemoryBudget (std::size_t nbBytes);
+
+  std::size_t getMemoryBudget () const;
+
+  /// Bytes stored by the computed nodes of this context (0 without budget).
+  std::size_t getStoredBytes () const;
+
 private:
   /* NodeRef is hashable and comparable as a pointer.
    * CachedNodeRef is hashable and comparable, by comparing the node configuration:
@@ -589,6 +901,12 @@ private:
   };
 
   std::unordered_set<CachedNodeRef, CachedNodeRefHash> nodeCache_;
+
+  std::shared_ptr<DataFlowScheduler> scheduler_;
+
+  std::size_t siteBlockSize_;
+
+  std::shared_ptr<MemoryBudget> memoryBudget_;
 };
 
 /// Helper: Same as Context::cached but with a shared_ptr<T> node.
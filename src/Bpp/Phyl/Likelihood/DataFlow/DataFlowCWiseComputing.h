@@ -56,6 +56,7 @@
 
 #include "DataFlowCWise.h"
 #include "DataFlowNumeric.h"
+#include "DataFlowScheduler.h"
 #include "Definitions.h"
 
 namespace bpp
@@ -94,6 +95,28 @@ template<typename F> class SumOfLogarithms;
 template<typename T> class ShiftDelta;
 template<typename T> class CombineDeltaShifted;
 
+/** @brief Call f(firstCol, nbCols) on blocks of columns (sites) of a
+ * nbRows x nbCols matrix, in parallel if scheduler is not null.
+ *
+ * Block width is given by DataFlowScheduler::getSiteBlockColumns.
+ * Without scheduler, f is called once on all columns.
+ */
+template<typename F>
+void computeBySiteBlocks (DataFlowScheduler* scheduler, Eigen::Index nbRows, Eigen::Index nbCols, const F& f)
+{
+  auto blockCols = scheduler ? Eigen::Index (scheduler->getSiteBlockColumns (std::size_t (nbRows), std::size_t (nbCols))) : nbCols;
+  if (blockCols <= 0 || blockCols >= nbCols)
+  {
+    f (Eigen::Index (0), nbCols);
+    return;
+  }
+  auto nbBlocks = (nbCols + blockCols - 1) / blockCols;
+  scheduler->parallelFor (std::size_t (nbBlocks), [&f, blockCols, nbCols](std::size_t block) {
+      auto firstCol = Eigen::Index (block) * blockCols;
+      f (firstCol, std::min (blockCols, nbCols - firstCol));
+    });
+}
+
 
 /*************************************************************************
  * @brief r = f(x0) for each component or column
@@ -188,6 +211,12 @@ public:
     return "Function Apply";
   }
 
+  /// The transition function calls the shared model (see Node_DF::isThreadSafe).
+  bool isThreadSafe () const override
+  {
+    return false;
+  }
+
 private:
   void compute() override { compute<T>();}
 
@@ -1031,7 +1060,8 @@ private:
   void compute() override { compute<T0, T1>();}
 
   template<class U, class V>
-  typename std::enable_if<!std::is_same<U, TransitionFunction>::value && !std::is_same<V, TransitionFunction>::value, void>::type
+  typename std::enable_if<!std::is_same<U, TransitionFunction>::value && !std::is_same<V, TransitionFunction>::value
+                          && !(std::is_same<R, MatrixLik>::value && std::is_same<U, MatrixLik>::value && std::is_same<V, MatrixLik>::value), void>::type
   compute ()
   {
     using namespace numeric;
@@ -1049,6 +1079,26 @@ private:
 #endif
   }
 
+  // Conditional likelihoods: sites are computed in blocks, with a
+  // single normalization of the result.
+  template<class U, class V>
+  typename std::enable_if<std::is_same<R, MatrixLik>::value && std::is_same<U, MatrixLik>::value && std::is_same<V, MatrixLik>::value, void>::type
+  compute ()
+  {
+    auto& result = this->accessValueMutable ();
+    const auto& x0 = accessValueConstCast<U>(*this->dependency (0));
+    const auto& x1 = accessValueConstCast<V>(*this->dependency (1));
+    auto& r = result.float_part ();
+    r.resize (x0.rows (), x0.cols ());
+    computeBySiteBlocks (this->getScheduler_ (), r.rows (), r.cols (),
+                         [&r, &x0, &x1](Eigen::Index firstCol, Eigen::Index nbCols) {
+        r.middleCols (firstCol, nbCols).array () =
+          x0.float_part ().middleCols (firstCol, nbCols).array () * x1.float_part ().middleCols (firstCol, nbCols).array ();
+      });
+    result.exponent_part () = x0.exponent_part () + x1.exponent_part ();
+    result.normalize ();
+  }
+
   template<class U, class V>
   typename std::enable_if<std::is_same<U, TransitionFunction>::value && std::is_same<V, TransitionFunction>::value, void>::type
   compute ()
@@ -1194,7 +1244,11 @@ public:
   }
 
 private:
-  void compute () final
+  void compute () final { compute<R, T>();}
+
+  template<class U, class V>
+  typename std::enable_if<!(std::is_same<U, MatrixLik>::value && std::is_same<V, MatrixLik>::value), void>::type
+  compute ()
   {
     using namespace numeric;
     auto& result = this->accessValueMutable ();
@@ -1205,6 +1259,28 @@ private:
     }
   }
 
+  // Conditional likelihoods: sites are computed in blocks, one pass
+  // per dependency, each followed by a normalization as above.
+  template<class U, class V>
+  typename std::enable_if<std::is_same<U, MatrixLik>::value && std::is_same<V, MatrixLik>::value, void>::type
+  compute ()
+  {
+    using namespace numeric;
+    auto& result = this->accessValueMutable ();
+    result = one (targetDimension_);
+    auto& r = result.float_part ();
+    for (const auto& depNodeRef : this->dependencies ())
+    {
+      const auto& x = accessValueConstCast<V>(*depNodeRef);
+      computeBySiteBlocks (this->getScheduler_ (), r.rows (), r.cols (),
+                           [&r, &x](Eigen::Index firstCol, Eigen::Index nbCols) {
+          r.middleCols (firstCol, nbCols).array () *= x.float_part ().middleCols (firstCol, nbCols).array ();
+        });
+      result.exponent_part () += x.exponent_part ();
+      result.normalize ();
+    }
+  }
+
   Dimension<R> targetDimension_;
 };
 
@@ -2205,6 +2281,13 @@ public:
     return "Matrix Product";
   }
 
+  double estimatedFlops () const override
+  {
+    const auto& x1 = accessValueConstCast<DepT1>(*this->dependency (1));
+    return 2. * double(targetDimension_.rows) * double(targetDimension_.cols)
+           * double(NumericalDependencyTransform<T1>::transform (x1).rows ());
+  }
+
   // MatrixProduct additional arguments = ().
   bool compareAdditionalArguments (const Node_DF& other) const final
   {
@@ -2230,7 +2313,11 @@ public:
   }
 
 private:
-  void compute () final
+  void compute () final { compute<R, DepT0, DepT1>();}
+
+  template<class U, class W, class V>
+  typename std::enable_if<!(std::is_same<U, MatrixLik>::value && std::is_same<W, Eigen::MatrixXd>::value && std::is_same<V, MatrixLik>::value), void>::type
+  compute ()
   {
     auto& result = this->accessValueMutable ();
     const auto& x0 = accessValueConstCast<DepT0>(*this->dependency (0));
@@ -2251,6 +2338,26 @@ private:
 #endif
   }
 
+  // Transitions of conditional likelihoods (x0 is a transition
+  // matrix): sites (columns of x1) are computed in blocks.
+  template<class U, class W, class V>
+  typename std::enable_if<std::is_same<U, MatrixLik>::value && std::is_same<W, Eigen::MatrixXd>::value && std::is_same<V, MatrixLik>::value, void>::type
+  compute ()
+  {
+    auto& result = this->accessValueMutable ();
+    const auto& x0 = accessValueConstCast<DepT0>(*this->dependency (0));
+    const auto& x1 = accessValueConstCast<V>(*this->dependency (1));
+    const auto& m0 = NumericalDependencyTransform<T0>::transform (x0);
+    auto& r = result.float_part ();
+    r.resize (m0.rows (), x1.cols ());
+    computeBySiteBlocks (this->getScheduler_ (), r.rows (), r.cols (),
+                         [&r, &m0, &x1](Eigen::Index firstCol, Eigen::Index nbCols) {
+        r.middleCols (firstCol, nbCols).noalias () = m0 * x1.float_part ().middleCols (firstCol, nbCols);
+      });
+    result.exponent_part () = x1.exponent_part ();
+    result.normalize ();
+  }
+
   Dimension<R> targetDimension_;
 };
 
@@ -0,0 +1,244 @@
+//
+// File: DataFlowOptimizer.cpp
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Phyl/Likelihood/DataFlow/DataFlowNumeric.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/Sequence_DF.h>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "DataFlowOptimizer.h"
+
+using namespace std;
+using namespace bpp;
+
+namespace
+{
+/*
+ * Nodes needed to compute the roots, dependencies first.
+ */
+
+vector<NodeRef> topologicalOrder (const NodeRefVec& roots)
+{
+  vector<NodeRef> order;
+  unordered_set<const Node_DF*> visited;
+  vector<pair<NodeRef, size_t> > path; // node, next dependency to visit
+  for (const auto& root : roots)
+  {
+    if (!root || !visited.insert (root.get ()).second)
+      continue;
+    path.emplace_back (root, 0);
+    while (!path.empty ())
+    {
+      auto node = path.back ().first;
+      auto& next = path.back ().second;
+      if (next < node->nbDependencies ())
+      {
+        const auto& dep = node->dependency (next++);
+        if (dep && visited.insert (dep.get ()).second)
+          path.emplace_back (dep, 0);
+      }
+      else
+      {
+        order.push_back (node);
+        path.pop_back ();
+      }
+    }
+  }
+  return order;
+}
+
+/*
+ * Typed helpers, for the value types of the likelihood graphs.
+ */
+
+template<typename T>
+NodeRef dependencyOfIdentity (const NodeRef& node)
+{
+  return dynamic_cast<const Identity<T>*>(node.get ()) ? node->dependency (0) : nullptr;
+}
+
+NodeRef dependencyOfIdentity (const NodeRef& node)
+{
+  NodeRef dep;
+  if ((dep = dependencyOfIdentity<double>(node)) ||
+      (dep = dependencyOfIdentity<Eigen::MatrixXd>(node)) ||
+      (dep = dependencyOfIdentity<ExtendedFloatMatrixXd>(node)))
+    return dep;
+  return nullptr;
+}
+
+template<typename T>
+NodeRef constantOf (Context& c, const NodeRef& node)
+{
+  auto value = std::dynamic_pointer_cast<Value<T> >(node);
+  if (!value)
+    return nullptr;
+  return NumericConstant<T>::create (c, value->getTargetValue ());
+}
+
+NodeRef constantOf (Context& c, const NodeRef& node)
+{
+  NodeRef constant;
+  if ((constant = constantOf<double>(c, node)) ||
+      (constant = constantOf<Eigen::VectorXd>(c, node)) ||
+      (constant = constantOf<Eigen::RowVectorXd>(c, node)) ||
+      (constant = constantOf<Eigen::MatrixXd>(c, node)) ||
+      (constant = constantOf<ExtendedFloatVectorXd>(c, node)) ||
+      (constant = constantOf<ExtendedFloatRowVectorXd>(c, node)) ||
+      (constant = constantOf<ExtendedFloatMatrixXd>(c, node)))
+    return constant;
+  return nullptr;
+}
+
+/*
+ * Without variables, the constant leaves are the nodes with the
+ * Constant property and the sequences. With variables, all the leaves
+ * but the variables.
+ */
+
+bool isConstantLeaf (const Node_DF& node, const unordered_set<const Node_DF*>* variables)
+{
+  if (variables)
+    return variables->count (&node) == 0;
+  return node.hasNumericalProperty (NumericalProperty::Constant) || dynamic_cast<const TipSequence_DF*>(&node) != nullptr;
+}
+
+void foldConstantsOf (Context& c, const NodeRefVec& roots, const unordered_set<const Node_DF*>* variables,
+                      DataFlowOptimizer::Report& report)
+{
+  const auto order = topologicalOrder (roots);
+
+  // A node is constant if it is a constant leaf, or if it is not a
+  // variable and all its dependencies are constant.
+  unordered_set<const Node_DF*> constants;
+  for (const auto& node : order)
+  {
+    const auto& deps = node->dependencies ();
+    bool isConstant;
+    if (deps.empty ())
+      isConstant = isConstantLeaf (*node, variables);
+    else
+      isConstant = (!variables || variables->count (node.get ()) == 0) &&
+                   std::all_of (deps.begin (), deps.end (), [&constants](const NodeRef& dep) {
+          return !dep || constants.count (dep.get ()) != 0;
+        });
+    if (isConstant)
+      constants.insert (node.get ());
+  }
+
+  // Fold the maximal constant sub-graphs: constant nodes with
+  // dependencies, used by a non constant node.
+  for (const auto& node : order)
+  {
+    if (node->dependencies ().empty () || constants.count (node.get ()) == 0)
+      continue;
+    const auto& dependents = node->dependentNodes ();
+    if (std::all_of (dependents.begin (), dependents.end (), [&constants](const Node_DF* dependent) {
+        return constants.count (dependent) != 0;
+      }))
+      continue;
+
+    auto constant = constantOf (c, node);
+    if (constant && constant != node)
+    {
+      report.nbMerged += c.replaceNode (node, constant);
+      ++report.nbFolded;
+    }
+  }
+}
+} // namespace
+
+void DataFlowOptimizer::collapseIdentities (Context& c, const NodeRefVec& roots, Report& report)
+{
+  for (const auto& node : topologicalOrder (roots))
+  {
+    auto dep = dependencyOfIdentity (node);
+    if (dep && !node->dependentNodes ().empty ())
+    {
+      report.nbMerged += c.replaceNode (node, dep);
+      ++report.nbCollapsed;
+    }
+  }
+}
+
+void DataFlowOptimizer::foldConstants (Context& c, const NodeRefVec& roots, Report& report)
+{
+  foldConstantsOf (c, roots, nullptr, report);
+}
+
+void DataFlowOptimizer::foldConstants (Context& c, const NodeRefVec& roots, const NodeRefVec& variables, Report& report)
+{
+  unordered_set<const Node_DF*> variableSet;
+  for (const auto& variable : variables)
+    variableSet.insert (variable.get ());
+  foldConstantsOf (c, roots, &variableSet, report);
+}
+
+void DataFlowOptimizer::mergeEqualNodes (Context& c, const NodeRefVec& roots, Report& report)
+{
+  unordered_set<const Node_DF*> rootSet;
+  for (const auto& root : roots)
+    rootSet.insert (root.get ());
+
+  for (const auto& node : topologicalOrder (roots))
+  {
+    // Skip leaves, and nodes already replaced by an equal one.
+    if (node->dependencies ().empty () ||
+        (node->dependentNodes ().empty () && rootSet.count (node.get ()) == 0))
+      continue;
+    // Cached again with its current dependencies.
+    c.erase (node);
+    NodeRef ref (node);
+    auto merged = c.cached (ref);
+    if (merged != node)
+      report.nbMerged += 1 + c.replaceNode (node, merged);
+  }
+}
+
+DataFlowOptimizer::Report DataFlowOptimizer::optimize (Context& c, const NodeRefVec& roots)
+{
+  Report report;
+  collapseIdentities (c, roots, report);
+  foldConstants (c, roots, report);
+  mergeEqualNodes (c, roots, report);
+  report.nbRemoved = c.removeUnreachable (roots);
+  return report;
+}
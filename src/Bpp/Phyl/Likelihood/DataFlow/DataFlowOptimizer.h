@@ -0,0 +1,102 @@
+//
+// File: DataFlowOptimizer.h
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef BPP_PHYL_LIKELIHOOD_DATAFLOW_DATAFLOWOPTIMIZER_H
+#define BPP_PHYL_LIKELIHOOD_DATAFLOW_DATAFLOWOPTIMIZER_H
+
+#include <cstddef>
+
+#include "DataFlow.h"
+
+namespace bpp
+{
+/** @brief Optimisation passes over a built dataflow graph.
+ *
+ * Context::cached merges identical nodes at creation, and the create
+ * functions simplify with the numerical properties of their direct
+ * dependencies. These passes work on the whole graph needed by some
+ * roots (for example a likelihood and its derivatives), once it is
+ * built:
+ * - collapseIdentities: dependents of Identity nodes use the
+ *   dependency of the Identity directly (no copy of the value).
+ * - foldConstants: maximal constant sub-graphs (whose leaves are all
+ *   constants) are computed once and replaced by a NumericConstant.
+ *   Constant leaves are the nodes with the Constant numerical
+ *   property and the sequences (TipSequence_DF) or, if the variables
+ *   of the graph are given, all the leaves but these variables (for
+ *   example the non optimised parameters of a likelihood, see
+ *   LikelihoodCalculationSingleProcess::foldConstants).
+ * - mergeEqualNodes: nodes equal by type, dependencies and arguments
+ *   (see Context) are merged, after the rewirings of the other passes.
+ * - Context::removeUnreachable: nodes not needed by the roots are
+ *   dropped from the context.
+ *
+ * Nodes are only rewired: the replaced nodes stay valid for external
+ * references (for example the ForwardLikelihoodTree nodes), but are
+ * not used anymore by the computation of the roots.
+ */
+class DataFlowOptimizer
+{
+public:
+  struct Report
+  {
+    std::size_t nbCollapsed{0};
+    std::size_t nbFolded{0};
+    std::size_t nbMerged{0};
+    std::size_t nbRemoved{0};
+  };
+
+  /// Run all the passes, and remove the unreachable nodes from the context.
+  static Report optimize (Context& c, const NodeRefVec& roots);
+
+  /* The passes add their counts to the report. Nodes which become equal
+   * after a rewiring are merged at once, and counted in nbMerged.
+   */
+
+  static void collapseIdentities (Context& c, const NodeRefVec& roots, Report& report);
+
+  static void foldConstants (Context& c, const NodeRefVec& roots, Report& report);
+
+  static void foldConstants (Context& c, const NodeRefVec& roots, const NodeRefVec& variables, Report& report);
+
+  static void mergeEqualNodes (Context& c, const NodeRefVec& roots, Report& report);
+};
+} // namespace bpp
+#endif // BPP_PHYL_LIKELIHOOD_DATAFLOW_DATAFLOWOPTIMIZER_H
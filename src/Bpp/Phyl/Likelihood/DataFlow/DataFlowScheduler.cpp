@@ -0,0 +1,336 @@
+//
+// File: DataFlowScheduler.cpp
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Exceptions.h>
+#include <algorithm>
+#include <unordered_map>
+
+#include "DataFlow.h"
+#include "DataFlowScheduler.h"
+
+namespace bpp
+{
+// Set for the whole life of worker threads.
+static thread_local bool isDataFlowWorker = false;
+
+bool DataFlowScheduler::isWorkerThread () noexcept
+{
+  return isDataFlowWorker;
+}
+
+constexpr std::size_t DataFlowScheduler::defaultSiteBlockSize;
+
+DataFlowScheduler::DataFlowScheduler (std::size_t nbThreads, std::size_t siteBlockSize)
+  : siteBlockSize_ (siteBlockSize)
+{
+  nbThreads = std::max (nbThreads, std::size_t (1));
+  for (std::size_t i = 0; i < nbThreads; ++i)
+  {
+    queues_.emplace_back (new WorkerQueue);
+  }
+  for (std::size_t i = 0; i < nbThreads; ++i)
+  {
+    workers_.emplace_back (&DataFlowScheduler::workerLoop_, this, i);
+  }
+}
+
+DataFlowScheduler::~DataFlowScheduler ()
+{
+  {
+    std::lock_guard<std::mutex> lock (sleepMutex_);
+    stop_ = true;
+  }
+  wakeUp_.notify_all ();
+  for (auto& w : workers_)
+  {
+    w.join ();
+  }
+}
+
+void DataFlowScheduler::computeRecursively (Node_DF& node)
+{
+  if (node.isValid ())
+    return;
+
+  std::lock_guard<std::mutex> evaluationLock (evaluationMutex_);
+
+  // Discover the invalid sub-DAG, same walk as Node_DF::computeRecursively.
+  // A node listed twice (walk concurrent with another one, see
+  // Node_DF::claimVisit_) gets a single task.
+  std::vector<Node_DF*> walk;
+  node.collectInvalidNodes_ (walk);
+  std::vector<Node_DF*> nodes;
+  nodes.reserve (walk.size ());
+  std::unordered_map<const Node_DF*, std::size_t> indexes;
+  indexes.reserve (walk.size ());
+  for (auto* n : walk)
+  {
+    if (indexes.emplace (n, nodes.size ()).second)
+      nodes.push_back (n);
+  }
+
+  // Link the tasks. A dependency listed twice is counted twice, and
+  // the dependent is notified twice, which is consistent.
+  std::vector<Task> tasks (nodes.size ());
+  std::vector<Task*> readyTasks;
+  for (std::size_t i = 0; i < nodes.size (); ++i)
+  {
+    auto& task = tasks[i];
+    task.node = nodes[i];
+    std::size_t nbPending = 0;
+    for (auto& dep : nodes[i]->dependencies ())
+    {
+      if (dep && !dep->isValid ())
+      {
+        tasks[indexes[dep.get ()]].dependents.push_back (&task);
+        ++nbPending;
+      }
+    }
+    task.pendingDependencies.store (nbPending, std::memory_order_relaxed);
+    if (nbPending == 0)
+      readyTasks.push_back (&task);
+  }
+
+  failed_.store (false);
+  failure_ = nullptr;
+  nbRemainingTasks_.store (tasks.size ());
+
+  // Spread the leaves of the sub-DAG over the workers.
+  for (std::size_t i = 0; i < readyTasks.size (); ++i)
+  {
+    push_ (Job{readyTasks[i], nullptr}, i % queues_.size ());
+  }
+
+  {
+    std::unique_lock<std::mutex> lock (doneMutex_);
+    done_.wait (lock, [this]() {
+      return nbRemainingTasks_.load () == 0;
+    });
+  }
+
+  if (failure_)
+    std::rethrow_exception (failure_);
+
+  // Memory budget: the computed values are released after the
+  // parallel evaluation, not during it.
+  if (node.memoryBudget_)
+  {
+    const std::unordered_set<const Node_DF*> pending;
+    for (auto* n : nodes)
+    {
+      n->releaseConsumedDependencies_ (pending);
+    }
+  }
+}
+
+void DataFlowScheduler::push_ (Job&& job, std::size_t workerIndex)
+{
+  {
+    // Counted before being queued, so that the counter never goes
+    // below the number of queued jobs. Taking the lock prevents a
+    // lost wake up between the check and the wait of a worker.
+    std::lock_guard<std::mutex> lock (sleepMutex_);
+    ++nbQueuedTasks_;
+  }
+  {
+    auto& queue = *queues_[workerIndex];
+    std::lock_guard<std::mutex> lock (queue.mutex);
+    queue.jobs.push_back (std::move (job));
+  }
+  wakeUp_.notify_one ();
+}
+
+bool DataFlowScheduler::pop_ (Job& job, std::size_t workerIndex)
+{
+  // Own queue first, newest job.
+  {
+    auto& queue = *queues_[workerIndex];
+    std::lock_guard<std::mutex> lock (queue.mutex);
+    if (!queue.jobs.empty ())
+    {
+      job = std::move (queue.jobs.back ());
+      queue.jobs.pop_back ();
+      --nbQueuedTasks_;
+      return true;
+    }
+  }
+  // Then steal the oldest job of another worker.
+  for (std::size_t i = 1; i < queues_.size (); ++i)
+  {
+    auto& queue = *queues_[(workerIndex + i) % queues_.size ()];
+    std::lock_guard<std::mutex> lock (queue.mutex);
+    if (!queue.jobs.empty ())
+    {
+      job = std::move (queue.jobs.front ());
+      queue.jobs.pop_front ();
+      --nbQueuedTasks_;
+      return true;
+    }
+  }
+  return false;
+}
+
+void DataFlowScheduler::run_ (Task* task, std::size_t workerIndex)
+{
+  auto* n = task->node;
+  // After a failure, remaining tasks are only drained (left invalid).
+  if (!failed_.load ())
+  {
+    try
+    {
+      if (n->isThreadSafe ())
+        n->runCompute_ ();
+      else
+      {
+        std::lock_guard<std::mutex> lock (serialComputeMutex_);
+        n->runCompute_ ();
+      }
+      n->makeValid ();
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock (failureMutex_);
+      if (!failed_.load ())
+      {
+        failure_ = std::current_exception ();
+        failed_.store (true);
+      }
+    }
+  }
+
+  for (auto* dependent : task->dependents)
+  {
+    if (dependent->pendingDependencies.fetch_sub (1) == 1)
+      push_ (Job{dependent, nullptr}, workerIndex);
+  }
+
+  if (nbRemainingTasks_.fetch_sub (1) == 1)
+  {
+    std::lock_guard<std::mutex> lock (doneMutex_);
+    done_.notify_all ();
+  }
+}
+
+void DataFlowScheduler::BlockRange::runBlocks ()
+{
+  std::size_t i;
+  while ((i = nextBlock.fetch_add (1)) < nbBlocks)
+  {
+    try
+    {
+      f (i);
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock (mutex);
+      if (!failure)
+        failure = std::current_exception ();
+    }
+    if (nbDoneBlocks.fetch_add (1) + 1 == nbBlocks)
+    {
+      std::lock_guard<std::mutex> lock (mutex);
+      allDone.notify_all ();
+    }
+  }
+}
+
+void DataFlowScheduler::parallelFor (std::size_t nbBlocks, const std::function<void (std::size_t)>& f)
+{
+  if (nbBlocks == 0)
+    return;
+  if (nbBlocks == 1)
+  {
+    f (0);
+    return;
+  }
+
+  // Helpers may be dequeued after the end of the loop: they then find
+  // no block left, and only keep range alive.
+  auto range = std::make_shared<BlockRange>(f, nbBlocks);
+  auto nbHelpers = std::min (nbBlocks - 1, workers_.size ());
+  for (std::size_t i = 0; i < nbHelpers; ++i)
+  {
+    push_ (Job{nullptr, range}, i % queues_.size ());
+  }
+
+  range->runBlocks ();
+
+  {
+    std::unique_lock<std::mutex> lock (range->mutex);
+    range->allDone.wait (lock, [&range]() {
+      return range->nbDoneBlocks.load () == range->nbBlocks;
+    });
+  }
+
+  if (range->failure)
+    std::rethrow_exception (range->failure);
+}
+
+std::size_t DataFlowScheduler::getSiteBlockColumns (std::size_t nbRows, std::size_t nbCols) const noexcept
+{
+  if (siteBlockSize_ == 0 || nbRows == 0)
+    return nbCols;
+  auto nbBlockCols = std::max (siteBlockSize_ / (3 * nbRows * sizeof (double)), std::size_t (1));
+  return std::min (nbBlockCols, nbCols);
+}
+
+void DataFlowScheduler::workerLoop_ (std::size_t workerIndex)
+{
+  isDataFlowWorker = true;
+  while (true)
+  {
+    Job job{nullptr, nullptr};
+    if (pop_ (job, workerIndex))
+    {
+      if (job.task)
+        run_ (job.task, workerIndex);
+      else
+        job.range->runBlocks ();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock (sleepMutex_);
+    wakeUp_.wait (lock, [this]() {
+      return stop_ || nbQueuedTasks_.load () > 0;
+    });
+    if (stop_ && nbQueuedTasks_.load () == 0)
+      return;
+  }
+}
+} // namespace bpp
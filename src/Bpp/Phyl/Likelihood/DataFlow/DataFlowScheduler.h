@@ -0,0 +1,214 @@
+//
+// File: DataFlowScheduler.h
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef BPP_PHYL_LIKELIHOOD_DATAFLOW_DATAFLOWSCHEDULER_H
+#define BPP_PHYL_LIKELIHOOD_DATAFLOW_DATAFLOWSCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace bpp
+{
+class Node_DF;
+
+/** @brief Parallel evaluation of dataflow graphs.
+ *
+ * A DataFlowScheduler owns a pool of worker threads. When asked to
+ * compute a node, it gathers the sub-DAG of its invalid transitive
+ * dependencies, and computes each node on any worker as soon as all
+ * its invalid dependencies have been computed. Independent parts of
+ * the graph (for example sibling subtrees of a ForwardLikelihoodTree,
+ * or the trees of different rate categories) are thus computed
+ * concurrently.
+ *
+ * Each worker owns a deque of ready nodes. A worker takes its own
+ * nodes in LIFO order (to follow the graph depth-first, and keep
+ * freshly computed values in cache), and steals nodes in FIFO order
+ * from the other workers when its deque is empty.
+ *
+ * Nodes for which Node_DF::isThreadSafe() returns false are computed
+ * one at a time, under a scheduler wide lock.
+ *
+ * Schedulers are set per Context (see Context::setNumberOfThreads),
+ * and used by Node_DF::computeRecursively. A computation started
+ * from a worker thread (ie inside a Node_DF::compute) is always
+ * sequential.
+ *
+ * The workers are also available to split the computation of a single
+ * node (see parallelFor), which heavy nodes use to compute blocks of
+ * sites in parallel (see computeBySiteBlocks).
+ */
+
+class DataFlowScheduler
+{
+public:
+  /// Default size of site blocks: about a L2 cache.
+  static constexpr std::size_t defaultSiteBlockSize = 256 * 1024;
+
+  /// Build a scheduler with nbThreads workers (at least one).
+  explicit DataFlowScheduler (std::size_t nbThreads, std::size_t siteBlockSize = defaultSiteBlockSize);
+
+  DataFlowScheduler (const DataFlowScheduler&) = delete;
+  DataFlowScheduler& operator=(const DataFlowScheduler&) = delete;
+
+  /// Stops and joins the workers.
+  ~DataFlowScheduler ();
+
+  std::size_t getNumberOfThreads () const noexcept { return workers_.size (); }
+
+  /** @brief Compute node, and its invalid dependencies, in parallel.
+   *
+   * Returns when node is valid. If a compute() throws, the remaining
+   * nodes are left invalid and the first exception is rethrown.
+   * Concurrent calls on the same scheduler are serialized.
+   */
+  void computeRecursively (Node_DF& node);
+
+  /** @brief Call f(i) for all i in [0, nbBlocks), in parallel.
+   *
+   * The calling thread computes blocks too, so this can be used from
+   * the compute() of a node run by a worker. Returns when all blocks
+   * are computed; if some f(i) throws, the first exception is rethrown.
+   */
+  void parallelFor (std::size_t nbBlocks, const std::function<void (std::size_t)>& f);
+
+  /** @brief Set the size in bytes of the site blocks.
+   *
+   * 0 disables the splitting of nodes in site blocks.
+   * Must not be called during a computation.
+   */
+  void setSiteBlockSize (std::size_t nbBytes) noexcept { siteBlockSize_ = nbBytes; }
+
+  std::size_t getSiteBlockSize () const noexcept { return siteBlockSize_; }
+
+  /** @brief Number of columns of a site block, for a nbRows x nbCols
+   * matrix of doubles.
+   *
+   * A block holds siteBlockSize bytes of each operand and result
+   * (3 matrices). Returns nbCols if the matrix should not be split.
+   */
+  std::size_t getSiteBlockColumns (std::size_t nbRows, std::size_t nbCols) const noexcept;
+
+  /// True if the calling thread is a worker of any scheduler.
+  static bool isWorkerThread () noexcept;
+
+private:
+  /// A node of the invalid sub-DAG, with the bookkeeping needed for scheduling.
+  struct Task
+  {
+    Node_DF* node{nullptr};
+    // Number of dependencies not computed yet.
+    std::atomic<std::size_t> pendingDependencies{0};
+    // Tasks which have this task as dependency.
+    std::vector<Task*> dependents{};
+  };
+
+  /// Shared state of a parallelFor.
+  struct BlockRange
+  {
+    BlockRange (const std::function<void (std::size_t)>& fArg, std::size_t nbBlocksArg)
+      : f (fArg), nbBlocks (nbBlocksArg) {}
+
+    // Compute blocks until none is left.
+    void runBlocks ();
+
+    const std::function<void (std::size_t)>& f;
+    const std::size_t nbBlocks;
+    std::atomic<std::size_t> nextBlock{0};
+    std::atomic<std::size_t> nbDoneBlocks{0};
+    std::mutex mutex{};
+    std::condition_variable allDone{};
+    std::exception_ptr failure{};
+  };
+
+  /// Queued work: either a node of the current evaluation, or a helper of a parallelFor.
+  struct Job
+  {
+    Task* task;
+    std::shared_ptr<BlockRange> range;
+  };
+
+  struct WorkerQueue
+  {
+    std::mutex mutex{};
+    std::deque<Job> jobs{};
+  };
+
+  void workerLoop_ (std::size_t workerIndex);
+  void push_ (Job&& job, std::size_t workerIndex);
+  bool pop_ (Job& job, std::size_t workerIndex);
+  void run_ (Task* task, std::size_t workerIndex);
+
+  std::vector<std::thread> workers_{};
+  std::vector<std::unique_ptr<WorkerQueue> > queues_{};
+
+  std::size_t siteBlockSize_;
+
+  // Sleep/wake up of the workers.
+  std::mutex sleepMutex_{};
+  std::condition_variable wakeUp_{};
+  std::atomic<std::size_t> nbQueuedTasks_{0};
+  bool stop_{false};
+
+  // Current evaluation.
+  std::mutex evaluationMutex_{};
+  std::atomic<std::size_t> nbRemainingTasks_{0};
+  std::mutex doneMutex_{};
+  std::condition_variable done_{};
+
+  // Serialization of non thread safe computations.
+  std::mutex serialComputeMutex_{};
+
+  // First error raised during the current evaluation.
+  std::mutex failureMutex_{};
+  std::atomic<bool> failed_{false};
+  std::exception_ptr failure_{};
+};
+} // namespace bpp
+#endif // BPP_PHYL_LIKELIHOOD_DATAFLOW_DATAFLOWSCHEDULER_H
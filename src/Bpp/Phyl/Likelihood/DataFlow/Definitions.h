@@ -16,6 +16,18 @@ typedef ExtendedFloatRowVectorXd RowLik;
 typedef ExtendedFloatVectorXd VectorLik;
 typedef ExtendedFloat DataLik;
 
+// Variants with one exponent per site (see ExtendedFloatColwiseMatrix),
+// used by the forward likelihoods of SiteScaledForward.h, and stored in
+// single precision if BPP_FLOAT32_LIKELIHOOD is defined (see
+// MixedPrecisionLogLikelihood for the accuracy checks).
+#ifdef BPP_FLOAT32_LIKELIHOOD
+typedef float SiteScaledStorage;
+#else
+typedef double SiteScaledStorage;
+#endif
+typedef ExtendedFloatColwiseMatrix<Eigen::Dynamic, Eigen::Dynamic, SiteScaledStorage> SiteScaledMatrixLik;
+typedef ExtendedFloatColwiseMatrix<1, Eigen::Dynamic, SiteScaledStorage> SiteScaledRowLik;
+
 // typedef Eigen::MatrixXd MatrixLik;
 // typedef Eigen::RowVectorXd RowLik;
 // typedef Eigen::VectorXd VectorLik;
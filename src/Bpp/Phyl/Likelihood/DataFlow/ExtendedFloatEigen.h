@@ -43,6 +43,9 @@
 #define BPP_PHYL_LIKELIHOOD_DATAFLOW_EXTENDEDFLOATEIGEN_H
 
 
+#include <algorithm>
+#include <utility>
+
 #include "ExtendedFloat.h"
 #include "ExtendedFloatEigenTools.h"
 
@@ -314,52 +317,76 @@ public:
 
   // Normalization methods
 
+  // The number of normalization steps is computed from a single scan of
+  // the extreme values, and the matrix is then scaled at once.
+
   bool normalize_big () noexcept
   {
-    using namespace std;
+    return normalize_big_ (float_part().cwiseAbs().maxCoeff());
+  }
+
+  bool normalize_small ()
+  {
+    const auto absMat = float_part().cwiseAbs();
+    double minAbs = absMat.minCoeff();
+    return minAbs != 0 && normalize_small_ (minAbs, absMat.maxCoeff());
+  }
 
-    if (isfinite(float_part().cwiseAbs().maxCoeff()))
+  void normalize () noexcept
+  {
+    const auto absMat = float_part().cwiseAbs();
+    double maxAbs = absMat.maxCoeff();
+    if (!normalize_big_ (maxAbs))
     {
-      bool normalized = false;
-      while (float_part().cwiseAbs().maxCoeff() > ExtendedFloat::biggest_normalized_value)
-      {
-        float_part() *= (double)ExtendedFloat::normalize_big_factor;
-        exp_ += ExtendedFloat::biggest_normalized_radix_power;
-        normalized = true;
-      }
-      return normalized;
+      double minAbs = absMat.minCoeff();
+      if (minAbs != 0)
+        normalize_small_ (minAbs, maxAbs);
     }
-    return false;
   }
 
-  bool normalize_small ()
+private:
+  bool normalize_big_ (double maxAbs) noexcept
   {
-    if (float_part().cwiseAbs().minCoeff() != 0)
+    if (!std::isfinite(maxAbs) || maxAbs <= ExtendedFloat::biggest_normalized_value)
+      return false;
+
+    // At most 2 steps from the largest double, so factor is representable.
+    int nbSteps = 0;
+    double factor = 1.;
+    while (maxAbs * factor > ExtendedFloat::biggest_normalized_value)
     {
-      bool normalized = false;
-      while (float_part().cwiseAbs().minCoeff() < ExtendedFloat::smallest_normalized_value)
-      {
-        if (float_part().cwiseAbs().maxCoeff() >= ExtendedFloat::biggest_value_for_mult)
-        {
-          break;
-        }
-        float_part() *= (double)ExtendedFloat::normalize_small_factor;
-        exp_ -= ExtendedFloat::biggest_normalized_radix_power;
-        normalized = true;
-      }
-      return normalized;
+      factor *= (double)ExtendedFloat::normalize_big_factor;
+      nbSteps++;
     }
-    return false;
+    float_part() *= factor;
+    exp_ += nbSteps * ExtendedFloat::biggest_normalized_radix_power;
+    return true;
   }
 
-  void normalize () noexcept
+  bool normalize_small_ (double minAbs, double maxAbs) noexcept
   {
-    if (!normalize_big())
+    int nbSteps = 0;
+    while (minAbs < ExtendedFloat::smallest_normalized_value && maxAbs < ExtendedFloat::biggest_value_for_mult)
+    {
+      minAbs *= (double)ExtendedFloat::normalize_small_factor;
+      maxAbs *= (double)ExtendedFloat::normalize_small_factor;
+      nbSteps++;
+    }
+    exp_ -= nbSteps * ExtendedFloat::biggest_normalized_radix_power;
+
+    // Scale by at most 2 steps at a time, to keep the factor representable.
+    for (int done = 0; done < nbSteps; done += 2)
     {
-      normalize_small();
+      double factor = (double)ExtendedFloat::normalize_small_factor;
+      if (nbSteps - done > 1)
+        factor *= (double)ExtendedFloat::normalize_small_factor;
+      float_part() *= factor;
     }
+    return nbSteps != 0;
   }
 
+public:
+
   // Static methods without normalization
   template< int R2,  int C2>
   inline static ExtendedFloatEigen<R, C2, EigenType> denorm_mul (const Self& lhs, const ExtendedFloatEigen<R2, C2, EigenType>& rhs)
@@ -919,6 +946,301 @@ typedef ExtendedFloatVector<Eigen::Dynamic> ExtendedFloatVectorXd;
 typedef ExtendedFloatArray<Eigen::Dynamic, 1> ExtendedFloatArrayXd;
 
 
+/*
+ * Variant of ExtendedFloatMatrix with one exponent per column.
+ *
+ * For likelihood matrices (states x sites), each site is scaled on
+ * its own: a badly scaled site is rescaled alone, without rescanning
+ * the whole matrix, and sites of very different magnitudes do not
+ * underflow each other.
+ *
+ * After each operation, every column is normalized so that its largest
+ * absolute value lies in [1/radix, 1). Null columns get exponent
+ * null_column_exponent, so that they vanish in sums. The operations
+ * work by blocks of columns, which are normalized while still in cache.
+ *
+ * The float part is stored as T, double or float. Since the scale is
+ * in the exponents, float storage only loses precision (about 7
+ * significant digits), not range, and halves the memory traffic. Sums
+ * of logarithms are accumulated in double.
+ */
+
+template< int R,  int C, typename T = double>
+class ExtendedFloatColwiseMatrix
+{
+public:
+  using MatType = Eigen::Matrix<T, R, C>;
+  using ExtType = Eigen::Matrix<ExtendedFloat::ExtType, 1, C>;
+
+  static constexpr ExtendedFloat::ExtType null_column_exponent = std::numeric_limits<ExtendedFloat::ExtType>::min () / 4;
+
+  static constexpr Eigen::Index block_size = 64;
+
+private:
+  using Self = ExtendedFloatColwiseMatrix<R, C, T>;
+
+  MatType mat_;
+  ExtType exp_;
+
+public:
+  ExtendedFloatColwiseMatrix () :
+    mat_(),
+    exp_() {}
+
+  ExtendedFloatColwiseMatrix (Eigen::Index rows, Eigen::Index cols) :
+    mat_(MatType::Zero(rows, cols)),
+    exp_(ExtType::Constant(cols, null_column_exponent)) {}
+
+  explicit ExtendedFloatColwiseMatrix (const EFMatrix<R, C>& mat) :
+    mat_(),
+    exp_()
+  {
+    assign_(mat, ExtType::Zero(mat.cols()));
+  }
+
+  explicit ExtendedFloatColwiseMatrix (const ExtendedFloatMatrix<R, C>& other) :
+    mat_(),
+    exp_()
+  {
+    assign_(other.float_part(), ExtType::Constant(other.cols(), other.exponent_part()));
+  }
+
+  // access members
+
+  const ExtType& exponent_part () const { return exp_; }
+
+  const MatType& float_part () const { return mat_; }
+
+  ExtType& exponent_part () noexcept { return exp_; }
+
+  MatType& float_part () noexcept { return mat_; }
+
+  Eigen::Index rows() const { return mat_.rows(); }
+
+  Eigen::Index cols() const { return mat_.cols(); }
+
+  void resize(Eigen::Index rows, Eigen::Index cols)
+  {
+    mat_.resize(rows, cols);
+    exp_.resize(cols);
+  }
+
+  const ExtendedFloat operator()(Eigen::Index r, Eigen::Index c) const
+  {
+    return mat_(r, c) == 0 ? ExtendedFloat() : ExtendedFloat(double(mat_(r, c)), exp_(c));
+  }
+
+  ExtendedFloatMatrix<R, 1> col(Eigen::Index c) const
+  {
+    return ExtendedFloatMatrix<R, 1>(EFMatrix<R, 1>(mat_.col(c).template cast<double>()), exp_(c) == null_column_exponent ? 0 : exp_(c));
+  }
+
+  /*
+   * @brief Same values with another storage type.
+   */
+  template<typename T2>
+  ExtendedFloatColwiseMatrix<R, C, T2> cast () const
+  {
+    ExtendedFloatColwiseMatrix<R, C, T2> r;
+    r.float_part() = mat_.template cast<T2>();
+    r.exponent_part() = exp_;
+    return r;
+  }
+
+  // Normalization methods
+
+  /*
+   * @brief Normalize column c, which exponent is exponent.
+   *
+   * @return the exponent of the normalized column.
+   */
+  template<typename Col>
+  static ExtendedFloat::ExtType normalize_column (Col&& c, ExtendedFloat::ExtType exponent)
+  {
+    double maxAbs = double(c.cwiseAbs().maxCoeff());
+    if (maxAbs == 0)
+      return null_column_exponent;
+    if (!std::isfinite(maxAbs))
+      return exponent;
+    int shift;
+    std::frexp(maxAbs, &shift);
+    if (shift == 0)
+      return exponent;
+    // 2^-shift is not representable for the smallest subnormals.
+    using S = typename std::decay<decltype(c.coeff(0))>::type;
+    if (shift > std::numeric_limits<S>::min_exponent)
+      c *= S(std::ldexp(1., -shift));
+    else
+    {
+      c *= S(std::ldexp(1., -shift / 2));
+      c *= S(std::ldexp(1., shift / 2 - shift));
+    }
+    return exponent + shift;
+  }
+
+  void normalize ()
+  {
+    for (Eigen::Index c = 0; c < cols(); c++)
+    {
+      exp_(c) = normalize_column(mat_.col(c), exp_(c));
+    }
+  }
+
+  // Operations, with normalization of the result
+
+  /*
+   * @brief result = lhs * rhs, component wise.
+   *
+   * result may be lhs or rhs.
+   */
+  static void mul (const Self& lhs, const Self& rhs, Self& result)
+  {
+    result.resize(lhs.rows(), lhs.cols());
+    for (Eigen::Index c = 0; c < lhs.cols(); c++)
+    {
+      auto rc = result.mat_.col(c);
+      rc = lhs.mat_.col(c).cwiseProduct(rhs.mat_.col(c));
+      result.exp_(c) = normalize_column(rc, lhs.exp_(c) + rhs.exp_(c));
+    }
+  }
+
+  /*
+   * @brief result = lhs + rhs, component wise.
+   *
+   * result may be lhs or rhs.
+   */
+  static void add (const Self& lhs, const Self& rhs, Self& result)
+  {
+    result.resize(lhs.rows(), lhs.cols());
+    for (Eigen::Index c = 0; c < lhs.cols(); c++)
+    {
+      auto e = std::max(lhs.exp_(c), rhs.exp_(c));
+      T lf = T(std::ldexp(1., lhs.exp_(c) - e));
+      T rf = T(std::ldexp(1., rhs.exp_(c) - e));
+      auto rc = result.mat_.col(c);
+      rc = lhs.mat_.col(c) * lf + rhs.mat_.col(c) * rf;
+      result.exp_(c) = normalize_column(rc, e);
+    }
+  }
+
+  /*
+   * @brief result = lhs * rhs, with lhs a plain matrix (for example a
+   * transition matrix, or root frequencies as a row vector), converted
+   * to T.
+   *
+   * The product is computed by blocks of block_size columns. result
+   * must not be rhs.
+   */
+  template<typename Derived, int R2>
+  static void product (const Eigen::MatrixBase<Derived>& lhs, const ExtendedFloatColwiseMatrix<R2, C, T>& rhs, Self& result)
+  {
+    const Eigen::Matrix<T, Derived::RowsAtCompileTime, Derived::ColsAtCompileTime> tlhs(lhs.template cast<T>());
+    result.resize(lhs.rows(), rhs.cols());
+    for (Eigen::Index first = 0; first < rhs.cols(); first += block_size)
+    {
+      Eigen::Index nbCols = std::min(block_size, rhs.cols() - first);
+      result.mat_.middleCols(first, nbCols).noalias() = tlhs * rhs.float_part().middleCols(first, nbCols);
+      for (Eigen::Index c = first; c < first + nbCols; c++)
+      {
+        result.exp_(c) = normalize_column(result.mat_.col(c), rhs.exponent_part()(c));
+      }
+    }
+  }
+
+  /*
+   * @brief Sum of each column, as a row vector.
+   */
+  ExtendedFloatColwiseMatrix<1, C, T> colwiseSum () const
+  {
+    ExtendedFloatColwiseMatrix<1, C, T> r;
+    r.float_part() = mat_.colwise().sum();
+    r.exponent_part() = exp_;
+    r.normalize();
+    return r;
+  }
+
+  /*
+   * @brief Sum of the logarithms of the components, for row vectors
+   * (site likelihoods).
+   */
+  template<int R2 = R>
+  typename std::enable_if<R2 == 1, double>::type sumOfLogarithms () const
+  {
+    return mat_.template cast<double>().array().log().sum() + exp_.template cast<double>().sum() * ExtendedFloat::ln_radix;
+  }
+
+  /*
+   * @brief Sum of the logarithms of the components, weighted by the
+   * numbers of occurrences of the sites.
+   */
+  template<int R2 = R>
+  typename std::enable_if<R2 == 1, double>::type sumOfLogarithms (const Eigen::RowVectorXi& weights) const
+  {
+    const auto w = weights.template cast<double>().array();
+    return (mat_.template cast<double>().array().log() * w).sum() + (exp_.template cast<double>().array() * w).sum() * ExtendedFloat::ln_radix;
+  }
+
+  /*
+   * @brief Conversion to a single exponent matrix, aligned on the largest
+   * column exponent. Columns much smaller than the largest one underflow.
+   */
+  ExtendedFloatMatrix<R, C> toExtendedFloatMatrix () const
+  {
+    EFMatrix<R, C> m(mat_.template cast<double>());
+    if (cols() == 0)
+      return ExtendedFloatMatrix<R, C>(m, 0);
+    auto e = exp_.maxCoeff();
+    if (e == null_column_exponent)
+      return ExtendedFloatMatrix<R, C>(m, 0);
+    for (Eigen::Index c = 0; c < cols(); c++)
+    {
+      m.col(c) *= std::ldexp(1., exp_(c) - e);
+    }
+    ExtendedFloatMatrix<R, C> r(m, e);
+    r.normalize();
+    return r;
+  }
+
+  friend std::ostream& operator<<(std::ostream& out, const Self& ef)
+  {
+    return out << "( " << ef.float_part() << " ) *  2^( " << ef.exponent_part() << " )";
+  }
+
+private:
+  /*
+   * @brief Set from double values, normalized before conversion to T.
+   */
+  void assign_ (const EFMatrix<R, C>& mat, const ExtType& exp)
+  {
+    resize(mat.rows(), mat.cols());
+    EFMatrix<R, 1> c;
+    for (Eigen::Index i = 0; i < mat.cols(); i++)
+    {
+      c = mat.col(i);
+      exp_(i) = normalize_column(c, exp(i));
+      mat_.col(i) = c.template cast<T>();
+    }
+  }
+
+  template< int R2,  int C2, typename T2>
+  friend class ExtendedFloatColwiseMatrix;
+};
+
+template< int R,  int C, typename T>
+constexpr ExtendedFloat::ExtType ExtendedFloatColwiseMatrix<R, C, T>::null_column_exponent;
+
+template< int R,  int C, typename T>
+constexpr Eigen::Index ExtendedFloatColwiseMatrix<R, C, T>::block_size;
+
+typedef ExtendedFloatColwiseMatrix<Eigen::Dynamic, Eigen::Dynamic> ExtendedFloatColwiseMatrixXd;
+
+typedef ExtendedFloatColwiseMatrix<1, Eigen::Dynamic> ExtendedFloatColwiseRowVectorXd;
+
+typedef ExtendedFloatColwiseMatrix<Eigen::Dynamic, Eigen::Dynamic, float> ExtendedFloatColwiseMatrixXf;
+
+typedef ExtendedFloatColwiseMatrix<1, Eigen::Dynamic, float> ExtendedFloatColwiseRowVectorXf;
+
+
 /*  Extern Methods */
 
 template< int R,  int C>
@@ -1056,5 +1378,50 @@ inline ExtendedFloatArray<R, C> operator*(const ExtendedFloatArray<R, C>& lhs,
 {
   return rhs * lhs; // cwise * is commutative
 }
+
+/*
+ * Releasable storage of the dynamic matrices, used by the DataFlow
+ * nodes under a memory budget (see valueStorageSize in DataFlow.h).
+ */
+
+template<template< int R2,  int C2> class EigenType>
+std::size_t valueStorageSize (const ExtendedFloatEigen<Eigen::Dynamic, Eigen::Dynamic, EigenType>& m)
+{
+  return std::size_t(m.float_part ().size ()) * sizeof(double);
+}
+
+template<template< int R2,  int C2> class EigenType>
+std::pair<std::size_t, std::size_t> releaseValueStorage (ExtendedFloatEigen<Eigen::Dynamic, Eigen::Dynamic, EigenType>& m)
+{
+  std::pair<std::size_t, std::size_t> shape(std::size_t(m.rows ()), std::size_t(m.cols ()));
+  m.resize (0, 0);
+  return shape;
+}
+
+template<template< int R2,  int C2> class EigenType>
+void restoreValueStorage (ExtendedFloatEigen<Eigen::Dynamic, Eigen::Dynamic, EigenType>& m, const std::pair<std::size_t, std::size_t>& shape)
+{
+  m.resize (Eigen::Index(shape.first), Eigen::Index(shape.second));
+}
+
+template<typename T>
+std::size_t valueStorageSize (const ExtendedFloatColwiseMatrix<Eigen::Dynamic, Eigen::Dynamic, T>& m)
+{
+  return std::size_t(m.rows () * m.cols ()) * sizeof(T) + std::size_t(m.cols ()) * sizeof(ExtendedFloat::ExtType);
+}
+
+template<typename T>
+std::pair<std::size_t, std::size_t> releaseValueStorage (ExtendedFloatColwiseMatrix<Eigen::Dynamic, Eigen::Dynamic, T>& m)
+{
+  std::pair<std::size_t, std::size_t> shape(std::size_t(m.rows ()), std::size_t(m.cols ()));
+  m.resize (0, 0);
+  return shape;
+}
+
+template<typename T>
+void restoreValueStorage (ExtendedFloatColwiseMatrix<Eigen::Dynamic, Eigen::Dynamic, T>& m, const std::pair<std::size_t, std::size_t>& shape)
+{
+  m.resize (Eigen::Index(shape.first), Eigen::Index(shape.second));
+}
 }
 #endif // BPP_PHYL_LIKELIHOOD_DATAFLOW_EXTENDEDFLOATEIGEN_H
@@ -42,36 +42,79 @@
 #include "ForwardLikelihoodTree.h"
 #include "Model.h"
 #include "Parametrizable.h"
-#include "Sequence_DF.h"
 
 using namespace bpp;
 using namespace std;
 
-ConditionalLikelihoodForwardRef ForwardLikelihoodTree::makeInitialConditionalLikelihood (const string& sequenceName, const AlignedValuesContainer& sites)
+TipLikelihood ForwardLikelihoodTree::makeTipLikelihood (const string& sequenceName, const AlignedValuesContainer& sites, const StateMap& statemap)
 {
   size_t nbSites = sites.getNumberOfSites();
   const auto sequenceIndex = sites.getSequencePosition (sequenceName);
-  Eigen::MatrixXd initCondLik ((int)nbState_, (int)nbSites);
+  const auto nbState = statemap.getNumberOfModelStates();
+
+  // Distinct columns (states or ambiguity codes) and their indexes
+  TipLikelihood tip;
+  tip.siteCodes.resize (Eigen::Index (nbSites));
+  std::map<std::vector<double>, int> codes;
+  std::vector<std::vector<double> > columns;
+  std::vector<double> column (nbState);
   for (size_t site = 0; site < nbSites; ++site)
   {
-    for (auto state = 0; state < nbState_; ++state)
+    for (size_t state = 0; state < nbState; ++state)
     {
-      initCondLik (Eigen::Index (state), Eigen::Index (site)) =
-        sites (site, sequenceIndex, statemap_.getAlphabetStateAsInt(size_t(state)));
+      column[state] = sites (site, sequenceIndex, statemap.getAlphabetStateAsInt(state));
     }
+    auto code = codes.emplace (column, int(columns.size ()));
+    if (code.second)
+      columns.push_back (column);
+    tip.siteCodes (Eigen::Index (site)) = code.first->second;
   }
 
-  return Sequence_DF::create (context_, std::move(initCondLik), sequenceName);
+  tip.codeLikelihoods.resize (Eigen::Index (nbState), Eigen::Index (columns.size ()));
+  for (size_t code = 0; code < columns.size (); ++code)
+  {
+    for (size_t state = 0; state < nbState; ++state)
+    {
+      tip.codeLikelihoods (Eigen::Index (state), Eigen::Index (code)) = columns[code][state];
+    }
+  }
+  return tip;
 }
 
-ForwardLikelihoodBelowRef ForwardLikelihoodTree::makeForwardLikelihoodAtEdge (shared_ptr<ProcessEdge> processEdge, const AlignedValuesContainer& sites)
+ConditionalLikelihoodForwardRef ForwardLikelihoodTree::makeInitialConditionalLikelihood (const string& sequenceName, const TipLikelihoods& tips)
+{
+  auto it = tips.find (sequenceName);
+  if (it == tips.end ())
+    throw Exception ("ForwardLikelihoodTree::makeInitialConditionalLikelihood : no likelihood for leaf " + sequenceName);
+  if (it->second.getNumberOfStates () != nbState_ || it->second.getNumberOfSites () != nbSites_)
+    throw Exception ("ForwardLikelihoodTree::makeInitialConditionalLikelihood : bad dimensions of the likelihood of leaf " + sequenceName);
+
+  auto tip = it->second;
+  auto tipSequence = TipSequence_DF::create (context_, std::move(tip), sequenceName);
+  return TipConditionalLikelihood::create (context_, {tipSequence}, likelihoodMatrixDim_);
+}
+
+ValueRef<Eigen::MatrixXd> ForwardLikelihoodTree::makeTransitionMatrix (Context& c, shared_ptr<ProcessEdge> processEdge, Eigen::Index nbState)
 {
-  const auto brlen = processEdge->getBrLen();
   const auto model = processEdge->getModel();
   const auto nMod = processEdge->getNMod();
+  auto zero = NumericConstant<size_t>::create(c, size_t(0));
+
+  // One matrix per branch, from the eigen decomposition shared by the branches of the model.
+  auto decomposition = EigenDecompositionFromModel::create (c, {model, nMod}, size_t(nbState));
+  auto transitionMatrix = ConfiguredParametrizable::createMatrix<ConfiguredModel, TransitionMatrixFromModel, Eigen::MatrixXd>(c, {model, processEdge->getBrLen(), zero, nMod, decomposition}, transitionMatrixDimension (size_t(nbState)));
+
+  processEdge->setTransitionMatrix(transitionMatrix);
+  return transitionMatrix;
+}
+
+ForwardLikelihoodBelowRef ForwardLikelihoodTree::makeForwardLikelihoodAtEdge (shared_ptr<ProcessEdge> processEdge, const TipLikelihoods& tips)
+{
+  const auto brlen = processEdge->getBrLen();
+  const auto model = processEdge->getModel();
   const auto brprob = processEdge->getProba();
 
-  auto childConditionalLikelihood = makeForwardLikelihoodAtNode (processTree_->getSon(processEdge), sites);
+  auto childConditionalLikelihood = makeForwardLikelihoodAtNode (processTree_->getSon(processEdge), tips);
 
   ForwardLikelihoodBelowRef forwardEdge;
 
@@ -81,11 +124,16 @@ ForwardLikelihoodBelowRef ForwardLikelihoodTree::makeForwardLikelihoodAtEdge (sh
   {
     if (dynamic_cast<const TransitionModel*>(model->getTargetValue()))
     {
-      auto transitionMatrix = ConfiguredParametrizable::createMatrix<ConfiguredModel, TransitionMatrixFromModel, Eigen::MatrixXd>(context_, {model, brlen, zero, nMod}, transitionMatrixDimension (size_t(nbState_)));
-
-      processEdge->setTransitionMatrix(transitionMatrix);
-      forwardEdge = ForwardTransition::create (
-        context_, {transitionMatrix, childConditionalLikelihood}, likelihoodMatrixDim_);
+      auto transitionMatrix = makeTransitionMatrix (context_, processEdge, nbState_);
+
+      // Leaves: the transition is computed on the compact sequence.
+      auto tipConditionalLikelihood = std::dynamic_pointer_cast<TipConditionalLikelihood>(childConditionalLikelihood);
+      if (tipConditionalLikelihood)
+        forwardEdge = ForwardTipTransition::create (
+          context_, {transitionMatrix, tipConditionalLikelihood->dependency (0)}, likelihoodMatrixDim_);
+      else
+        forwardEdge = ForwardTransition::create (
+          context_, {transitionMatrix, childConditionalLikelihood}, likelihoodMatrixDim_);
     }
     else
     {
@@ -131,7 +179,7 @@ ForwardLikelihoodBelowRef ForwardLikelihoodTree::makeForwardLikelihoodAtEdge (sh
   return forwardEdge;
 }
 
-ConditionalLikelihoodForwardRef ForwardLikelihoodTree::makeForwardLikelihoodAtNode (shared_ptr<ProcessNode> processNode, const AlignedValuesContainer& sites)
+ConditionalLikelihoodForwardRef ForwardLikelihoodTree::makeForwardLikelihoodAtNode (shared_ptr<ProcessNode> processNode, const TipLikelihoods& tips)
 {
   const auto childBranches = processTree_->getBranches (processNode);
 
@@ -141,7 +189,7 @@ ConditionalLikelihoodForwardRef ForwardLikelihoodTree::makeForwardLikelihoodAtNo
 
   if (childBranches.empty ())
   {
-    forwardNode = makeInitialConditionalLikelihood (processNode->getName (), sites);
+    forwardNode = makeInitialConditionalLikelihood (processNode->getName (), tips);
     if (!hasNodeIndex(forwardNode))
     {
       createNode(forwardNode);
@@ -160,11 +208,30 @@ ConditionalLikelihoodForwardRef ForwardLikelihoodTree::makeForwardLikelihoodAtNo
 
     for (size_t i = 0; i < childBranches.size (); ++i)
     {
-      depE[i] = makeForwardLikelihoodAtEdge (childBranches[i], sites);
+      depE[i] = makeForwardLikelihoodAtEdge (childBranches[i], tips);
       deps[i] = depE[i];
     }
 
+    // Speciation with only transitions below: computed on the site
+    // repeats of the node.
+    NodeRefVec repeatsDeps;
     if (processNode->isSpeciation())
+    {
+      for (const auto& edge : depE)
+      {
+        if (!std::dynamic_pointer_cast<TipTransition>(edge) && !std::dynamic_pointer_cast<ForwardTransition>(edge))
+        {
+          repeatsDeps.clear();
+          break;
+        }
+        repeatsDeps.push_back(edge->dependency (0));
+        repeatsDeps.push_back(edge->dependency (1));
+      }
+    }
+
+    if (!repeatsDeps.empty())
+      forwardNode = SpeciationRepeats::create(context_, std::move(repeatsDeps), likelihoodMatrixDim_);
+    else if (processNode->isSpeciation())
       forwardNode = SpeciationForward::create(context_, std::move(deps),
                                               likelihoodMatrixDim_);
     else if (processNode->isMixture())
@@ -46,6 +46,8 @@
 
 #include "Bpp/Phyl/Likelihood/DataFlow/ProcessTree.h"
 #include "Definitions.h"
+#include "Sequence_DF.h"
+#include "SiteRepeats.h"
 
 namespace bpp
 {
@@ -73,6 +75,14 @@ inline MatrixDimension conditionalLikelihoodDimension (Eigen::Index nbState, Eig
 
 using SpeciationForward = CWiseMul<MatrixLik, ReductionOf<MatrixLik> >;
 
+/** conditionalLikelihood = f(transitionMatrix[i], forwardLikelihood[children[i]] for i).
+ * Same as SpeciationForward of transitions, computed once per
+ * site repeat of the subtree (see SpeciationSiteRepeats). Leaves are
+ * their TipLikelihood.
+ */
+
+using SpeciationRepeats = SpeciationSiteRepeats;
+
 /** conditionalLikelihood = f(forwardLikelihood[children[i]] for i).
  * conditionalLikelihood: Matrix(state, site).
  * forwardLikelihood[i]: Matrix(state, site).
@@ -94,6 +104,16 @@ using MixtureForward = CWiseAdd<MatrixLik, ReductionOf<MatrixLik> >;
 using ForwardTransition =
   MatrixProduct<MatrixLik, Eigen::MatrixXd, MatrixLik>;
 
+/** @brief forwardLikelihood = f(transitionMatrix, tip) for leaf edges.
+ * - forwardLikelihood: Matrix(state, site).
+ * - transitionMatrix: Matrix (fromState, toState)
+ * - tip: TipLikelihood, distinct columns of the leaf and their sites.
+ *
+ * Same as ForwardTransition, computed once per distinct column.
+ */
+
+using ForwardTipTransition = TipTransition;
+
 using ForwardTransitionFunction =
   CWiseApply<MatrixLik, MatrixLik, TransitionFunction>;
 
@@ -162,7 +182,26 @@ public:
 
   void initialize(const AlignedValuesContainer& sites)
   {
-    nbSites_ = Eigen::Index(sites.getNumberOfSites ());
+    TipLikelihoods tips;
+    for (const auto& leaf : processTree_->getAllLeaves ())
+    {
+      if (tips.find (leaf->getName ()) == tips.end ())
+        tips.emplace (leaf->getName (), makeTipLikelihood (leaf->getName (), sites, statemap_));
+    }
+    initialize (tips);
+  }
+
+  /*
+   * @brief Build from the compact likelihoods of the leaves, for
+   * example read from a LikelihoodSnapshot, without the sequences.
+   *
+   */
+
+  void initialize(const TipLikelihoods& tips)
+  {
+    if (tips.empty ())
+      throw Exception("ForwardLikelihoodTree::initialize : no leaf likelihood.");
+    nbSites_ = tips.begin ()->second.getNumberOfSites ();
     likelihoodMatrixDim_ = conditionalLikelihoodDimension (nbState_, nbSites_);
     ConditionalLikelihoodForwardRef bidonRoot = ConstantZero<MatrixLik>::create(context_, MatrixDimension(1, 1));
     createNode(bidonRoot);
@@ -172,11 +211,28 @@ public:
      */
 
     rootAt(bidonRoot); // for construction, temporary top node for new edges
-    auto n = makeForwardLikelihoodAtNode (processTree_->getRoot(), sites);
+    auto n = makeForwardLikelihoodAtNode (processTree_->getRoot(), tips);
     rootAt(n);
     deleteNode(bidonRoot);
   }
 
+  /*
+   * @brief Compact conditional likelihood of a sequence (distinct
+   * columns and their sites), with the states of the StateMap.
+   *
+   */
+
+  static TipLikelihood makeTipLikelihood (const std::string& sequenceName, const AlignedValuesContainer& sites, const StateMap& statemap);
+
+  /*
+   * @brief Transition matrix of an edge with a TransitionModel, from
+   * the eigen decomposition shared by the edges of the model. The
+   * matrix is set on the edge.
+   *
+   */
+
+  static ValueRef<Eigen::MatrixXd> makeTransitionMatrix (Context& c, std::shared_ptr<ProcessEdge> processEdge, Eigen::Index nbState);
+
 private:
   /*
    * @brief Compute ConditionalLikelihood after reading edge on
@@ -184,7 +240,7 @@ private:
    *
    */
 
-  ForwardLikelihoodBelowRef makeForwardLikelihoodAtEdge (std::shared_ptr<ProcessEdge> edge, const AlignedValuesContainer& sites);
+  ForwardLikelihoodBelowRef makeForwardLikelihoodAtEdge (std::shared_ptr<ProcessEdge> edge, const TipLikelihoods& tips);
 
   /*
    * @brief Compute ConditionalLikelihood after reading node on
@@ -192,14 +248,16 @@ private:
    *
    */
 
-  ConditionalLikelihoodForwardRef makeForwardLikelihoodAtNode (std::shared_ptr<ProcessNode> node, const AlignedValuesContainer& sites);
+  ConditionalLikelihoodForwardRef makeForwardLikelihoodAtNode (std::shared_ptr<ProcessNode> node, const TipLikelihoods& tips);
 
   /*
    * @brief Compute ConditionalLikelihood for leaf.
    *
+   * The leaf is stored as a TipLikelihood (distinct columns and
+   * their sites), the returned node expands it only if needed.
    */
 
-  ConditionalLikelihoodForwardRef makeInitialConditionalLikelihood (const std::string& sequenceName, const AlignedValuesContainer& sites);
+  ConditionalLikelihoodForwardRef makeInitialConditionalLikelihood (const std::string& sequenceName, const TipLikelihoods& tips);
 
   /*
    * @brief Map the species indexes and the likelihood DAG
@@ -110,6 +110,12 @@ public:
     return static_cast<const ConfiguredParameter&>(getParameter(name));
   }
 
+  /// Updates the wrapped bpp object (see Node_DF::isThreadSafe).
+  bool isThreadSafe () const final
+  {
+    return false;
+  }
+
 private:
   void compute ()
   {
@@ -136,7 +136,7 @@ protected:
     throw Exception("LikelihoodCalculation:: makeLikelihoods should not be called. Probably likelihood_ is null.");
   }
 
-  Context& getContext_()
+  Context& getContext_() const
   {
     return context_;
   }
@@ -14,6 +14,8 @@
 #include "Bpp/Phyl/Likelihood/DataFlow/BackwardLikelihoodTree.h"
 #include "Bpp/Phyl/Likelihood/DataFlow/ForwardLikelihoodTree.h"
 #include "Bpp/Phyl/Likelihood/DataFlow/LikelihoodCalculationSingleProcess.h"
+#include "Bpp/Phyl/Likelihood/DataFlow/RateCategoriesForward.h"
+#include "Bpp/Phyl/Likelihood/DataFlow/SiteScaledForward.h"
 #include "Bpp/Phyl/Likelihood/SubstitutionProcessCollectionMember.h"
 
 using namespace std;
@@ -25,9 +27,9 @@ LikelihoodCalculationSingleProcess::LikelihoodCalculationSingleProcess(Context&
                                                                        const AlignedValuesContainer& sites,
                                                                        const SubstitutionProcess& process) :
   AlignedLikelihoodCalculation(context), process_(process), psites_(&sites),
-  rootPatternLinks_(), rootWeights_(), shrunkData_(),
+  rootPatternLinks_(), rootWeights_(), shrunkData_(), tips_(),
   processNodes_(), rFreqs_(),
-  vRateCatTrees_(), condLikelihoodTree_(0)
+  vRateCatTrees_(), stackedRoot_(), perCategoryTrees_(false), siteScaled_(false), condLikelihoodTree_(0)
 {
   if (!process_.getParametrizablePhyloTree())
     throw Exception("LikelihoodCalculationSingleProcess::LikelihoodCalculationSingleProcess: missing tree in SubstitutionProcess.");
@@ -42,9 +44,9 @@ LikelihoodCalculationSingleProcess::LikelihoodCalculationSingleProcess(Context&
                                                                        const SubstitutionProcess& process) :
   AlignedLikelihoodCalculation(context),
   process_(process), psites_(),
-  rootPatternLinks_(), rootWeights_(), shrunkData_(),
+  rootPatternLinks_(), rootWeights_(), shrunkData_(), tips_(),
   processNodes_(), rFreqs_(),
-  vRateCatTrees_(), condLikelihoodTree_(0)
+  vRateCatTrees_(), stackedRoot_(), perCategoryTrees_(false), siteScaled_(false), condLikelihoodTree_(0)
 {
   if (!process_.getParametrizablePhyloTree())
     throw Exception("LikelihoodCalculationSingleProcess::LikelihoodCalculationSingleProcess: missing tree in SubstitutionProcess.");
@@ -59,9 +61,9 @@ LikelihoodCalculationSingleProcess::LikelihoodCalculationSingleProcess(Collectio
                                                                        const AlignedValuesContainer& sites,
                                                                        size_t nProcess) :
   AlignedLikelihoodCalculation(collection.getContext()), process_(collection.getCollection().getSubstitutionProcess(nProcess)), psites_(&sites),
-  rootPatternLinks_(), rootWeights_(), shrunkData_(),
+  rootPatternLinks_(), rootWeights_(), shrunkData_(), tips_(),
   processNodes_(), rFreqs_(),
-  vRateCatTrees_(), condLikelihoodTree_(0)
+  vRateCatTrees_(), stackedRoot_(), perCategoryTrees_(false), siteScaled_(false), condLikelihoodTree_(0)
 {
   if (!process_.getParametrizablePhyloTree())
     throw Exception("LikelihoodCalculationSingleProcess::LikelihoodCalculationSingleProcess: missing tree in SubstitutionProcess.");
@@ -77,9 +79,9 @@ LikelihoodCalculationSingleProcess::LikelihoodCalculationSingleProcess(Collectio
 LikelihoodCalculationSingleProcess::LikelihoodCalculationSingleProcess(CollectionNodes& collection,
                                                                        size_t nProcess) :
   AlignedLikelihoodCalculation(collection.getContext()), process_(collection.getCollection().getSubstitutionProcess(nProcess)), psites_(),
-  rootPatternLinks_(), rootWeights_(), shrunkData_(),
+  rootPatternLinks_(), rootWeights_(), shrunkData_(), tips_(),
   processNodes_(), rFreqs_(),
-  vRateCatTrees_(), condLikelihoodTree_(0)
+  vRateCatTrees_(), stackedRoot_(), perCategoryTrees_(false), siteScaled_(false), condLikelihoodTree_(0)
 {
   makeProcessNodes_(collection, nProcess);
 
@@ -91,11 +93,12 @@ LikelihoodCalculationSingleProcess::LikelihoodCalculationSingleProcess(Collectio
 LikelihoodCalculationSingleProcess::LikelihoodCalculationSingleProcess(const LikelihoodCalculationSingleProcess& lik) :
   AlignedLikelihoodCalculation(lik),
   process_(lik.process_), psites_(lik.psites_),
-  rootPatternLinks_(lik.rootPatternLinks_), rootWeights_(), shrunkData_(lik.shrunkData_),
+  rootPatternLinks_(lik.rootPatternLinks_), rootWeights_(lik.rootWeights_), shrunkData_(lik.shrunkData_), tips_(lik.tips_),
   processNodes_(), rFreqs_(),
-  vRateCatTrees_(), condLikelihoodTree_(0)
+  vRateCatTrees_(), stackedRoot_(), perCategoryTrees_(false), siteScaled_(lik.siteScaled_), condLikelihoodTree_(0)
 {
-  setPatterns_();
+  if (psites_)
+    setPatterns_();
   makeProcessNodes_();
 
   // Default Derivate
@@ -116,6 +119,34 @@ void LikelihoodCalculationSingleProcess::setPatterns_()
   rootWeights_ = SiteWeights::create(getContext_(), std::move(weights));
 }
 
+void LikelihoodCalculationSingleProcess::setPatterns(const PatternType& patternLinks, const Eigen::RowVectorXi& weights, const TipLikelihoods& tips)
+{
+  if (tips.empty())
+    throw Exception("LikelihoodCalculationSingleProcess::setPatterns : no leaf likelihood.");
+  for (const auto& tip : tips)
+  {
+    if (tip.second.getNumberOfSites() != weights.size())
+      throw BadSizeException("LikelihoodCalculationSingleProcess::setPatterns : bad number of patterns for leaf " + tip.first, size_t(tip.second.getNumberOfSites()), size_t(weights.size()));
+  }
+  for (Eigen::Index i = 0; i < patternLinks.size(); i++)
+  {
+    if (patternLinks(i) >= size_t(weights.size()))
+      throw IndexOutOfBoundsException("LikelihoodCalculationSingleProcess::setPatterns : bad pattern of site.", patternLinks(i), 0, size_t(weights.size()));
+  }
+
+  psites_ = 0;
+  shrunkData_.reset();
+  tips_ = tips;
+  rootPatternLinks_ = NumericConstant<PatternType>::create(getContext_(), patternLinks);
+  rootWeights_ = SiteWeights::create(getContext_(), weights);
+  if (isInitialized())
+  {
+    vRateCatTrees_.clear();
+    perCategoryTrees_ = false;
+    makeLikelihoodsAtRoot_();
+  }
+}
+
 void LikelihoodCalculationSingleProcess::makeProcessNodes_()
 {
 #ifdef DEBUG
@@ -386,14 +417,15 @@ void LikelihoodCalculationSingleProcess::makeRootFreqs_()
 }
 
 
-void LikelihoodCalculationSingleProcess::makeForwardLikelihoodTree_()
+void LikelihoodCalculationSingleProcess::makeRateCategoryTrees_()
 {
-  // Build conditional likelihoods up to root recursively.
   if (!processNodes_.treeNode_->isRooted ())
   {
-    throw Exception ("LikelihoodCalculationSingleProcess::makeForwardLikelihoodTree_ : PhyloTree must be rooted");
+    throw Exception ("LikelihoodCalculationSingleProcess::makeRateCategoryTrees_ : PhyloTree must be rooted");
   }
 
+  // Process trees of the rate categories, their forward likelihood
+  // trees are built on demand (see getForwardLikelihoodTree).
   if (processNodes_.ratesNode_)
   {
     uint nbCat = (uint)processNodes_.ratesNode_->getTargetValue()->getNumberOfCategories();
@@ -404,31 +436,13 @@ void LikelihoodCalculationSingleProcess::makeForwardLikelihoodTree_()
     {
       ValueRef<double> catRef = CategoryFromDiscreteDistribution::create(getContext_(), {processNodes_.ratesNode_}, nCat);
 
-      auto treeCat = std::make_shared<ProcessTree>(*processNodes_.treeNode_, catRef);
-
-      vRateCatTrees_[nCat].phyloTree = treeCat;
-
-      auto flt = std::make_shared<ForwardLikelihoodTree>(getContext_(), treeCat, getStateMap());
-
-      if (getShrunkData())
-        flt->initialize(*getShrunkData());
-      else
-        flt->initialize(*psites_);
-      vRateCatTrees_[nCat].flt = flt;
+      vRateCatTrees_[nCat].phyloTree = std::make_shared<ProcessTree>(*processNodes_.treeNode_, catRef);
     }
   }
   else
   {
     vRateCatTrees_.resize(1);
     vRateCatTrees_[0].phyloTree = processNodes_.treeNode_;
-
-    auto flt = std::make_shared<ForwardLikelihoodTree >(getContext_(), processNodes_.treeNode_, processNodes_.modelNode_->getTargetValue()->getStateMap());
-
-    if (getShrunkData())
-      flt->initialize(*getShrunkData());
-    else
-      flt->initialize(*psites_);
-    vRateCatTrees_[0].flt = flt;
   }
 }
 
@@ -436,7 +450,7 @@ void LikelihoodCalculationSingleProcess::makeForwardLikelihoodTree_()
 void LikelihoodCalculationSingleProcess::makeLikelihoodsAtRoot_()
 {
   if (vRateCatTrees_.size() == 0)
-    makeForwardLikelihoodTree_();
+    makeRateCategoryTrees_();
 
   size_t nbDistSite = getNumberOfDistinctSites();
 
@@ -446,16 +460,43 @@ void LikelihoodCalculationSingleProcess::makeLikelihoodsAtRoot_()
 
   ValueRef<RowLik> sL;
 
-  if (processNodes_.ratesNode_)
+  // Rate categories stacked in one forward likelihood, when the tree
+  // allows it and the per category trees are not computed anyway
+  // (see getForwardLikelihoodTree).
+  stackedRoot_.reset();
+  const auto nbCat = Eigen::Index(vRateCatTrees_.size());
+  const auto nbState = Eigen::Index(getStateMap().getNumberOfModelStates());
+  if (processNodes_.ratesNode_ && nbCat > 1 && !perCategoryTrees_)
+  {
+    stackedRoot_ = std::dynamic_pointer_cast<Value<MatrixLik> >(makeRateCategoriesForwardAtNode_(
+                                                                  vRateCatTrees_[0].phyloTree->getRoot(),
+                                                                  conditionalLikelihoodDimension (nbState, nbCat * Eigen::Index(nbDistSite))));
+  }
+
+  if (stackedRoot_)
+  {
+    NodeRefVec deps;
+    deps.push_back(LikelihoodFromRootConditionalAtRoot::create (
+                     getContext_(), {rFreqs_, stackedRoot_},
+                     RowVectorDimension (nbCat * Eigen::Index (nbDistSite))));
+
+    for (size_t nCat = 0; nCat < vRateCatTrees_.size(); nCat++)
+    {
+      deps.push_back(ProbabilityFromDiscreteDistribution::create(getContext_(), {processNodes_.ratesNode_}, (uint)nCat));
+    }
+
+    sL = RateCategoriesMean::create(getContext_(), std::move(deps), RowVectorDimension (Eigen::Index(nbDistSite)));
+  }
+  else if (processNodes_.ratesNode_)
   {
     std::vector<std::shared_ptr<Node_DF> > vLikRoot;
 
     auto zero = NumericConstant<size_t>::create(getContext_(), size_t(0));
 
-    for (auto& rateCat: vRateCatTrees_)
+    for (size_t nCat = 0; nCat < vRateCatTrees_.size(); nCat++)
     {
       vLikRoot.push_back(LikelihoodFromRootConditionalAtRoot::create (
-                           getContext_(), {rFreqs_, rateCat.flt->getForwardLikelihoodArrayAtRoot()},
+                           getContext_(), {rFreqs_, getForwardLikelihoodTree(nCat)->getForwardLikelihoodArrayAtRoot()},
                            RowVectorDimension (Eigen::Index (nbDistSite))));
     }
 
@@ -471,7 +512,7 @@ void LikelihoodCalculationSingleProcess::makeLikelihoodsAtRoot_()
   else
   {
     sL = LikelihoodFromRootConditionalAtRoot::create (
-      getContext_(), {rFreqs_, vRateCatTrees_[0].flt->getForwardLikelihoodArrayAtRoot()}, RowVectorDimension (Eigen::Index (nbDistSite)));
+      getContext_(), {rFreqs_, getForwardLikelihoodTree(0)->getForwardLikelihoodArrayAtRoot()}, RowVectorDimension (Eigen::Index (nbDistSite)));
   }
 
 
@@ -488,7 +529,31 @@ void LikelihoodCalculationSingleProcess::makeLikelihoodsAtRoot_()
   else
     val = SumOfLogarithms<RowLik>::create (getContext_(), {sL}, RowVectorDimension (Eigen::Index (nbDistSite)));
 
-  setLikelihoodNode(val);
+  // Same log-likelihood with one exponent per site, if asked and when
+  // the tree allows it. val and sL are then only computed on demand,
+  // for the site likelihoods, the second order derivatives and the
+  // check of single precision values.
+  ValueRef<DataLik> lik = val;
+  auto siteScaledRoot = siteScaled_ ? makeRateCategoriesForwardAtNode_(
+    vRateCatTrees_[0].phyloTree->getRoot(),
+    conditionalLikelihoodDimension (nbState, nbCat * Eigen::Index(nbDistSite)), true) : nullptr;
+  if (siteScaledRoot)
+  {
+    NodeRefVec deps = {rFreqs_, siteScaledRoot};
+    for (size_t nCat = 0; nCat < vRateCatTrees_.size(); nCat++)
+    {
+      if (processNodes_.ratesNode_)
+        deps.push_back(ProbabilityFromDiscreteDistribution::create(getContext_(), {processNodes_.ratesNode_}, (uint)nCat));
+      else
+        deps.push_back(NumericConstant<double>::create(getContext_(), 1.));
+    }
+    if (rootPatternLinks_)
+      deps.push_back(rootWeights_);
+
+    lik = SiteScaledLogLikelihood::create(getContext_(), std::move(deps), val, vRateCatTrees_.size());
+  }
+
+  setLikelihoodNode(lik);
 
 
 #ifdef DEBUG
@@ -499,6 +564,101 @@ void LikelihoodCalculationSingleProcess::makeLikelihoodsAtRoot_()
 }
 
 
+void LikelihoodCalculationSingleProcess::setSiteScaledLikelihood(bool yn)
+{
+  if (siteScaled_ == yn)
+    return;
+  siteScaled_ = yn;
+  if (isInitialized())
+    makeLikelihoodsAtRoot_();
+}
+
+DataFlowOptimizer::Report LikelihoodCalculationSingleProcess::foldConstants(const ParameterList& variables)
+{
+  NodeRefVec variableNodes;
+  for (size_t i = 0; i < variables.size(); i++)
+  {
+    const auto& name = variables[i].getName();
+    if (!hasParameter(name))
+      continue;
+    auto param = dynamic_cast<const ConfiguredParameter*>(getSharedParameter(name).get());
+    if (param)
+      variableNodes.push_back(param->dependency(0));
+  }
+
+  NodeRefVec roots = {getLikelihoodNode(), getSiteLikelihoods(true)};
+  auto siteScaled = dynamic_cast<const SiteScaledLogLikelihood*>(roots[0].get());
+  if (siteScaled)
+    roots.push_back(siteScaled->getEquivalent());
+
+  DataFlowOptimizer::Report report;
+  DataFlowOptimizer::foldConstants(getContext_(), roots, variableNodes, report);
+  return report;
+}
+
+
+NodeRef LikelihoodCalculationSingleProcess::makeRateCategoriesForwardAtNode_(shared_ptr<ProcessNode> processNode, const MatrixDimension& stackedDim, bool siteScaled)
+{
+  const auto& processTree = vRateCatTrees_[0].phyloTree;
+  const auto nbState = stackedDim.rows;
+
+  const auto childBranches = processTree->getBranches(processNode);
+  if (childBranches.empty() || !processNode->isSpeciation())
+    return nullptr;
+
+  NodeRefVec deps;
+  for (const auto& processEdge : childBranches)
+  {
+    if (!processEdge->getBrLen() || !dynamic_cast<const TransitionModel*>(processEdge->getModel()->getTargetValue()))
+      return nullptr;
+
+    // Transition matrices of the edge in each category, the same
+    // nodes as in the ForwardLikelihoodTree of the category.
+    const auto edgeIndex = processTree->getEdgeIndex(processEdge);
+    for (auto& rateCat : vRateCatTrees_)
+    {
+      deps.push_back(ForwardLikelihoodTree::makeTransitionMatrix(getContext_(), rateCat.phyloTree->getEdge(edgeIndex), nbState));
+    }
+
+    const auto son = processTree->getSon(processEdge);
+    if (processTree->getBranches(son).empty())
+      deps.push_back(makeTipSequence_(son->getName()));
+    else
+    {
+      auto below = makeRateCategoriesForwardAtNode_(son, stackedDim, siteScaled);
+      if (!below)
+        return nullptr;
+      deps.push_back(below);
+    }
+  }
+
+  // Transitions and speciation computed on the site repeats.
+  if (siteScaled)
+    return SiteScaledSpeciation::create(getContext_(), std::move(deps), stackedDim, vRateCatTrees_.size());
+  else
+    return SpeciationSiteRepeats::create(getContext_(), std::move(deps), stackedDim, vRateCatTrees_.size());
+}
+
+ValueRef<TipLikelihood> LikelihoodCalculationSingleProcess::makeTipSequence_(const std::string& sequenceName)
+{
+  TipLikelihood tip;
+  if (!tips_.empty())
+  {
+    auto it = tips_.find(sequenceName);
+    if (it == tips_.end())
+      throw Exception("LikelihoodCalculationSingleProcess::makeTipSequence_ : no likelihood for leaf " + sequenceName);
+    tip = it->second;
+  }
+  else if (getShrunkData())
+    tip = ForwardLikelihoodTree::makeTipLikelihood(sequenceName, *getShrunkData(), getStateMap());
+  else
+    tip = ForwardLikelihoodTree::makeTipLikelihood(sequenceName, *psites_, getStateMap());
+
+  // Same node as the leaf of the ForwardLikelihoodTrees
+  return TipSequence_DF::create(getContext_(), std::move(tip), sequenceName);
+}
+
+
 void LikelihoodCalculationSingleProcess::makeLikelihoodsAtNode_(uint speciesId)
 {
   // Already built
@@ -506,7 +666,7 @@ void LikelihoodCalculationSingleProcess::makeLikelihoodsAtNode_(uint speciesId)
     return;
 
   if (vRateCatTrees_.size() == 0)
-    makeForwardLikelihoodTree_();
+    makeRateCategoryTrees_();
 
   if (rFreqs_ == 0)
     makeRootFreqs_();
@@ -534,22 +694,25 @@ void LikelihoodCalculationSingleProcess::makeLikelihoodsAtNode_(uint speciesId)
 
   auto one = ConstantOne<Eigen::RowVectorXd>::create(getContext_(), RowVectorDimension (nbState));
 
-  for (auto& rateCat: vRateCatTrees_)
+  for (size_t nCat = 0; nCat < vRateCatTrees_.size(); nCat++)
   {
+    auto& rateCat = vRateCatTrees_[nCat];
+    auto flt = getForwardLikelihoodTree(nCat);
+
     if (!rateCat.blt)
-      rateCat.blt = std::make_shared<BackwardLikelihoodTree>(getContext_(), rateCat.flt, rateCat.phyloTree, rFreqs_, stateMap, nbDistSite);
+      rateCat.blt = std::make_shared<BackwardLikelihoodTree>(getContext_(), flt, rateCat.phyloTree, rFreqs_, stateMap, nbDistSite);
 
     if (!rateCat.clt)
-      rateCat.clt = std::make_shared<ConditionalLikelihoodDAG>(rateCat.flt->getGraph());
+      rateCat.clt = std::make_shared<ConditionalLikelihoodDAG>(flt->getGraph());
 
     if (!rateCat.lt)
-      rateCat.lt = std::make_shared<SiteLikelihoodsDAG>(rateCat.flt->getGraph());
+      rateCat.lt = std::make_shared<SiteLikelihoodsDAG>(flt->getGraph());
 
 
     if (!rateCat.speciesLt)
       rateCat.speciesLt = std::make_shared<SiteLikelihoodsTree>(phylotree->getGraph());
 
-    auto& dagIndexes = rateCat.flt->getDAGNodesIndexes(speciesId);
+    auto& dagIndexes = flt->getDAGNodesIndexes(speciesId);
 
     std::vector<std::shared_ptr<Node_DF> > vCond;
 
@@ -564,7 +727,7 @@ void LikelihoodCalculationSingleProcess::makeLikelihoodsAtNode_(uint speciesId)
       }
 
       auto condAbove = rateCat.blt->getBackwardLikelihoodArray(index);
-      auto condBelow = rateCat.flt->getForwardLikelihoodArray(index);
+      auto condBelow = flt->getForwardLikelihoodArray(index);
 
       cond = BuildConditionalLikelihood::create (
         getContext_(), {condAbove, condBelow}, likelihoodMatrixDim);
@@ -572,14 +735,14 @@ void LikelihoodCalculationSingleProcess::makeLikelihoodsAtNode_(uint speciesId)
       if (dagIndexes.size() > 1) // for sum
         vCond.push_back(cond);
 
-      rateCat.clt->associateNode(cond, rateCat.flt->getNodeGraphid(rateCat.flt->getNode(index)));
+      rateCat.clt->associateNode(cond, flt->getNodeGraphid(flt->getNode(index)));
       rateCat.clt->setNodeIndex(cond, index);
 
       // Site Likelihoods on this point
       auto lt = LikelihoodFromRootConditionalAtRoot::create (
         getContext_(), {one, cond}, RowVectorDimension (nbDistSite));
 
-      rateCat.lt->associateNode(lt, rateCat.flt->getNodeGraphid(rateCat.flt->getNode(index)));
+      rateCat.lt->associateNode(lt, flt->getNodeGraphid(flt->getNode(index)));
       rateCat.lt->setNodeIndex(lt, index);
     }
 
@@ -641,7 +804,7 @@ void LikelihoodCalculationSingleProcess::makeLikelihoodsAtNode_(uint speciesId)
 void LikelihoodCalculationSingleProcess::makeLikelihoodsAtDAGNode_(uint nodeId)
 {
   if (vRateCatTrees_.size() == 0)
-    makeForwardLikelihoodTree_();
+    makeRateCategoryTrees_();
 
   if (rFreqs_ == 0)
     makeRootFreqs_();
@@ -655,36 +818,39 @@ void LikelihoodCalculationSingleProcess::makeLikelihoodsAtDAGNode_(uint nodeId)
 
   auto one = ConstantOne<Eigen::RowVectorXd>::create(getContext_(), RowVectorDimension (Eigen::Index (nbState)));
 
-  for (auto& rateCat: vRateCatTrees_)
+  for (size_t nCat = 0; nCat < vRateCatTrees_.size(); nCat++)
   {
+    auto& rateCat = vRateCatTrees_[nCat];
+    auto flt = getForwardLikelihoodTree(nCat);
+
     if (!rateCat.clt)
-      rateCat.clt = std::make_shared<ConditionalLikelihoodDAG>(rateCat.flt->getGraph());
+      rateCat.clt = std::make_shared<ConditionalLikelihoodDAG>(flt->getGraph());
 
     if (rateCat.clt->hasNode(nodeId)) // already computed
       continue;
 
     if (!rateCat.blt)
-      rateCat.blt = std::make_shared<BackwardLikelihoodTree>(getContext_(), rateCat.flt, rateCat.phyloTree, rFreqs_, stateMap, nbDistSite);
+      rateCat.blt = std::make_shared<BackwardLikelihoodTree>(getContext_(), flt, rateCat.phyloTree, rFreqs_, stateMap, nbDistSite);
 
     if (!rateCat.lt)
-      rateCat.lt = std::make_shared<SiteLikelihoodsDAG>(rateCat.flt->getGraph());
+      rateCat.lt = std::make_shared<SiteLikelihoodsDAG>(flt->getGraph());
 
     // Conditional Likelihoods on this node
 
     auto condAbove = rateCat.blt->getBackwardLikelihoodArray(nodeId);
-    auto condBelow = rateCat.flt->getForwardLikelihoodArray(nodeId);
+    auto condBelow = flt->getForwardLikelihoodArray(nodeId);
 
     auto cond = BuildConditionalLikelihood::create (
       getContext_(), {condAbove, condBelow}, likelihoodMatrixDim);
 
-    rateCat.clt->associateNode(cond, rateCat.flt->getNodeGraphid(rateCat.flt->getNode(nodeId)));
+    rateCat.clt->associateNode(cond, flt->getNodeGraphid(flt->getNode(nodeId)));
     rateCat.clt->setNodeIndex(cond, nodeId);
 
     // Site Likelihoods on this node
     auto lt = LikelihoodFromRootConditionalAtRoot::create (
       getContext_(), {one, cond}, RowVectorDimension (Eigen::Index (nbDistSite)));
 
-    rateCat.lt->associateNode(lt, rateCat.flt->getNodeGraphid(rateCat.flt->getNode(nodeId)));
+    rateCat.lt->associateNode(lt, flt->getNodeGraphid(flt->getNode(nodeId)));
     rateCat.lt->setNodeIndex(lt, nodeId);
   }
 }
@@ -719,7 +885,29 @@ ConditionalLikelihoodRef LikelihoodCalculationSingleProcess::getForwardLikelihoo
   if (nCat >= vRateCatTrees_.size())
     throw Exception("LikelihoodCalculationSingleProcess::getForwardLikelihoodsAtNodeForClass : bad class number " + TextTools::toString(nCat));
 
-  return vRateCatTrees_[nCat].flt->getNode(nodeId);
+  return getForwardLikelihoodTree(nCat)->getNode(nodeId);
+}
+
+ValueRef<double> LikelihoodCalculationSingleProcess::getRateForClass(size_t nCat)
+{
+  if (nCat >= getNumberOfClasses())
+    throw Exception("LikelihoodCalculationSingleProcess::getRateForClass : bad class number " + TextTools::toString(nCat));
+
+  if (!processNodes_.ratesNode_)
+    return NumericConstant<double>::create(getContext_(), 1.);
+
+  return CategoryFromDiscreteDistribution::create(getContext_(), {processNodes_.ratesNode_}, (uint)nCat);
+}
+
+ValueRef<double> LikelihoodCalculationSingleProcess::getProbabilityForClass(size_t nCat)
+{
+  if (nCat >= getNumberOfClasses())
+    throw Exception("LikelihoodCalculationSingleProcess::getProbabilityForClass : bad class number " + TextTools::toString(nCat));
+
+  if (!processNodes_.ratesNode_)
+    return NumericConstant<double>::create(getContext_(), 1.);
+
+  return ProbabilityFromDiscreteDistribution::create(getContext_(), {processNodes_.ratesNode_}, (uint)nCat);
 }
 
 ConditionalLikelihoodRef LikelihoodCalculationSingleProcess::getConditionalLikelihoodsAtNodeForClass(uint nodeId, size_t nCat)
@@ -784,7 +972,7 @@ const DAGindexes& LikelihoodCalculationSingleProcess::getNodesIds(uint speciesId
   if (vRateCatTrees_.size() == 0)
     throw Exception("LikelihoodCalculationSingleProcess::getNodeIds. ForwardLikelihoodTree not computed.");
 
-  return vRateCatTrees_[0].flt->getDAGNodesIndexes(speciesId);
+  return makeForwardLikelihoodTree_(0)->getDAGNodesIndexes(speciesId);
 }
 
 const DAGindexes& LikelihoodCalculationSingleProcess::getEdgesIds(uint speciesId, size_t nCat) const
@@ -792,13 +980,176 @@ const DAGindexes& LikelihoodCalculationSingleProcess::getEdgesIds(uint speciesId
   if (nCat >= vRateCatTrees_.size())
     throw Exception("LikelihoodCalculationSingleProcess::getEdgesIds : bad class number " + TextTools::toString(nCat));
 
-  return vRateCatTrees_[nCat].flt->getDAGEdgesIndexes(speciesId);
+  return makeForwardLikelihoodTree_(nCat)->getDAGEdgesIndexes(speciesId);
 }
 
 std::shared_ptr<ForwardLikelihoodTree> LikelihoodCalculationSingleProcess::getForwardLikelihoodTree(size_t nCat)
 {
+  if (vRateCatTrees_.size() == 0)
+    makeRateCategoryTrees_();
+
   if (nCat >= vRateCatTrees_.size())
     throw Exception("LikelihoodCalculationSingleProcess::getForwardTree : bad class number " + TextTools::toString(nCat));
 
-  return vRateCatTrees_[nCat].flt;
+  // The per category trees are computed from now on: the root
+  // likelihood is built on them instead of the stacked forward
+  // likelihood, so that only one forward graph is computed.
+  if (!perCategoryTrees_)
+  {
+    perCategoryTrees_ = true;
+    if (stackedRoot_)
+    {
+      std::vector<NodeRef> stacked = {stackedRoot_};
+      makeLikelihoodsAtRoot_();
+      while (!stacked.empty())
+      {
+        auto node = std::move(stacked.back());
+        stacked.pop_back();
+        node->releaseStorage();
+        for (const auto& dep : node->dependencies())
+        {
+          if (dynamic_cast<const SpeciationSiteRepeats*>(dep.get()))
+            stacked.push_back(dep);
+        }
+      }
+    }
+  }
+
+  return makeForwardLikelihoodTree_(nCat);
+}
+
+std::shared_ptr<ForwardLikelihoodTree> LikelihoodCalculationSingleProcess::makeForwardLikelihoodTree_(size_t nCat) const
+{
+  auto& rateCat = vRateCatTrees_[nCat];
+  if (!rateCat.flt)
+  {
+    rateCat.flt = std::make_shared<ForwardLikelihoodTree>(getContext_(), rateCat.phyloTree, getStateMap());
+
+    if (!tips_.empty())
+      rateCat.flt->initialize(tips_);
+    else if (getShrunkData())
+      rateCat.flt->initialize(*getShrunkData());
+    else
+      rateCat.flt->initialize(*psites_);
+  }
+  return rateCat.flt;
+}
+
+ValueRef<RowLik> LikelihoodCalculationSingleProcess::getAdjointSiteLikelihoodsDerivative(const Node_DF& variable)
+{
+  if (!getLikelihoodNode_())
+    makeLikelihoods();
+
+  const auto& stateMap = getStateMap();
+  auto nbDistSite = Eigen::Index(getNumberOfDistinctSites());
+  auto nbState = Eigen::Index(stateMap.getNumberOfModelStates());
+  MatrixDimension likelihoodMatrixDim = conditionalLikelihoodDimension (nbState, nbDistSite);
+
+  auto one = ConstantOne<Eigen::RowVectorXd>::create(getContext_(), RowVectorDimension (nbState));
+  auto dRFreqs = rFreqs_->derive(getContext_(), variable);
+
+  NodeRefVec vdLikRoot;
+
+  for (size_t nCat = 0; nCat < vRateCatTrees_.size(); nCat++)
+  {
+    auto& rateCat = vRateCatTrees_[nCat];
+    auto flt = getForwardLikelihoodTree(nCat);
+
+    if (!rateCat.blt)
+      rateCat.blt = std::make_shared<BackwardLikelihoodTree>(getContext_(), flt, rateCat.phyloTree, rFreqs_, stateMap, nbDistSite);
+
+    NodeRefVec vdCond;
+
+    for (auto edgeIndex : flt->getAllEdgesIndexes())
+    {
+      const auto processEdge = rateCat.phyloTree->getEdge(edgeIndex);
+      auto forwardEdge = flt->getEdge(edgeIndex);
+
+      // Dependency of the forward likelihood that holds the edge
+      // transition (the other one is the forward likelihood below).
+      size_t nTrans;
+      if (processEdge->getBrLen())
+        nTrans = dynamic_cast<const TransitionModel*>(processEdge->getModel()->getTargetValue()) ? 0 : 1;
+      else if (processEdge->getProba())
+        nTrans = 0;
+      else // junction branch above a mixture node
+        continue;
+
+      auto dTrans = forwardEdge->dependency(nTrans)->derive(getContext_(), variable);
+      if (dTrans->hasNumericalProperty(NumericalProperty::ConstantZero))
+        continue;
+
+      NodeRefVec deps = forwardEdge->dependencies();
+      deps[nTrans] = std::move(dTrans);
+      auto dForwardEdge = forwardEdge->recreate(getContext_(), std::move(deps));
+
+      auto backwardEdge = rateCat.blt->hasEdge(edgeIndex)
+        ? rateCat.blt->getEdge(edgeIndex)
+        : rateCat.blt->makeBackwardLikelihoodAtEdge(edgeIndex);
+
+      vdCond.push_back(BuildConditionalLikelihood::create (
+                         getContext_(), {backwardEdge, dForwardEdge}, likelihoodMatrixDim));
+    }
+
+    auto dCond = CWiseAdd<MatrixLik, ReductionOf<MatrixLik> >::create(getContext_(), std::move(vdCond), likelihoodMatrixDim);
+
+    auto dLikEdges = LikelihoodFromRootConditionalAtRoot::create (
+      getContext_(), {one, dCond}, RowVectorDimension (nbDistSite));
+
+    auto dLikFreqs = LikelihoodFromRootConditionalAtRoot::create (
+      getContext_(), {dRFreqs, flt->getForwardLikelihoodArrayAtRoot()}, RowVectorDimension (nbDistSite));
+
+    vdLikRoot.push_back(CWiseAdd<RowLik, std::tuple<RowLik, RowLik> >::create(getContext_(), {dLikEdges, dLikFreqs}, RowVectorDimension (nbDistSite)));
+  }
+
+  if (!processNodes_.ratesNode_)
+    return convertRef<Value<RowLik> >(vdLikRoot[0]);
+
+  // sL = sum_c p_c * L_c, so dsL = sum_c p_c * dL_c + sum_c dp_c * L_c
+  NodeRefVec vLikRoot;
+  NodeRefVec vdProbs;
+  bool constantProbs = true;
+
+  for (size_t nCat = 0; nCat < vRateCatTrees_.size(); nCat++)
+  {
+    auto prob = ProbabilityFromDiscreteDistribution::create(getContext_(), {processNodes_.ratesNode_}, (uint)nCat);
+    vdLikRoot.push_back(prob);
+
+    auto dProb = prob->derive(getContext_(), variable);
+    constantProbs &= dProb->hasNumericalProperty(NumericalProperty::ConstantZero);
+    vdProbs.push_back(dProb);
+
+    vLikRoot.push_back(LikelihoodFromRootConditionalAtRoot::create (
+                         getContext_(), {rFreqs_, getForwardLikelihoodTree(nCat)->getForwardLikelihoodArrayAtRoot()},
+                         RowVectorDimension (nbDistSite)));
+  }
+
+  auto dsL = CWiseMean<RowLik, ReductionOf<RowLik>, ReductionOf<double> >::create(getContext_(), std::move(vdLikRoot), RowVectorDimension (nbDistSite));
+
+  if (constantProbs)
+    return dsL;
+
+  vLikRoot.insert(vLikRoot.end(), vdProbs.begin(), vdProbs.end());
+  auto dsLProbs = CWiseMean<RowLik, ReductionOf<RowLik>, ReductionOf<double> >::create(getContext_(), std::move(vLikRoot), RowVectorDimension (nbDistSite));
+
+  return CWiseAdd<RowLik, std::tuple<RowLik, RowLik> >::create(getContext_(), {dsL, dsLProbs}, RowVectorDimension (nbDistSite));
+}
+
+ValueRef<DataLik> LikelihoodCalculationSingleProcess::getAdjointLikelihoodDerivative(const Node_DF& variable)
+{
+  // Per site scaled derivative, without the per category trees
+  if (dynamic_cast<const SiteScaledLogLikelihood*>(getLikelihoodNode().get()))
+    return getLikelihoodNode()->deriveAsValue(getContext_(), variable);
+
+  auto dsL = getAdjointSiteLikelihoodsDerivative(variable);
+  auto sL = getSiteLikelihoods(true);
+
+  auto nbDistSite = Eigen::Index(getNumberOfDistinctSites());
+
+  // As SumOfLogarithms::derive: dlog(L)/dx = sum_site weight * dL/dx / L
+  ValueRef<RowLik> sLInverse = CWiseInverse<RowLik>::create (getContext_(), {sL}, RowVectorDimension (nbDistSite));
+  if (rootPatternLinks_)
+    sLInverse = CWiseMul<RowLik, std::tuple<RowLik, Eigen::RowVectorXi> >::create (getContext_(), {sLInverse, rootWeights_}, RowVectorDimension (nbDistSite));
+
+  return ScalarProduct<DataLik, RowLik, RowLik>::create (getContext_(), {dsL, sLInverse});
 }
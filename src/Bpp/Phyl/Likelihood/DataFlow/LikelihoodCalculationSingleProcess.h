@@ -48,10 +48,12 @@
 #include <Bpp/Seq/Container/AlignedValuesContainer.h>
 
 #include "Bpp/Phyl/Likelihood/DataFlow/CollectionNodes.h"
+#include "Bpp/Phyl/Likelihood/DataFlow/DataFlowOptimizer.h"
 #include "Bpp/Phyl/Likelihood/DataFlow/DiscreteDistribution.h"
 #include "Bpp/Phyl/Likelihood/DataFlow/FrequencySet.h"
 #include "Bpp/Phyl/Likelihood/DataFlow/LikelihoodCalculation.h"
 #include "Bpp/Phyl/Likelihood/DataFlow/Model.h"
+#include "Bpp/Phyl/Likelihood/DataFlow/Sequence_DF.h"
 #include "Bpp/Phyl/Likelihood/SubstitutionProcess.h"
 
 namespace bpp
@@ -153,6 +155,14 @@ private:
   {
 public:
     std::shared_ptr<ProcessTree> phyloTree;
+
+    /*
+     * @brief forward likelihood tree (only computed when needed, the
+     * likelihood of several rate categories is computed on their
+     * stacked forward likelihoods when possible)
+     *
+     */
+
     std::shared_ptr<ForwardLikelihoodTree> flt;
 
     /*
@@ -234,6 +244,13 @@ public:
   std::shared_ptr<SiteWeights> rootWeights_;
   std::shared_ptr<AlignedValuesContainer> shrunkData_;
 
+  /**
+   * @brief Likelihoods of the leaves on the patterns, when set
+   * without data (see setPatterns).
+   */
+
+  TipLikelihoods tips_;
+
   /************************************/
   /* DataFlow objects */
 
@@ -241,8 +258,19 @@ public:
 
   ValueRef<Eigen::RowVectorXd> rFreqs_;
 
-  /* Likelihood Trees with for all rate categories */
-  std::vector<RateCategoryTrees> vRateCatTrees_;
+  /* Likelihood Trees with for all rate categories (forward
+   * likelihood trees built on demand) */
+  mutable std::vector<RateCategoryTrees> vRateCatTrees_;
+
+  /* Forward likelihood of the rate categories stacked at the root,
+   * used until the per category trees are computed (see
+   * getForwardLikelihoodTree) */
+  ValueRef<MatrixLik> stackedRoot_;
+  bool perCategoryTrees_;
+
+  /* If the log-likelihood is computed with one exponent per site
+   * (see setSiteScaledLikelihood) */
+  bool siteScaled_;
 
   /* Likelihood tree on mean likelihoods on rate categories */
   std::shared_ptr<ConditionalLikelihoodTree> condLikelihoodTree_;
@@ -288,13 +316,38 @@ public:
   void setData(const AlignedValuesContainer& sites)
   {
     psites_ = &sites;
+    tips_.clear();
     setPatterns_();
     if (isInitialized())
     {
       vRateCatTrees_.clear();
+      perCategoryTrees_ = false;
       makeLikelihoodsAtRoot_();
     }
   }
+
+  /**
+   * @brief Set the compressed data without the alignment, for
+   * example from a LikelihoodSnapshot.
+   *
+   * @param patternLinks The pattern of each site.
+   * @param weights The number of sites of each pattern.
+   * @param tips The likelihoods of the leaves on the patterns.
+   *
+   * getData() and getShrunkData() are then null.
+   */
+
+  void setPatterns(const PatternType& patternLinks, const Eigen::RowVectorXi& weights, const TipLikelihoods& tips);
+
+  /**
+   * @brief The likelihoods of the leaves on the patterns, if set
+   * with setPatterns.
+   */
+
+  const TipLikelihoods& getTipLikelihoods() const
+  {
+    return tips_;
+  }
   
   /**
    * @brief Set derivation procedure (see DataFlowNumeric.h)
@@ -312,6 +365,38 @@ public:
 
   void setClockLike(double rate = 1);
 
+  /**
+   * @brief Compute once the parts of the likelihood which do not
+   * depend on the given parameters (see
+   * DataFlowOptimizer::foldConstants).
+   *
+   * Not done by default: the other parameters are frozen to their
+   * current values, so they must not be changed or aliased afterwards.
+   *
+   * @param variables The parameters that may still change.
+   * @return The numbers of folded and merged nodes.
+   */
+
+  DataFlowOptimizer::Report foldConstants(const ParameterList& variables);
+
+  /**
+   * @brief Compute the log-likelihood and its first order derivatives
+   * with one exponent per site (see SiteScaledForward.h), so that a
+   * site much less likely than the others does not underflow.
+   *
+   * Not done by default. Only used when the process tree holds only
+   * transitions through a TransitionModel and speciations. The site
+   * likelihoods and the second order derivatives are still computed
+   * with one exponent per pattern of sites, on demand.
+   */
+
+  void setSiteScaledLikelihood(bool yn);
+
+  bool isSiteScaledLikelihood() const
+  {
+    return siteScaled_;
+  }
+
   /**************************************************/
 
   /*
@@ -321,7 +406,7 @@ public:
    */
   void makeLikelihoods()
   {
-    if (!psites_)
+    if (!psites_ && tips_.empty())
       throw Exception("LikelihoodCalculationSingleProcess::makeLikelihoods : data not set.");
 
     makeLikelihoodsAtRoot_();
@@ -351,12 +436,14 @@ public:
 
   size_t getNumberOfSites() const
   {
-    return psites_ ? psites_->getNumberOfSites() : 0;
+    if (psites_)
+      return psites_->getNumberOfSites();
+    return rootPatternLinks_ ? size_t(rootPatternLinks_->getTargetValue().size()) : 0;
   }
 
   size_t getNumberOfDistinctSites() const
   {
-    return shrunkData_ ? shrunkData_->getNumberOfSites() : getNumberOfSites();
+    return rootWeights_ ? size_t(rootWeights_->getTargetValue().size()) : getNumberOfSites();
   }
 
   /*
@@ -417,7 +504,7 @@ public:
     if (!rootPatternLinks_)
       return vector;
     else
-      return CWisePattern<RowLik>::create(getContext_(), {vector, rootPatternLinks_}, RowVectorDimension ((int)getData()->getNumberOfSites()));
+      return CWisePattern<RowLik>::create(getContext_(), {vector, rootPatternLinks_}, RowVectorDimension ((int)getNumberOfSites()));
   }
 
   /*
@@ -431,7 +518,7 @@ public:
     if (!rootPatternLinks_)
       return matrix;
     else
-      return CWisePattern<MatrixLik>::create(getContext_(), {matrix, rootPatternLinks_}, MatrixDimension (matrix->getTargetValue().rows(), Eigen::Index (getData()->getNumberOfSites())));
+      return CWisePattern<MatrixLik>::create(getContext_(), {matrix, rootPatternLinks_}, MatrixDimension (matrix->getTargetValue().rows(), Eigen::Index (getNumberOfSites())));
   }
 
   /*
@@ -597,12 +684,88 @@ public:
     return vRateCatTrees_[nCat].phyloTree;
   }
 
+  /*
+   *@brief Get the forward likelihood tree of a rate category, built
+   * on the first call.
+   *
+   * The likelihood at the root is then computed on the forward
+   * likelihood trees of the rate categories, and the stacked forward
+   * likelihood is released (see makeRateCategoriesForwardAtNode_).
+   *
+   *@param nCat : index of the rate category
+   */
+
   std::shared_ptr<ForwardLikelihoodTree> getForwardLikelihoodTree(size_t nCat);
 
+  /*
+   *@brief Number of rate categories (1 without rate distribution).
+   */
+
+  size_t getNumberOfClasses() const
+  {
+    return processNodes_.ratesNode_ ? processNodes_.ratesNode_->getTargetValue()->getNumberOfCategories() : 1;
+  }
+
+  /*
+   *@brief Rate and probability of a rate category, as nodes.
+   *
+   *@param nCat : index of the rate category
+   */
+
+  ValueRef<double> getRateForClass(size_t nCat);
+
+  ValueRef<double> getProbabilityForClass(size_t nCat);
+
+  /*
+   *@brief Branch length parameter of an edge, shared by all the
+   * rate categories (0 if the edge has no length).
+   *
+   *@param edgeId : index of the edge in the process tree
+   */
+
+  std::shared_ptr<ConfiguredParameter> getBranchLengthParameter(uint edgeId)
+  {
+    return processNodes_.treeNode_->getEdge(edgeId)->getBrLen();
+  }
+
+  /*
+   *@brief Derivative of the site likelihoods (on shrunked data)
+   * with respect to a variable, computed with the backward
+   * likelihoods (adjoint method).
+   *
+   * Site likelihoods are linear in the forward likelihood of each
+   * edge, with the backward likelihood at the top of the edge as
+   * coefficient, so:
+   *
+   * dL/dx = sum_edges sum_states backward[e] * dforward[e]/dx
+   *           (with the forward likelihood at the bottom of e fixed)
+   *         + sum_states drootFreqs/dx * forward[root],
+   *
+   * for each rate category. Forward and backward likelihoods are
+   * shared by all the variables: the derivative on a branch length
+   * costs one product on this branch, instead of a new derivation of
+   * the path up to the root, and the gradient on all branch lengths
+   * needs only one forward and one backward computation.
+   *
+   *@param variable : the derived node (see accessVariableNode in
+   * AbstractPhyloLikelihood).
+   */
+
+  ValueRef<RowLik> getAdjointSiteLikelihoodsDerivative(const Node_DF& variable);
+
+  /*
+   *@brief Derivative of the log-likelihood with respect to a
+   * variable, from getAdjointSiteLikelihoodsDerivative, or with one
+   * exponent per site if the log-likelihood is (see
+   * setSiteScaledLikelihood).
+   */
+
+  ValueRef<DataLik> getAdjointLikelihoodDerivative(const Node_DF& variable);
+
 private:
   void setPatterns_();
 
-  void makeForwardLikelihoodTree_();
+  void makeRateCategoryTrees_();
 
   void makeProcessNodes_();
 
@@ -610,6 +773,29 @@ private:
 
   void makeLikelihoodsAtRoot_();
 
+  /*
+   * @brief Forward likelihood of all the rate categories, stacked
+   * in one MatrixLik (see RateCategoriesForward.h), above a node of
+   * the process tree.
+   *
+   * The per category ForwardLikelihoodTrees are not needed, the
+   * transition matrices and the leaves are the same nodes as
+   * theirs. Returns nullptr if the subtree holds edges or nodes
+   * other than transitions through a TransitionModel and
+   * speciations.
+   *
+   * If siteScaled, the forward likelihood is a SiteScaledMatrixLik,
+   * with one exponent per site (see SiteScaledForward.h).
+   */
+
+  NodeRef makeRateCategoriesForwardAtNode_(std::shared_ptr<ProcessNode> processNode, const MatrixDimension& stackedDim, bool siteScaled = false);
+
+  /*
+   * @brief Compact likelihood of a leaf, from the tips or the data.
+   */
+
+  ValueRef<TipLikelihood> makeTipSequence_(const std::string& sequenceName);
+
   /*
    *@ brief make DF nodes of a process in a collection, using
    * ConfiguredParameters defined in a CollectionNodes.
@@ -641,6 +827,13 @@ private:
   void makeLikelihoodsAtDAGNode_(uint nodeId);
 
   std::shared_ptr<SiteLikelihoodsTree> getSiteLikelihoodsTree_(size_t nCat);
+
+  /*
+   * @brief The forward likelihood tree of a rate category, built on
+   * the first call (only the nodes, not their values).
+   */
+
+  std::shared_ptr<ForwardLikelihoodTree> makeForwardLikelihoodTree_(size_t nCat) const;
 };
 } // namespace bpp
 #endif // BPP_PHYL_LIKELIHOOD_DATAFLOW_LIKELIHOODCALCULATIONSINGLEPROCESS_H
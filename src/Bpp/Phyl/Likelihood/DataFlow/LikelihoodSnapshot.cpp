@@ -0,0 +1,261 @@
+//
+// File: LikelihoodSnapshot.cpp
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Exceptions.h>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#include "ForwardLikelihoodTree.h"
+#include "LikelihoodSnapshot.h"
+
+using namespace std;
+using namespace bpp;
+
+namespace
+{
+/*
+ * File layout: header, then for each leaf its name, its number of
+ * codes, codeLikelihoods and siteCodes, then the pattern links, the
+ * weights and the parameters (name, value). Strings are a length
+ * followed by the characters.
+ *
+ * Site codes and weights are stored as int, and pattern links as
+ * size_t: their sizes are recorded in the header, and checked on
+ * reading.
+ */
+
+const char snapshotMagic[8] = {'B', 'P', 'P', 'L', 'I', 'K', 'S', 'N'};
+const uint32_t snapshotVersion = 2;
+const uint32_t byteOrderMark = 0x01020304;
+
+struct Header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t intSize;
+  uint32_t sizeSize;
+  uint64_t nbStates;
+  uint64_t nbSites;
+  uint64_t nbPatterns;
+  uint64_t nbLeaves;
+  uint64_t nbParameters;
+};
+
+class Writer
+{
+private:
+  ofstream out_;
+  uint64_t offset_{0};
+
+public:
+  explicit Writer (const string& path) : out_ (path.c_str (), ios::out | ios::binary)
+  {
+    if (!out_)
+      throw IOException ("LikelihoodSnapshot::write : can not open file " + path);
+  }
+
+  void bytes (const void* data, size_t size)
+  {
+    out_.write (static_cast<const char*>(data), streamsize (size));
+    offset_ += size;
+    const char padding[8] = {};
+    const auto nbPadding = (8 - offset_ % 8) % 8;
+    out_.write (padding, streamsize (nbPadding));
+    offset_ += nbPadding;
+    if (!out_)
+      throw IOException ("LikelihoodSnapshot::write : write error.");
+  }
+
+  template<typename T> void value (const T& v) { bytes (&v, sizeof(T)); }
+
+  void text (const string& s)
+  {
+    value (uint64_t (s.size ()));
+    bytes (s.data (), s.size ());
+  }
+};
+
+class Reader
+{
+private:
+  ifstream in_;
+  uint64_t offset_{0};
+
+public:
+  explicit Reader (const string& path) : in_ (path.c_str (), ios::in | ios::binary)
+  {
+    if (!in_)
+      throw IOException ("LikelihoodSnapshot::read : can not open file " + path);
+  }
+
+  void bytes (void* data, size_t size)
+  {
+    in_.read (static_cast<char*>(data), streamsize (size));
+    offset_ += size;
+    const auto nbPadding = (8 - offset_ % 8) % 8;
+    in_.ignore (streamsize (nbPadding));
+    offset_ += nbPadding;
+    if (!in_)
+      throw IOException ("LikelihoodSnapshot::read : truncated file.");
+  }
+
+  template<typename T> T value ()
+  {
+    T v;
+    bytes (&v, sizeof(T));
+    return v;
+  }
+
+  string text ()
+  {
+    string s (size_t (value<uint64_t>()), '\0');
+    if (!s.empty ())
+      bytes (&s[0], s.size ());
+    return s;
+  }
+};
+} // namespace
+
+LikelihoodSnapshot::LikelihoodSnapshot (const LikelihoodCalculationSingleProcess& lik) :
+  patternLinks_ (), weights_ (), tips_ (lik.getTipLikelihoods ()), parameters_ (lik.getParameters ())
+{
+  if (lik.getNumberOfSites () == 0)
+    throw Exception ("LikelihoodSnapshot::LikelihoodSnapshot : data not set.");
+
+  patternLinks_ = lik.getRootArrayPositions ();
+  const auto nbPatterns = lik.getNumberOfDistinctSites ();
+  weights_.resize (Eigen::Index (nbPatterns));
+  for (size_t i = 0; i < nbPatterns; i++)
+  {
+    weights_ (Eigen::Index (i)) = int(lik.getWeight (i));
+  }
+
+  if (tips_.empty ())
+  {
+    const auto* sites = lik.getShrunkData ();
+    for (const auto& name : lik.getSubstitutionProcess ().getParametrizablePhyloTree ()->getAllLeavesNames ())
+    {
+      tips_.emplace (name, ForwardLikelihoodTree::makeTipLikelihood (name, *sites, lik.getStateMap ()));
+    }
+  }
+}
+
+void LikelihoodSnapshot::write (const string& path) const
+{
+  Header header;
+  memcpy (header.magic, snapshotMagic, sizeof(snapshotMagic));
+  header.version = snapshotVersion;
+  header.byteOrder = byteOrderMark;
+  header.intSize = uint32_t (sizeof(int));
+  header.sizeSize = uint32_t (sizeof(size_t));
+  header.nbStates = uint64_t (tips_.begin ()->second.getNumberOfStates ());
+  header.nbSites = uint64_t (patternLinks_.size ());
+  header.nbPatterns = uint64_t (weights_.size ());
+  header.nbLeaves = uint64_t (tips_.size ());
+  header.nbParameters = uint64_t (parameters_.size ());
+
+  Writer out (path);
+  out.value (header);
+  for (const auto& tip : tips_)
+  {
+    out.text (tip.first);
+    out.value (uint64_t (tip.second.codeLikelihoods.cols ()));
+    out.bytes (tip.second.codeLikelihoods.data (), sizeof(double) * size_t (tip.second.codeLikelihoods.size ()));
+    out.bytes (tip.second.siteCodes.data (), sizeof(int) * size_t (tip.second.siteCodes.size ()));
+  }
+  out.bytes (patternLinks_.data (), sizeof(size_t) * size_t (patternLinks_.size ()));
+  out.bytes (weights_.data (), sizeof(int) * size_t (weights_.size ()));
+  for (size_t i = 0; i < parameters_.size (); i++)
+  {
+    out.text (parameters_[i].getName ());
+    out.value (parameters_[i].getValue ());
+  }
+}
+
+LikelihoodSnapshot LikelihoodSnapshot::read (const string& path)
+{
+  Reader in (path);
+  const auto header = in.value<Header>();
+  if (memcmp (header.magic, snapshotMagic, sizeof(snapshotMagic)) != 0)
+    throw IOException ("LikelihoodSnapshot::read : not a likelihood snapshot: " + path);
+  if (header.byteOrder != byteOrderMark)
+    throw IOException ("LikelihoodSnapshot::read : snapshot written with another byte order: " + path);
+  if (header.version != snapshotVersion)
+    throw IOException ("LikelihoodSnapshot::read : unknown snapshot version " + std::to_string (header.version));
+  if (header.intSize != sizeof(int) || header.sizeSize != sizeof(size_t))
+    throw IOException ("LikelihoodSnapshot::read : snapshot written with another word size: " + path);
+
+  LikelihoodSnapshot snapshot;
+  const auto nbStates = Eigen::Index (header.nbStates);
+  const auto nbPatterns = Eigen::Index (header.nbPatterns);
+  for (uint64_t i = 0; i < header.nbLeaves; i++)
+  {
+    auto name = in.text ();
+    TipLikelihood tip;
+    tip.codeLikelihoods.resize (nbStates, Eigen::Index (in.value<uint64_t>()));
+    tip.siteCodes.resize (nbPatterns);
+    in.bytes (tip.codeLikelihoods.data (), sizeof(double) * size_t (tip.codeLikelihoods.size ()));
+    in.bytes (tip.siteCodes.data (), sizeof(int) * size_t (tip.siteCodes.size ()));
+    if (nbPatterns != 0 && (tip.siteCodes.minCoeff () < 0 || tip.siteCodes.maxCoeff () >= tip.codeLikelihoods.cols ()))
+      throw IOException ("LikelihoodSnapshot::read : bad site code for leaf " + name + " in " + path);
+    snapshot.tips_.emplace (std::move (name), std::move (tip));
+  }
+
+  snapshot.patternLinks_.resize (Eigen::Index (header.nbSites));
+  snapshot.weights_.resize (nbPatterns);
+  in.bytes (snapshot.patternLinks_.data (), sizeof(size_t) * size_t (snapshot.patternLinks_.size ()));
+  in.bytes (snapshot.weights_.data (), sizeof(int) * size_t (snapshot.weights_.size ()));
+  if (snapshot.patternLinks_.size () != 0 && snapshot.patternLinks_.maxCoeff () >= size_t (nbPatterns))
+    throw IOException ("LikelihoodSnapshot::read : bad pattern link in " + path);
+  for (uint64_t i = 0; i < header.nbParameters; i++)
+  {
+    auto name = in.text ();
+    snapshot.parameters_.addParameter (Parameter (name, in.value<double>()));
+  }
+  return snapshot;
+}
+
+void LikelihoodSnapshot::restore (LikelihoodCalculationSingleProcess& lik) const
+{
+  lik.setPatterns (patternLinks_, weights_, tips_);
+  lik.matchParametersValues (parameters_);
+}
@@ -0,0 +1,103 @@
+//
+// File: LikelihoodSnapshot.h
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef BPP_PHYL_LIKELIHOOD_DATAFLOW_LIKELIHOODSNAPSHOT_H
+#define BPP_PHYL_LIKELIHOOD_DATAFLOW_LIKELIHOODSNAPSHOT_H
+
+#include <Bpp/Numeric/ParameterList.h>
+#include <string>
+
+#include "LikelihoodCalculationSingleProcess.h"
+
+namespace bpp
+{
+/** @brief Saved state of a LikelihoodCalculationSingleProcess, to
+ * restart a computation without the alignment.
+ *
+ * The snapshot holds what is long to get from the data: the links
+ * between sites and patterns, the weights of the patterns, the
+ * compact likelihoods of the leaves on the patterns (TipLikelihood),
+ * and the parameter values.
+ *
+ * The likelihood graph itself is not stored: it is built again from
+ * the SubstitutionProcess, which is cheap compared to reading and
+ * compressing the alignment:
+ *
+ * @code
+ * LikelihoodSnapshot (lik).write ("analysis.snapshot");
+ * ...
+ * LikelihoodCalculationSingleProcess lik (context, process);
+ * LikelihoodSnapshot::read ("analysis.snapshot").restore (lik);
+ * @endcode
+ *
+ * The file is binary, in the byte order of the machine (checked on
+ * reading). Arrays are stored contiguously, aligned on 8 bytes.
+ */
+class LikelihoodSnapshot
+{
+private:
+  PatternType patternLinks_;
+  Eigen::RowVectorXi weights_;
+  TipLikelihoods tips_;
+  ParameterList parameters_;
+
+  LikelihoodSnapshot () : patternLinks_ (), weights_ (), tips_ (), parameters_ () {}
+
+public:
+  /// Snapshot of a likelihood calculation, which data must be set.
+  explicit LikelihoodSnapshot (const LikelihoodCalculationSingleProcess& lik);
+
+  static LikelihoodSnapshot read (const std::string& path);
+
+  void write (const std::string& path) const;
+
+  /// Set the patterns and the parameter values of lik.
+  void restore (LikelihoodCalculationSingleProcess& lik) const;
+
+  const PatternType& getPatternLinks () const { return patternLinks_; }
+
+  const Eigen::RowVectorXi& getWeights () const { return weights_; }
+
+  const TipLikelihoods& getTipLikelihoods () const { return tips_; }
+
+  const ParameterList& getParameters () const { return parameters_; }
+};
+} // namespace bpp
+#endif // BPP_PHYL_LIKELIHOOD_DATAFLOW_LIKELIHOODSNAPSHOT_H
@@ -0,0 +1,92 @@
+//
+// File: MixedPrecisionLogLikelihood.cpp
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include "MixedPrecisionLogLikelihood.h"
+
+using namespace bpp;
+
+MixedPrecisionLogLikelihood::MixedPrecisionLogLikelihood (Evaluation singleEvaluation, Evaluation doubleEvaluation, double errorFactor)
+  : singleEvaluation_ (std::move (singleEvaluation))
+  , doubleEvaluation_ (std::move (doubleEvaluation))
+  , errorFactor_ (errorFactor)
+  , tolerance_ (0.)
+  , lastInDouble_ (false)
+  , nbDoubleEvaluations_ (0)
+{}
+
+double MixedPrecisionLogLikelihood::getErrorBound (double logLikelihood) const
+{
+  return errorFactor_ * std::numeric_limits<float>::epsilon () * std::max (1., std::abs (logLikelihood));
+}
+
+double MixedPrecisionLogLikelihood::getValue ()
+{
+  if (tolerance_ <= 0)
+    return evaluateInDouble_ ();
+  double logLikelihood = singleEvaluation_ ();
+  if (!std::isfinite (logLikelihood) || getErrorBound (logLikelihood) > tolerance_)
+    return evaluateInDouble_ ();
+  lastInDouble_ = false;
+  return logLikelihood;
+}
+
+double MixedPrecisionLogLikelihood::getValueComparedTo (double reference)
+{
+  if (tolerance_ <= 0)
+    return evaluateInDouble_ ();
+  double logLikelihood = singleEvaluation_ ();
+  double bound = getErrorBound (logLikelihood);
+  if (!std::isfinite (logLikelihood) || bound > tolerance_ || std::abs (logLikelihood - reference) <= bound)
+    return evaluateInDouble_ ();
+  lastInDouble_ = false;
+  return logLikelihood;
+}
+
+double MixedPrecisionLogLikelihood::evaluateInDouble_ ()
+{
+  lastInDouble_ = true;
+  nbDoubleEvaluations_++;
+  return doubleEvaluation_ ();
+}
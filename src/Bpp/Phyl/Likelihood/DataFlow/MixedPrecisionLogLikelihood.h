@@ -0,0 +1,109 @@
+//
+// File: MixedPrecisionLogLikelihood.h
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef BPP_PHYL_LIKELIHOOD_DATAFLOW_MIXEDPRECISIONLOGLIKELIHOOD_H
+#define BPP_PHYL_LIKELIHOOD_DATAFLOW_MIXEDPRECISIONLOGLIKELIHOOD_H
+
+#include <cstddef>
+#include <functional>
+
+namespace bpp
+{
+/**
+ * @brief Log-likelihood evaluated in single precision, and reevaluated
+ * in double precision when the single precision error may matter.
+ *
+ * The two evaluations are given as functions, typically the same
+ * computation on float and double per-site scaled likelihoods (see
+ * ExtendedFloatColwiseMatrix).
+ *
+ * The absolute error of the single precision log-likelihood is
+ * bounded by errorFactor * FLT_EPSILON * max(1, |logL|), errorFactor
+ * being about the number of products and sums along a path of the
+ * tree (its depth) times a safety margin. The double precision
+ * evaluation is used when this bound exceeds the required accuracy
+ * (setTolerance), or, through getValueComparedTo, when the difference
+ * with a previous value is within the bound, for example when an
+ * optimizer compares close values near convergence.
+ *
+ * Without tolerance (the default), only the double precision
+ * evaluation is done.
+ */
+class MixedPrecisionLogLikelihood
+{
+public:
+  using Evaluation = std::function<double ()>;
+
+private:
+  Evaluation singleEvaluation_;
+  Evaluation doubleEvaluation_;
+  double errorFactor_;
+  double tolerance_;
+  bool lastInDouble_;
+  std::size_t nbDoubleEvaluations_;
+
+public:
+  MixedPrecisionLogLikelihood (Evaluation singleEvaluation, Evaluation doubleEvaluation, double errorFactor = 64.);
+
+  /// Absolute accuracy required on the log-likelihood (default: 0,
+  /// only evaluated in double).
+  void setTolerance (double tolerance) { tolerance_ = tolerance; }
+  double getTolerance () const { return tolerance_; }
+
+  /// Bound of the error of a single precision log-likelihood.
+  double getErrorBound (double logLikelihood) const;
+
+  /// Single precision value if accurate enough given the tolerance.
+  double getValue ();
+
+  /// Single precision value if accurate enough given the tolerance,
+  /// and to be compared to reference.
+  double getValueComparedTo (double reference);
+
+  /// Whether the last value was computed in double precision.
+  bool isLastValueInDouble () const { return lastInDouble_; }
+
+  std::size_t getNumberOfDoubleEvaluations () const { return nbDoubleEvaluations_; }
+
+private:
+  double evaluateInDouble_ ();
+};
+} // namespace bpp
+#endif // BPP_PHYL_LIKELIHOOD_DATAFLOW_MIXEDPRECISIONLOGLIKELIHOOD_H
@@ -39,6 +39,7 @@
 */
 
 #include <Bpp/Exceptions.h>
+#include <Bpp/Numeric/NumConstants.h>
 #include <Bpp/Phyl/Likelihood/DataFlow/Model.h>
 #include <Bpp/Phyl/Likelihood/DataFlow/Parametrizable.h>
 #include <Bpp/Phyl/Model/MixedTransitionModel.h>
@@ -47,6 +48,16 @@
 using namespace std;
 using namespace bpp;
 
+// Substitution model of a ConfiguredModel node, or its submodel nMod if not null.
+static const SubstitutionModel* getSubstitutionModel (const Node_DF& model, const NodeRef& nMod)
+{
+  const auto* model1 = accessValueConstCast<BranchModel*>(model);
+  const auto* mixmodel = dynamic_cast<const MixedTransitionModel*>(model1);
+  if (mixmodel && nMod)
+    return dynamic_cast<const SubstitutionModel*>(mixmodel->getNModel (accessValueConstCast<size_t>(*nMod)));
+  return dynamic_cast<const SubstitutionModel*>(model1);
+}
+
 // Model node
 
 ConfiguredModel::ConfiguredModel (Context& context, NodeRefVec&& deps, std::unique_ptr<BranchModel>&& model)
@@ -191,20 +202,36 @@ NodeRef TransitionMatrixFromModel::derive (Context& c, const Node_DF& node)
   const auto nDeriv = accessValueConstCast<size_t>(*derivNode);
 
   // Model part
-  auto& model = static_cast<Dep&>(*modelDep);
-  auto buildFWithNewModel = [this, &c, &brlenDep, &derivNode, &subNode](NodeRef&& newModel) {
-                              return ConfiguredParametrizable::createMatrix<Dep, Self>(c, {std::move (newModel), brlenDep, derivNode, subNode}, targetDimension_);
-                            };
-  NodeRefVec derivativeSumDeps = ConfiguredParametrizable::generateDerivativeSumDepsForComputations<Dep, T>(
-    c, model, node, targetDimension_, buildFWithNewModel);
+  NodeRefVec derivativeSumDeps;
+  if (nDeriv == 0 && getSubstitutionModel (*modelDep, subNode))
+  {
+    // Through the derivative of the generator
+    auto dGenerator = GeneratorFromModel::create (c, {modelDep, subNode}, targetDimension_)->derive (c, node);
+    derivativeSumDeps.emplace_back (TransitionMatrixFromGeneratorDerivative::create (
+                                      c, {modelDep, brlenDep, std::move (dGenerator), subNode}, targetDimension_));
+  }
+  else
+  {
+    auto& model = static_cast<Dep&>(*modelDep);
+    auto buildFWithNewModel = [this, &c, &brlenDep, &derivNode, &subNode](NodeRef&& newModel) {
+                                NodeRefVec deps{newModel, brlenDep, derivNode, subNode};
+                                if (hasEigenDecomposition_ ())
+                                  deps.push_back (EigenDecompositionFromModel::create (c, {newModel, subNode}, std::size_t (targetDimension_.rows)));
+                                return ConfiguredParametrizable::createMatrix<Dep, Self>(c, std::move (deps), targetDimension_);
+                              };
+    derivativeSumDeps = ConfiguredParametrizable::generateDerivativeSumDepsForComputations<Dep, T>(
+      c, model, node, targetDimension_, buildFWithNewModel);
+  }
   // Brlen part, use specific node
   auto dbrlen_dn = brlenDep->derive (c, node);
   if (!dbrlen_dn->hasNumericalProperty (NumericalProperty::ConstantZero))
   {
     auto nDerivp = NumericConstant<size_t>::create(c, nDeriv + 1);
 
-    auto df_dbrlen =
-      ConfiguredParametrizable::createMatrix<Dep, TransitionMatrixFromModel>(c, {modelDep, brlenDep, nDerivp, subNode}, targetDimension_);
+    NodeRefVec deps{modelDep, brlenDep, nDerivp, subNode};
+    if (hasEigenDecomposition_ ())
+      deps.push_back (this->dependency (4));
+    auto df_dbrlen = ConfiguredParametrizable::createMatrix<Dep, TransitionMatrixFromModel>(c, std::move (deps), targetDimension_);
     derivativeSumDeps.emplace_back (CWiseMul<T, std::tuple<double, T> >::create (
                                       c, {std::move (dbrlen_dn), std::move (df_dbrlen)}, targetDimension_));
   }
@@ -216,6 +243,23 @@ NodeRef TransitionMatrixFromModel::recreate (Context& c, NodeRefVec&& deps)
   return ConfiguredParametrizable::createMatrix<Dep, Self>(c, std::move (deps), targetDimension_);
 }
 
+const TransitionModel* TransitionMatrixFromModel::getTransitionModel_ () const
+{
+  const auto* model1 = accessValueConstCast<const BranchModel*>(*this->dependency (0));
+  const auto* mixmodel = dynamic_cast<const MixedTransitionModel*>(model1);
+
+  if (mixmodel && nbDependencies() >= 4 && this->dependency(3)) // in case there is a submodel
+    return mixmodel->getNModel(accessValueConstCast<size_t>(*this->dependency (3)));
+  else
+    return dynamic_cast<const TransitionModel*>(model1);
+}
+
+bool TransitionMatrixFromModel::isThreadSafe () const
+{
+  const auto* model = getTransitionModel_ ();
+  return model && model->hasReentrantPij_t ();
+}
+
 void TransitionMatrixFromModel::compute ()
 {
   const auto brlen = accessValueConstCast<double>(*this->dependency (1)->dependency(0));
@@ -223,52 +267,342 @@ void TransitionMatrixFromModel::compute ()
 
   auto& r = this->accessValueMutable ();
 
-  r.resize(4, 4);
+  r.resize(targetDimension_.rows, targetDimension_.cols);
 
-  const auto* mixmodel = dynamic_cast<const MixedTransitionModel*>(accessValueConstCast<const BranchModel*>(*this->dependency (0)));
+  const auto* model = getTransitionModel_ ();
+  if (!model)
+    throw Exception("TransitionMatrixFromModel::compute only possible for Transition Models.");
 
-  if (mixmodel && nbDependencies() >= 4 && this->dependency(3)) // in case there is a submodel
+  if (nDeriv > 2)
+    throw Exception("TransitionMatrixFromModel likelihood derivate " + TextTools::toString(nDeriv) + " not defined.");
+
+  if (hasEigenDecomposition_ ())
+  {
+    const auto& decomposition = accessValueConstCast<Eigen::MatrixXd>(*this->dependency (4));
+    if (decomposition.size () != 0)
+    {
+      // U diag(lambda^d exp(lambda.t)) U^-1
+      const auto nbState = decomposition.rows ();
+      const auto eigenValues = decomposition.col (0).array ();
+      Eigen::ArrayXd scale = (eigenValues * brlen).exp ();
+      for (std::size_t d = 0; d < nDeriv; ++d)
+      {
+        scale *= eigenValues;
+      }
+      r.noalias () = decomposition.middleCols (1, nbState) * scale.matrix ().asDiagonal () * decomposition.middleCols (nbState + 1, nbState);
+
+      // Same checks as AbstractSubstitutionModel::getPij_t
+      if (nDeriv == 0)
+      {
+        if (brlen == 0)
+          r.setIdentity ();
+        else
+        {
+          if (r.minCoeff () < -NumConstants::SMALL())
+            throw Exception("TransitionMatrixFromModel: issue in the computation of the transition matrix for branch length " + TextTools::toString(brlen));
+          r = r.cwiseMax (0.);
+        }
+      }
+      return;
+    }
+  }
+
+  switch (nDeriv)
+  {
+  case 0:
+    model->computePij_t (brlen, r);
+    break;
+  case 1:
+    model->computedPij_dt (brlen, r);
+    break;
+  case 2:
+    model->computed2Pij_dt2 (brlen, r);
+    break;
+  default:
+    throw Exception("TransitionMatrixFromModel likelihood derivate " + TextTools::toString(nDeriv) + " not defined.");
+  }
+}
+
+////////////////////////////////////////////////////////////
+// EigenDecompositionFromModel
+
+EigenDecompositionFromModel::EigenDecompositionFromModel (NodeRefVec&& deps,
+                                                          const Dimension<Eigen::MatrixXd>& dim)
+  : Value<Eigen::MatrixXd>(std::move (deps)), targetDimension_ (dim)
+{}
+
+ValueRef<Eigen::MatrixXd> EigenDecompositionFromModel::create (Context& c, NodeRefVec&& deps, std::size_t nbState)
+{
+  checkDependencyVectorSize (typeid (Self), deps, 2);
+  checkNthDependencyNotNull (typeid (Self), deps, 0);
+  checkNthDependencyIs<ConfiguredModel>(typeid (Self), deps, 0);
+  return cachedAs<Value<T> >(c, std::make_shared<Self>(std::move (deps), MatrixDimension (nbState, 2 * nbState + 1)));
+}
+
+std::string EigenDecompositionFromModel::debugInfo () const
+{
+  using namespace numeric;
+  return debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_);
+}
+
+// EigenDecompositionFromModel additional arguments = ().
+bool EigenDecompositionFromModel::compareAdditionalArguments (const Node_DF& other) const
+{
+  return dynamic_cast<const Self*>(&other) != nullptr;
+}
+
+NodeRef EigenDecompositionFromModel::derive (Context& c, const Node_DF& node)
+{
+  if (&node == this)
+    return ConstantOne<T>::create (c, targetDimension_);
+
+  // The eigenvectors are not differentiable entry by entry (their
+  // order and signs may change with the parameters), so only a
+  // decomposition that does not depend on node is derived.
+  // TransitionMatrixFromModel derives the transition matrices through
+  // the generator instead (see TransitionMatrixFromGeneratorDerivative).
+  const auto& model = static_cast<const Dep&>(*this->dependency (0));
+  for (std::size_t i = 0; i < model.nbDependencies (); ++i)
   {
-    auto nMod = accessValueConstCast<size_t>(*this->dependency (3));
+    if (model.dependency (i) &&
+        !model.dependency (i)->derive (c, node)->hasNumericalProperty (NumericalProperty::ConstantZero))
+      throw Exception("EigenDecompositionFromModel::derive: the eigen decomposition is not derived wrt the parameters of the model, derive the transition matrices.");
+  }
+  return ConstantZero<T>::create (c, targetDimension_);
+}
 
-    switch (nDeriv)
+NodeRef EigenDecompositionFromModel::recreate (Context& c, NodeRefVec&& deps)
+{
+  return Self::create (c, std::move (deps), std::size_t (targetDimension_.rows));
+}
+
+void EigenDecompositionFromModel::compute ()
+{
+  auto& r = this->accessValueMutable ();
+  const auto* smodel = getSubstitutionModel (*this->dependency (0), this->dependency (1));
+
+  // Real eigen decomposition available?
+  bool isDiagonalized = smodel && smodel->enableEigenDecomposition () && smodel->isDiagonalizable () && smodel->isNonSingular ();
+  if (isDiagonalized)
+  {
+    for (auto iev : smodel->getIEigenValues ())
     {
-    case 0:
-      copyBppToEigen (mixmodel->getNModel(nMod)->getPij_t (brlen), r);
-      break;
-    case 1:
-      copyBppToEigen (mixmodel->getNModel(nMod)->getdPij_dt (brlen), r);
-      break;
-    case 2:
-      copyBppToEigen (mixmodel->getNModel(nMod)->getd2Pij_dt2 (brlen), r);
-      break;
-    default:
-      throw Exception("TransitionMatrixFromModel likelihood derivate " + TextTools::toString(nDeriv) + " not defined.");
+      if (iev != 0)
+        isDiagonalized = false;
     }
   }
-  else
+  if (!isDiagonalized)
+  {
+    r.resize (0, 0);
+    return;
+  }
+
+  const auto nbState = targetDimension_.rows;
+  r.resize (targetDimension_.rows, targetDimension_.cols);
+  const auto& ev = smodel->getEigenValues ();
+  r.col (0) = Eigen::Map<const Eigen::VectorXd>(ev.data (), Eigen::Index (ev.size ())) * smodel->getRate ();
+  Eigen::MatrixXd vectors;
+  copyBppToEigen (smodel->getColumnRightEigenVectors (), vectors);
+  r.middleCols (1, nbState) = vectors;
+  copyBppToEigen (smodel->getRowLeftEigenVectors (), vectors);
+  r.middleCols (nbState + 1, nbState) = vectors;
+}
+
+////////////////////////////////////////////////////////////
+// GeneratorFromModel
+
+GeneratorFromModel::GeneratorFromModel (NodeRefVec&& deps, const Dimension<Eigen::MatrixXd>& dim, const std::string& parameter)
+  : Value<Eigen::MatrixXd>(std::move (deps)), targetDimension_ (dim), parameter_ (parameter)
+{}
+
+ValueRef<Eigen::MatrixXd> GeneratorFromModel::create (Context& c, NodeRefVec&& deps, const Dimension<T>& dim, const std::string& parameter)
+{
+  checkDependencyVectorSize (typeid (Self), deps, 2);
+  checkNthDependencyNotNull (typeid (Self), deps, 0);
+  checkNthDependencyIs<ConfiguredModel>(typeid (Self), deps, 0);
+  return cachedAs<Value<T> >(c, std::make_shared<Self>(std::move (deps), dim, parameter));
+}
+
+std::string GeneratorFromModel::debugInfo () const
+{
+  using namespace numeric;
+  return debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_) + ":parameter=" + parameter_;
+}
+
+// GeneratorFromModel additional arguments = (parameter_).
+bool GeneratorFromModel::compareAdditionalArguments (const Node_DF& other) const
+{
+  const auto* derived = dynamic_cast<const Self*>(&other);
+  return derived != nullptr && parameter_ == derived->parameter_;
+}
+
+std::size_t GeneratorFromModel::hashAdditionalArguments () const
+{
+  std::size_t seed = 0;
+  combineHash (seed, parameter_);
+  return seed;
+}
+
+NodeRef GeneratorFromModel::derive (Context& c, const Node_DF& node)
+{
+  // dG/dn = sum_i dG/dx_i * dx_i/dn (x_i = model parameters).
+  auto modelDep = this->dependency (0);
+  NodeRef subNode = this->dependency (1);
+  auto& model = static_cast<Dep&>(*modelDep);
+
+  auto buildFWithNewModel = [this, &c, &subNode](NodeRef&& newModel) {
+                              return Self::create (c, {std::move (newModel), subNode}, targetDimension_, parameter_);
+                            };
+
+  // Numerical derivation of the analytic derivatives
+  if (!parameter_.empty ())
+    return CWiseAdd<T, ReductionOf<T> >::create (
+      c, ConfiguredParametrizable::generateDerivativeSumDepsForComputations<Dep, T>(c, model, node, targetDimension_, buildFWithNewModel),
+      targetDimension_);
+
+  // Parameters of a mixture are not those of its submodels.
+  const auto* smodel = subNode ? nullptr : getSubstitutionModel (*modelDep, subNode);
+
+  NodeRefVec derivativeSumDeps;
+  for (std::size_t i = 0; i < model.nbDependencies (); ++i)
   {
-    const auto* model1 = accessValueConstCast<const BranchModel*>(*this->dependency (0));
-    const auto model = dynamic_cast<const TransitionModel*>(model1);
+    if (!model.dependency (i))
+      continue;
 
-    if (!model)
-      throw Exception("TransitionMatrixFromModel::compute only possible for Transition Models.");
+    auto dxi_dn = model.dependency (i)->derive (c, node);
+    if (dxi_dn->hasNumericalProperty (NumericalProperty::ConstantZero))
+      continue;
 
-    switch (nDeriv)
+    const auto& name = static_cast<const ConfiguredParameter&>(*model.dependency (i)).getName ();
+    ValueRef<T> df_dxi;
+    if (smodel && smodel->hasdGenerator_dParameter (name))
+      df_dxi = Self::create (c, {modelDep, subNode}, targetDimension_, name);
+    else
     {
-    case 0:
-      copyBppToEigen (model->getPij_t (brlen), r);
-      break;
-    case 1:
-      copyBppToEigen (model->getdPij_dt (brlen), r);
-      break;
-    case 2:
-      copyBppToEigen (model->getd2Pij_dt2 (brlen), r);
-      break;
-    default:
-      throw Exception("TransitionMatrixFromModel likelihood derivate " + TextTools::toString(nDeriv) + " not defined.");
+      // Only the generator is computed with shifted parameters.
+      auto buildFWithNewXi = [&c, i, &model, &buildFWithNewModel](std::shared_ptr<ConfiguredParameter> newDep) {
+                               NodeRefVec newModelDeps = model.dependencies ();
+                               newModelDeps[i] = std::move (newDep);
+                               return buildFWithNewModel (model.recreate (c, std::move (newModelDeps)));
+                             };
+      df_dxi = generateNumericalDerivative<T>(c, model.config, model.dependency (i), targetDimension_, buildFWithNewXi);
     }
+
+    if (dxi_dn->hasNumericalProperty (NumericalProperty::ConstantOne))
+      derivativeSumDeps.emplace_back (std::move (df_dxi));
+    else
+      derivativeSumDeps.emplace_back (CWiseMul<T, std::tuple<double, T> >::create (
+                                        c, {std::move (dxi_dn), std::move (df_dxi)}, targetDimension_));
+  }
+  return CWiseAdd<T, ReductionOf<T> >::create (c, std::move (derivativeSumDeps), targetDimension_);
+}
+
+NodeRef GeneratorFromModel::recreate (Context& c, NodeRefVec&& deps)
+{
+  return Self::create (c, std::move (deps), targetDimension_, parameter_);
+}
+
+void GeneratorFromModel::compute ()
+{
+  const auto* model = getSubstitutionModel (*this->dependency (0), this->dependency (1));
+  if (!model)
+    throw Exception("GeneratorFromModel::compute only possible for Substitution Models.");
+
+  auto& r = this->accessValueMutable ();
+  r.resize (targetDimension_.rows, targetDimension_.cols);
+  if (parameter_.empty ())
+  {
+    copyBppToEigen (model->getGenerator (), r);
+    r *= model->getRate ();
+  }
+  else
+    model->computedGenerator_dParameter (parameter_, r);
+}
+
+////////////////////////////////////////////////////////////
+// TransitionMatrixFromGeneratorDerivative
+
+TransitionMatrixFromGeneratorDerivative::TransitionMatrixFromGeneratorDerivative (NodeRefVec&& deps, const Dimension<Eigen::MatrixXd>& dim)
+  : Value<Eigen::MatrixXd>(std::move (deps)), targetDimension_ (dim)
+{}
+
+ValueRef<Eigen::MatrixXd> TransitionMatrixFromGeneratorDerivative::create (Context& c, NodeRefVec&& deps, const Dimension<T>& dim)
+{
+  checkDependencyVectorSize (typeid (Self), deps, 4);
+  checkNthDependencyNotNull (typeid (Self), deps, 0);
+  checkNthDependencyNotNull (typeid (Self), deps, 1);
+  checkNthDependencyNotNull (typeid (Self), deps, 2);
+  checkNthDependencyIs<ConfiguredModel>(typeid (Self), deps, 0);
+  checkNthDependencyIs<ConfiguredParameter>(typeid (Self), deps, 1);
+  checkNthDependencyIsValue<T>(typeid (Self), deps, 2);
+  // Linear in dGenerator
+  if (deps[2]->hasNumericalProperty (NumericalProperty::ConstantZero))
+    return ConstantZero<T>::create (c, dim);
+  return cachedAs<Value<T> >(c, std::make_shared<Self>(std::move (deps), dim));
+}
+
+std::string TransitionMatrixFromGeneratorDerivative::debugInfo () const
+{
+  using namespace numeric;
+  return debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_);
+}
+
+// TransitionMatrixFromGeneratorDerivative additional arguments = ().
+bool TransitionMatrixFromGeneratorDerivative::compareAdditionalArguments (const Node_DF& other) const
+{
+  return dynamic_cast<const Self*>(&other) != nullptr;
+}
+
+NodeRef TransitionMatrixFromGeneratorDerivative::derive (Context& c, const Node_DF& node)
+{
+  // df/dn = sum_i df/dx_i * dx_i/dn + df/dbrlen * dbrlen/dn + f(ddGenerator/dn) (x_i = model parameters, f linear in dGenerator).
+  auto modelDep = this->dependency (0);
+  auto brlenDep = this->dependency (1);
+  auto dGeneratorDep = this->dependency (2);
+  NodeRef subNode = this->dependency (3);
+  auto& model = static_cast<Dep&>(*modelDep);
+
+  // Model part
+  auto buildFWithNewModel = [this, &c, &brlenDep, &dGeneratorDep, &subNode](NodeRef&& newModel) {
+                              return Self::create (c, {std::move (newModel), brlenDep, dGeneratorDep, subNode}, targetDimension_);
+                            };
+  NodeRefVec derivativeSumDeps = ConfiguredParametrizable::generateDerivativeSumDepsForComputations<Dep, T>(
+    c, model, node, targetDimension_, buildFWithNewModel);
+
+  // Brlen part
+  auto dbrlen_dn = brlenDep->derive (c, node);
+  if (!dbrlen_dn->hasNumericalProperty (NumericalProperty::ConstantZero))
+  {
+    auto buildFWithNewBrlen = [this, &c, &modelDep, &dGeneratorDep, &subNode](std::shared_ptr<ConfiguredParameter> newBrlen) {
+                                return Self::create (c, {modelDep, std::move (newBrlen), dGeneratorDep, subNode}, targetDimension_);
+                              };
+    auto df_dbrlen = generateNumericalDerivative<T>(c, model.config, brlenDep, targetDimension_, buildFWithNewBrlen);
+    derivativeSumDeps.emplace_back (CWiseMul<T, std::tuple<double, T> >::create (
+                                      c, {std::move (dbrlen_dn), std::move (df_dbrlen)}, targetDimension_));
   }
+
+  // dGenerator part
+  derivativeSumDeps.emplace_back (Self::create (c, {modelDep, brlenDep, dGeneratorDep->derive (c, node), subNode}, targetDimension_));
+
+  return CWiseAdd<T, ReductionOf<T> >::create (c, std::move (derivativeSumDeps), targetDimension_);
+}
+
+NodeRef TransitionMatrixFromGeneratorDerivative::recreate (Context& c, NodeRefVec&& deps)
+{
+  return Self::create (c, std::move (deps), targetDimension_);
+}
+
+void TransitionMatrixFromGeneratorDerivative::compute ()
+{
+  const auto brlen = accessValueConstCast<double>(*this->dependency (1)->dependency (0));
+  const auto& dGenerator = accessValueConstCast<Eigen::MatrixXd>(*this->dependency (2));
+  const auto* model = getSubstitutionModel (*this->dependency (0), this->dependency (3));
+  if (!model)
+    throw Exception("TransitionMatrixFromGeneratorDerivative::compute only possible for Substitution Models.");
+
+  auto& r = this->accessValueMutable ();
+  r.resize (targetDimension_.rows, targetDimension_.cols);
+  model->computedPij_dGenerator (brlen, dGenerator, r);
 }
 
 ////////////////////////////////////////////////////////////
@@ -118,6 +118,12 @@ public:
     return static_cast<const ConfiguredParameter&>(getParameter(name));
   }
 
+  /// Updates the wrapped bpp object (see Node_DF::isThreadSafe).
+  bool isThreadSafe () const final
+  {
+    return false;
+  }
+
 private:
   void compute ()
   {
@@ -161,13 +167,21 @@ private:
   Dimension<T> targetDimension_;
 };
 
-/** transitionMatrix = f(model, branchLen, nDeriv, nMod, mult).
+/** transitionMatrix = f(model, branchLen, nDeriv, nMod, eigenDecomposition).
  * transitionMatrix: Matrix(fromState, toState).
  * model: ConfiguredModel.
  * branchLen: double.
  * nDeriv: degree of derivate (default: 0)
  * nMod: in case of mixture model, takes the number of submodel
  *       where the generator comes from (optional, or null).
+ * eigenDecomposition: EigenDecompositionFromModel of (model, nMod)
+ *       (optional).
+ *
+ * With a non empty eigenDecomposition,
+ * d^d P(t)/dt^d = U diag(lambda^d exp(lambda.t)) U^-1 is computed
+ * from the decomposition shared by all the branches of the model, so
+ * that a change of one branch length only invalidates the matrix of
+ * this branch. Otherwise the model computes P(t) (computePij_t & co).
  *
  * Node construction should be done with the create static method.
  */
@@ -203,6 +217,12 @@ public:
     return "TransitionMatrix";
   }
 
+  /** From the eigen decomposition, or through TransitionModel::computePij_t & co,
+   * which are reentrant only if TransitionModel::hasReentrantPij_t
+   * (see Node_DF::isThreadSafe).
+   */
+  bool isThreadSafe () const final;
+
   std::string shape() const
   {
     return "octagon";
@@ -210,6 +230,199 @@ public:
 
 private:
   void compute () final;
+
+  /// The model of the transition, or submodel in case of mixture model.
+  const TransitionModel* getTransitionModel_ () const;
+
+  bool hasEigenDecomposition_ () const
+  {
+    return nbDependencies () > 4 && this->dependency (4);
+  }
+};
+
+/** eigenDecomposition = f(model, nMod).
+ * eigenDecomposition: Matrix(state, (lambda, U, U^-1)), ie the
+ *   eigenvalues of the generator r.Q in column 0, then the columns of
+ *   its right eigenvectors U, then the rows of its left eigenvectors
+ *   U^-1. Empty if the generator has no real eigen decomposition.
+ * model: ConfiguredModel.
+ * nMod: in case of mixture model, takes the number of submodel
+ *       where the generator comes from (optional, or null).
+ *
+ * Shared by the transition matrices of all the branches with the
+ * same model (see TransitionMatrixFromModel). The decomposition is
+ * read from the model, which already caches it per parameter change.
+ *
+ * Only derived wrt nodes it does not depend on: the derivatives of
+ * the transition matrices go through the generator.
+ *
+ * Node construction should be done with the create static method.
+ */
+
+class EigenDecompositionFromModel : public Value<Eigen::MatrixXd>
+{
+public:
+  using Self = EigenDecompositionFromModel;
+  using Dep = ConfiguredModel;
+  using T = Eigen::MatrixXd;
+
+  /// Build a new EigenDecompositionFromModel node, for models with nbState states.
+  static ValueRef<T> create (Context& c, NodeRefVec&& deps, std::size_t nbState);
+
+  EigenDecompositionFromModel (NodeRefVec&& deps, const Dimension<T>& dim);
+
+  std::string debugInfo () const final;
+
+  bool compareAdditionalArguments (const Node_DF& other) const;
+
+  NodeRef derive (Context& c, const Node_DF& node) final;
+  NodeRef recreate (Context& c, NodeRefVec&& deps) final;
+
+  std::string color () const final
+  {
+    return "#aaff00";
+  }
+
+  std::string description () const final
+  {
+    return "EigenDecomposition";
+  }
+
+  /// Only reads the model (see Node_DF::isThreadSafe).
+  bool isThreadSafe () const final
+  {
+    return true;
+  }
+
+private:
+  void compute () final;
+
+  Dimension<T> targetDimension_;
+};
+
+/** generator = f(model, nMod).
+ * generator: Matrix(fromState, toState).
+ * model: ConfiguredModel, of a SubstitutionModel.
+ * nMod: in case of mixture model, takes the number of submodel
+ *       where the generator comes from (optional, or null).
+ *
+ * Generator including the rate of the model, r.Q, or if parameter
+ * is not empty, its analytic derivative with respect to this
+ * parameter (see SubstitutionModel::computedGenerator_dParameter).
+ *
+ * The derivative of r.Q uses the analytic derivatives of the model
+ * when available, and numerical derivation of the generator only
+ * otherwise.
+ *
+ * Node construction should be done with the create static method.
+ */
+
+class GeneratorFromModel : public Value<Eigen::MatrixXd>
+{
+public:
+  using Self = GeneratorFromModel;
+  using Dep = ConfiguredModel;
+  using T = Eigen::MatrixXd;
+
+  /// Build a new GeneratorFromModel node, of the derivative wrt parameter if not empty.
+  static ValueRef<T> create (Context& c, NodeRefVec&& deps, const Dimension<T>& dim, const std::string& parameter = "");
+
+  GeneratorFromModel (NodeRefVec&& deps, const Dimension<T>& dim, const std::string& parameter);
+
+  std::string debugInfo () const final;
+
+  bool compareAdditionalArguments (const Node_DF& other) const final;
+  std::size_t hashAdditionalArguments () const final;
+
+  NodeRef derive (Context& c, const Node_DF& node) final;
+  NodeRef recreate (Context& c, NodeRefVec&& deps) final;
+
+  std::string color () const final
+  {
+    return "#aaff00";
+  }
+
+  std::string description () const final
+  {
+    return parameter_.empty () ? "Generator" : "dGenerator/d" + parameter_;
+  }
+
+  /// Only reads the model (see Node_DF::isThreadSafe).
+  bool isThreadSafe () const final
+  {
+    return true;
+  }
+
+private:
+  void compute () final;
+
+  Dimension<T> targetDimension_;
+  std::string parameter_;
+};
+
+/** transitionMatrixDerivative = f(model, branchLen, dGenerator, nMod).
+ * transitionMatrixDerivative: Matrix(fromState, toState).
+ * model: ConfiguredModel, of a SubstitutionModel.
+ * branchLen: ConfiguredParameter.
+ * dGenerator: Matrix(fromState, toState), derivative of the
+ *   generator r.Q (see GeneratorFromModel).
+ * nMod: in case of mixture model, takes the number of submodel
+ *       where the generator comes from (optional, or null).
+ *
+ * Derivative of the transition matrix exp(branchLen.r.Q) along
+ * dGenerator, computed through
+ * SubstitutionModel::computedPij_dGenerator. With the derivative of
+ * a GeneratorFromModel node, this is the derivative of the
+ * transition matrix with respect to the model parameters, without
+ * numerical derivation of the transition matrices.
+ *
+ * Node construction should be done with the create static method.
+ */
+
+class TransitionMatrixFromGeneratorDerivative : public Value<Eigen::MatrixXd>
+{
+public:
+  using Self = TransitionMatrixFromGeneratorDerivative;
+  using Dep = ConfiguredModel;
+  using T = Eigen::MatrixXd;
+
+  /// Build a new TransitionMatrixFromGeneratorDerivative node with the given output dimensions.
+  static ValueRef<T> create (Context& c, NodeRefVec&& deps, const Dimension<T>& dim);
+
+  TransitionMatrixFromGeneratorDerivative (NodeRefVec&& deps, const Dimension<T>& dim);
+
+  std::string debugInfo () const final;
+
+  bool compareAdditionalArguments (const Node_DF& other) const final;
+
+  NodeRef derive (Context& c, const Node_DF& node) final;
+  NodeRef recreate (Context& c, NodeRefVec&& deps) final;
+
+  std::string color () const final
+  {
+    return "#aaff00";
+  }
+
+  std::string description () const final
+  {
+    return "dTransitionMatrix/dGenerator";
+  }
+
+  /// Computed through the reentrant SubstitutionModel::computedPij_dGenerator (see Node_DF::isThreadSafe).
+  bool isThreadSafe () const final
+  {
+    return true;
+  }
+
+  std::string shape() const
+  {
+    return "octagon";
+  }
+
+private:
+  void compute () final;
+
+  Dimension<T> targetDimension_;
 };
 
 /** transitionProbability = f(model, branchLen, nDeriv).
@@ -253,6 +466,12 @@ public:
     return "TransitionFunction";
   }
 
+  /// Uses the internal matrices of the shared model (see Node_DF::isThreadSafe).
+  bool isThreadSafe () const final
+  {
+    return false;
+  }
+
   std::string shape() const
   {
     return "octagon";
@@ -90,6 +90,8 @@ public:
     checkDependencyVectorSize (typeid (Self), deps, 1);
     checkNthDependencyIsValue<double>(typeid (Self), deps, 0);
 
+    // The hash of self changes with its dependencies.
+    c.erase(self);
     self->resetDependencies_(std::move(deps));
 
     return cachedAs<Self>(c, self);
@@ -148,6 +150,12 @@ public:
 
   NodeRef recreate (Context& c);
 
+  /// Parameter values are updated through the bpp::Parameter interface (see Node_DF::isThreadSafe).
+  bool isThreadSafe () const override
+  {
+    return false;
+  }
+
 private:
   void compute () override;
 };
@@ -328,6 +336,12 @@ public:
 
   std::string color () const;
 
+  /// ConfiguredParameter::getValue updates the parameter (see Node_DF::isThreadSafe).
+  bool isThreadSafe () const final
+  {
+    return false;
+  }
+
 private:
   void compute () final;
 
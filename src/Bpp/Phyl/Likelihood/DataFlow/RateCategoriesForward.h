@@ -0,0 +1,437 @@
+//
+// File: RateCategoriesForward.h
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef BPP_PHYL_LIKELIHOOD_DATAFLOW_RATECATEGORIESFORWARD_H
+#define BPP_PHYL_LIKELIHOOD_DATAFLOW_RATECATEGORIESFORWARD_H
+
+#include <Bpp/Exceptions.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/DataFlowCWiseComputing.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/DataFlowNumeric.h>
+#include <algorithm>
+
+#include "Definitions.h"
+#include "Sequence_DF.h"
+
+namespace bpp
+{
+/*
+ * Conditional likelihoods of all the rate categories of a process,
+ * stored together as one MatrixLik (state, category * nbSites +
+ * site): the columns of category c are the block [c * nbSites, (c
+ * + 1) * nbSites[.
+ *
+ * An edge is then a single node, which applies the transition
+ * matrix of each category to its block, and speciations are
+ * SpeciationForward on the stacked matrices (or
+ * SpeciationSiteRepeats, with the transitions of the sons).
+ */
+
+/** @brief Transition of the stacked conditional likelihoods of the
+ * rate categories.
+ * - r: MatrixLik (state, category * nbSites + site).
+ * - transitionMatrix_c: Matrix (fromState, toState), for each category c.
+ * - x: MatrixLik (state, category * nbSites + site).
+ *
+ * r(., block c) = transitionMatrix_c * x(., block c).
+ *
+ * Same value as a ForwardTransition per category, with one node and
+ * one pass on the stacked columns.
+ */
+
+class RateCategoriesTransition : public Value<MatrixLik>
+{
+public:
+  using Self = RateCategoriesTransition;
+
+  /// deps = (transitionMatrix_0, ..., transitionMatrix_{k-1}, x).
+  static ValueRef<MatrixLik> create (Context& c, NodeRefVec&& deps, const Dimension<MatrixLik>& dim)
+  {
+    checkDependenciesNotNull (typeid (Self), deps);
+    checkDependencyVectorMinSize (typeid (Self), deps, 2);
+    checkDependencyRangeIsValue<Eigen::MatrixXd>(typeid (Self), deps, 0, deps.size () - 1);
+    checkNthDependencyIsValue<MatrixLik>(typeid (Self), deps, deps.size () - 1);
+    if (deps.back ()->hasNumericalProperty (NumericalProperty::ConstantZero) ||
+        std::all_of (deps.begin (), deps.end () - 1, [](const NodeRef& dep) -> bool {
+          return dep->hasNumericalProperty (NumericalProperty::ConstantZero);
+        }))
+    {
+      return ConstantZero<MatrixLik>::create (c, dim);
+    }
+    return cachedAs<Value<MatrixLik> >(c, std::make_shared<Self>(std::move (deps), dim));
+  }
+
+  RateCategoriesTransition (NodeRefVec&& deps, const Dimension<MatrixLik>& dim)
+    : Value<MatrixLik>(std::move (deps)), targetDimension_ (dim)
+  {}
+
+  std::size_t getNumberOfCategories () const
+  {
+    return this->nbDependencies () - 1;
+  }
+
+  std::string debugInfo () const override
+  {
+    using namespace numeric;
+    return debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_) +
+           " categories=" + std::to_string (getNumberOfCategories ());
+  }
+
+  std::string shape() const override
+  {
+    return "doubleoctagon";
+  }
+
+  std::string color() const override
+  {
+    return "#9e9e9e";
+  }
+
+  std::string description() const override
+  {
+    return "Rate Categories Transition";
+  }
+
+  // RateCategoriesTransition additional arguments = ().
+  bool compareAdditionalArguments (const Node_DF& other) const final
+  {
+    return dynamic_cast<const Self*>(&other) != nullptr;
+  }
+
+  // Bilinear in (transition matrices, x).
+  NodeRef derive (Context& c, const Node_DF& node) final
+  {
+    if (&node == this)
+    {
+      return ConstantOne<MatrixLik>::create (c, targetDimension_);
+    }
+    const auto nbCat = getNumberOfCategories ();
+    NodeRefVec dTransitionDeps = this->dependencies ();
+    for (std::size_t i = 0; i < nbCat; ++i)
+    {
+      dTransitionDeps[i] = this->dependency (i)->derive (c, node);
+    }
+    NodeRefVec dxDeps = this->dependencies ();
+    dxDeps[nbCat] = this->dependency (nbCat)->derive (c, node);
+
+    auto dTransition = Self::create (c, std::move (dTransitionDeps), targetDimension_);
+    auto dx = Self::create (c, std::move (dxDeps), targetDimension_);
+    return CWiseAdd<MatrixLik, std::tuple<MatrixLik, MatrixLik> >::create (c, {dTransition, dx}, targetDimension_);
+  }
+
+  NodeRef recreate (Context& c, NodeRefVec&& deps) final
+  {
+    return Self::create (c, std::move (deps), targetDimension_);
+  }
+
+private:
+  void compute () final
+  {
+    auto& result = this->accessValueMutable ();
+    const auto nbCat = Eigen::Index (getNumberOfCategories ());
+    const auto& x = accessValueConstCast<MatrixLik>(*this->dependency (std::size_t (nbCat)));
+    const auto& xf = x.float_part ();
+
+    if (xf.cols () % nbCat != 0)
+      throw Exception ("RateCategoriesTransition: " + std::to_string (xf.cols ()) +
+                       " columns for " + std::to_string (nbCat) + " categories.");
+    const auto nbSites = xf.cols () / nbCat;
+
+    std::vector<const Eigen::MatrixXd*> transitions (std::size_t (nbCat), nullptr);
+    for (Eigen::Index cat = 0; cat < nbCat; ++cat)
+    {
+      transitions[std::size_t (cat)] = &accessValueConstCast<Eigen::MatrixXd>(*this->dependency (std::size_t (cat)));
+    }
+
+    auto& r = result.float_part ();
+    r.resize (transitions[0]->rows (), xf.cols ());
+    // Blocks of sites may overlap several categories.
+    computeBySiteBlocks (this->getScheduler_ (), r.rows (), r.cols (),
+                         [&r, &xf, &transitions, nbSites](Eigen::Index firstCol, Eigen::Index nbCols) {
+        auto col = firstCol;
+        while (col < firstCol + nbCols)
+        {
+          const auto cat = col / nbSites;
+          const auto endCol = std::min (firstCol + nbCols, (cat + 1) * nbSites);
+          r.middleCols (col, endCol - col).noalias () =
+            *transitions[std::size_t (cat)] * xf.middleCols (col, endCol - col);
+          col = endCol;
+        }
+      });
+    result.exponent_part () = x.exponent_part ();
+    result.normalize ();
+  }
+
+  Dimension<MatrixLik> targetDimension_;
+};
+
+/** @brief Transition of the conditional likelihood of a leaf, for
+ * all the rate categories.
+ * - r: MatrixLik (state, category * nbSites + site).
+ * - transitionMatrix_c: Matrix (fromState, toState), for each category c.
+ * - tip: TipLikelihood.
+ *
+ * As TipTransition, the products are done once per code: the
+ * transition matrices are stacked so that all the categories are
+ * computed with one product, and the sites gather the columns.
+ */
+
+class RateCategoriesTipTransition : public Value<MatrixLik>
+{
+public:
+  using Self = RateCategoriesTipTransition;
+
+  /// deps = (transitionMatrix_0, ..., transitionMatrix_{k-1}, tip).
+  static ValueRef<MatrixLik> create (Context& c, NodeRefVec&& deps, const Dimension<MatrixLik>& dim)
+  {
+    checkDependenciesNotNull (typeid (Self), deps);
+    checkDependencyVectorMinSize (typeid (Self), deps, 2);
+    checkDependencyRangeIsValue<Eigen::MatrixXd>(typeid (Self), deps, 0, deps.size () - 1);
+    checkNthDependencyIsValue<TipLikelihood>(typeid (Self), deps, deps.size () - 1);
+    if (std::all_of (deps.begin (), deps.end () - 1, [](const NodeRef& dep) -> bool {
+          return dep->hasNumericalProperty (NumericalProperty::ConstantZero);
+        }))
+    {
+      return ConstantZero<MatrixLik>::create (c, dim);
+    }
+    return cachedAs<Value<MatrixLik> >(c, std::make_shared<Self>(std::move (deps), dim));
+  }
+
+  RateCategoriesTipTransition (NodeRefVec&& deps, const Dimension<MatrixLik>& dim)
+    : Value<MatrixLik>(std::move (deps)), targetDimension_ (dim)
+  {}
+
+  std::size_t getNumberOfCategories () const
+  {
+    return this->nbDependencies () - 1;
+  }
+
+  std::string debugInfo () const override
+  {
+    using namespace numeric;
+    return debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_) +
+           " categories=" + std::to_string (getNumberOfCategories ());
+  }
+
+  std::string shape() const override
+  {
+    return "doubleoctagon";
+  }
+
+  std::string color() const override
+  {
+    return "#9e9e9e";
+  }
+
+  std::string description() const override
+  {
+    return "Rate Categories Tip Transition";
+  }
+
+  // RateCategoriesTipTransition additional arguments = ().
+  bool compareAdditionalArguments (const Node_DF& other) const final
+  {
+    return dynamic_cast<const Self*>(&other) != nullptr;
+  }
+
+  // Leaf data is constant: only the transition matrices are derived.
+  NodeRef derive (Context& c, const Node_DF& node) final
+  {
+    if (&node == this)
+    {
+      return ConstantOne<MatrixLik>::create (c, targetDimension_);
+    }
+    NodeRefVec deps = this->dependencies ();
+    for (std::size_t i = 0; i < getNumberOfCategories (); ++i)
+    {
+      deps[i] = this->dependency (i)->derive (c, node);
+    }
+    return Self::create (c, std::move (deps), targetDimension_);
+  }
+
+  NodeRef recreate (Context& c, NodeRefVec&& deps) final
+  {
+    return Self::create (c, std::move (deps), targetDimension_);
+  }
+
+private:
+  void compute () final
+  {
+    auto& result = this->accessValueMutable ();
+    const auto nbCat = Eigen::Index (getNumberOfCategories ());
+    const auto& tip = accessValueConstCast<TipLikelihood>(*this->dependency (std::size_t (nbCat)));
+    const auto nbState = tip.getNumberOfStates ();
+    const auto nbSites = tip.getNumberOfSites ();
+
+    Eigen::MatrixXd transitions (nbCat * nbState, nbState);
+    for (Eigen::Index cat = 0; cat < nbCat; ++cat)
+    {
+      transitions.middleRows (cat * nbState, nbState) = accessValueConstCast<Eigen::MatrixXd>(*this->dependency (std::size_t (cat)));
+    }
+    const Eigen::MatrixXd codeForward = transitions * tip.codeLikelihoods;
+
+    auto& r = result.float_part ();
+    r.resize (nbState, nbCat * nbSites);
+    computeBySiteBlocks (this->getScheduler_ (), r.rows (), r.cols (),
+                         [&r, &codeForward, &tip, nbState, nbSites](Eigen::Index firstCol, Eigen::Index nbCols) {
+        for (Eigen::Index col = firstCol; col < firstCol + nbCols; ++col)
+        {
+          r.col (col) = codeForward.block ((col / nbSites) * nbState, tip.siteCodes (col % nbSites), nbState, 1);
+        }
+      });
+    result.exponent_part () = 0;
+    result.normalize ();
+  }
+
+  Dimension<MatrixLik> targetDimension_;
+};
+
+/** @brief Mean of the site likelihoods of the rate categories.
+ * - r: RowLik (site).
+ * - x: RowLik (category * nbSites + site).
+ * - p_c: double, for each category c.
+ *
+ * r(site) = sum_c p_c * x(c * nbSites + site).
+ */
+
+class RateCategoriesMean : public Value<RowLik>
+{
+public:
+  using Self = RateCategoriesMean;
+
+  /// deps = (x, p_0, ..., p_{k-1}).
+  static ValueRef<RowLik> create (Context& c, NodeRefVec&& deps, const Dimension<RowLik>& dim)
+  {
+    checkDependenciesNotNull (typeid (Self), deps);
+    checkDependencyVectorMinSize (typeid (Self), deps, 2);
+    checkNthDependencyIsValue<RowLik>(typeid (Self), deps, 0);
+    checkDependencyRangeIsValue<double>(typeid (Self), deps, 1, deps.size ());
+    if (deps[0]->hasNumericalProperty (NumericalProperty::ConstantZero) ||
+        std::all_of (deps.begin () + 1, deps.end (), [](const NodeRef& dep) -> bool {
+          return dep->hasNumericalProperty (NumericalProperty::ConstantZero);
+        }))
+    {
+      return ConstantZero<RowLik>::create (c, dim);
+    }
+    return cachedAs<Value<RowLik> >(c, std::make_shared<Self>(std::move (deps), dim));
+  }
+
+  RateCategoriesMean (NodeRefVec&& deps, const Dimension<RowLik>& dim)
+    : Value<RowLik>(std::move (deps)), targetDimension_ (dim)
+  {}
+
+  std::string debugInfo () const override
+  {
+    using namespace numeric;
+    return debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_);
+  }
+
+  std::string shape() const override
+  {
+    return "trapezium";
+  }
+
+  std::string color() const override
+  {
+    return "#ffd0d0";
+  }
+
+  std::string description() const override
+  {
+    return "Rate Categories Mean";
+  }
+
+  // RateCategoriesMean additional arguments = ().
+  bool compareAdditionalArguments (const Node_DF& other) const final
+  {
+    return dynamic_cast<const Self*>(&other) != nullptr;
+  }
+
+  // Bilinear in (x, probabilities).
+  NodeRef derive (Context& c, const Node_DF& node) final
+  {
+    if (&node == this)
+    {
+      return ConstantOne<RowLik>::create (c, targetDimension_);
+    }
+    NodeRefVec dxDeps = this->dependencies ();
+    dxDeps[0] = this->dependency (0)->derive (c, node);
+    NodeRefVec dProbDeps = this->dependencies ();
+    for (std::size_t i = 1; i < this->nbDependencies (); ++i)
+    {
+      dProbDeps[i] = this->dependency (i)->derive (c, node);
+    }
+
+    auto dx = Self::create (c, std::move (dxDeps), targetDimension_);
+    auto dProb = Self::create (c, std::move (dProbDeps), targetDimension_);
+    return CWiseAdd<RowLik, std::tuple<RowLik, RowLik> >::create (c, {dx, dProb}, targetDimension_);
+  }
+
+  NodeRef recreate (Context& c, NodeRefVec&& deps) final
+  {
+    return Self::create (c, std::move (deps), targetDimension_);
+  }
+
+private:
+  void compute () final
+  {
+    auto& result = this->accessValueMutable ();
+    const auto& x = accessValueConstCast<RowLik>(*this->dependency (0));
+    const auto& xf = x.float_part ();
+    const auto nbCat = Eigen::Index (this->nbDependencies () - 1);
+
+    if (xf.cols () % nbCat != 0)
+      throw Exception ("RateCategoriesMean: " + std::to_string (xf.cols ()) +
+                       " columns for " + std::to_string (nbCat) + " categories.");
+    const auto nbSites = xf.cols () / nbCat;
+
+    auto& r = result.float_part ();
+    r.setZero (nbSites);
+    for (Eigen::Index cat = 0; cat < nbCat; ++cat)
+    {
+      r += accessValueConstCast<double>(*this->dependency (std::size_t (cat + 1))) * xf.middleCols (cat * nbSites, nbSites);
+    }
+    result.exponent_part () = x.exponent_part ();
+    result.normalize ();
+  }
+
+  Dimension<RowLik> targetDimension_;
+};
+} // namespace bpp
+#endif // BPP_PHYL_LIKELIHOOD_DATAFLOW_RATECATEGORIESFORWARD_H
@@ -42,8 +42,11 @@
 #define BPP_PHYL_LIKELIHOOD_DATAFLOW_SEQUENCE_DF_H
 
 #include <Bpp/Exceptions.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/DataFlowCWiseComputing.h>
 #include <Bpp/Phyl/Likelihood/DataFlow/DataFlowNumeric.h>
 #include <functional>
+#include <map>
+#include <string>
 #include <unordered_map>
 
 #include "Definitions.h"
@@ -135,5 +138,298 @@ private:
     failureComputeWasCalled (typeid (*this));
   }
 };
+
+/** @brief Compact conditional likelihood of a leaf.
+ *
+ * The nbState x nbSite conditional likelihood of a leaf has few
+ * distinct columns (one per observed state or ambiguity code).
+ * They are stored once, with the index of the column of each site.
+ */
+struct TipLikelihood
+{
+  /// Distinct columns of the conditional likelihood (nbState x nbCode).
+  Eigen::MatrixXd codeLikelihoods;
+
+  /// Index of the column of codeLikelihoods for each site.
+  Eigen::RowVectorXi siteCodes;
+
+  Eigen::Index getNumberOfStates () const { return codeLikelihoods.rows (); }
+
+  Eigen::Index getNumberOfSites () const { return siteCodes.cols (); }
+
+  bool operator==(const TipLikelihood& other) const
+  {
+    return codeLikelihoods.rows () == other.codeLikelihoods.rows ()
+           && codeLikelihoods.cols () == other.codeLikelihoods.cols ()
+           && siteCodes.cols () == other.siteCodes.cols ()
+           && codeLikelihoods == other.codeLikelihoods
+           && siteCodes == other.siteCodes;
+  }
+};
+
+/// TipLikelihood of the leaves, by sequence name.
+using TipLikelihoods = std::map<std::string, TipLikelihood>;
+
+/** @brief Data flow node representing a Sequence as a compact
+ * TipLikelihood with a name.
+ *
+ * Used by ForwardLikelihoodTree for leaves, through
+ * TipConditionalLikelihood and TipTransition.
+ */
+
+class TipSequence_DF : public Value<TipLikelihood>
+{
+private:
+  std::string name_;
+
+public:
+  using Self = TipSequence_DF;
+  using T = TipLikelihood;
+
+  static std::shared_ptr<Self> create (Context& c, T&& value, const std::string& name)
+  {
+    return cachedAs<Self>(c, std::make_shared<Self>(std::move(value), name));
+  }
+
+  TipSequence_DF (T&& value, const std::string& name) :
+    Value<T>(NodeRefVec{}, std::move(value)),
+    name_(name)
+  {
+    this->makeValid (); // Always valid
+  }
+
+  const std::string& getName() const
+  {
+    return name_;
+  }
+
+  std::string debugInfo () const final
+  {
+    const auto& tip = this->accessValueConst ();
+    return name_ + " states=" + std::to_string (tip.getNumberOfStates ()) +
+           " codes=" + std::to_string (tip.codeLikelihoods.cols ()) +
+           " sites=" + std::to_string (tip.getNumberOfSites ());
+  }
+
+  std::string description () const final
+  {
+    return Node_DF::description() + "\n" + name_;
+  }
+
+  bool compareAdditionalArguments (const Node_DF& other) const override
+  {
+    const auto* derived = dynamic_cast<const Self*>(&other);
+    return derived != nullptr && name_ == derived->name_ && this->accessValueConst () == derived->accessValueConst ();
+  }
+
+  std::string color () const override
+  {
+    return "grey";
+  }
+
+  NodeRef recreate (Context& c, NodeRefVec&& deps) final
+  {
+    checkRecreateWithoutDependencies (typeid (Self), deps);
+    return this->shared_from_this ();
+  }
+
+  std::size_t hashAdditionalArguments () const override
+  {
+    using namespace numeric;
+    size_t seed = hash (this->accessValueConst ().siteCodes);
+    combineHash<std::string>(seed, name_);
+    return seed;
+  }
+
+private:
+  void compute () final
+  {
+    // Constant is valid from construction
+    failureComputeWasCalled (typeid (*this));
+  }
+};
+
+/** @brief Conditional likelihood of a leaf, expanded from its
+ * TipSequence_DF.
+ *
+ * r(state, site) = codeLikelihoods(state, siteCodes(site)).
+ *
+ * Computed only if needed (leaves are usually only read through
+ * TipTransition), so the dense matrix is not stored otherwise.
+ */
+
+class TipConditionalLikelihood : public Value<MatrixLik>
+{
+public:
+  using Self = TipConditionalLikelihood;
+
+  static ValueRef<MatrixLik> create (Context& c, NodeRefVec&& deps, const Dimension<MatrixLik>& dim)
+  {
+    checkDependenciesNotNull (typeid (Self), deps);
+    checkDependencyVectorSize (typeid (Self), deps, 1);
+    checkNthDependencyIsValue<TipLikelihood>(typeid (Self), deps, 0);
+    return cachedAs<Value<MatrixLik> >(c, std::make_shared<Self>(std::move (deps), dim));
+  }
+
+  TipConditionalLikelihood (NodeRefVec&& deps, const Dimension<MatrixLik>& dim)
+    : Value<MatrixLik>(std::move (deps)), targetDimension_ (dim)
+  {}
+
+  /// Name of the sequence.
+  const std::string& getName() const
+  {
+    return static_cast<const TipSequence_DF&>(*this->dependency (0)).getName ();
+  }
+
+  std::string debugInfo () const override
+  {
+    using namespace numeric;
+    return getName () + " " + debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_);
+  }
+
+  std::string color () const override
+  {
+    return "grey";
+  }
+
+  bool compareAdditionalArguments (const Node_DF& other) const final
+  {
+    return dynamic_cast<const Self*>(&other) != nullptr;
+  }
+
+  NodeRef derive (Context& c, const Node_DF& node) final
+  {
+    if (&node == this)
+    {
+      return ConstantOne<MatrixLik>::create (c, targetDimension_);
+    }
+    return ConstantZero<MatrixLik>::create (c, targetDimension_);
+  }
+
+  NodeRef recreate (Context& c, NodeRefVec&& deps) final
+  {
+    return Self::create (c, std::move (deps), targetDimension_);
+  }
+
+private:
+  void compute () final
+  {
+    auto& result = this->accessValueMutable ();
+    const auto& tip = accessValueConstCast<TipLikelihood>(*this->dependency (0));
+    auto& r = result.float_part ();
+    r.resize (tip.getNumberOfStates (), tip.getNumberOfSites ());
+    for (Eigen::Index site = 0; site < r.cols (); ++site)
+    {
+      r.col (site) = tip.codeLikelihoods.col (tip.siteCodes (site));
+    }
+    result.exponent_part () = 0;
+  }
+
+  Dimension<MatrixLik> targetDimension_;
+};
+
+/** @brief Transition of the conditional likelihood of a leaf.
+ * - r: MatrixLik (state, site).
+ * - transitionMatrix: Matrix (fromState, toState).
+ * - tip: TipLikelihood.
+ *
+ * Same value as MatrixProduct<MatrixLik, Eigen::MatrixXd, MatrixLik>
+ * with the expanded leaf, but the product is done once per code, and
+ * sites only gather the columns of the nbState x nbCode result.
+ */
+
+class TipTransition : public Value<MatrixLik>
+{
+public:
+  using Self = TipTransition;
+
+  static ValueRef<MatrixLik> create (Context& c, NodeRefVec&& deps, const Dimension<MatrixLik>& dim)
+  {
+    checkDependenciesNotNull (typeid (Self), deps);
+    checkDependencyVectorSize (typeid (Self), deps, 2);
+    checkNthDependencyIsValue<Eigen::MatrixXd>(typeid (Self), deps, 0);
+    checkNthDependencyIsValue<TipLikelihood>(typeid (Self), deps, 1);
+    if (deps[0]->hasNumericalProperty (NumericalProperty::ConstantZero))
+    {
+      return ConstantZero<MatrixLik>::create (c, dim);
+    }
+    else if (deps[0]->hasNumericalProperty (NumericalProperty::ConstantIdentity))
+    {
+      return TipConditionalLikelihood::create (c, {deps[1]}, dim);
+    }
+    else
+    {
+      return cachedAs<Value<MatrixLik> >(c, std::make_shared<Self>(std::move (deps), dim));
+    }
+  }
+
+  TipTransition (NodeRefVec&& deps, const Dimension<MatrixLik>& dim)
+    : Value<MatrixLik>(std::move (deps)), targetDimension_ (dim)
+  {}
+
+  std::string debugInfo () const override
+  {
+    using namespace numeric;
+    return debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_);
+  }
+
+  std::string shape() const override
+  {
+    return "doubleoctagon";
+  }
+
+  std::string color() const override
+  {
+    return "#9e9e9e";
+  }
+
+  std::string description() const override
+  {
+    return "Tip Transition";
+  }
+
+  // TipTransition additional arguments = ().
+  bool compareAdditionalArguments (const Node_DF& other) const final
+  {
+    return dynamic_cast<const Self*>(&other) != nullptr;
+  }
+
+  // Leaf data is constant: only the transition matrix is derived.
+  NodeRef derive (Context& c, const Node_DF& node) final
+  {
+    if (&node == this)
+    {
+      return ConstantOne<MatrixLik>::create (c, targetDimension_);
+    }
+    return Self::create (c, {this->dependency (0)->derive (c, node), this->dependency (1)}, targetDimension_);
+  }
+
+  NodeRef recreate (Context& c, NodeRefVec&& deps) final
+  {
+    return Self::create (c, std::move (deps), targetDimension_);
+  }
+
+private:
+  void compute () final
+  {
+    auto& result = this->accessValueMutable ();
+    const auto& transition = accessValueConstCast<Eigen::MatrixXd>(*this->dependency (0));
+    const auto& tip = accessValueConstCast<TipLikelihood>(*this->dependency (1));
+    const Eigen::MatrixXd codeForward = transition * tip.codeLikelihoods;
+    auto& r = result.float_part ();
+    r.resize (codeForward.rows (), tip.getNumberOfSites ());
+    computeBySiteBlocks (this->getScheduler_ (), r.rows (), r.cols (),
+                         [&r, &codeForward, &tip](Eigen::Index firstCol, Eigen::Index nbCols) {
+        for (Eigen::Index site = firstCol; site < firstCol + nbCols; ++site)
+        {
+          r.col (site) = codeForward.col (tip.siteCodes (site));
+        }
+      });
+    result.exponent_part () = 0;
+    result.normalize ();
+  }
+
+  Dimension<MatrixLik> targetDimension_;
+};
 } // namespace bpp
 #endif // BPP_PHYL_LIKELIHOOD_DATAFLOW_SEQUENCE_DF_H
@@ -0,0 +1,270 @@
+//
+// File: SingleBranchLikelihood.cpp
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Phyl/Likelihood/DataFlow/SingleBranchLikelihood.h>
+#include <Bpp/Phyl/Model/MixedTransitionModel.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+using namespace bpp;
+
+namespace
+{
+/*
+ * Substitution model of an edge, if its transition matrix is
+ * computed from a diagonalizable model with real eigen values, else
+ * nullptr.
+ */
+
+const SubstitutionModel* getDiagonalizableModel_(ProcessEdge& edge)
+{
+  if (!edge.getModel())
+    return nullptr;
+
+  const auto* model1 = edge.getModel()->getTargetValue();
+  const auto* mixmodel = dynamic_cast<const MixedTransitionModel*>(model1);
+
+  const SubstitutionModel* model;
+  if (mixmodel && edge.getNMod())
+    model = dynamic_cast<const SubstitutionModel*>(mixmodel->getNModel(edge.getNMod()->getTargetValue()));
+  else
+    model = dynamic_cast<const SubstitutionModel*>(model1);
+
+  if (!model || !model->isDiagonalizable() || !model->isNonSingular())
+    return nullptr;
+
+  const auto& ivp = model->getIEigenValues();
+  if (model->getEigenValues().size() != model->getNumberOfStates()
+      || std::any_of(ivp.begin(), ivp.end(), [](double x) { return x != 0; }))
+    return nullptr;
+
+  return model;
+}
+} // namespace
+
+SingleBranchLikelihood::SingleBranchLikelihood(LikelihoodCalculationSingleProcess& likCal, uint edgeId) :
+  likCal_(likCal), edgeId_(edgeId), brLen_(likCal.getBranchLengthParameter(edgeId)),
+  exponents_(), sumTables_(), weights_(), logScale_(0)
+{
+  if (!brLen_)
+    throw Exception("SingleBranchLikelihood: edge " + TextTools::toString(edgeId) + " has no branch length.");
+
+  update();
+}
+
+void SingleBranchLikelihood::update()
+{
+  likCal_.getLikelihoodNode();
+
+  const size_t nbCat = likCal_.getNumberOfClasses();
+  auto tree = likCal_.getTreeNode(0);
+  auto edge = tree->getEdge(edgeId_);
+  const auto sonId = tree->getNodeIndex(tree->getSon(edge));
+
+  const auto* model = getDiagonalizableModel_(*edge);
+  if (!model)
+    throw Exception("SingleBranchLikelihood::update: model of edge " + TextTools::toString(edgeId_) + " is not diagonalizable with real eigen values.");
+
+  const auto nbState = Eigen::Index(model->getNumberOfStates());
+
+  // P(t) = U diag(exp(r.l.t)) V, with V = U^-1
+  Eigen::MatrixXd u, v;
+  copyBppToEigen(model->getColumnRightEigenVectors(), u);
+  copyBppToEigen(model->getRowLeftEigenVectors(), v);
+  Eigen::VectorXd lambda;
+  copyBppToEigen(model->getEigenValues(), lambda);
+  lambda *= model->getRate();
+
+  std::vector<Eigen::MatrixXd> tables(nbCat);
+  std::vector<ExtendedFloat::ExtType> exps(nbCat);
+  std::vector<double> probas(nbCat);
+
+  exponents_.resize(Eigen::Index(nbCat) * nbState);
+
+  for (size_t c = 0; c < nbCat; c++)
+  {
+    // Used one at a time, since the storage of a value may be
+    // released by the next computation (see Context::setMemoryBudget).
+    const auto& above = likCal_.getBackwardLikelihoodsAtEdgeForClass(edgeId_, c)->getTargetValue();
+    tables[c] = u.transpose() * above.float_part();
+    exps[c] = above.exponent_part();
+
+    const auto& below = likCal_.getForwardLikelihoodsAtNodeForClass(sonId, c)->getTargetValue();
+    tables[c] = tables[c].cwiseProduct(v * below.float_part());
+    exps[c] += below.exponent_part();
+    probas[c] = likCal_.getProbabilityForClass(c)->getTargetValue();
+
+    exponents_.segment(Eigen::Index(c) * nbState, nbState) = lambda * likCal_.getRateForClass(c)->getTargetValue();
+  }
+
+  // All categories are scaled on the biggest exponent.
+  const auto maxExp = *std::max_element(exps.begin(), exps.end());
+  const auto nbSites = tables[0].cols();
+
+  sumTables_.resize(Eigen::Index(nbCat) * nbState, nbSites);
+  for (size_t c = 0; c < nbCat; c++)
+  {
+    sumTables_.middleRows(Eigen::Index(c) * nbState, nbState) =
+      tables[c] * (probas[c] * std::exp(double(exps[c] - maxExp) * ExtendedFloat::ln_radix));
+  }
+
+  auto rootWeights = likCal_.getRootWeights();
+  if (rootWeights)
+    weights_ = rootWeights->getTargetValue().cast<double>();
+  else
+    weights_ = Eigen::RowVectorXd::Ones(nbSites);
+
+  logScale_ = weights_.sum() * double(maxExp) * ExtendedFloat::ln_radix;
+}
+
+void SingleBranchLikelihood::compute(double brLen, double& logLikelihood, double& d1, double& d2) const
+{
+  const Eigen::ArrayXd e = (exponents_ * brLen).array().exp();
+  const Eigen::ArrayXd de = exponents_.array() * e;
+  const Eigen::ArrayXd d2e = exponents_.array() * de;
+
+  const Eigen::ArrayXd lik = (e.matrix().transpose() * sumTables_).transpose().array();
+  const Eigen::ArrayXd dlik = (de.matrix().transpose() * sumTables_).transpose().array() / lik;
+  const Eigen::ArrayXd d2lik = (d2e.matrix().transpose() * sumTables_).transpose().array() / lik;
+
+  const auto w = weights_.transpose().array();
+  logLikelihood = (w * lik.log()).sum() + logScale_;
+  d1 = (w * dlik).sum();
+  d2 = (w * (d2lik - dlik.square())).sum();
+}
+
+double SingleBranchLikelihood::getLogLikelihood(double brLen) const
+{
+  double l, d1, d2;
+  compute(brLen, l, d1, d2);
+  return l;
+}
+
+double SingleBranchLikelihood::getFirstOrderDerivative(double brLen) const
+{
+  double l, d1, d2;
+  compute(brLen, l, d1, d2);
+  return d1;
+}
+
+double SingleBranchLikelihood::getSecondOrderDerivative(double brLen) const
+{
+  double l, d1, d2;
+  compute(brLen, l, d1, d2);
+  return d2;
+}
+
+unsigned int SingleBranchLikelihood::optimize(double tolerance, unsigned int maxIterations)
+{
+  // Bounds accepted by the parameter.
+  double minLength = 0.;
+  double maxLength = std::numeric_limits<double>::infinity();
+  if (brLen_->hasConstraint())
+  {
+    minLength = std::max(minLength, brLen_->getConstraint()->getAcceptedLimit(-std::numeric_limits<double>::infinity()));
+    maxLength = brLen_->getConstraint()->getAcceptedLimit(std::numeric_limits<double>::infinity());
+  }
+
+  double t = std::min(std::max(brLen_->getValue(), minLength), maxLength);
+
+  unsigned int nbSteps = 0;
+  while (nbSteps < maxIterations)
+  {
+    double l, d1, d2;
+    compute(t, l, d1, d2);
+
+    // Newton step where the function is concave, else move towards
+    // the increasing side.
+    double step;
+    if (d2 < 0)
+      step = -d1 / d2;
+    else
+      step = (d1 > 0) ? std::max(t, tolerance) : -t / 2;
+
+    double newT = std::min(std::max(t + step, minLength), maxLength);
+    double newL = getLogLikelihood(newT);
+
+    // Halve the step while it does not improve.
+    while (!(newL >= l) && std::abs(newT - t) > tolerance)
+    {
+      newT = (t + newT) / 2;
+      newL = getLogLikelihood(newT);
+    }
+
+    if (!(newL >= l))
+      break;
+
+    const double delta = std::abs(newT - t);
+    t = newT;
+    nbSteps++;
+    if (delta <= tolerance)
+      break;
+  }
+
+  if (t != brLen_->getValue())
+    brLen_->setValue(t);
+
+  return nbSteps;
+}
+
+unsigned int SingleBranchLikelihood::optimizeAllBranches(LikelihoodCalculationSingleProcess& likCal,
+                                                         double tolerance, unsigned int nbPasses)
+{
+  likCal.getLikelihoodNode();
+  auto tree = likCal.getTreeNode(0);
+
+  unsigned int nbSteps = 0;
+  for (unsigned int pass = 0; pass < nbPasses; pass++)
+  {
+    for (const auto& edge : tree->getAllEdges())
+    {
+      const auto edgeId = tree->getEdgeIndex(edge);
+      if (!likCal.getBranchLengthParameter(edgeId) || !getDiagonalizableModel_(*edge))
+        continue;
+
+      SingleBranchLikelihood sbl(likCal, edgeId);
+      nbSteps += sbl.optimize(tolerance);
+    }
+  }
+
+  return nbSteps;
+}
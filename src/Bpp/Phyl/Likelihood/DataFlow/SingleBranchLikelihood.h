@@ -0,0 +1,156 @@
+//
+// File: SingleBranchLikelihood.h
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef BPP_PHYL_LIKELIHOOD_DATAFLOW_SINGLEBRANCHLIKELIHOOD_H
+#define BPP_PHYL_LIKELIHOOD_DATAFLOW_SINGLEBRANCHLIKELIHOOD_H
+
+#include <Bpp/Phyl/Likelihood/DataFlow/LikelihoodCalculationSingleProcess.h>
+
+namespace bpp
+{
+/**
+ * @brief Log-likelihood as a function of the length of a single
+ * branch, all other parameters fixed.
+ *
+ * With P(t) = U diag(exp(r.l.t)) U^-1 the transition matrix of the
+ * edge (real eigen decomposition of the model, with rate r), the
+ * likelihood of a site is, summed on the rate categories c (rate r_c,
+ * probability p_c):
+ *
+ * L(t) = sum_c p_c sum_k exp(r_c.r.l_k.t) S_c(k),
+ * S_c(k) = (U' backward_c)(k) * (U^-1 forward_c)(k),
+ *
+ * with backward_c the backward likelihood at the top of the edge and
+ * forward_c the forward likelihood at its bottom ("sum table"). These
+ * are computed once by update(), from the current values of the
+ * LikelihoodCalculationSingleProcess. Then the log-likelihood and its
+ * derivatives for any length cost O(nbClasses x nbStates x nbSites),
+ * without any computation in the DataFlow graph, which makes Newton
+ * steps on the branch length cheap.
+ *
+ * Only edges with a diagonalizable model (real eigen values) are
+ * supported.
+ */
+
+class SingleBranchLikelihood
+{
+private:
+  LikelihoodCalculationSingleProcess& likCal_;
+  uint edgeId_;
+  std::shared_ptr<ConfiguredParameter> brLen_;
+
+  /// r_c.r.l_k for all categories c and eigen values k.
+  Eigen::VectorXd exponents_;
+
+  /// Sum tables S_c, scaled by p_c (rows: category c then k).
+  Eigen::MatrixXd sumTables_;
+
+  /// Weights of the sites.
+  Eigen::RowVectorXd weights_;
+
+  /// log of the scale of the sum tables, times the sum of the weights.
+  double logScale_;
+
+public:
+  /**
+   * @brief Build and update the sum table of an edge.
+   *
+   * @param likCal the likelihood calculation
+   * @param edgeId index of the edge in the process tree
+   */
+  SingleBranchLikelihood(LikelihoodCalculationSingleProcess& likCal, uint edgeId);
+
+  /**
+   * @brief Compute the sum table from the current values of the
+   * likelihood calculation (ie after a change of other parameters).
+   */
+  void update();
+
+  uint getEdgeId() const { return edgeId_; }
+
+  std::shared_ptr<ConfiguredParameter> getBranchLengthParameter() const { return brLen_; }
+
+  /**
+   * @brief Log-likelihood and its first and second order derivatives
+   * with respect to the branch length, for a given branch length.
+   */
+  void compute(double brLen, double& logLikelihood, double& d1, double& d2) const;
+
+  double getLogLikelihood(double brLen) const;
+
+  double getFirstOrderDerivative(double brLen) const;
+
+  double getSecondOrderDerivative(double brLen) const;
+
+  /**
+   * @brief Newton optimization of the branch length, from its current
+   * value, which is then set to the result.
+   *
+   * The branch length stays within the constraint of its parameter
+   * (non negative if it has none).
+   *
+   * @param tolerance stop when a step is smaller than this
+   * @param maxIterations maximum number of Newton steps
+   * @return the number of Newton steps
+   */
+  unsigned int optimize(double tolerance = 0.000001, unsigned int maxIterations = 20);
+
+  /**
+   * @brief Optimize all the branch lengths one after the other, with
+   * the sum table of each edge updated before its optimization.
+   *
+   * Edges without length or with a model that is not
+   * diagonalizable are skipped.
+   *
+   * Each edge has its own transition matrix, so a new length only
+   * invalidates the forward likelihoods on the path to the root, and
+   * the backward likelihoods are recomputed along the path to the
+   * next edge, when its sum table is updated.
+   *
+   * @param likCal the likelihood calculation
+   * @param tolerance tolerance on each branch length
+   * @param nbPasses number of passes on all the edges
+   * @return the number of Newton steps
+   */
+  static unsigned int optimizeAllBranches(LikelihoodCalculationSingleProcess& likCal,
+                                          double tolerance = 0.000001, unsigned int nbPasses = 3);
+};
+} // namespace bpp
+#endif // BPP_PHYL_LIKELIHOOD_DATAFLOW_SINGLEBRANCHLIKELIHOOD_H
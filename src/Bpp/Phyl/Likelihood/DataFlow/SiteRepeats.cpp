@@ -0,0 +1,235 @@
+//
+// File: SiteRepeats.cpp
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Phyl/Likelihood/DataFlow/SiteRepeats.h>
+
+using namespace std;
+
+namespace bpp
+{
+SiteRepeatClasses::SiteRepeatClasses (const NodeRefVec& deps, size_t nbCategories, Eigen::Index nbSites)
+  : siteClasses_ (), representatives_ (), sonNbClasses_ (), sonClasses_ (), sonRepresentatives_ ()
+{
+  const auto nbSons = deps.size () / (nbCategories + 1);
+
+  // Classes of the sites for each son
+  vector<Eigen::RowVectorXi> sonSiteClasses (nbSons);
+  sonNbClasses_.resize (nbSons);
+  sonRepresentatives_.resize (nbSons);
+  for (size_t son = 0; son < nbSons; ++son)
+  {
+    const auto& x = deps[son * (nbCategories + 1) + nbCategories];
+    const auto* repeats = dynamic_cast<const SiteRepeatClasses*>(x.get ());
+    if (dynamic_cast<const Value<TipLikelihood>*>(x.get ()))
+    {
+      const auto& tip = accessValueConstCast<TipLikelihood>(*x);
+      sonSiteClasses[son] = tip.siteCodes;
+      sonNbClasses_[son] = tip.codeLikelihoods.cols ();
+    }
+    else if (repeats)
+    {
+      sonSiteClasses[son] = repeats->siteClasses_;
+      sonNbClasses_[son] = repeats->getNumberOfClasses ();
+      if (repeats->getNumberOfClasses () < nbSites)
+        sonRepresentatives_[son] = repeats->representatives_;
+    }
+    else
+    {
+      sonSiteClasses[son] = Eigen::RowVectorXi::LinSpaced (nbSites, 0, int(nbSites - 1));
+      sonNbClasses_[son] = nbSites;
+    }
+
+    if (sonSiteClasses[son].cols () != nbSites)
+      throw Exception ("SiteRepeatClasses: son " + std::to_string (son) + " has " + std::to_string (sonSiteClasses[son].cols ()) +
+                       " sites instead of " + std::to_string (nbSites) + ".");
+  }
+
+  // Classes of this node: distinct tuples of classes of the sons,
+  // built by pairs.
+  siteClasses_ = Eigen::RowVectorXi::Zero (nbSites);
+  for (size_t son = 0; son < nbSons; ++son)
+  {
+    unordered_map<int64_t, int> classes;
+    for (Eigen::Index site = 0; site < nbSites; ++site)
+    {
+      const auto key = int64_t (siteClasses_ (site)) * int64_t (sonNbClasses_[son]) + sonSiteClasses[son] (site);
+      siteClasses_ (site) = classes.emplace (key, int(classes.size ())).first->second;
+    }
+  }
+
+  const auto nbClasses = siteClasses_.size () == 0 ? 0 : siteClasses_.maxCoeff () + 1;
+  representatives_ = Eigen::RowVectorXi::Constant (nbClasses, -1);
+  for (Eigen::Index site = 0; site < nbSites; ++site)
+  {
+    if (representatives_ (siteClasses_ (site)) < 0)
+      representatives_ (siteClasses_ (site)) = int(site);
+  }
+
+  sonClasses_.resize (nbSons);
+  for (size_t son = 0; son < nbSons; ++son)
+  {
+    sonClasses_[son].resize (nbClasses);
+    for (Eigen::Index cl = 0; cl < nbClasses; ++cl)
+    {
+      sonClasses_[son] (cl) = sonSiteClasses[son] (representatives_ (cl));
+    }
+  }
+}
+
+SpeciationSiteRepeats::SpeciationSiteRepeats (NodeRefVec&& deps, const Dimension<MatrixLik>& dim, size_t nbCategories)
+  : Value<MatrixLik>(std::move (deps)),
+  SiteRepeatClasses (this->dependencies (), nbCategories, dim.cols / Eigen::Index (nbCategories)),
+  targetDimension_ (dim), nbCategories_ (nbCategories)
+{}
+
+NodeRef SpeciationSiteRepeats::derive (Context& c, const Node_DF& node)
+{
+  if (&node == this)
+  {
+    return ConstantOne<MatrixLik>::create (c, targetDimension_);
+  }
+
+  NodeRefVec factors;
+  for (size_t son = 0; son < getNumberOfSons (); ++son)
+  {
+    const auto first = son * (nbCategories_ + 1);
+    const auto& x = this->dependency (first + nbCategories_);
+    const bool isTip = dynamic_cast<const Value<TipLikelihood>*>(x.get ()) != nullptr;
+    if (nbCategories_ == 1)
+    {
+      if (isTip)
+        factors.push_back (TipTransition::create (c, {this->dependency (first), x}, targetDimension_));
+      else
+        factors.push_back (MatrixProduct<MatrixLik, Eigen::MatrixXd, MatrixLik>::create (c, {this->dependency (first), x}, targetDimension_));
+    }
+    else
+    {
+      NodeRefVec deps (this->dependencies ().begin () + Eigen::Index (first),
+                       this->dependencies ().begin () + Eigen::Index (first + nbCategories_ + 1));
+      if (isTip)
+        factors.push_back (RateCategoriesTipTransition::create (c, std::move (deps), targetDimension_));
+      else
+        factors.push_back (RateCategoriesTransition::create (c, std::move (deps), targetDimension_));
+    }
+  }
+
+  auto product = CWiseMul<MatrixLik, ReductionOf<MatrixLik> >::create (c, std::move (factors), targetDimension_);
+  return product->derive (c, node);
+}
+
+void SpeciationSiteRepeats::compute ()
+{
+  auto& result = this->accessValueMutable ();
+  const auto nbCat = Eigen::Index (nbCategories_);
+  const auto nbSites = getNumberOfSites ();
+  const auto nbClasses = getNumberOfClasses ();
+  const auto nbState = accessValueConstCast<Eigen::MatrixXd>(*this->dependency (0)).rows ();
+  auto* scheduler = this->getScheduler_ ();
+
+  // Likelihoods of the classes, category after category, normalized
+  // after each son so that the products do not underflow.
+  auto classLikelihoods = MatrixLik::Ones (nbState, nbCat * nbClasses);
+  auto& classFloat = classLikelihoods.float_part ();
+  int exponent = 0;
+
+  for (size_t son = 0; son < getNumberOfSons (); ++son)
+  {
+    const auto first = son * (nbCategories_ + 1);
+    const auto& x = *this->dependency (first + nbCategories_);
+    const auto nbSonClasses = sonNbClasses_[son];
+    const auto& sonRepresentatives = sonRepresentatives_[son];
+    const auto& sonClasses = sonClasses_[son];
+
+    // Transitions of the classes of the son
+    Eigen::MatrixXd sonForward (nbState, nbCat * nbSonClasses);
+    const auto* tip = dynamic_cast<const Value<TipLikelihood>*>(&x) ? &accessValueConstCast<TipLikelihood>(x) : nullptr;
+    const auto* below = tip ? nullptr : &accessValueConstCast<MatrixLik>(x);
+    if (below)
+      exponent += below->exponent_part ();
+
+    for (Eigen::Index cat = 0; cat < nbCat; ++cat)
+    {
+      const auto& transition = accessValueConstCast<Eigen::MatrixXd>(*this->dependency (first + size_t (cat)));
+      computeBySiteBlocks (scheduler, nbState, nbSonClasses,
+                           [&](Eigen::Index firstCol, Eigen::Index nbCols) {
+          auto forward = sonForward.middleCols (cat * nbSonClasses + firstCol, nbCols);
+          if (tip)
+            forward.noalias () = transition * tip->codeLikelihoods.middleCols (firstCol, nbCols);
+          else if (sonRepresentatives.size () == 0)
+            forward.noalias () = transition * below->float_part ().middleCols (cat * nbSites + firstCol, nbCols);
+          else
+          {
+            Eigen::MatrixXd gathered (nbState, nbCols);
+            for (Eigen::Index cl = 0; cl < nbCols; ++cl)
+            {
+              gathered.col (cl) = below->float_part ().col (cat * nbSites + sonRepresentatives (firstCol + cl));
+            }
+            forward.noalias () = transition * gathered;
+          }
+        });
+    }
+
+    // Product on the classes of this node
+    computeBySiteBlocks (scheduler, nbState, nbCat * nbClasses,
+                         [&](Eigen::Index firstCol, Eigen::Index nbCols) {
+        for (Eigen::Index col = firstCol; col < firstCol + nbCols; ++col)
+        {
+          const auto cat = col / nbClasses;
+          classFloat.col (col).array () *= sonForward.col (cat * nbSonClasses + sonClasses (col % nbClasses)).array ();
+        }
+      });
+    classLikelihoods.normalize ();
+  }
+
+  // Expansion to the sites
+  auto& r = result.float_part ();
+  r.resize (nbState, nbCat * nbSites);
+  const auto& siteClasses = siteClasses_;
+  computeBySiteBlocks (scheduler, r.rows (), r.cols (),
+                       [&r, &classFloat, &siteClasses, nbSites, nbClasses](Eigen::Index firstCol, Eigen::Index nbCols) {
+      for (Eigen::Index col = firstCol; col < firstCol + nbCols; ++col)
+      {
+        r.col (col) = classFloat.col ((col / nbSites) * nbClasses + siteClasses (col % nbSites));
+      }
+    });
+  result.exponent_part () = exponent + classLikelihoods.exponent_part ();
+  result.normalize ();
+}
+} // namespace bpp
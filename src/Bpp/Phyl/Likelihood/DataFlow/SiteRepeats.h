@@ -0,0 +1,210 @@
+//
+// File: SiteRepeats.h
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef BPP_PHYL_LIKELIHOOD_DATAFLOW_SITEREPEATS_H
+#define BPP_PHYL_LIKELIHOOD_DATAFLOW_SITEREPEATS_H
+
+#include <Bpp/Exceptions.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/DataFlowCWiseComputing.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/DataFlowNumeric.h>
+#include <cstdint>
+#include <unordered_map>
+
+#include "Definitions.h"
+#include "RateCategoriesForward.h"
+#include "Sequence_DF.h"
+
+namespace bpp
+{
+/** @brief Site repeat classes of a speciation node, built from the
+ * dependencies of a SpeciationSiteRepeats or a SiteScaledSpeciation:
+ * for each son, the transition matrices of the categories, then x,
+ * either a TipLikelihood, a node with SiteRepeatClasses, or a node
+ * with one class per site.
+ *
+ * Two sites with the same states on all the leaves below a node (a
+ * site repeat of the node) have the same conditional likelihood at
+ * this node. The repeat classes of the sites are the codes for a
+ * leaf, and are built from those of the sons (pairs of classes),
+ * upward from the leaves.
+ *
+ * The classes only depend on the (constant) leaves, so they are
+ * built at construction.
+ */
+
+class SiteRepeatClasses
+{
+public:
+  SiteRepeatClasses (const NodeRefVec& deps, std::size_t nbCategories, Eigen::Index nbSites);
+
+  /// Number of sites of a category.
+  Eigen::Index getNumberOfSites () const
+  {
+    return siteClasses_.cols ();
+  }
+
+  /// Number of site repeat classes.
+  Eigen::Index getNumberOfClasses () const
+  {
+    return representatives_.cols ();
+  }
+
+  /// Repeat class of each site.
+  const Eigen::RowVectorXi& getSiteClasses () const
+  {
+    return siteClasses_;
+  }
+
+  /// First site of each repeat class.
+  const Eigen::RowVectorXi& getRepresentatives () const
+  {
+    return representatives_;
+  }
+
+protected:
+  Eigen::RowVectorXi siteClasses_;
+  Eigen::RowVectorXi representatives_;
+
+  // For each son: its number of classes, the class of each
+  // representative, and its representative sites if it is not a leaf
+  // (empty if one class per site).
+  std::vector<Eigen::Index> sonNbClasses_;
+  std::vector<Eigen::RowVectorXi> sonClasses_;
+  std::vector<Eigen::RowVectorXi> sonRepresentatives_;
+};
+
+/** @brief Conditional likelihood of a speciation node, computed on
+ * the site repeats of its subtree.
+ * - r: MatrixLik (state, category * nbSites + site).
+ * - for each son i: transitionMatrix_{i,c} for each category c (Matrix
+ *   (fromState, toState)), then x_i, either a TipLikelihood or a
+ *   MatrixLik (state, category * nbSites + site).
+ *
+ * r(., category c) = prod_i transitionMatrix_{i,c} * x_i(., category c), cwise.
+ *
+ * With one category this is a SpeciationForward of ForwardTransitions
+ * (or TipTransitions), otherwise of RateCategoriesTransitions (see
+ * RateCategoriesForward.h).
+ *
+ * The transitions are done once per repeat class of each son (see
+ * SiteRepeatClasses), and the products once per repeat class of the
+ * node, before being gathered for each site. A son that is neither a
+ * leaf nor a SpeciationSiteRepeats has one class per site.
+ */
+
+class SpeciationSiteRepeats : public Value<MatrixLik>, public SiteRepeatClasses
+{
+public:
+  using Self = SpeciationSiteRepeats;
+
+  static ValueRef<MatrixLik> create (Context& c, NodeRefVec&& deps, const Dimension<MatrixLik>& dim,
+                                     std::size_t nbCategories = 1)
+  {
+    checkDependenciesNotNull (typeid (Self), deps);
+    if (nbCategories == 0 || deps.empty () || deps.size () % (nbCategories + 1) != 0)
+      throw Exception ("SpeciationSiteRepeats: " + std::to_string (deps.size ()) + " dependencies for " +
+                       std::to_string (nbCategories) + " categories.");
+    for (std::size_t son = 0; son < deps.size (); son += nbCategories + 1)
+    {
+      checkDependencyRangeIsValue<Eigen::MatrixXd>(typeid (Self), deps, son, son + nbCategories);
+      const auto& x = deps[son + nbCategories];
+      if (!dynamic_cast<const Value<TipLikelihood>*>(x.get ()))
+        checkNthDependencyIsValue<MatrixLik>(typeid (Self), deps, son + nbCategories);
+    }
+    return cachedAs<Value<MatrixLik> >(c, std::make_shared<Self>(std::move (deps), dim, nbCategories));
+  }
+
+  SpeciationSiteRepeats (NodeRefVec&& deps, const Dimension<MatrixLik>& dim, std::size_t nbCategories);
+
+  std::size_t getNumberOfCategories () const
+  {
+    return nbCategories_;
+  }
+
+  std::size_t getNumberOfSons () const
+  {
+    return this->nbDependencies () / (nbCategories_ + 1);
+  }
+
+  std::string debugInfo () const override
+  {
+    using namespace numeric;
+    return debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_) +
+           " classes=" + std::to_string (getNumberOfClasses ()) + "/" + std::to_string (getNumberOfSites ());
+  }
+
+  std::string color() const override
+  {
+    return "#9e9e9e";
+  }
+
+  std::string description() const override
+  {
+    return "Speciation Site Repeats";
+  }
+
+  // SpeciationSiteRepeats additional arguments = (nbCategories_).
+  bool compareAdditionalArguments (const Node_DF& other) const final
+  {
+    const auto* derived = dynamic_cast<const Self*>(&other);
+    return derived != nullptr && nbCategories_ == derived->nbCategories_;
+  }
+
+  std::size_t hashAdditionalArguments () const final
+  {
+    return nbCategories_;
+  }
+
+  // Derived through the equivalent expression without repeats.
+  NodeRef derive (Context& c, const Node_DF& node) final;
+
+  NodeRef recreate (Context& c, NodeRefVec&& deps) final
+  {
+    return Self::create (c, std::move (deps), targetDimension_, nbCategories_);
+  }
+
+private:
+  void compute () final;
+
+  Dimension<MatrixLik> targetDimension_;
+  std::size_t nbCategories_;
+};
+} // namespace bpp
+#endif // BPP_PHYL_LIKELIHOOD_DATAFLOW_SITEREPEATS_H
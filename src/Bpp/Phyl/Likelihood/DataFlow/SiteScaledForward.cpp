@@ -0,0 +1,489 @@
+//
+// File: SiteScaledForward.cpp
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Phyl/Likelihood/DataFlow/SiteScaledForward.h>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace bpp
+{
+namespace
+{
+using Storage = SiteScaledStorage;
+using StorageMatrix = Eigen::Matrix<Storage, Eigen::Dynamic, Eigen::Dynamic>;
+
+/*
+ * Transitions of the classes of a son, category after category:
+ * forward(., c * nbSonClasses + class) = transitions[c] * x(., c * nbSites + representative (class)),
+ * each column normalized. x is a TipLikelihood or a SiteScaledMatrixLik.
+ */
+void sonTransitions (DataFlowScheduler* scheduler, const std::vector<const Eigen::MatrixXd*>& transitions,
+                     const Node_DF& x, Eigen::Index nbSites, Eigen::Index nbSonClasses,
+                     const Eigen::RowVectorXi& sonRepresentatives, SiteScaledMatrixLik& forward)
+{
+  const auto nbState = transitions.front ()->rows ();
+  forward.resize (nbState, Eigen::Index (transitions.size ()) * nbSonClasses);
+  auto& sonFloat = forward.float_part ();
+  auto& sonExponent = forward.exponent_part ();
+  const auto* tip = dynamic_cast<const Value<TipLikelihood>*>(&x) ? &accessValueConstCast<TipLikelihood>(x) : nullptr;
+  const auto* below = tip ? nullptr : &accessValueConstCast<SiteScaledMatrixLik>(x);
+
+  for (Eigen::Index cat = 0; cat < Eigen::Index (transitions.size ()); ++cat)
+  {
+    const auto& transition = *transitions[size_t (cat)];
+    const StorageMatrix storageTransition = transition.cast<Storage>();
+    computeBySiteBlocks (scheduler, nbState, nbSonClasses,
+                         [&](Eigen::Index firstCol, Eigen::Index nbCols) {
+        const auto firstSonCol = cat * nbSonClasses + firstCol;
+        auto block = sonFloat.middleCols (firstSonCol, nbCols);
+        if (tip)
+        {
+          block = (transition * tip->codeLikelihoods.middleCols (firstCol, nbCols)).cast<Storage>();
+          sonExponent.segment (firstSonCol, nbCols).setZero ();
+        }
+        else if (sonRepresentatives.size () == 0)
+        {
+          block.noalias () = storageTransition * below->float_part ().middleCols (cat * nbSites + firstCol, nbCols);
+          sonExponent.segment (firstSonCol, nbCols) = below->exponent_part ().segment (cat * nbSites + firstCol, nbCols);
+        }
+        else
+        {
+          StorageMatrix gathered (nbState, nbCols);
+          for (Eigen::Index cl = 0; cl < nbCols; ++cl)
+          {
+            const auto belowCol = cat * nbSites + sonRepresentatives (firstCol + cl);
+            gathered.col (cl) = below->float_part ().col (belowCol);
+            sonExponent (firstSonCol + cl) = below->exponent_part () (belowCol);
+          }
+          block.noalias () = storageTransition * gathered;
+        }
+        for (Eigen::Index col = firstSonCol; col < firstSonCol + nbCols; ++col)
+        {
+          sonExponent (col) = SiteScaledMatrixLik::normalize_column (sonFloat.col (col), sonExponent (col));
+        }
+      });
+  }
+}
+
+/*
+ * Expansion of the classes to the sites: r(., c * nbSites + site) = classes(., c * nbClasses + siteClasses (site)).
+ */
+void expandToSites (DataFlowScheduler* scheduler, const SiteScaledMatrixLik& classes,
+                    const Eigen::RowVectorXi& siteClasses, Eigen::Index nbCategories, SiteScaledMatrixLik& result)
+{
+  const auto nbSites = siteClasses.cols ();
+  const auto nbClasses = classes.cols () / nbCategories;
+  result.resize (classes.rows (), nbCategories * nbSites);
+  auto& r = result.float_part ();
+  auto& e = result.exponent_part ();
+  const auto& classFloat = classes.float_part ();
+  const auto& classExponent = classes.exponent_part ();
+  computeBySiteBlocks (scheduler, r.rows (), r.cols (),
+                       [&r, &e, &classFloat, &classExponent, &siteClasses, nbSites, nbClasses](Eigen::Index firstCol, Eigen::Index nbCols) {
+      for (Eigen::Index col = firstCol; col < firstCol + nbCols; ++col)
+      {
+        const auto cl = (col / nbSites) * nbClasses + siteClasses (col % nbSites);
+        r.col (col) = classFloat.col (cl);
+        e (col) = classExponent (cl);
+      }
+    });
+}
+
+/*
+ * Derivative of forward likelihoods x computed by SiteScaledSpeciation
+ * nodes, null if zero (for example for a leaf).
+ */
+NodeRef deriveSiteScaledForward (Context& c, const NodeRef& x, const Node_DF& node)
+{
+  if (dynamic_cast<const Value<TipLikelihood>*>(x.get ()) || x->hasNumericalProperty (NumericalProperty::Constant))
+    return nullptr;
+  auto* speciation = dynamic_cast<SiteScaledSpeciation*>(x.get ());
+  if (!speciation)
+    throw Exception ("SiteScaledLogLikelihood::derive: the site scaled forward likelihoods are not computed by a SiteScaledSpeciation.");
+
+  const auto nbCategories = speciation->getNumberOfCategories ();
+  NodeRefVec deps{x};
+  bool nonZero = false;
+  for (size_t son = 0; son < speciation->getNumberOfSons (); ++son)
+  {
+    const auto first = son * (nbCategories + 1);
+    NodeRefVec dTransitions (nbCategories);
+    bool transitionsNonZero = false;
+    for (size_t cat = 0; cat < nbCategories; ++cat)
+    {
+      dTransitions[cat] = speciation->dependency (first + cat)->derive (c, node);
+      transitionsNonZero = transitionsNonZero || !dTransitions[cat]->hasNumericalProperty (NumericalProperty::ConstantZero);
+    }
+    if (!transitionsNonZero)
+      std::fill (dTransitions.begin (), dTransitions.end (), nullptr);
+    auto dx = deriveSiteScaledForward (c, speciation->dependency (first + nbCategories), node);
+    nonZero = nonZero || transitionsNonZero || dx;
+    deps.insert (deps.end (), dTransitions.begin (), dTransitions.end ());
+    deps.push_back (std::move (dx));
+  }
+  return nonZero ? SiteScaledSpeciationDerivative::create (c, std::move (deps)) : nullptr;
+}
+} // namespace
+
+SiteScaledSpeciation::SiteScaledSpeciation (NodeRefVec&& deps, const Dimension<MatrixLik>& dim, size_t nbCategories)
+  : Value<SiteScaledMatrixLik>(std::move (deps)),
+  SiteRepeatClasses (this->dependencies (), nbCategories, dim.cols / Eigen::Index (nbCategories)),
+  targetDimension_ (dim), nbCategories_ (nbCategories)
+{}
+
+void SiteScaledSpeciation::compute ()
+{
+  const auto nbCat = Eigen::Index (nbCategories_);
+  const auto nbSites = getNumberOfSites ();
+  const auto nbClasses = getNumberOfClasses ();
+  const auto nbState = accessValueConstCast<Eigen::MatrixXd>(*this->dependency (0)).rows ();
+  auto* scheduler = this->getScheduler_ ();
+
+  // Likelihoods of the classes, category after category, each class
+  // with its exponent.
+  SiteScaledMatrixLik classLikelihoods;
+  classLikelihoods.resize (nbState, nbCat * nbClasses);
+  auto& classFloat = classLikelihoods.float_part ();
+  auto& classExponent = classLikelihoods.exponent_part ();
+  classFloat.setOnes ();
+  classExponent.setZero ();
+
+  std::vector<const Eigen::MatrixXd*> transitions (nbCategories_);
+  SiteScaledMatrixLik sonForward;
+  for (size_t son = 0; son < getNumberOfSons (); ++son)
+  {
+    const auto first = son * (nbCategories_ + 1);
+    const auto nbSonClasses = sonNbClasses_[son];
+    const auto& sonClasses = sonClasses_[son];
+
+    // Transitions of the classes of the son
+    for (size_t cat = 0; cat < nbCategories_; ++cat)
+    {
+      transitions[cat] = &accessValueConstCast<Eigen::MatrixXd>(*this->dependency (first + cat));
+    }
+    sonTransitions (scheduler, transitions, *this->dependency (first + nbCategories_), nbSites, nbSonClasses,
+                    sonRepresentatives_[son], sonForward);
+    const auto& sonFloat = sonForward.float_part ();
+    const auto& sonExponent = sonForward.exponent_part ();
+
+    // Product on the classes of this node
+    computeBySiteBlocks (scheduler, nbState, nbCat * nbClasses,
+                         [&](Eigen::Index firstCol, Eigen::Index nbCols) {
+        for (Eigen::Index col = firstCol; col < firstCol + nbCols; ++col)
+        {
+          const auto sonCol = (col / nbClasses) * nbSonClasses + sonClasses (col % nbClasses);
+          classFloat.col (col).array () *= sonFloat.col (sonCol).array ();
+          classExponent (col) = SiteScaledMatrixLik::normalize_column (classFloat.col (col), classExponent (col) + sonExponent (sonCol));
+        }
+      });
+  }
+
+  // Expansion to the sites
+  expandToSites (scheduler, classLikelihoods, siteClasses_, nbCat, this->accessValueMutable ());
+}
+
+SiteScaledSpeciationDerivative::SiteScaledSpeciationDerivative (NodeRefVec&& deps)
+  : Value<SiteScaledMatrixLik>(std::move (deps))
+{}
+
+void SiteScaledSpeciationDerivative::compute ()
+{
+  const auto& speciation = static_cast<const SiteScaledSpeciation&>(*this->dependency (0));
+  const auto nbCategories = speciation.getNumberOfCategories ();
+  const auto nbCat = Eigen::Index (nbCategories);
+  const auto nbSites = speciation.getNumberOfSites ();
+  const auto nbClasses = speciation.getNumberOfClasses ();
+  const auto nbState = accessValueConstCast<Eigen::MatrixXd>(*speciation.dependency (0)).rows ();
+  auto* scheduler = this->getScheduler_ ();
+
+  // Product of the sons and its derivative on the classes, each class
+  // with its exponent.
+  SiteScaledMatrixLik product;
+  product.resize (nbState, nbCat * nbClasses);
+  product.float_part ().setOnes ();
+  product.exponent_part ().setZero ();
+  SiteScaledMatrixLik derivative (nbState, nbCat * nbClasses);
+  auto& pFloat = product.float_part ();
+  auto& pExponent = product.exponent_part ();
+  auto& dFloat = derivative.float_part ();
+  auto& dExponent = derivative.exponent_part ();
+
+  std::vector<const Eigen::MatrixXd*> transitions (nbCategories);
+  SiteScaledMatrixLik sonForward, sonDerivative, dxTerm;
+  for (size_t son = 0; son < speciation.getNumberOfSons (); ++son)
+  {
+    const auto first = son * (nbCategories + 1);
+    const auto nbSonClasses = speciation.sonNbClasses_[son];
+    const auto& sonClasses = speciation.sonClasses_[son];
+    const auto& sonRepresentatives = speciation.sonRepresentatives_[son];
+    const auto& x = *speciation.dependency (first + nbCategories);
+    const auto& dx = this->dependency (1 + first + nbCategories);
+    const bool transitionsNonZero = this->dependency (1 + first) != nullptr;
+
+    // Transitions of the classes of the son, and their derivative
+    // d(T * x) = dT * x + T * dx.
+    for (size_t cat = 0; cat < nbCategories; ++cat)
+    {
+      transitions[cat] = &accessValueConstCast<Eigen::MatrixXd>(*speciation.dependency (first + cat));
+    }
+    sonTransitions (scheduler, transitions, x, nbSites, nbSonClasses, sonRepresentatives, sonForward);
+    if (dx)
+      sonTransitions (scheduler, transitions, *dx, nbSites, nbSonClasses, sonRepresentatives, dxTerm);
+    if (transitionsNonZero)
+    {
+      for (size_t cat = 0; cat < nbCategories; ++cat)
+      {
+        transitions[cat] = &accessValueConstCast<Eigen::MatrixXd>(*this->dependency (1 + first + cat));
+      }
+      sonTransitions (scheduler, transitions, x, nbSites, nbSonClasses, sonRepresentatives, sonDerivative);
+      if (dx)
+        SiteScaledMatrixLik::add (sonDerivative, dxTerm, sonDerivative);
+    }
+    else if (dx)
+      std::swap (sonDerivative, dxTerm);
+    const bool sonNonZero = transitionsNonZero || dx;
+
+    // d(P * y) = dP * y + P * dy on the classes of this node
+    const auto& yFloat = sonForward.float_part ();
+    const auto& yExponent = sonForward.exponent_part ();
+    const auto& dyFloat = sonDerivative.float_part ();
+    const auto& dyExponent = sonDerivative.exponent_part ();
+    computeBySiteBlocks (scheduler, nbState, nbCat * nbClasses,
+                         [&](Eigen::Index firstCol, Eigen::Index nbCols) {
+        for (Eigen::Index col = firstCol; col < firstCol + nbCols; ++col)
+        {
+          const auto sonCol = (col / nbClasses) * nbSonClasses + sonClasses (col % nbClasses);
+          auto d = dFloat.col (col);
+          auto e = dExponent (col) + yExponent (sonCol);
+          d.array () *= yFloat.col (sonCol).array ();
+          if (sonNonZero)
+          {
+            const auto pdyExponent = pExponent (col) + dyExponent (sonCol);
+            const auto maxExponent = std::max (e, pdyExponent);
+            d *= Storage (std::ldexp (1., e - maxExponent));
+            d.array () += pFloat.col (col).array () * dyFloat.col (sonCol).array () * Storage (std::ldexp (1., pdyExponent - maxExponent));
+            e = maxExponent;
+          }
+          dExponent (col) = SiteScaledMatrixLik::normalize_column (d, e);
+          pFloat.col (col).array () *= yFloat.col (sonCol).array ();
+          pExponent (col) = SiteScaledMatrixLik::normalize_column (pFloat.col (col), pExponent (col) + yExponent (sonCol));
+        }
+      });
+  }
+
+  // Expansion to the sites
+  expandToSites (scheduler, derivative, speciation.getSiteClasses (), nbCat, this->accessValueMutable ());
+}
+
+SiteScaledLogLikelihood::SiteScaledLogLikelihood (NodeRefVec&& deps, ValueRef<DataLik> equivalent, size_t nbCategories, double tolerance)
+  : Value<DataLik>(std::move (deps)), equivalent_ (std::move (equivalent)), nbCategories_ (nbCategories),
+  mixedPrecision_ ([this]() { return logLikelihood_ (); },
+                   [this]() { return convert (equivalent_->getTargetValue ()); })
+{
+  mixedPrecision_.setTolerance (tolerance);
+}
+
+void SiteScaledLogLikelihood::compute ()
+{
+  auto& result = this->accessValueMutable ();
+  if (std::is_same<SiteScaledStorage, float>::value)
+    result = mixedPrecision_.getValue ();
+  else
+    result = logLikelihood_ ();
+}
+
+NodeRef SiteScaledLogLikelihood::derive (Context& c, const Node_DF& node)
+{
+  if (&node == this)
+    return ConstantOne<DataLik>::create (c, Dimension<DataLik>());
+
+  bool nonZero = false;
+  auto nonZeroDerivative = [&c, &node, &nonZero](const NodeRef& dep) -> NodeRef {
+    auto d = dep->derive (c, node);
+    if (d->hasNumericalProperty (NumericalProperty::ConstantZero))
+      return nullptr;
+    nonZero = true;
+    return d;
+  };
+
+  // deps = (rootFreqs, x, p_c[, weights], drootFreqs, dx, dp_c)
+  NodeRefVec deps (this->dependencies ());
+  deps.push_back (nonZeroDerivative (this->dependency (0)));
+  auto dx = deriveSiteScaledForward (c, this->dependency (1), node);
+  nonZero = nonZero || dx;
+  deps.push_back (std::move (dx));
+  for (size_t cat = 0; cat < nbCategories_; ++cat)
+  {
+    deps.push_back (nonZeroDerivative (this->dependency (2 + cat)));
+  }
+  if (!nonZero)
+    return ConstantZero<DataLik>::create (c, Dimension<DataLik>());
+  return SiteScaledLogLikelihoodDerivative::create (c, std::move (deps), equivalent_, node.shared_from_this (), nbCategories_);
+}
+
+double SiteScaledLogLikelihood::logLikelihood_ () const
+{
+  const auto& rootFreqs = accessValueConstCast<Eigen::RowVectorXd>(*this->dependency (0));
+  const auto& x = accessValueConstCast<SiteScaledMatrixLik>(*this->dependency (1));
+  const auto nbCat = Eigen::Index (nbCategories_);
+  const auto nbSites = x.cols () / nbCat;
+
+  // Site likelihoods of the categories
+  SiteScaledRowLik categorySites;
+  SiteScaledRowLik::product (rootFreqs, x, categorySites);
+  const auto& categoryFloat = categorySites.float_part ();
+  const auto& categoryExponent = categorySites.exponent_part ();
+
+  // Mean on the categories, aligned on the largest exponent of each
+  // site, and summed in double precision.
+  ExtendedFloatColwiseRowVectorXd sites;
+  sites.resize (1, nbSites);
+  for (Eigen::Index site = 0; site < nbSites; ++site)
+  {
+    auto exponent = SiteScaledRowLik::null_column_exponent;
+    for (Eigen::Index cat = 0; cat < nbCat; ++cat)
+    {
+      exponent = std::max (exponent, categoryExponent (cat * nbSites + site));
+    }
+    double mean = 0.;
+    for (Eigen::Index cat = 0; cat < nbCat; ++cat)
+    {
+      const auto col = cat * nbSites + site;
+      const auto p = accessValueConstCast<double>(*this->dependency (2 + size_t (cat)));
+      mean += p * double(categoryFloat (col)) * std::ldexp (1., categoryExponent (col) - exponent);
+    }
+    sites.float_part () (site) = mean;
+    sites.exponent_part () (site) = exponent;
+  }
+  sites.normalize ();
+
+  if (this->nbDependencies () == nbCategories_ + 3)
+    return sites.sumOfLogarithms (accessValueConstCast<Eigen::RowVectorXi>(*this->dependency (nbCategories_ + 2)));
+  else
+    return sites.sumOfLogarithms ();
+}
+
+SiteScaledLogLikelihoodDerivative::SiteScaledLogLikelihoodDerivative (NodeRefVec&& deps, ValueRef<DataLik> equivalent,
+                                                                      std::shared_ptr<const Node_DF> variable, size_t nbCategories)
+  : Value<DataLik>(std::move (deps)), equivalent_ (std::move (equivalent)), variable_ (std::move (variable)),
+  nbCategories_ (nbCategories)
+{}
+
+void SiteScaledLogLikelihoodDerivative::compute ()
+{
+  const auto nbValueDeps = this->nbDependencies () - nbCategories_ - 2;
+  const auto& rootFreqs = accessValueConstCast<Eigen::RowVectorXd>(*this->dependency (0));
+  const auto& x = accessValueConstCast<SiteScaledMatrixLik>(*this->dependency (1));
+  const auto& dRootFreqs = this->dependency (nbValueDeps);
+  const auto& dx = this->dependency (nbValueDeps + 1);
+  const auto nbCat = Eigen::Index (nbCategories_);
+  const auto nbSites = x.cols () / nbCat;
+
+  // Site likelihoods of the categories, and the terms of their
+  // derivatives: drootFreqs * x and rootFreqs * dx.
+  SiteScaledRowLik categorySites, dRootFreqsTerm, dxTerm;
+  SiteScaledRowLik::product (rootFreqs, x, categorySites);
+  if (dRootFreqs)
+    SiteScaledRowLik::product (accessValueConstCast<Eigen::RowVectorXd>(*dRootFreqs), x, dRootFreqsTerm);
+  if (dx)
+    SiteScaledRowLik::product (rootFreqs, accessValueConstCast<SiteScaledMatrixLik>(*dx), dxTerm);
+
+  std::vector<double> p (nbCategories_), dp (nbCategories_);
+  for (size_t cat = 0; cat < nbCategories_; ++cat)
+  {
+    p[cat] = accessValueConstCast<double>(*this->dependency (2 + cat));
+    const auto& dpCat = this->dependency (nbValueDeps + 2 + cat);
+    dp[cat] = dpCat ? accessValueConstCast<double>(*dpCat) : 0.;
+  }
+  const Eigen::RowVectorXi* weights = nbValueDeps == nbCategories_ + 3 ?
+                                      &accessValueConstCast<Eigen::RowVectorXi>(*this->dependency (nbCategories_ + 2)) : nullptr;
+
+  // Per site, L and dL are each aligned on their own largest exponent,
+  // and dL / L is summed in double precision.
+  std::vector<std::pair<double, ExtendedFloat::ExtType> > terms;
+  double result = 0.;
+  for (Eigen::Index site = 0; site < nbSites; ++site)
+  {
+    auto lExponent = SiteScaledRowLik::null_column_exponent;
+    auto dExponent = SiteScaledRowLik::null_column_exponent;
+    terms.clear ();
+    for (Eigen::Index cat = 0; cat < nbCat; ++cat)
+    {
+      const auto col = cat * nbSites + site;
+      lExponent = std::max (lExponent, categorySites.exponent_part () (col));
+      const auto pCat = p[size_t (cat)];
+      const auto dpCat = dp[size_t (cat)];
+      if (dpCat != 0.)
+        terms.emplace_back (dpCat * double(categorySites.float_part () (col)), categorySites.exponent_part () (col));
+      if (dRootFreqs)
+        terms.emplace_back (pCat * double(dRootFreqsTerm.float_part () (col)), dRootFreqsTerm.exponent_part () (col));
+      if (dx)
+        terms.emplace_back (pCat * double(dxTerm.float_part () (col)), dxTerm.exponent_part () (col));
+    }
+    for (const auto& term : terms)
+    {
+      if (term.first != 0.)
+        dExponent = std::max (dExponent, term.second);
+    }
+    if (dExponent == SiteScaledRowLik::null_column_exponent)
+      continue;
+
+    double l = 0.;
+    for (Eigen::Index cat = 0; cat < nbCat; ++cat)
+    {
+      const auto col = cat * nbSites + site;
+      l += p[size_t (cat)] * double(categorySites.float_part () (col)) * std::ldexp (1., categorySites.exponent_part () (col) - lExponent);
+    }
+    double dl = 0.;
+    for (const auto& term : terms)
+    {
+      if (term.first != 0.)
+        dl += term.first * std::ldexp (1., term.second - dExponent);
+    }
+    const auto ratio = dl / l * std::ldexp (1., dExponent - lExponent);
+    result += weights ? double((*weights) (site)) * ratio : ratio;
+  }
+  this->accessValueMutable () = result;
+}
+} // namespace bpp
@@ -0,0 +1,459 @@
+//
+// File: SiteScaledForward.h
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef BPP_PHYL_LIKELIHOOD_DATAFLOW_SITESCALEDFORWARD_H
+#define BPP_PHYL_LIKELIHOOD_DATAFLOW_SITESCALEDFORWARD_H
+
+#include <Bpp/Exceptions.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/DataFlowNumeric.h>
+#include <type_traits>
+
+#include "Definitions.h"
+#include "MixedPrecisionLogLikelihood.h"
+#include "Sequence_DF.h"
+#include "SiteRepeats.h"
+
+namespace bpp
+{
+/*
+ * Forward likelihoods with one exponent per site (SiteScaledMatrixLik,
+ * see ExtendedFloatColwiseMatrix), stored in single precision if
+ * BPP_FLOAT32_LIKELIHOOD is defined.
+ *
+ * They give the same log-likelihood as the SpeciationSiteRepeats of
+ * the rate categories, but a site much less likely than the others is
+ * not lost in a common exponent. The first order derivatives of
+ * SiteScaledLogLikelihood are computed on the same forward likelihoods
+ * (see SiteScaledSpeciationDerivative), the second order ones on the
+ * equivalent MatrixLik graph.
+ */
+
+/** @brief Conditional likelihood of a speciation node, with one
+ * exponent per site, computed on the site repeats of its subtree.
+ * - r: SiteScaledMatrixLik (state, category * nbSites + site).
+ * - for each son i: transitionMatrix_{i,c} for each category c (Matrix
+ *   (fromState, toState)), then x_i, either a TipLikelihood or a
+ *   SiteScaledMatrixLik (state, category * nbSites + site).
+ *
+ * r(., category c) = prod_i transitionMatrix_{i,c} * x_i(., category c), cwise.
+ *
+ * Same dependencies and value as SpeciationSiteRepeats.
+ */
+
+class SiteScaledSpeciation : public Value<SiteScaledMatrixLik>, public SiteRepeatClasses
+{
+public:
+  using Self = SiteScaledSpeciation;
+
+  static ValueRef<SiteScaledMatrixLik> create (Context& c, NodeRefVec&& deps, const Dimension<MatrixLik>& dim,
+                                               std::size_t nbCategories = 1)
+  {
+    checkDependenciesNotNull (typeid (Self), deps);
+    if (nbCategories == 0 || deps.empty () || deps.size () % (nbCategories + 1) != 0)
+      throw Exception ("SiteScaledSpeciation: " + std::to_string (deps.size ()) + " dependencies for " +
+                       std::to_string (nbCategories) + " categories.");
+    for (std::size_t son = 0; son < deps.size (); son += nbCategories + 1)
+    {
+      checkDependencyRangeIsValue<Eigen::MatrixXd>(typeid (Self), deps, son, son + nbCategories);
+      const auto& x = deps[son + nbCategories];
+      if (!dynamic_cast<const Value<TipLikelihood>*>(x.get ()))
+        checkNthDependencyIsValue<SiteScaledMatrixLik>(typeid (Self), deps, son + nbCategories);
+    }
+    return cachedAs<Value<SiteScaledMatrixLik> >(c, std::make_shared<Self>(std::move (deps), dim, nbCategories));
+  }
+
+  SiteScaledSpeciation (NodeRefVec&& deps, const Dimension<MatrixLik>& dim, std::size_t nbCategories);
+
+  std::size_t getNumberOfCategories () const
+  {
+    return nbCategories_;
+  }
+
+  std::size_t getNumberOfSons () const
+  {
+    return this->nbDependencies () / (nbCategories_ + 1);
+  }
+
+  std::string debugInfo () const override
+  {
+    using namespace numeric;
+    return "targetDim=" + to_string (targetDimension_) +
+           " classes=" + std::to_string (getNumberOfClasses ()) + "/" + std::to_string (getNumberOfSites ());
+  }
+
+  std::string color() const override
+  {
+    return "#9e9e9e";
+  }
+
+  std::string description() const override
+  {
+    return "Site Scaled Speciation";
+  }
+
+  // SiteScaledSpeciation additional arguments = (nbCategories_).
+  bool compareAdditionalArguments (const Node_DF& other) const final
+  {
+    const auto* derived = dynamic_cast<const Self*>(&other);
+    return derived != nullptr && nbCategories_ == derived->nbCategories_;
+  }
+
+  std::size_t hashAdditionalArguments () const final
+  {
+    return nbCategories_;
+  }
+
+  NodeRef recreate (Context& c, NodeRefVec&& deps) final
+  {
+    return Self::create (c, std::move (deps), targetDimension_, nbCategories_);
+  }
+
+private:
+  void compute () final;
+
+  Dimension<MatrixLik> targetDimension_;
+  std::size_t nbCategories_;
+
+  friend class SiteScaledSpeciationDerivative;
+};
+
+/** @brief Derivative of a SiteScaledSpeciation, with one exponent per
+ * site.
+ * - r: SiteScaledMatrixLik (state, category * nbSites + site).
+ * - speciation: the SiteScaledSpeciation, which dependencies give the
+ *   transitionMatrix_{i,c} and x_i.
+ * - for each son i: dtransitionMatrix_{i,c} for each category c, then
+ *   dx_i (SiteScaledMatrixLik). The dtransitionMatrix_{i,c} are null if
+ *   they are all zero, dx_i is null if zero (for example for a leaf).
+ *
+ * r(., category c) = sum_i (dtransitionMatrix_{i,c} * x_i + transitionMatrix_{i,c} * dx_i)
+ *                    * prod_{j != i} transitionMatrix_{j,c} * x_j, cwise.
+ *
+ * Computed on the site repeats of the speciation. Not derived.
+ */
+
+class SiteScaledSpeciationDerivative : public Value<SiteScaledMatrixLik>
+{
+public:
+  using Self = SiteScaledSpeciationDerivative;
+
+  /// deps = (speciation, dtransitionMatrix_{0,0}, ..., dx_0, dtransitionMatrix_{1,0}, ...).
+  static ValueRef<SiteScaledMatrixLik> create (Context& c, NodeRefVec&& deps)
+  {
+    if (deps.empty () || !deps[0])
+      failureEmptyDependency (typeid (Self), 0);
+    checkNthDependencyIs<SiteScaledSpeciation>(typeid (Self), deps, 0);
+    const auto& speciation = static_cast<const SiteScaledSpeciation&>(*deps[0]);
+    checkDependencyVectorSize (typeid (Self), deps, speciation.nbDependencies () + 1);
+    const auto nbCategories = speciation.getNumberOfCategories ();
+    for (std::size_t son = 1; son < deps.size (); son += nbCategories + 1)
+    {
+      for (std::size_t i = son; i < son + nbCategories; ++i)
+      {
+        if (deps[i])
+          checkNthDependencyIsValue<Eigen::MatrixXd>(typeid (Self), deps, i);
+      }
+      if (deps[son + nbCategories])
+        checkNthDependencyIsValue<SiteScaledMatrixLik>(typeid (Self), deps, son + nbCategories);
+    }
+    return cachedAs<Value<SiteScaledMatrixLik> >(c, std::make_shared<Self>(std::move (deps)));
+  }
+
+  explicit SiteScaledSpeciationDerivative (NodeRefVec&& deps);
+
+  std::string debugInfo () const override
+  {
+    const auto& speciation = static_cast<const SiteScaledSpeciation&>(*this->dependency (0));
+    return "classes=" + std::to_string (speciation.getNumberOfClasses ()) + "/" + std::to_string (speciation.getNumberOfSites ());
+  }
+
+  std::string color() const override
+  {
+    return "#9e9e9e";
+  }
+
+  std::string description() const override
+  {
+    return "Site Scaled Speciation Derivative";
+  }
+
+  // SiteScaledSpeciationDerivative additional arguments = ().
+  bool compareAdditionalArguments (const Node_DF& other) const final
+  {
+    return dynamic_cast<const Self*>(&other) != nullptr;
+  }
+
+  NodeRef recreate (Context& c, NodeRefVec&& deps) final
+  {
+    return Self::create (c, std::move (deps));
+  }
+
+private:
+  void compute () final;
+};
+
+/** @brief Log-likelihood from the site scaled conditional likelihoods
+ * at the root.
+ * - r: DataLik.
+ * - rootFreqs: RowVector (state).
+ * - x: SiteScaledMatrixLik (state, category * nbSites + site).
+ * - p_c: double, probability of each category c.
+ * - weights (optional): RowVectorXi (site), numbers of occurrences of the sites.
+ *
+ * r = sum_site weights(site) * log (sum_c p_c * rootFreqs * x(., c * nbSites + site)).
+ *
+ * The equivalent node computes the same value on MatrixLik (for
+ * example the SumOfLogarithms of a RateCategoriesMean). With single
+ * precision storage, the value is checked by a
+ * MixedPrecisionLogLikelihood, which computes the equivalent node when
+ * the single precision error may exceed the tolerance.
+ *
+ * The derivative is a SiteScaledLogLikelihoodDerivative, built on the
+ * derivatives of the SiteScaledSpeciation nodes below x.
+ */
+
+class SiteScaledLogLikelihood : public Value<DataLik>
+{
+public:
+  using Self = SiteScaledLogLikelihood;
+
+  /// deps = (rootFreqs, x, p_0, ..., p_{k-1}[, weights]).
+  static ValueRef<DataLik> create (Context& c, NodeRefVec&& deps, ValueRef<DataLik> equivalent,
+                                   std::size_t nbCategories, double tolerance = defaultTolerance ())
+  {
+    checkDependenciesNotNull (typeid (Self), deps);
+    if (!equivalent || nbCategories == 0 || (deps.size () != nbCategories + 2 && deps.size () != nbCategories + 3))
+      throw Exception ("SiteScaledLogLikelihood: " + std::to_string (deps.size ()) + " dependencies for " +
+                       std::to_string (nbCategories) + " categories.");
+    checkNthDependencyIsValue<Eigen::RowVectorXd>(typeid (Self), deps, 0);
+    checkNthDependencyIsValue<SiteScaledMatrixLik>(typeid (Self), deps, 1);
+    checkDependencyRangeIsValue<double>(typeid (Self), deps, 2, nbCategories + 2);
+    if (deps.size () == nbCategories + 3)
+      checkNthDependencyIsValue<Eigen::RowVectorXi>(typeid (Self), deps, nbCategories + 2);
+    return cachedAs<Value<DataLik> >(c, std::make_shared<Self>(std::move (deps), std::move (equivalent), nbCategories, tolerance));
+  }
+
+  /** @brief Absolute accuracy required on single precision
+   * log-likelihoods: below the differences that matter between models,
+   * while single precision is used up to |logL| about 10^4 (see
+   * MixedPrecisionLogLikelihood::getErrorBound).
+   */
+  static double defaultTolerance ()
+  {
+    return 0.1;
+  }
+
+  SiteScaledLogLikelihood (NodeRefVec&& deps, ValueRef<DataLik> equivalent, std::size_t nbCategories, double tolerance);
+
+  const ValueRef<DataLik>& getEquivalent () const
+  {
+    return equivalent_;
+  }
+
+  const MixedPrecisionLogLikelihood& getMixedPrecision () const
+  {
+    return mixedPrecision_;
+  }
+
+  std::string debugInfo () const override
+  {
+    using namespace numeric;
+    return debug (this->accessValueConst ()) + " categories=" + std::to_string (nbCategories_);
+  }
+
+  std::string color() const override
+  {
+    return "#ffd0d0";
+  }
+
+  std::string description() const override
+  {
+    return "Site Scaled Log Likelihood";
+  }
+
+  // SiteScaledLogLikelihood additional arguments = (equivalent_, nbCategories_, tolerance).
+  bool compareAdditionalArguments (const Node_DF& other) const final
+  {
+    const auto* derived = dynamic_cast<const Self*>(&other);
+    return derived != nullptr && equivalent_ == derived->equivalent_ && nbCategories_ == derived->nbCategories_ &&
+           mixedPrecision_.getTolerance () == derived->mixedPrecision_.getTolerance ();
+  }
+
+  std::size_t hashAdditionalArguments () const final
+  {
+    std::size_t seed = 0;
+    combineHash (seed, equivalent_.get ());
+    combineHash (seed, nbCategories_);
+    combineHash (seed, mixedPrecision_.getTolerance ());
+    return seed;
+  }
+
+  NodeRef derive (Context& c, const Node_DF& node) final;
+
+  NodeRef recreate (Context& c, NodeRefVec&& deps) final
+  {
+    return Self::create (c, std::move (deps), equivalent_, nbCategories_, mixedPrecision_.getTolerance ());
+  }
+
+  /// With single precision storage, may compute the equivalent node
+  /// (see Node_DF::isThreadSafe).
+  bool isThreadSafe () const final
+  {
+    return !std::is_same<SiteScaledStorage, float>::value;
+  }
+
+private:
+  void compute () final;
+
+  double logLikelihood_ () const;
+
+  ValueRef<DataLik> equivalent_;
+  std::size_t nbCategories_;
+  MixedPrecisionLogLikelihood mixedPrecision_;
+};
+
+/** @brief Derivative of a SiteScaledLogLikelihood with respect to a
+ * variable.
+ * - r: DataLik.
+ * - rootFreqs, x, p_c, weights (optional): as SiteScaledLogLikelihood.
+ * - drootFreqs: RowVector (state), null if zero.
+ * - dx: SiteScaledMatrixLik (state, category * nbSites + site), null if zero.
+ * - dp_c: double, derivative of p_c, null if zero.
+ *
+ * r = sum_site weights(site) * dL(site) / L(site), with
+ * L(site) = sum_c p_c * rootFreqs * x(., c * nbSites + site) and dL its
+ * derivative, both with the exponent of the site.
+ *
+ * Derived as the derivative of the equivalent node of the
+ * SiteScaledLogLikelihood with respect to the same variable (second
+ * order derivatives are computed on MatrixLik).
+ */
+
+class SiteScaledLogLikelihoodDerivative : public Value<DataLik>
+{
+public:
+  using Self = SiteScaledLogLikelihoodDerivative;
+
+  /// deps = (rootFreqs, x, p_0, ..., p_{k-1}[, weights], drootFreqs, dx, dp_0, ..., dp_{k-1}).
+  static ValueRef<DataLik> create (Context& c, NodeRefVec&& deps, ValueRef<DataLik> equivalent,
+                                   std::shared_ptr<const Node_DF> variable, std::size_t nbCategories)
+  {
+    if (!equivalent || !variable || nbCategories == 0 ||
+        (deps.size () != 2 * nbCategories + 4 && deps.size () != 2 * nbCategories + 5))
+      throw Exception ("SiteScaledLogLikelihoodDerivative: " + std::to_string (deps.size ()) + " dependencies for " +
+                       std::to_string (nbCategories) + " categories.");
+    const auto nbValueDeps = deps.size () - nbCategories - 2;
+    for (std::size_t i = 0; i < nbValueDeps; ++i)
+    {
+      if (!deps[i])
+        failureEmptyDependency (typeid (Self), i);
+    }
+    checkNthDependencyIsValue<Eigen::RowVectorXd>(typeid (Self), deps, 0);
+    checkNthDependencyIsValue<SiteScaledMatrixLik>(typeid (Self), deps, 1);
+    checkDependencyRangeIsValue<double>(typeid (Self), deps, 2, nbCategories + 2);
+    if (nbValueDeps == nbCategories + 3)
+      checkNthDependencyIsValue<Eigen::RowVectorXi>(typeid (Self), deps, nbCategories + 2);
+    if (deps[nbValueDeps])
+      checkNthDependencyIsValue<Eigen::RowVectorXd>(typeid (Self), deps, nbValueDeps);
+    if (deps[nbValueDeps + 1])
+      checkNthDependencyIsValue<SiteScaledMatrixLik>(typeid (Self), deps, nbValueDeps + 1);
+    for (std::size_t i = nbValueDeps + 2; i < deps.size (); ++i)
+    {
+      if (deps[i])
+        checkNthDependencyIsValue<double>(typeid (Self), deps, i);
+    }
+    return cachedAs<Value<DataLik> >(c, std::make_shared<Self>(std::move (deps), std::move (equivalent), std::move (variable), nbCategories));
+  }
+
+  SiteScaledLogLikelihoodDerivative (NodeRefVec&& deps, ValueRef<DataLik> equivalent,
+                                     std::shared_ptr<const Node_DF> variable, std::size_t nbCategories);
+
+  std::string debugInfo () const override
+  {
+    using namespace numeric;
+    return debug (this->accessValueConst ()) + " categories=" + std::to_string (nbCategories_);
+  }
+
+  std::string color() const override
+  {
+    return "#ffd0d0";
+  }
+
+  std::string description() const override
+  {
+    return "Site Scaled Log Likelihood Derivative";
+  }
+
+  // SiteScaledLogLikelihoodDerivative additional arguments = (equivalent_, variable_, nbCategories_).
+  bool compareAdditionalArguments (const Node_DF& other) const final
+  {
+    const auto* derived = dynamic_cast<const Self*>(&other);
+    return derived != nullptr && equivalent_ == derived->equivalent_ && variable_ == derived->variable_ &&
+           nbCategories_ == derived->nbCategories_;
+  }
+
+  std::size_t hashAdditionalArguments () const final
+  {
+    std::size_t seed = 0;
+    combineHash (seed, equivalent_.get ());
+    combineHash (seed, variable_.get ());
+    combineHash (seed, nbCategories_);
+    return seed;
+  }
+
+  NodeRef derive (Context& c, const Node_DF& node) final
+  {
+    return equivalent_->derive (c, *variable_)->derive (c, node);
+  }
+
+  NodeRef recreate (Context& c, NodeRefVec&& deps) final
+  {
+    return Self::create (c, std::move (deps), equivalent_, variable_, nbCategories_);
+  }
+
+private:
+  void compute () final;
+
+  ValueRef<DataLik> equivalent_;
+  std::shared_ptr<const Node_DF> variable_;
+  std::size_t nbCategories_;
+};
+} // namespace bpp
+#endif // BPP_PHYL_LIKELIHOOD_DATAFLOW_SITESCALEDFORWARD_H
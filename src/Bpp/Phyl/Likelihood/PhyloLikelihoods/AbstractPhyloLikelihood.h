@@ -193,7 +193,7 @@ public:
     }
     else
     {
-      auto node = getLikelihoodNode()->deriveAsValue (context_, accessVariableNode (variable));
+      auto node = makeFirstOrderDerivativeNode_ (variable);
       firstOrderDerivativeNodes_.emplace (variable, node);
       return node;
     }
@@ -233,6 +233,16 @@ public:
   }
 
 protected:
+  /*
+   * @brief Build the node of the first order derivative, by default
+   * through the derivation of the likelihood node.
+   *
+   */
+  virtual ValueRef<DataLik> makeFirstOrderDerivativeNode_ (const std::string& variable) const
+  {
+    return getLikelihoodNode()->deriveAsValue (context_, accessVariableNode (variable));
+  }
+
   static Node_DF& accessVariableNode (const Parameter& param)
   {
     return *dynamic_cast<const ConfiguredParameter&>(param).dependency(0);
@@ -233,7 +233,8 @@ public:
     }
     else
     {
-      auto vector = getLikelihoodCalculationSingleProcess()->getSiteLikelihoods(true)->deriveAsValue (context_, accessVariableNode (variable));
+      // Adjoint computation, from the backward likelihoods
+      auto vector = getLikelihoodCalculationSingleProcess()->getAdjointSiteLikelihoodsDerivative (accessVariableNode (variable));
       firstOrderDerivativeVectors_.emplace (variable, vector);
       return vector;
     }
@@ -269,6 +270,18 @@ public:
     }
   }
 
+protected:
+  /*
+   * @brief The first order derivatives share the forward and backward
+   * likelihoods (see
+   * LikelihoodCalculationSingleProcess::getAdjointLikelihoodDerivative).
+   *
+   */
+  ValueRef<DataLik> makeFirstOrderDerivativeNode_ (const std::string& variable) const override
+  {
+    return getLikelihoodCalculationSingleProcess()->getAdjointLikelihoodDerivative (accessVariableNode (variable));
+  }
+
 public:
   /**
    * Utilities
@@ -305,7 +305,8 @@ public:
     }
     else
     {
-      auto vector = getLikelihoodCalculationSingleProcess()->getSiteLikelihoods(true)->deriveAsValue (context_, accessVariableNode (variable));
+      // Adjoint computation, from the backward likelihoods
+      auto vector = getLikelihoodCalculationSingleProcess()->getAdjointSiteLikelihoodsDerivative (accessVariableNode (variable));
       firstOrderDerivativeVectors_.emplace (variable, vector);
       return vector;
     }
@@ -341,6 +342,19 @@ public:
     }
   }
 
+protected:
+  /*
+   * @brief The first order derivatives share the forward and backward
+   * likelihoods (see
+   * LikelihoodCalculationSingleProcess::getAdjointLikelihoodDerivative).
+   *
+   */
+  ValueRef<DataLik> makeFirstOrderDerivativeNode_ (const std::string& variable) const override
+  {
+    return getLikelihoodCalculationSingleProcess()->getAdjointLikelihoodDerivative (accessVariableNode (variable));
+  }
+
+public:
   /**
    * @brief Get the posterior probabilities of each class, for
    * each site.
@@ -43,6 +43,7 @@
 #include <Bpp/Numeric/NumConstants.h>
 #include <Bpp/Numeric/VectorTools.h>
 #include <Bpp/Text/TextTools.h>
+#include <Eigen/Eigenvalues>
 
 #include "AbstractSubstitutionModel.h"
 
@@ -170,6 +171,7 @@ void AbstractSubstitutionModel::updateMatrices()
     // ie null diagonal elements
 
     size_t nbStop = 0;
+    bool isSymmetrized = false;
     size_t salph = getNumberOfStates();
     vector<bool> vnull(salph); // vector of the indices of lines with
                                // only zeros
@@ -262,6 +264,11 @@ void AbstractSubstitutionModel::updateMatrices()
         }
       }
     }
+    else if (diagonalizeReversibleGenerator_())
+    {
+      // leftEigenVectors_ is already the inverse of rightEigenVectors_
+      isSymmetrized = true;
+    }
     else
     {
       EigenValue<double> ev(generator_);
@@ -274,7 +281,8 @@ void AbstractSubstitutionModel::updateMatrices()
     /// Now check inversion and diagonalization
     try
     {
-      MatrixTools::inv(rightEigenVectors_, leftEigenVectors_);
+      if (!isSymmetrized)
+        MatrixTools::inv(rightEigenVectors_, leftEigenVectors_);
 
       // is it diagonalizable ?
       isDiagonalizable_ = true;
@@ -416,6 +424,68 @@ void AbstractSubstitutionModel::updateMatrices()
 }
 
 
+/******************************************************************************/
+
+bool AbstractSubstitutionModel::diagonalizeReversibleGenerator_()
+{
+  if (computeFrequencies() || !dynamic_cast<ReversibleSubstitutionModel*>(this))
+    return false;
+
+  size_t salph = getNumberOfStates();
+  if (freq_.size() != salph)
+    return false;
+
+  Eigen::VectorXd sqrtFreq(Eigen::Index(salph));
+  for (size_t i = 0; i < salph; i++)
+  {
+    if (!(freq_[i] > 0))
+      return false;
+    sqrtFreq(Eigen::Index(i)) = sqrt(freq_[i]);
+  }
+
+  // Symmetric form, after check of the detailed balance
+  Eigen::MatrixXd symGenerator(Eigen::Index(salph), Eigen::Index(salph));
+  for (size_t i = 0; i < salph; i++)
+  {
+    const auto ei = Eigen::Index(i);
+    symGenerator(ei, ei) = generator_(i, i);
+    for (size_t j = i + 1; j < salph; j++)
+    {
+      const auto ej = Eigen::Index(j);
+      double fluxij = freq_[i] * generator_(i, j);
+      double fluxji = freq_[j] * generator_(j, i);
+      if (abs(fluxij - fluxji) > NumConstants::TINY() * max(abs(fluxij), abs(fluxji)))
+        return false;
+      double sij = 0.5 * (sqrtFreq(ei) / sqrtFreq(ej) * generator_(i, j) + sqrtFreq(ej) / sqrtFreq(ei) * generator_(j, i));
+      symGenerator(ei, ej) = sij;
+      symGenerator(ej, ei) = sij;
+    }
+  }
+
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(symGenerator);
+  if (solver.info() != Eigen::Success)
+    return false;
+
+  const auto& values = solver.eigenvalues();
+  const auto& vectors = solver.eigenvectors();
+  eigenValues_.resize(salph);
+  iEigenValues_.assign(salph, 0.);
+  rightEigenVectors_.resize(salph, salph);
+  leftEigenVectors_.resize(salph, salph);
+  for (size_t j = 0; j < salph; j++)
+  {
+    const auto ej = Eigen::Index(j);
+    eigenValues_[j] = values(ej);
+    for (size_t i = 0; i < salph; i++)
+    {
+      const auto ei = Eigen::Index(i);
+      rightEigenVectors_(i, j) = vectors(ei, ej) / sqrtFreq(ei);
+      leftEigenVectors_(j, i) = vectors(ei, ej) * sqrtFreq(ei);
+    }
+  }
+  return true;
+}
+
 /******************************************************************************/
 
 const Matrix<double>& AbstractSubstitutionModel::getPij_t(double t) const
@@ -606,7 +676,7 @@ const Matrix<double>& AbstractSubstitutionModel::getd2Pij_dt2(double t) const
                        - 2 * eigenValues_[i] * iEigenValues_[i] * s) * e;
           vup[i] = NumTools::sqr(rate_)
                    * ((NumTools::sqr(eigenValues_[i]) - NumTools::sqr(iEigenValues_[i])) * s
-                      - 2 * eigenValues_[i] * iEigenValues_[i] * c) * e;
+                      + 2 * eigenValues_[i] * iEigenValues_[i] * c) * e;
           vlo[i] = -vup[i];
           vdia[i + 1] = vdia[i]; // trick to avoid computation
           i++;
@@ -654,6 +724,247 @@ const Matrix<double>& AbstractSubstitutionModel::getd2Pij_dt2(double t) const
 
 /******************************************************************************/
 
+void AbstractSubstitutionModel::computeTransitionMatrix_(double t, unsigned int nDeriv, Eigen::Ref<Eigen::MatrixXd> out) const
+{
+  const auto n = Eigen::Index(size_);
+  if (out.rows() != n || out.cols() != n)
+    throw Exception("AbstractSubstitutionModel::computePij_t: output matrix of size " + to_string(out.rows()) + "x" + to_string(out.cols()) + " instead of " + to_string(size_) + "x" + to_string(size_) + " for " + getName());
+
+  if (nDeriv == 0 && t == 0)
+  {
+    out.setIdentity();
+    return;
+  }
+
+  if (isNonSingular_)
+  {
+    Eigen::MatrixXd right(n, n), left(n, n);
+    for (size_t i = 0; i < size_; i++)
+    {
+      for (size_t j = 0; j < size_; j++)
+      {
+        right(Eigen::Index(i), Eigen::Index(j)) = rightEigenVectors_(i, j);
+        left(Eigen::Index(i), Eigen::Index(j)) = leftEigenVectors_(i, j);
+      }
+    }
+
+    double l = rate_ * t;
+    if (isDiagonalizable_)
+    {
+      // right . diag((r.lambda)^d exp(r.t.lambda)) . left
+      Eigen::VectorXd dia(n);
+      for (size_t i = 0; i < size_; i++)
+      {
+        dia(Eigen::Index(i)) = std::pow(rate_ * eigenValues_[i], nDeriv) * std::exp(eigenValues_[i] * l);
+      }
+      out.noalias() = right * (dia.asDiagonal() * left);
+    }
+    else
+    {
+      // 2x2 blocks for the conjugated complex eigen values a +/- ib,
+      // derivatives of exp(a.l) (cos(b.l), sin(b.l)).
+      Eigen::MatrixXd blocks = Eigen::MatrixXd::Zero(n, n);
+      for (size_t i = 0; i < size_; i++)
+      {
+        const auto k = Eigen::Index(i);
+        double a = eigenValues_[i];
+        double e = std::exp(a * l);
+        if (iEigenValues_[i] != 0)
+        {
+          double b = iEigenValues_[i];
+          double s = std::sin(b * l);
+          double c = std::cos(b * l);
+          double dia, up;
+          switch (nDeriv)
+          {
+          case 0:
+            dia = c * e;
+            up = s * e;
+            break;
+          case 1:
+            dia = rate_ * (a * c - b * s) * e;
+            up = rate_ * (a * s + b * c) * e;
+            break;
+          default:
+            dia = NumTools::sqr(rate_) * ((NumTools::sqr(a) - NumTools::sqr(b)) * c - 2 * a * b * s) * e;
+            up = NumTools::sqr(rate_) * ((NumTools::sqr(a) - NumTools::sqr(b)) * s + 2 * a * b * c) * e;
+            break;
+          }
+          blocks(k, k) = dia;
+          blocks(k + 1, k + 1) = dia;
+          blocks(k, k + 1) = up;
+          blocks(k + 1, k) = -up;
+          i++;
+        }
+        else
+          blocks(k, k) = std::pow(rate_ * a, nDeriv) * e;
+      }
+      out.noalias() = right * blocks * left;
+    }
+  }
+  else
+  {
+    // exp(r.t.Q) = (exp(r.t/(2^m) Q))^(2^m), from the powers of the
+    // generator if they are available.
+    Eigen::MatrixXd generator(n, n);
+    for (size_t i = 0; i < size_; i++)
+    {
+      for (size_t j = 0; j < size_; j++)
+      {
+        generator(Eigen::Index(i), Eigen::Index(j)) = generator_(i, j);
+      }
+    }
+
+    double v = rate_ * t;
+    size_t m = 0;
+    while (v > 0.5)
+    {
+      m += 1;
+      v /= 2;
+    }
+
+    Eigen::MatrixXd pij = Eigen::MatrixXd::Identity(n, n);
+    double s = 1.0;
+    if (vPowGen_.size() > 0)
+    {
+      for (size_t p = 1; p < vPowGen_.size(); p++)
+      {
+        s *= v / static_cast<double>(p);
+        for (size_t i = 0; i < size_; i++)
+        {
+          for (size_t j = 0; j < size_; j++)
+          {
+            pij(Eigen::Index(i), Eigen::Index(j)) += s * vPowGen_[p](i, j);
+          }
+        }
+      }
+    }
+    else
+    {
+      Eigen::MatrixXd term = Eigen::MatrixXd::Identity(n, n);
+      for (size_t p = 1; p < 30; p++)
+      {
+        term = (term * generator) * (v / static_cast<double>(p));
+        pij += term;
+      }
+    }
+    while (m > 0)
+    {
+      pij = pij * pij;
+      m--;
+    }
+
+    switch (nDeriv)
+    {
+    case 0:
+      out = pij;
+      break;
+    case 1:
+      out.noalias() = rate_ * generator * pij;
+      break;
+    default:
+      out.noalias() = NumTools::sqr(rate_) * generator * (generator * pij);
+      break;
+    }
+  }
+
+  // Same check as getPij_t, to avoid numerical issues
+  if (nDeriv == 0)
+  {
+    for (Eigen::Index i = 0; i < n; i++)
+    {
+      for (Eigen::Index j = 0; j < n; j++)
+      {
+        if (out(i, j) < 0.)
+        {
+          if (std::abs(out(i, j)) > NumConstants::SMALL())
+            throw Exception("There is an issue in the computation of transition matrix of " + getName() + " : pijt_(" + to_string(i) + "," + to_string(j) + ", " + to_string(t) + ")=" + to_string(out(i, j)));
+          out(i, j) = 0.;
+        }
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+
+bool AbstractSubstitutionModel::hasdGenerator_dParameter(const std::string& name) const
+{
+  return getParameterNameWithoutNamespace(name) == "rate" && hasParameter("rate");
+}
+
+/******************************************************************************/
+
+void AbstractSubstitutionModel::computedGenerator_dParameter(const std::string& name, Eigen::Ref<Eigen::MatrixXd> out) const
+{
+  if (!AbstractSubstitutionModel::hasdGenerator_dParameter(name))
+    throw Exception("AbstractSubstitutionModel::computedGenerator_dParameter: no analytic derivative for parameter " + name + " in model " + getName());
+
+  // d(r.Q)/dr = Q
+  for (size_t i = 0; i < size_; i++)
+  {
+    for (size_t j = 0; j < size_; j++)
+    {
+      out(Eigen::Index(i), Eigen::Index(j)) = generator_(i, j);
+    }
+  }
+}
+
+/******************************************************************************/
+
+void AbstractSubstitutionModel::computedPij_dGenerator(double t, const Eigen::Ref<const Eigen::MatrixXd>& dGenerator, Eigen::Ref<Eigen::MatrixXd> out) const
+{
+  const auto n = Eigen::Index(size_);
+  if (out.rows() != n || out.cols() != n || dGenerator.rows() != n || dGenerator.cols() != n)
+    throw Exception("AbstractSubstitutionModel::computedPij_dGenerator: matrices of size " + to_string(size_) + "x" + to_string(size_) + " expected for " + getName());
+
+  if (t == 0)
+  {
+    out.setZero();
+    return;
+  }
+
+  bool isRealDiagonalized = eigenDecompose_ && isNonSingular_ && isDiagonalizable_;
+  for (size_t i = 0; isRealDiagonalized && i < size_; i++)
+  {
+    isRealDiagonalized = (iEigenValues_[i] == 0);
+  }
+
+  if (!isRealDiagonalized)
+  {
+    SubstitutionModel::computedPij_dGenerator(t, dGenerator, out);
+    return;
+  }
+
+  Eigen::MatrixXd right(n, n), left(n, n);
+  Eigen::VectorXd a(n);
+  for (size_t i = 0; i < size_; i++)
+  {
+    a(Eigen::Index(i)) = rate_ * t * eigenValues_[i];
+    for (size_t j = 0; j < size_; j++)
+    {
+      right(Eigen::Index(i), Eigen::Index(j)) = rightEigenVectors_(i, j);
+      left(Eigen::Index(i), Eigen::Index(j)) = leftEigenVectors_(i, j);
+    }
+  }
+
+  // Derivative in the eigen basis, scaled by the divided differences
+  // of exp on the eigen values.
+  Eigen::MatrixXd phi = t * (left * dGenerator * right);
+  for (Eigen::Index i = 0; i < n; i++)
+  {
+    double ei = std::exp(a(i));
+    for (Eigen::Index j = 0; j < n; j++)
+    {
+      double d = a(j) - a(i);
+      phi(i, j) *= (std::abs(d) < NumConstants::TINY()) ? ei * (1 + d / 2) : ei * std::expm1(d) / d;
+    }
+  }
+  out.noalias() = right * phi * left;
+}
+
+/******************************************************************************/
+
 double AbstractSubstitutionModel::getScale() const
 {
   vector<double> v;
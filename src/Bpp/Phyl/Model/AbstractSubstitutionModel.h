@@ -391,6 +391,48 @@ public:
   const Matrix<double>& getdPij_dt(double t) const;
   const Matrix<double>& getd2Pij_dt2(double t) const;
 
+  /**
+   * @brief Reentrant computation of the transition probabilities
+   * (see TransitionModel::computePij_t).
+   *
+   * Computed from the eigen decomposition if the generator is non
+   * singular (including the complex eigen values), and else by
+   * exp(r.t.Q) Taylor series on the generator_ matrix.
+   *
+   * Models computing getPij_t & co in closed form (K80, HKY85, ...)
+   * forward these methods to the TransitionModel ones, which copy
+   * getPij_t & co, and are not reentrant.
+   */
+  void computePij_t(double t, Eigen::Ref<Eigen::MatrixXd> out) const { computeTransitionMatrix_(t, 0, out); }
+  void computedPij_dt(double t, Eigen::Ref<Eigen::MatrixXd> out) const { computeTransitionMatrix_(t, 1, out); }
+  void computed2Pij_dt2(double t, Eigen::Ref<Eigen::MatrixXd> out) const { computeTransitionMatrix_(t, 2, out); }
+
+  bool hasReentrantPij_t() const { return true; }
+
+  /**
+   * @brief Analytic derivative of the generator with respect to the
+   * rate parameter, if any (see addRateParameter): \f$Q\f$.
+   *
+   * Models with an analytic derivative for their own parameters
+   * should override these methods, and call them for the rate.
+   */
+  bool hasdGenerator_dParameter(const std::string& name) const;
+  void computedGenerator_dParameter(const std::string& name, Eigen::Ref<Eigen::MatrixXd> out) const;
+
+  /**
+   * @brief Reentrant derivative of the transition probabilities along
+   * a direction of the generator (see
+   * SubstitutionModel::computedPij_dGenerator).
+   *
+   * If the generator is diagonalizable in R, with
+   * \f$r.t.Q = U diag(a) U^{-1}\f$:
+   * \f[ dP = U (\Phi \circ (U^{-1} t.dG U)) U^{-1}, \f]
+   * with \f$\Phi_{i,j} = (e^{a_i} - e^{a_j}) / (a_i - a_j)\f$, or
+   * \f$e^{a_i}\f$ if \f$a_i = a_j\f$. Otherwise the default block
+   * exponential is used.
+   */
+  void computedPij_dGenerator(double t, const Eigen::Ref<const Eigen::MatrixXd>& dGenerator, Eigen::Ref<Eigen::MatrixXd> out) const;
+
   double Sij(size_t i, size_t j) const { return exchangeability_(i, j); }
 
   const Vdouble& getEigenValues() const { return eigenValues_; }
@@ -429,9 +471,35 @@ protected:
    *
    * !! Here there is no normalization of the generator.
    *
+   * Reversible generators are diagonalized through their symmetric
+   * form (see diagonalizeReversibleGenerator_).
+   *
    */
   virtual void updateMatrices();
 
+  /**
+   * @brief Diagonalize a reversible generator_ through its symmetric form.
+   *
+   * If the model is reversible for freq_, ie
+   * \f$\pi_i Q_{i,j} = \pi_j Q_{j,i}\f$, then
+   * \f$S = D^{1/2} Q D^{-1/2}\f$, with \f$D = diag(\pi)\f$, is
+   * symmetric. S is diagonalized by a self-adjoint solver as
+   * \f$S = V \Lambda V^T\f$, so \f$Q = (D^{-1/2} V) \Lambda (V^T D^{1/2})\f$:
+   * eigen values are real, and leftEigenVectors_ is obtained without
+   * matrix inversion.
+   *
+   * @return true if eigenValues_, iEigenValues_, rightEigenVectors_ and
+   * leftEigenVectors_ are set, false if the generator is not
+   * reversible for freq_ (nothing is changed then).
+   */
+  bool diagonalizeReversibleGenerator_();
+
+  /**
+   * @brief Compute the nDeriv-th derivative of the transition
+   * probabilities into out, using only local buffers.
+   */
+  void computeTransitionMatrix_(double t, unsigned int nDeriv, Eigen::Ref<Eigen::MatrixXd> out) const;
+
 public:
   /**
    * @brief sets if model is scalable, ie scale can be changed.
@@ -151,6 +151,14 @@ public:
 
   const Matrix<double>& getd2Pij_dt2(double t) const { return getTransitionModel().getd2Pij_dt2(t); }
 
+  void computePij_t(double t, Eigen::Ref<Eigen::MatrixXd> out) const { getTransitionModel().computePij_t(t, out); }
+
+  void computedPij_dt(double t, Eigen::Ref<Eigen::MatrixXd> out) const { getTransitionModel().computedPij_dt(t, out); }
+
+  void computed2Pij_dt2(double t, Eigen::Ref<Eigen::MatrixXd> out) const { getTransitionModel().computed2Pij_dt2(t, out); }
+
+  bool hasReentrantPij_t() const { return getTransitionModel().hasReentrantPij_t(); }
+
   double getInitValue(size_t i, int state) const
   {
     return getTransitionModel().getInitValue(i, state);
@@ -204,6 +204,12 @@ public:
   const Matrix<double>& getdPij_dt  (double d) const;
   const Matrix<double>& getd2Pij_dt2(double d) const;
 
+  // Closed forms (see AbstractSubstitutionModel::computePij_t).
+  void computePij_t(double d, Eigen::Ref<Eigen::MatrixXd> out) const { TransitionModel::computePij_t(d, out); }
+  void computedPij_dt(double d, Eigen::Ref<Eigen::MatrixXd> out) const { TransitionModel::computedPij_dt(d, out); }
+  void computed2Pij_dt2(double d, Eigen::Ref<Eigen::MatrixXd> out) const { TransitionModel::computed2Pij_dt2(d, out); }
+  bool hasReentrantPij_t() const { return false; }
+
   std::string getName() const { return "F81"; }
 
   /**
@@ -123,6 +123,76 @@ void GTR::updateMatrices()
 
 /******************************************************************************/
 
+bool GTR::hasdGenerator_dParameter(const std::string& name) const
+{
+  const std::string pname = getParameterNameWithoutNamespace(name);
+  return pname == "a" || pname == "b" || pname == "c" || pname == "d" || pname == "e"
+         || pname == "theta" || pname == "theta1" || pname == "theta2"
+         || AbstractSubstitutionModel::hasdGenerator_dParameter(name);
+}
+
+void GTR::computedGenerator_dParameter(const std::string& name, Eigen::Ref<Eigen::MatrixXd> out) const
+{
+  const std::string pname = getParameterNameWithoutNamespace(name);
+
+  // For i != j, Q_ij = x_ij.pi_j / p_, with x the symmetric matrix
+  // of (a, b, c, d, e, 1), and p_ = sum_{i != j} pi_i.x_ij.pi_j.
+  Eigen::Matrix4d x;
+  x << 0., d_, 1., b_,
+    d_, 0., e_, a_,
+    1., e_, 0., c_,
+    b_, a_, c_, 0.;
+  Eigen::Vector4d pi(piA_, piC_, piG_, piT_);
+
+  Eigen::Matrix4d dx = Eigen::Matrix4d::Zero();
+  Eigen::Vector4d dpi = Eigen::Vector4d::Zero();
+  if (pname == "a")
+    dx(1, 3) = dx(3, 1) = 1.;
+  else if (pname == "b")
+    dx(0, 3) = dx(3, 0) = 1.;
+  else if (pname == "c")
+    dx(2, 3) = dx(3, 2) = 1.;
+  else if (pname == "d")
+    dx(0, 1) = dx(1, 0) = 1.;
+  else if (pname == "e")
+    dx(1, 2) = dx(2, 1) = 1.;
+  else if (pname == "theta")
+    dpi << -theta1_, 1. - theta2_, theta2_, -(1. - theta1_);
+  else if (pname == "theta1")
+    dpi << 1. - theta_, 0., 0., -(1. - theta_);
+  else if (pname == "theta2")
+    dpi << 0., -theta_, theta_, 0.;
+  else
+  {
+    AbstractSubstitutionModel::computedGenerator_dParameter(name, out);
+    return;
+  }
+
+  double dp = 0.;
+  for (Eigen::Index i = 0; i < 4; i++)
+  {
+    for (Eigen::Index j = 0; j < 4; j++)
+    {
+      dp += dx(i, j) * pi(i) * pi(j) + x(i, j) * (dpi(i) * pi(j) + pi(i) * dpi(j));
+    }
+  }
+
+  for (Eigen::Index i = 0; i < 4; i++)
+  {
+    double diag = 0.;
+    for (Eigen::Index j = 0; j < 4; j++)
+    {
+      if (j == i)
+        continue;
+      out(i, j) = getRate() * ((dx(i, j) * pi(j) + x(i, j) * dpi(j)) / p_ - x(i, j) * pi(j) * dp / (p_ * p_));
+      diag -= out(i, j);
+    }
+    out(i, i) = diag;
+  }
+}
+
+/******************************************************************************/
+
 void GTR::setFreq(map<int, double>& freqs)
 {
   piA_ = freqs[0];
@@ -161,6 +161,13 @@ public:
 public:
   std::string getName() const { return "GTR"; }
 
+  /**
+   * @brief Analytic derivative of the generator with respect to all
+   * the parameters (see SubstitutionModel::computedGenerator_dParameter).
+   */
+  bool hasdGenerator_dParameter(const std::string& name) const;
+  void computedGenerator_dParameter(const std::string& name, Eigen::Ref<Eigen::MatrixXd> out) const;
+
   void updateMatrices();
 
 
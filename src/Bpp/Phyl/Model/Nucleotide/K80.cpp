@@ -143,6 +143,36 @@ void K80::updateMatrices()
 
 /******************************************************************************/
 
+bool K80::hasdGenerator_dParameter(const std::string& name) const
+{
+  return getParameterNameWithoutNamespace(name) == "kappa" || AbstractSubstitutionModel::hasdGenerator_dParameter(name);
+}
+
+void K80::computedGenerator_dParameter(const std::string& name, Eigen::Ref<Eigen::MatrixXd> out) const
+{
+  if (getParameterNameWithoutNamespace(name) != "kappa")
+  {
+    AbstractSubstitutionModel::computedGenerator_dParameter(name, out);
+    return;
+  }
+
+  // generator_ = s.Q0, with s = 1/(kappa+2) if scalable, so
+  // dQ/dkappa = s.dQ0/dkappa + (ds/dkappa)/s.generator_
+  double s = isScalable() ? 1. / (kappa_ + 2.) : 1.;
+  double ds_s = isScalable() ? -1. / (kappa_ + 2.) : 0.;
+
+  for (size_t i = 0; i < 4; i++)
+  {
+    for (size_t j = 0; j < 4; j++)
+    {
+      double dq0 = (i == j) ? -1. : ((i + 2) % 4 == j ? 1. : 0.);
+      out(Eigen::Index(i), Eigen::Index(j)) = getRate() * (s * dq0 + ds_s * generator_(i, j));
+    }
+  }
+}
+
+/******************************************************************************/
+
 double K80::Pij_t(size_t i, size_t j, double d) const
 {
   l_ = rate_ * r_ * d;
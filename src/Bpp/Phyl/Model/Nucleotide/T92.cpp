@@ -186,6 +186,52 @@ void T92::updateMatrices()
 
 /******************************************************************************/
 
+bool T92::hasdGenerator_dParameter(const std::string& name) const
+{
+  const std::string pname = getParameterNameWithoutNamespace(name);
+  return pname == "kappa" || pname == "theta" || AbstractSubstitutionModel::hasdGenerator_dParameter(name);
+}
+
+void T92::computedGenerator_dParameter(const std::string& name, Eigen::Ref<Eigen::MatrixXd> out) const
+{
+  const std::string pname = getParameterNameWithoutNamespace(name);
+
+  // generator_ = r_.Q0, so dQ = r_.dQ0 + (dr/r).generator_
+  Eigen::Matrix4d dq0;
+  double dr_r;
+  if (pname == "kappa")
+  {
+    dq0 << -theta_ / 2, 0., theta_ / 2, 0.,
+      0., -(1. - theta_) / 2, 0., (1. - theta_) / 2,
+      (1. - theta_) / 2, 0., -(1. - theta_) / 2, 0.,
+      0., theta_ / 2, 0., -theta_ / 2;
+    dr_r = isScalable() ? -r_ * (theta_ - theta_ * theta_) : 0.;
+  }
+  else if (pname == "theta")
+  {
+    dq0 << -kappa_ / 2, 1. / 2, kappa_ / 2, -1. / 2,
+      -1. / 2, kappa_ / 2, 1. / 2, -kappa_ / 2,
+      -kappa_ / 2, 1. / 2, kappa_ / 2, -1. / 2,
+      -1. / 2, kappa_ / 2, 1. / 2, -kappa_ / 2;
+    dr_r = isScalable() ? -r_ * (kappa_ - 2. * theta_ * kappa_) : 0.;
+  }
+  else
+  {
+    AbstractSubstitutionModel::computedGenerator_dParameter(name, out);
+    return;
+  }
+
+  for (size_t i = 0; i < 4; i++)
+  {
+    for (size_t j = 0; j < 4; j++)
+    {
+      out(Eigen::Index(i), Eigen::Index(j)) = getRate() * (r_ * dq0(Eigen::Index(i), Eigen::Index(j)) + dr_r * generator_(i, j));
+    }
+  }
+}
+
+/******************************************************************************/
+
 double T92::Pij_t(size_t i, size_t j, double d) const
 {
   l_ = rate_ * r_ * d;
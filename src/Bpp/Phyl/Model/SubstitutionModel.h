@@ -59,6 +59,7 @@
 #include <Bpp/Seq/Container/SequencedValuesContainer.h>
 
 // From the STL:
+#include <cmath>
 #include <cstdlib>
 #include <map>
 #include <string>
@@ -304,6 +305,75 @@ public:
    */
   virtual const Matrix<double>& getd2Pij_dt2(double t) const = 0;
 
+  /**
+   * @brief Reentrant computation of the transition probabilities.
+   *
+   * Write all probabilities of change from state i to state j during
+   * time t in out, which must be of size nbStates x nbStates.
+   *
+   * Unlike getPij_t, which returns a buffer owned by the model, these
+   * methods do not modify the model when hasReentrantPij_t() is true:
+   * they may then be called concurrently on the same model, as long
+   * as it is not modified meanwhile.
+   *
+   * The default implementation copies getPij_t, so calls on the same
+   * model must be serialized by the caller.
+   *
+   * @see getPij_t()
+   */
+  virtual void computePij_t(double t, Eigen::Ref<Eigen::MatrixXd> out) const
+  {
+    copyTransitionMatrix_(getPij_t(t), out);
+  }
+
+  /**
+   * @brief Reentrant computation of the first order derivatives of
+   * the transition probabilities with respect to time t.
+   *
+   * @see computePij_t(), getdPij_dt()
+   */
+  virtual void computedPij_dt(double t, Eigen::Ref<Eigen::MatrixXd> out) const
+  {
+    copyTransitionMatrix_(getdPij_dt(t), out);
+  }
+
+  /**
+   * @brief Reentrant computation of the second order derivatives of
+   * the transition probabilities with respect to time t.
+   *
+   * @see computePij_t(), getd2Pij_dt2()
+   */
+  virtual void computed2Pij_dt2(double t, Eigen::Ref<Eigen::MatrixXd> out) const
+  {
+    copyTransitionMatrix_(getd2Pij_dt2(t), out);
+  }
+
+  /**
+   * @return true if computePij_t, computedPij_dt and computed2Pij_dt2
+   * do not write into the model, and may be called concurrently.
+   * False for the default implementations.
+   */
+  virtual bool hasReentrantPij_t() const
+  {
+    return false;
+  }
+
+protected:
+
+  static void copyTransitionMatrix_(const Matrix<double>& pij, Eigen::Ref<Eigen::MatrixXd> out)
+  {
+    if (out.rows() != Eigen::Index(pij.getNumberOfRows()) || out.cols() != Eigen::Index(pij.getNumberOfColumns()))
+      throw Exception("TransitionModel::computePij_t: output matrix of size " + std::to_string(out.rows()) + "x" + std::to_string(out.cols()) + " instead of " + std::to_string(pij.getNumberOfRows()) + "x" + std::to_string(pij.getNumberOfColumns()) + ".");
+    for (size_t i = 0; i < pij.getNumberOfRows(); i++)
+    {
+      for (size_t j = 0; j < pij.getNumberOfColumns(); j++)
+      {
+        out(Eigen::Index(i), Eigen::Index(j)) = pij(i, j);
+      }
+    }
+  }
+
+public:
   /**
    * This method is used to compute likelihoods in recursions.
    * It computes the probability of a vector given a start state.
@@ -538,6 +608,93 @@ public:
    */
   virtual const Matrix<double>& getGenerator() const = 0;
 
+  /**
+   * @brief Tell if the derivative of the generator with respect to
+   * parameter name is computed analytically (see
+   * computedGenerator_dParameter).
+   *
+   * The rate and the parameters of K80, T92 and GTR are derived
+   * analytically. The other parameters (those of the codon, protein
+   * and word models among them) are derived numerically, on the
+   * generator of shifted copies of the model (see GeneratorFromModel).
+   *
+   * @param name The full name of the parameter (with namespace).
+   */
+  virtual bool hasdGenerator_dParameter(const std::string& name) const
+  {
+    return false;
+  }
+
+  /**
+   * @brief Write the derivative of the generator including the rate,
+   * \f$r.Q\f$ (getRate() . getGenerator()), with respect to parameter
+   * name in out, which must be of size nbStates x nbStates.
+   *
+   * Only available if hasdGenerator_dParameter(name).
+   */
+  virtual void computedGenerator_dParameter(const std::string& name, Eigen::Ref<Eigen::MatrixXd> out) const
+  {
+    throw Exception("SubstitutionModel::computedGenerator_dParameter: no analytic derivative for parameter " + name + " in model " + getName());
+  }
+
+  /**
+   * @brief Reentrant computation of the derivative of the transition
+   * probabilities along a direction of the generator.
+   *
+   * With \f$G = r.Q\f$ the generator including the rate, writes in
+   * out the derivative of \f$P(t) = \exp(t.G)\f$ with respect to
+   * \f$G\f$, in the direction dGenerator:
+   * \f[ \int_0^t \exp(s.G)\, dG \exp((t-s).G) ds. \f]
+   * So if dGenerator is \f$d(r.Q)/d\theta\f$ (see
+   * computedGenerator_dParameter), out is \f$dP(t)/d\theta\f$.
+   *
+   * The default implementation computes the exponential of the
+   * block matrix \f$\begin{pmatrix} t.G & t.dG \\ 0 & t.G\end{pmatrix}\f$,
+   * whose upper right block is the derivative (Van Loan, 1978), by
+   * a Taylor series with scaling and squaring.
+   */
+  virtual void computedPij_dGenerator(double t, const Eigen::Ref<const Eigen::MatrixXd>& dGenerator, Eigen::Ref<Eigen::MatrixXd> out) const
+  {
+    const auto& gen = getGenerator();
+    const auto n = Eigen::Index(gen.getNumberOfRows());
+    if (out.rows() != n || out.cols() != n || dGenerator.rows() != n || dGenerator.cols() != n)
+      throw Exception("SubstitutionModel::computedPij_dGenerator: matrices of size " + std::to_string(n) + "x" + std::to_string(n) + " expected for " + getName());
+
+    Eigen::MatrixXd block = Eigen::MatrixXd::Zero(2 * n, 2 * n);
+    for (Eigen::Index i = 0; i < n; i++)
+    {
+      for (Eigen::Index j = 0; j < n; j++)
+      {
+        block(i, j) = block(n + i, n + j) = getRate() * t * gen(size_t(i), size_t(j));
+      }
+    }
+    block.topRightCorner(n, n) = t * dGenerator;
+
+    // exp(B) = (exp(B/(2^m)))^(2^m)
+    double norm = block.cwiseAbs().rowwise().sum().maxCoeff();
+    size_t m = 0;
+    while (norm > 0.5)
+    {
+      m += 1;
+      norm /= 2;
+    }
+    block /= std::pow(2., static_cast<double>(m));
+
+    Eigen::MatrixXd expBlock = Eigen::MatrixXd::Identity(2 * n, 2 * n);
+    Eigen::MatrixXd term = expBlock;
+    for (size_t p = 1; p < 20; p++)
+    {
+      term = (term * block) / static_cast<double>(p);
+      expBlock += term;
+    }
+    while (m > 0)
+    {
+      expBlock = expBlock * expBlock;
+      m--;
+    }
+    out = expBlock.topRightCorner(n, n);
+  }
+
   /**
    * @return The matrix of exchangeability terms.
    * It is recommended that exchangeability matrix be normalized so that the normalized
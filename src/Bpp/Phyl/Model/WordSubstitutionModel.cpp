@@ -311,6 +311,104 @@ const RowMatrix<double>& WordSubstitutionModel::getd2Pij_dt2(double d) const
   return d2pijt_;
 }
 
+bool WordSubstitutionModel::hasReentrantPij_t() const
+{
+  for (const auto* model : VSubMod_)
+  {
+    if (!model->hasReentrantPij_t())
+      return false;
+  }
+  return true;
+}
+
+void WordSubstitutionModel::computeWordTransitionMatrix_(double d, unsigned int nDeriv, Eigen::Ref<Eigen::MatrixXd> out) const
+{
+  size_t nbmod = VSubMod_.size();
+  size_t nbStates = getNumberOfStates();
+  if (out.rows() != Eigen::Index(nbStates) || out.cols() != Eigen::Index(nbStates))
+    throw Exception("WordSubstitutionModel::computePij_t: output matrix of size " + TextTools::toString(out.rows()) + "x" + TextTools::toString(out.cols()) + " instead of " + TextTools::toString(nbStates) + "x" + TextTools::toString(nbStates) + ".");
+
+  // Matrices of the positions, and their derivatives wrt d:
+  vector<Eigen::MatrixXd> vM(nbmod), vdM(nbmod), vd2M(nbmod);
+  for (size_t p = 0; p < nbmod; p++)
+  {
+    size_t t = VSubMod_[p]->getNumberOfStates();
+    double c = rate_ * Vrate_[p];
+    vM[p].resize(Eigen::Index(t), Eigen::Index(t));
+    VSubMod_[p]->computePij_t(d * c, vM[p]);
+    if (nDeriv >= 1)
+    {
+      vdM[p].resize(Eigen::Index(t), Eigen::Index(t));
+      VSubMod_[p]->computedPij_dt(d * c, vdM[p]);
+      vdM[p] *= c;
+    }
+    if (nDeriv >= 2)
+    {
+      vd2M[p].resize(Eigen::Index(t), Eigen::Index(t));
+      VSubMod_[p]->computed2Pij_dt2(d * c, vd2M[p]);
+      vd2M[p] *= c * c;
+    }
+  }
+
+  vector<Eigen::Index> vi(nbmod), vj(nbmod);
+  for (size_t i = 0; i < nbStates; i++)
+  {
+    for (size_t j = 0; j < nbStates; j++)
+    {
+      // States of the positions
+      size_t i2 = i, j2 = j;
+      for (size_t p = nbmod; p > 0; p--)
+      {
+        size_t t = VSubMod_[p - 1]->getNumberOfStates();
+        vi[p - 1] = Eigen::Index(i2 % t);
+        vj[p - 1] = Eigen::Index(j2 % t);
+        i2 /= t;
+        j2 /= t;
+      }
+
+      // Product of the matrices, with q and b derived:
+      auto product = [&](size_t q, size_t b) {
+          double x = 1;
+          for (size_t p = 0; p < nbmod; p++)
+          {
+            if (p == q && p == b)
+              x *= vd2M[p](vi[p], vj[p]);
+            else if (p == q || p == b)
+              x *= vdM[p](vi[p], vj[p]);
+            else
+              x *= vM[p](vi[p], vj[p]);
+          }
+          return x;
+        };
+
+      double r = 0;
+      switch (nDeriv)
+      {
+      case 0:
+        r = product(nbmod, nbmod);
+        break;
+      case 1:
+        for (size_t q = 0; q < nbmod; q++)
+        {
+          r += product(q, nbmod);
+        }
+        break;
+      default:
+        for (size_t q = 0; q < nbmod; q++)
+        {
+          for (size_t b = 0; b < q; b++)
+          {
+            r += 2 * product(q, b);
+          }
+          r += product(q, q);
+        }
+        break;
+      }
+      out(Eigen::Index(i), Eigen::Index(j)) = r;
+    }
+  }
+}
+
 string WordSubstitutionModel::getName() const
 {
   return "Word";
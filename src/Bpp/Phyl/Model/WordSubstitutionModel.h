@@ -125,7 +125,26 @@ public:
 
   virtual const RowMatrix<double>& getd2Pij_dt2(double d) const;
 
+  /**
+   * @brief Reentrant computation of the transition probabilities, as
+   * products of the ones of the models of the positions (see
+   * TransitionModel::computePij_t).
+   */
+  void computePij_t(double d, Eigen::Ref<Eigen::MatrixXd> out) const { computeWordTransitionMatrix_(d, 0, out); }
+  void computedPij_dt(double d, Eigen::Ref<Eigen::MatrixXd> out) const { computeWordTransitionMatrix_(d, 1, out); }
+  void computed2Pij_dt2(double d, Eigen::Ref<Eigen::MatrixXd> out) const { computeWordTransitionMatrix_(d, 2, out); }
+
+  bool hasReentrantPij_t() const;
+
   virtual std::string getName() const;
+
+private:
+  /**
+   * @brief Compute the nDeriv-th derivative of the transition
+   * probabilities into out, from the computePij_t & co of the models
+   * of the positions.
+   */
+  void computeWordTransitionMatrix_(double d, unsigned int nDeriv, Eigen::Ref<Eigen::MatrixXd> out) const;
 };
 } // end of namespace bpp.
 #endif // BPP_PHYL_MODEL_WORDSUBSTITUTIONMODEL_H
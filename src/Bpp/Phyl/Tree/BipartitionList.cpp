@@ -57,7 +57,6 @@ using namespace bpp;
 
 // From the STL:
 #include <iostream>
-#include <climits> // defines CHAR_BIT
 
 using namespace std;
 
@@ -105,7 +104,9 @@ bool operator<(IntAndInt iai1, IntAndInt iai2)
 BipartitionList::BipartitionList(const Tree& tr, bool sorted, std::vector<int>* index) :
   bitBipartitionList_(),
   elements_(),
-  sorted_(sorted)
+  sorted_(sorted),
+  intBits_(),
+  intBitBipartitionList_()
 {
   size_t nbbip;
 
@@ -119,32 +120,26 @@ BipartitionList::BipartitionList(const Tree& tr, bool sorted, std::vector<int>*
   if (sorted)
     std::sort(elements_.begin(), elements_.end());
 
-  size_t lword  = static_cast<size_t>(BipartitionTools::LWORD);
-  size_t nbword = (elements_.size() + lword - 1) / lword;
-  size_t nbint  = nbword * lword / (CHAR_BIT * sizeof(int));
+  bitBipartitionList_ = SplitMatrix(elements_.size(), nbbip);
 
-  for (size_t i = 0; i < nbbip; i++)
+  map<string, size_t> elementIndexes;
+  for (size_t i = 0; i < elements_.size(); i++)
   {
-    bitBipartitionList_.push_back(new int[nbint]);
-    for (size_t j = 0; j < nbint; j++)
-    {
-      bitBipartitionList_[i][j] = 0;
-    }
+    elementIndexes[elements_[i]] = i;
   }
 
   size_t cpt = 0;
-  vector<string> underlyingNames;
   const Tree* tree = &tr;
   const TreeTemplate<Node>* ttree = dynamic_cast<const TreeTemplate<Node>*>(tree);
   if (ttree)
   {
     // Gain some time...
-    buildBitBipartitions(ttree->getRootNode(), bitBipartitionList_, elements_, &cpt, index);
+    buildBitBipartitions(ttree->getRootNode(), bitBipartitionList_, elementIndexes, &cpt, index);
   }
   else
   {
     TreeTemplate<Node> tmp(tr);
-    buildBitBipartitions(tmp.getRootNode(), bitBipartitionList_, elements_, &cpt, index);
+    buildBitBipartitions(tmp.getRootNode(), bitBipartitionList_, elementIndexes, &cpt, index);
   }
 }
 
@@ -152,21 +147,41 @@ BipartitionList::BipartitionList(const Tree& tr, bool sorted, std::vector<int>*
 
 BipartitionList::BipartitionList(
   const std::vector<std::string>& elements,
-  const std::vector<int*>& bitBipL) :
-  bitBipartitionList_(),
+  const SplitMatrix& bitBipL) :
+  bitBipartitionList_(bitBipL),
   elements_(elements),
-  sorted_()
+  sorted_(),
+  intBits_(),
+  intBitBipartitionList_()
 {
-  size_t lword  = static_cast<size_t>(BipartitionTools::LWORD);
-  size_t nbword = (elements.size() + lword - 1) / lword;
-  size_t nbint  = nbword * lword / (CHAR_BIT * sizeof(int));
+  if (bitBipL.getNumberOfElements() != elements.size())
+    throw Exception("BipartitionList::BipartitionList. Bipartitions and elements do not match.");
+
+  vector<string> cpelements_ = elements;
+  std::sort(cpelements_.begin(), cpelements_.end());
+  if (cpelements_ == elements)
+    sorted_ = true;
+  else
+    sorted_ = false;
+}
 
+/******************************************************************************/
+
+BipartitionList::BipartitionList(
+  const std::vector<std::string>& elements,
+  const std::vector<int*>& bitBipL) :
+  bitBipartitionList_(elements.size(), bitBipL.size()),
+  elements_(elements),
+  sorted_(),
+  intBits_(),
+  intBitBipartitionList_()
+{
   for (size_t i = 0; i < bitBipL.size(); i++)
   {
-    bitBipartitionList_.push_back(new int[nbint]);
-    for (size_t j = 0; j < nbint; j++)
+    for (size_t j = 0; j < elements.size(); j++)
     {
-      bitBipartitionList_[i][j] = bitBipL[i][j];
+      if (BipartitionTools::testBit(bitBipL[i], static_cast<int>(j)))
+        bitBipartitionList_.setBit(i, j);
     }
   }
 
@@ -181,49 +196,18 @@ BipartitionList::BipartitionList(
 /******************************************************************************/
 
 BipartitionList::BipartitionList(const BipartitionList& bipL) :
-  bitBipartitionList_(),
+  bitBipartitionList_(bipL.bitBipartitionList_),
   elements_(bipL.elements_),
-  sorted_(bipL.sorted_)
-{
-  size_t lword  = static_cast<size_t>(BipartitionTools::LWORD);
-  size_t nbword = (bipL.getNumberOfElements() + lword - 1) / lword;
-  size_t nbint  = nbword * lword / (CHAR_BIT * sizeof(int));
-
-  bitBipartitionList_.resize(bipL.getNumberOfBipartitions());
-  vector<int*> bitBipL = bipL.getBitBipartitionList();
-  for (size_t i = 0; i < bipL.getNumberOfBipartitions(); i++)
-  {
-    bitBipartitionList_[i] = new int[nbint];
-    for (size_t j = 0; j < nbint; j++)
-    {
-      bitBipartitionList_[i][j] = bitBipL[i][j];
-    }
-  }
-}
+  sorted_(bipL.sorted_),
+  intBits_(),
+  intBitBipartitionList_()
+{}
 
 /******************************************************************************/
 
 BipartitionList& BipartitionList::operator=(const BipartitionList& bipL)
 {
-  size_t lword  = static_cast<size_t>(BipartitionTools::LWORD);
-  size_t nbword = (bipL.getNumberOfElements() + lword - 1) / lword;
-  size_t nbint  = nbword * lword / (CHAR_BIT * sizeof(int));
-
-  for (size_t i = 0; i < bitBipartitionList_.size(); i++)
-  {
-    delete[] bitBipartitionList_[i];
-  }
-  bitBipartitionList_.resize(bipL.getNumberOfBipartitions());
-  vector<int*> bitBipL = bipL.getBitBipartitionList();
-  for (size_t i = 0; i < bipL.getNumberOfBipartitions(); i++)
-  {
-    bitBipartitionList_[i] = new int[nbint];
-    for (size_t j = 0; j < nbint; j++)
-    {
-      bitBipartitionList_[i][j] = bitBipL[i][j];
-    }
-  }
-
+  bitBipartitionList_ = bipL.bitBipartitionList_;
   elements_ = bipL.elements_;
   sorted_   = bipL.sorted_;
   return *this;
@@ -231,13 +215,7 @@ BipartitionList& BipartitionList::operator=(const BipartitionList& bipL)
 
 /******************************************************************************/
 
-BipartitionList::~BipartitionList()
-{
-  for (size_t i = 0; i < bitBipartitionList_.size(); i++)
-  {
-    delete[] bitBipartitionList_[i];
-  }
-}
+BipartitionList::~BipartitionList() {}
 
 /******************************************************************************/
 
@@ -245,27 +223,45 @@ map<string, bool> BipartitionList::getBipartition(size_t i) const
 {
   map<string, bool> bip;
 
-  if (i >= bitBipartitionList_.size())
+  if (i >= getNumberOfBipartitions())
     throw Exception("Bipartition index exceeds BipartitionList size");
 
   for (size_t j = 0; j < elements_.size(); j++)
   {
-    if (BipartitionTools::testBit(bitBipartitionList_[i], static_cast<int>(j)))
-      bip[elements_[j]] = true;
-    else
-      bip[elements_[j]] = false;
+    bip[elements_[j]] = bitBipartitionList_.testBit(i, j);
   }
   return bip;
 }
 
 /******************************************************************************/
 
+const vector<int*>& BipartitionList::getBitBipartitionList() const
+{
+  size_t lword  = static_cast<size_t>(BipartitionTools::LWORD);
+  size_t nbint  = (elements_.size() + lword - 1) / lword;
+
+  intBits_.assign(nbint * getNumberOfBipartitions(), 0);
+  intBitBipartitionList_.resize(getNumberOfBipartitions());
+  for (size_t i = 0; i < getNumberOfBipartitions(); i++)
+  {
+    intBitBipartitionList_[i] = intBits_.data() + i * nbint;
+    for (size_t j = 0; j < elements_.size(); j++)
+    {
+      if (bitBipartitionList_.testBit(i, j))
+        BipartitionTools::bit1(intBitBipartitionList_[i], static_cast<int>(j));
+    }
+  }
+  return intBitBipartitionList_;
+}
+
+/******************************************************************************/
+
 int* BipartitionList::getBitBipartition(size_t i)
 {
-  if (i >= bitBipartitionList_.size())
+  if (i >= getNumberOfBipartitions())
     throw Exception("Bipartition index exceeds BipartitionList size");
 
-  return bitBipartitionList_[i];
+  return getBitBipartitionList()[i];
 }
 
 /******************************************************************************/
@@ -297,22 +293,11 @@ void BipartitionList::addBipartition(map<string, bool>& bipart, bool checkElemen
   if (checkElements && !BipartitionList::haveSameElementsThan(bipart))
     throw Exception("Distinct bipartition element sets");
 
-  size_t lword  = static_cast<size_t>(BipartitionTools::LWORD);
-  size_t nbword = (elements_.size() + lword - 1) / lword;
-  size_t nbint  = nbword * lword / (CHAR_BIT * sizeof(int));
-  bitBipartitionList_.push_back(new int[nbint]);
-  size_t ind    = bitBipartitionList_.size() - 1;
-  for (size_t j = 0; j < nbint; j++)
-  {
-    bitBipartitionList_[ind][j] = 0;
-  }
-
+  size_t ind = bitBipartitionList_.addRow();
   for (size_t i = 0; i < elements_.size(); i++)
   {
     if (bipart[elements_[i]] == true)
-      BipartitionTools::bit1(bitBipartitionList_[ind], static_cast<int>(i));
-    else
-      BipartitionTools::bit0(bitBipartitionList_[ind], static_cast<int>(i));
+      bitBipartitionList_.setBit(ind, i);
   }
 }
 
@@ -320,46 +305,29 @@ void BipartitionList::addBipartition(map<string, bool>& bipart, bool checkElemen
 
 void BipartitionList::deleteBipartition(size_t i)
 {
-  if (i >= bitBipartitionList_.size())
+  if (i >= getNumberOfBipartitions())
     throw Exception("Bipartition index exceeds BipartitionList size");
 
-  delete[] bitBipartitionList_[i];
-  bitBipartitionList_.erase(bitBipartitionList_.begin() + static_cast<ptrdiff_t>(i));
+  bitBipartitionList_.deleteRow(i);
 }
 
 /******************************************************************************/
 
 bool BipartitionList::containsBipartition(map<string, bool>& bipart, bool checkElements) const
 {
-  size_t i, j;
-  bool dac, padac;
-
   if (checkElements && !BipartitionList::haveSameElementsThan(bipart))
     throw Exception("Distinct bipartition element sets");
 
-  for (i = 0; i < bitBipartitionList_.size(); i++)
+  SplitMatrix bip(elements_.size(), 1);
+  for (size_t j = 0; j < elements_.size(); j++)
   {
-    dac = padac = false;
-    for (j = 0; j < elements_.size(); j++)
-    {
-      if (BipartitionTools::testBit(bitBipartitionList_[i], static_cast<int>(j)))
-      {
-        if (bipart[elements_[j]])
-          dac = true;
-        else
-          padac = true;
-      }
-      else
-      {
-        if (bipart[elements_[j]])
-          padac = true;
-        else
-          dac = true;
-      }
-      if (dac && padac)
-        break;
-    }
-    if (j == elements_.size())
+    if (bipart[elements_[j]])
+      bip.setBit(0, j);
+  }
+
+  for (size_t i = 0; i < getNumberOfBipartitions(); i++)
+  {
+    if (bitBipartitionList_.areIdentical(i, bip, 0))
       return true;
   }
   return false;
@@ -369,81 +337,35 @@ bool BipartitionList::containsBipartition(map<string, bool>& bipart, bool checkE
 
 bool BipartitionList::areIdentical(size_t k1, size_t k2) const
 {
-  bool dac, padac;
-
-  if (k1 >= bitBipartitionList_.size())
+  if (k1 >= getNumberOfBipartitions())
     throw Exception("Bipartition index exceeds BipartitionList size");
-  if (k2 >= bitBipartitionList_.size())
+  if (k2 >= getNumberOfBipartitions())
     throw Exception("Bipartition index exceeds BipartitionList size");
 
-  dac = padac = false;
-  for (size_t j = 0; j < elements_.size(); j++)
-  {
-    if (BipartitionTools::testBit(bitBipartitionList_[k1], static_cast<int>(j)))
-    {
-      if (BipartitionTools::testBit(bitBipartitionList_[k2], static_cast<int>(j)))
-        dac = true;
-      else
-        padac = true;
-    }
-    else
-    {
-      if (BipartitionTools::testBit(bitBipartitionList_[k2], static_cast<int>(j)))
-        padac = true;
-      else
-        dac = true;
-    }
-    if (dac && padac)
-      return false;
-  }
-  return true;
+  return bitBipartitionList_.areIdentical(k1, bitBipartitionList_, k2);
 }
 
 /******************************************************************************/
 
 bool BipartitionList::areCompatible(size_t k1, size_t k2) const
 {
-  bool uu, uz, zu, zz;
-
-  if (k1 >= bitBipartitionList_.size())
+  if (k1 >= getNumberOfBipartitions())
     throw Exception("Bipartition index exceeds BipartitionList size");
-  if (k2 >= bitBipartitionList_.size())
+  if (k2 >= getNumberOfBipartitions())
     throw Exception("Bipartition index exceeds BipartitionList size");
 
-  uu = uz = zu = zz = false;
-
-  for (size_t j = 0; j < elements_.size(); j++)
-  {
-    if (BipartitionTools::testBit(bitBipartitionList_[k1], static_cast<int>(j)))
-    {
-      if (BipartitionTools::testBit(bitBipartitionList_[k2], static_cast<int>(j)))
-        uu = true;
-      else
-        uz = true;
-    }
-    else
-    {
-      if (BipartitionTools::testBit(bitBipartitionList_[k2], static_cast<int>(j)))
-        zu = true;
-      else
-        zz = true;
-    }
-    if (uu && uz && zu && zz)
-      return false;
-  }
-
-  return true;
+  return bitBipartitionList_.areCompatible(k1, bitBipartitionList_, k2);
 }
 
 /******************************************************************************/
 
 bool BipartitionList::areAllCompatible() const
 {
-  for (size_t i = 0; i < bitBipartitionList_.size(); i++)
+  for (size_t i = 0; i < getNumberOfBipartitions(); i++)
   {
-    for (size_t j = i + 1; j < bitBipartitionList_.size(); j++)
+    for (size_t j = i + 1; j < getNumberOfBipartitions(); j++)
     {
-      if (!BipartitionList::areCompatible(i, j))
+      if (!bitBipartitionList_.areCompatible(i, bitBipartitionList_, j))
         return false;
     }
   }
@@ -456,7 +378,7 @@ bool BipartitionList::areAllCompatibleWith(map<string, bool>& bipart, bool check
 {
   if (checkElements && !haveSameElementsThan(bipart))
     throw Exception("Distinct bipartition element sets");
-  size_t nbBip = bitBipartitionList_.size();
+  size_t nbBip = getNumberOfBipartitions();
   const_cast<BipartitionList*>(this)->addBipartition(bipart, false);
 
   for (size_t i = 0; i < nbBip; i++)
@@ -477,7 +399,6 @@ void BipartitionList::sortElements()
 {
   vector<StringAndInt> relements_;
   StringAndInt sai;
-  size_t nbbip;
 
   for (size_t i = 0; i < elements_.size(); i++)
   {
@@ -493,34 +414,17 @@ void BipartitionList::sortElements()
     elements_[i] = relements_[i].str;
   }
 
-  nbbip = bitBipartitionList_.size();
-  bitBipartitionList_.resize(2 * nbbip);
-  size_t lword  = static_cast<size_t>(BipartitionTools::LWORD);
-  size_t nbword = (elements_.size() + lword - 1) / lword;
-  size_t nbint  = nbword * lword / (CHAR_BIT * sizeof(int));
-
-  for (size_t j = nbbip; j < 2 * nbbip; j++)
+  SplitMatrix sortedBitBipL(elements_.size(), getNumberOfBipartitions());
+  for (size_t j = 0; j < getNumberOfBipartitions(); j++)
   {
-    bitBipartitionList_[j] = new int[nbint];
-    for (size_t k = 0; k < nbint; k++)
-    {
-      bitBipartitionList_[j][k] = 0;
-    }
     for (size_t i = 0; i < elements_.size(); i++)
     {
-      if (BipartitionTools::testBit(bitBipartitionList_[j - nbbip], relements_[i].ind))
-        BipartitionTools::bit1(bitBipartitionList_[j], static_cast<int>(i));
-      else
-        BipartitionTools::bit0(bitBipartitionList_[j], static_cast<int>(i));
+      if (bitBipartitionList_.testBit(j, static_cast<size_t>(relements_[i].ind)))
+        sortedBitBipL.setBit(j, i);
     }
   }
 
-  for (size_t j = 0; j < nbbip; j++)
-  {
-    delete[] bitBipartitionList_[j];
-  }
-
-  bitBipartitionList_.erase(bitBipartitionList_.begin(), bitBipartitionList_.begin() + static_cast<ptrdiff_t>(nbbip));
+  bitBipartitionList_ = sortedBitBipL;
   sorted_ = true;
 }
 
@@ -528,15 +432,10 @@ void BipartitionList::sortElements()
 
 size_t BipartitionList::getPartitionSize(size_t k) const
 {
-  size_t size = 0;
-  if (k >= bitBipartitionList_.size())
+  if (k >= getNumberOfBipartitions())
     throw Exception("Bipartition index exceeds BipartitionList size");
 
-  for (size_t i = 0; i < elements_.size(); i++)
-  {
-    if (BipartitionTools::testBit(bitBipartitionList_[k], static_cast<int>(i)))
-      size++;
-  }
+  size_t size = bitBipartitionList_.countBits(k);
 
   if (size <= elements_.size() / 2)
     return size;
@@ -548,7 +447,7 @@ size_t BipartitionList::getPartitionSize(size_t k) const
 
 void BipartitionList::removeTrivialBipartitions()
 {
-  size_t size = bitBipartitionList_.size();
+  size_t size = getNumberOfBipartitions();
   for (size_t i = size; i > 0; i--)
   {
     if (BipartitionList::getPartitionSize(i - 1) < 2)
@@ -580,11 +479,10 @@ void BipartitionList::addTrivialBipartitions(bool checkExisting)
 
 void BipartitionList::sortByPartitionSize()
 {
-  vector<int*> sortedBitBipL;
   vector<IntAndInt> iaiVec;
   IntAndInt iai;
 
-  for (size_t i = 0; i < bitBipartitionList_.size(); i++)
+  for (size_t i = 0; i < getNumberOfBipartitions(); i++)
   {
     iai.ind = i;
     iai.val = static_cast<int>(BipartitionList::getPartitionSize(i));
@@ -593,31 +491,22 @@ void BipartitionList::sortByPartitionSize()
 
   std::sort(iaiVec.begin(), iaiVec.end());
 
-  for (size_t i = 0; i < bitBipartitionList_.size(); i++)
+  vector<size_t> order;
+  for (size_t i = 0; i < iaiVec.size(); i++)
   {
-    sortedBitBipL.push_back(bitBipartitionList_[iaiVec[i].ind]);
+    order.push_back(iaiVec[i].ind);
   }
 
-  bitBipartitionList_ = sortedBitBipL;
+  bitBipartitionList_.permuteRows(order);
 }
 
 /******************************************************************************/
 
 void BipartitionList::flip(size_t k)
 {
-  if (k >= bitBipartitionList_.size())
+  if (k >= getNumberOfBipartitions())
     throw Exception("Bipartition index exceeds BipartitionList size");
-  size_t lword = static_cast<size_t>(BipartitionTools::LWORD);
-  size_t nbword = (elements_.size() + lword - 1) / lword;
-  size_t nbint = nbword * lword / (CHAR_BIT * sizeof(int));
-  int* flipbip = new int[nbint];
-  for (size_t i = 0; i < nbint; i++)
-  {
-    flipbip[i] = 0;
-  }
-  BipartitionTools::bitNot(flipbip, bitBipartitionList_[k], nbint);
-  delete[] bitBipartitionList_[k];
-  bitBipartitionList_[k] = flipbip;
+  bitBipartitionList_.flip(k);
 }
 
 /******************************************************************************/
@@ -629,9 +518,9 @@ void BipartitionList::removeRedundantBipartitions()
   while (deletion)
   {
     deletion = false;
-    for (size_t i = 0; i < bitBipartitionList_.size(); i++)
+    for (size_t i = 0; i < getNumberOfBipartitions(); i++)
     {
-      for (size_t j = i + 1; j < bitBipartitionList_.size(); j++)
+      for (size_t j = i + 1; j < getNumberOfBipartitions(); j++)
       {
         if (BipartitionList::areIdentical(i, j))
         {
@@ -651,11 +540,8 @@ void BipartitionList::removeRedundantBipartitions()
 TreeTemplate<Node>* BipartitionList::toTree() const
 {
   BipartitionList* sortedBipL;
-  vector<int*> sortedBitBipL;
-  int* bip;
   vector<Node*> vecNd, sonNd;
   vector<bool> alive;
-  size_t lword, nbword, nbint, ii;
 
   /* check, copy and prepare bipartition list */
 
@@ -670,17 +556,13 @@ TreeTemplate<Node>* BipartitionList::toTree() const
   }
   sortedBipL->sortByPartitionSize();
   sortedBipL->removeRedundantBipartitions();
-  sortedBitBipL = sortedBipL->getBitBipartitionList();
+  const SplitMatrix& sortedBitBipL = sortedBipL->getSplitMatrix();
 
   for (size_t i = 0; i < sortedBipL->getNumberOfBipartitions(); i++)
   {
     alive.push_back(true);
   }
   vecNd.resize(sortedBipL->getNumberOfBipartitions() + 1);
-  lword  = static_cast<size_t>(BipartitionTools::LWORD);
-  nbword = (elements_.size() + lword - 1) / lword;
-  nbint  = nbword * lword / (CHAR_BIT * sizeof(int));
-  bip    = new int[1]; bip[0] = 0;
 
   /* main loop: create one node per bipartition */
   for (size_t i = 0; i < sortedBipL->getNumberOfBipartitions(); i++)
@@ -689,7 +571,7 @@ TreeTemplate<Node>* BipartitionList::toTree() const
     { // terminal
       for (size_t j = 0; j < sortedBipL->getNumberOfElements(); j++)
       {
-        if (BipartitionTools::testBit(sortedBitBipL[i], static_cast<int>(j)))
+        if (sortedBitBipL.testBit(i, j))
         {
           vecNd[i] = new Node(elements_[j]);
           break;
@@ -701,19 +583,10 @@ TreeTemplate<Node>* BipartitionList::toTree() const
       sonNd.clear();
       for (size_t j = 0; j < i; j++)
       {
-        if (alive[j])
+        if (alive[j] && sortedBitBipL.isSubset(j, sortedBitBipL, i))
         {
-          for (ii = 0; ii < nbint; ii++)
-          {
-            BipartitionTools::bitOr(bip, sortedBitBipL[j] + ii, sortedBitBipL[i] + ii, 1);
-            if (bip[0] != sortedBitBipL[i][ii])
-              break;
-          }
-          if (ii == nbint)
-          {
-            sonNd.push_back(vecNd[j]);
-            alive[j] = false;
-          }
+          sonNd.push_back(vecNd[j]);
+          alive[j] = false;
         }
       }
       vecNd[i] = new Node();
@@ -741,20 +614,17 @@ TreeTemplate<Node>* BipartitionList::toTree() const
 
 /******************************************************************************/
 
-vector<string> BipartitionList::buildBitBipartitions(const Node* nd, vector<int*>& bitbip, const vector<string>& elements, size_t* cpt, vector<int>* index) const
+vector<size_t> BipartitionList::buildBitBipartitions(const Node* nd, SplitMatrix& bitbip, const map<string, size_t>& elementIndexes, size_t* cpt, vector<int>* index) const
 {
-  vector<string> underelements_, retelements_;
+  vector<size_t> underelements_, retelements_;
 
   if (nd->getNumberOfSons() == 0)
-    underelements_.push_back(nd->getName());
+    underelements_.push_back(elementIndexes.at(nd->getName()));
 
   for (size_t i = 0; i < nd->getNumberOfSons(); i++)
   {
-    retelements_ = BipartitionList::buildBitBipartitions(nd->getSon(i), bitbip, elements, cpt, index);
-    for (size_t j = 0; j < retelements_.size(); j++)
-    {
-      underelements_.push_back(retelements_[j]);
-    }
+    retelements_ = BipartitionList::buildBitBipartitions(nd->getSon(i), bitbip, elementIndexes, cpt, index);
+    underelements_.insert(underelements_.end(), retelements_.begin(), retelements_.end());
   }
 
   if (!nd->hasFather())
@@ -768,29 +638,17 @@ vector<string> BipartitionList::buildBitBipartitions(const Node* nd, vector<int*
   }
 
   bool ones;
-  if (underelements_.size() <= elements.size() / 2)
+  if (underelements_.size() <= elementIndexes.size() / 2)
     ones = true;
   else
     ones = false;
 
-  for (size_t i = 0; i < elements.size(); i++)
-  {
-    if (ones)
-      BipartitionTools::bit0(bitbip[*cpt], static_cast<int>(i));
-    else
-      BipartitionTools::bit1(bitbip[*cpt], static_cast<int>(i));
-  }
-
   for (size_t i = 0; i < underelements_.size(); i++)
   {
-    size_t taxa_ind = 0;
-    while (underelements_[i] != elements[taxa_ind])
-      taxa_ind++;
-    if (ones)
-      BipartitionTools::bit1(bitbip[*cpt], static_cast<int>(taxa_ind));
-    else
-      BipartitionTools::bit0(bitbip[*cpt], static_cast<int>(taxa_ind));
+    bitbip.setBit(*cpt, underelements_[i]);
   }
+  if (!ones)
+    bitbip.flip(*cpt);
 
   (*cpt)++;
 
@@ -45,6 +45,7 @@
 #include <Bpp/Numeric/Matrix/Matrix.h>
 #include <Bpp/Utils/MapTools.h>
 
+#include "SplitMatrix.h"
 #include "Tree.h"
 
 // From the STL:
@@ -65,16 +66,16 @@ template<class N> class TreeTemplate;
  * Coding trees this way is useful for comparing topologies, calculating topological distances,
  * producing consensus trees or super-trees, calculating bootstrap support.
  *
- * A BipartitionList includes a set of element names (typically leaf names) and a vector of arrays of bits
- * (int*, not bitsets, are used to allow for dynamic memory allocation). Each array of bit codes for one bipartition.
- * Each bit in an array of bit corresponds to one element, so the order of element names matter.
+ * A BipartitionList includes a set of element names (typically leaf names) and a SplitMatrix, whose rows
+ * of bits (contiguous 64-bit words) code for one bipartition each.
+ * Each bit in a row corresponds to one element, so the order of element names matter.
  * Bits set to zero versus bits set to one define the two partitions of elements.
  * A BipartitionList is called sorted if its elements (leaf names) are in alphabetic order (recommended).
  *
  * BipartitionList objects are typically created from a tree, in which case elements are leaf names.
  * Note that BipartitionList is an unrooted object: a rooted or unrooted versions of the same tree will
  * yield the same BipartitionList in which the root location is ignored. Bipartitions can be accessed as
- * arrays of bits (e.g. getBitBipartition), or as map<string, bool>, in which keys are leaf names and
+ * rows of bits (e.g. getSplitMatrix), or as map<string, bool>, in which keys are leaf names and
  * true/false values define the two partitions (e.g. getBipartition, addBipartition).
  *
  * @see Tree
@@ -85,10 +86,14 @@ class BipartitionList :
   public virtual Clonable
 {
 private:
-  std::vector<int*> bitBipartitionList_;
+  SplitMatrix bitBipartitionList_;
   std::vector<std::string> elements_;
   bool sorted_;
 
+  // int arrays returned by the deprecated getBitBipartitionList.
+  mutable std::vector<int> intBits_;
+  mutable std::vector<int*> intBitBipartitionList_;
+
 public:
   /**
    * @brief The main contructor
@@ -103,6 +108,16 @@ public:
    * @brief An alternative constructor in which elements and bipartitions are passed directly
    *
    * @param elements Leaf names
+   * @param bipl The bit-encoded bipartitions, on the elements
+   */
+  BipartitionList(const std::vector<std::string>& elements, const SplitMatrix& bipl);
+
+  /**
+   * @brief Same with bipartitions as arrays of int (see BipartitionTools::LWORD).
+   *
+   * @deprecated Use the SplitMatrix constructor.
+   *
+   * @param elements Leaf names
    * @param bipl The list of bit-encoded bipartitions
    */
   BipartitionList(const std::vector<std::string>& elements, const std::vector<int*>& bipl);
@@ -126,12 +141,28 @@ public:
 
   const std::vector<std::string>& getElementNames() const { return elements_; }
 
-  size_t getNumberOfBipartitions() const { return bitBipartitionList_.size(); }
+  size_t getNumberOfBipartitions() const { return bitBipartitionList_.getNumberOfRows(); }
 
-  const std::vector<int*>& getBitBipartitionList() const { return bitBipartitionList_; }
+  const SplitMatrix& getSplitMatrix() const { return bitBipartitionList_; }
 
   std::map<std::string, bool> getBipartition(size_t i) const;
 
+  /**
+   * @brief The bipartitions as arrays of int (see BipartitionTools::LWORD).
+   *
+   * The arrays are copies of the split matrix, owned by the list.
+   * They are valid until the next modification of the list or call
+   * to this method, and their changes are not reflected in the list.
+   *
+   * @deprecated Use getSplitMatrix.
+   */
+  const std::vector<int*>& getBitBipartitionList() const;
+
+  /**
+   * @brief Bipartition i as an array of int, as in getBitBipartitionList.
+   *
+   * @deprecated Use getSplitMatrix().getRow(i).
+   */
   int* getBitBipartition(size_t i);
 
   bool haveSameElementsThan(std::map<std::string, bool>& bipart) const;
@@ -216,7 +247,7 @@ public:
   RowMatrix<int> toMatrix() const;
 
 private:
-  std::vector<std::string> buildBitBipartitions(const Node* nd, std::vector<int*>& bitbip, const std::vector<std::string>& elements, size_t* cpt, std::vector<int>* index) const;
+  std::vector<size_t> buildBitBipartitions(const Node* nd, SplitMatrix& bitbip, const std::map<std::string, size_t>& elementIndexes, size_t* cpt, std::vector<int>* index) const;
 };
 } // end of namespace bpp.
 #endif // BPP_PHYL_TREE_BIPARTITIONLIST_H
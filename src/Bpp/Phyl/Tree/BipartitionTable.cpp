@@ -0,0 +1,321 @@
+//
+// File: BipartitionTable.cpp
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Exceptions.h>
+#include <Bpp/Text/TextTools.h>
+
+#include "BipartitionTable.h"
+#include "SplitMatrix.h"
+#include "TreeTemplate.h"
+
+// From the STL:
+#include <algorithm>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+uint64_t BipartitionTable::hash_(const Split& split)
+{
+  uint64_t hash = split.size();
+  for (auto word : split)
+  {
+    // splitmix64 finalizer
+    uint64_t x = hash ^ (word + 0x9E3779B97F4A7C15ULL);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    hash = x ^ (x >> 31);
+  }
+  return hash;
+}
+
+/******************************************************************************/
+
+BipartitionTable::BipartitionTable(const vector<string>& elements) :
+  elements_(elements),
+  elementIndexes_(),
+  occurrences_(),
+  nbTrees_(0)
+{
+  std::sort(elements_.begin(), elements_.end());
+  for (size_t i = 0; i < elements_.size(); i++)
+  {
+    if (!elementIndexes_.emplace(elements_[i], i).second)
+      throw Exception("BipartitionTable::BipartitionTable. Duplicated element: " + elements_[i]);
+  }
+}
+
+/******************************************************************************/
+
+void BipartitionTable::normalize_(Split& split) const
+{
+  if (split.empty() || (split[0] & 1) == 0)
+    return;
+  for (auto& word : split)
+  {
+    word = ~word;
+  }
+  size_t nbLastBits = elements_.size() % 64;
+  if (nbLastBits != 0)
+    split.back() &= (uint64_t(1) << nbLastBits) - 1;
+}
+
+/******************************************************************************/
+
+bool BipartitionTable::isTrivial_(const Split& split) const
+{
+  size_t size = SplitMatrix::countBits(split.data(), split.size());
+  return size < 2 || size + 2 > elements_.size();
+}
+
+/******************************************************************************/
+
+BipartitionTable::Split BipartitionTable::buildSplits_(const Node* node, vector<Split>& splits, vector<const Node*>* nodes) const
+{
+  Split under(getNumberOfWords_(), 0);
+
+  if (node->getNumberOfSons() == 0)
+  {
+    auto it = elementIndexes_.find(node->getName());
+    if (it == elementIndexes_.end())
+      throw Exception("BipartitionTable. Unknown leaf: " + node->getName());
+    under[it->second / 64] |= uint64_t(1) << (it->second % 64);
+  }
+
+  for (size_t i = 0; i < node->getNumberOfSons(); i++)
+  {
+    Split son = buildSplits_(node->getSon(i), splits, nodes);
+    for (size_t j = 0; j < under.size(); j++)
+    {
+      under[j] |= son[j];
+    }
+  }
+
+  // Same edges as BipartitionList: not the root, nor the second son
+  // of a root with two sons.
+  if (!node->hasFather())
+    return under;
+  if (!node->getFather()->hasFather() && node->getFather()->getNumberOfSons() == 2 && node == node->getFather()->getSon(1))
+    return under;
+
+  splits.push_back(under);
+  if (nodes)
+    nodes->push_back(node);
+  return under;
+}
+
+/******************************************************************************/
+
+void BipartitionTable::getSplits_(const Tree& tree, vector<Split>& splits, vector<double>* lengths) const
+{
+  if (tree.getNumberOfLeaves() != elements_.size())
+    throw Exception("BipartitionTable. The tree has " + TextTools::toString(tree.getNumberOfLeaves()) + " leaves, for " + TextTools::toString(elements_.size()) + " elements.");
+
+  vector<const Node*> nodes;
+  const TreeTemplate<Node>* ttree = dynamic_cast<const TreeTemplate<Node>*>(&tree);
+  unique_ptr< TreeTemplate<Node> > tmp;
+  if (!ttree)
+  {
+    tmp.reset(new TreeTemplate<Node>(tree));
+    ttree = tmp.get();
+  }
+  buildSplits_(ttree->getRootNode(), splits, lengths ? &nodes : 0);
+
+  if (lengths)
+  {
+    lengths->resize(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+      const Node* node = nodes[i];
+      double length = node->hasDistanceToFather() ? node->getDistanceToFather() : 0.;
+      // The second son of a root with two sons is on the same edge.
+      const Node* father = node->getFather();
+      if (!father->hasFather() && father->getNumberOfSons() == 2 && father->getSon(1)->hasDistanceToFather())
+        length += father->getSon(1)->getDistanceToFather();
+      (*lengths)[i] = length;
+    }
+  }
+}
+
+/******************************************************************************/
+
+void BipartitionTable::addTree(const Tree& tree)
+{
+  vector<Split> splits;
+  getSplits_(tree, splits, 0);
+
+  for (size_t i = 0; i < splits.size(); i++)
+  {
+    normalize_(splits[i]);
+    if (isTrivial_(splits[i]))
+      continue;
+    auto& occurrences = occurrences_.emplace(std::move(splits[i]), Occurrences{0, 0, 0}).first->second;
+    // Count each bipartition once per tree
+    if (occurrences.count == 0 || occurrences.lastTree != nbTrees_)
+      occurrences.count++;
+    occurrences.lastTree = nbTrees_;
+    occurrences.lastPosition = i;
+  }
+  nbTrees_++;
+}
+
+/******************************************************************************/
+
+void BipartitionTable::getSplitHashes(const Tree& tree, vector<uint64_t>& hashes, vector<double>* lengths) const
+{
+  vector<Split> splits;
+  vector<double> splitLengths;
+  getSplits_(tree, splits, lengths ? &splitLengths : 0);
+
+  vector< pair<uint64_t, double> > signature;
+  signature.reserve(splits.size());
+  for (size_t i = 0; i < splits.size(); i++)
+  {
+    normalize_(splits[i]);
+    if (isTrivial_(splits[i]))
+      continue;
+    signature.push_back(make_pair(hash_(splits[i]), lengths ? splitLengths[i] : 0.));
+  }
+  std::sort(signature.begin(), signature.end());
+
+  hashes.resize(signature.size());
+  for (size_t i = 0; i < signature.size(); i++)
+  {
+    hashes[i] = signature[i].first;
+  }
+  if (lengths)
+  {
+    lengths->resize(signature.size());
+    for (size_t i = 0; i < signature.size(); i++)
+    {
+      (*lengths)[i] = signature[i].second;
+    }
+  }
+}
+
+/******************************************************************************/
+
+void BipartitionTable::merge(const BipartitionTable& table)
+{
+  if (table.elements_ != elements_)
+    throw Exception("BipartitionTable::merge. Distinct bipartition element sets");
+
+  for (const auto& it : table.occurrences_)
+  {
+    auto& occurrences = occurrences_.emplace(it.first, Occurrences{0, 0, 0}).first->second;
+    occurrences.count += it.second.count;
+    occurrences.lastTree = nbTrees_ + it.second.lastTree;
+    occurrences.lastPosition = it.second.lastPosition;
+  }
+  nbTrees_ += table.nbTrees_;
+}
+
+/******************************************************************************/
+
+BipartitionTable::Split BipartitionTable::getSplit(const BipartitionList& bipartitions, size_t i) const
+{
+  if (i >= bipartitions.getNumberOfBipartitions())
+    throw Exception("BipartitionTable::getSplit. Bipartition index exceeds BipartitionList size");
+
+  const auto& names = bipartitions.getElementNames();
+  const SplitMatrix& matrix = bipartitions.getSplitMatrix();
+  Split split(getNumberOfWords_(), 0);
+  if (names == elements_)
+  {
+    // Same element order: the row words are the split words.
+    std::copy(matrix.getRow(i), matrix.getRow(i) + split.size(), split.begin());
+  }
+  else
+  {
+    for (size_t j = 0; j < names.size(); j++)
+    {
+      auto it = elementIndexes_.find(names[j]);
+      if (it == elementIndexes_.end())
+        throw Exception("BipartitionTable::getSplit. Unknown element: " + names[j]);
+      if (matrix.testBit(i, j))
+        split[it->second / 64] |= uint64_t(1) << (it->second % 64);
+    }
+  }
+  normalize_(split);
+  return split;
+}
+
+/******************************************************************************/
+
+size_t BipartitionTable::getNumberOfOccurrences(const Split& split) const
+{
+  if (isTrivial_(split))
+    return nbTrees_;
+  auto it = occurrences_.find(split);
+  return it == occurrences_.end() ? 0 : it->second.count;
+}
+
+/******************************************************************************/
+
+BipartitionList* BipartitionTable::toBipartitionList(vector<size_t>& bipScore) const
+{
+  vector<const pair<const Split, Occurrences>*> sorted;
+  sorted.reserve(occurrences_.size());
+  for (const auto& it : occurrences_)
+  {
+    sorted.push_back(&it);
+  }
+  std::sort(sorted.begin(), sorted.end(), [](const pair<const Split, Occurrences>* a, const pair<const Split, Occurrences>* b) {
+      return a->second.lastTree < b->second.lastTree
+             || (a->second.lastTree == b->second.lastTree && a->second.lastPosition < b->second.lastPosition);
+    });
+
+  // Same layout as BipartitionList: the smaller side set.
+  SplitMatrix bitBipL(elements_.size());
+  bipScore.clear();
+  for (const auto* it : sorted)
+  {
+    const Split& split = it->first;
+    size_t row = bitBipL.addRow();
+    std::copy(split.begin(), split.end(), bitBipL.getRow(row));
+    if (2 * bitBipL.countBits(row) > elements_.size())
+      bitBipL.flip(row);
+    bipScore.push_back(it->second.count);
+  }
+
+  return new BipartitionList(elements_, bitBipL);
+}
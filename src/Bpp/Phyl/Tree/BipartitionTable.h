@@ -0,0 +1,186 @@
+//
+// File: BipartitionTable.h
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef BPP_PHYL_TREE_BIPARTITIONTABLE_H
+#define BPP_PHYL_TREE_BIPARTITIONTABLE_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "BipartitionList.h"
+
+namespace bpp
+{
+/**
+ * @brief Number of occurrences of the bipartitions of a set of trees.
+ *
+ * A bipartition is stored as a bit vector on the sorted element
+ * names, normalized so that the first element is never in the set
+ * part: a bipartition and its complement have the same
+ * representation. The bit vectors are hashed on 64 bits, so adding a
+ * tree with n leaves costs O(n^2/64), and the count of a bipartition
+ * is found in constant time, whatever the number of trees.
+ *
+ * Trees are added one by one. Tables built on different subsets of
+ * trees (for example on different threads) can be merged.
+ *
+ * Trivial bipartitions (less than two elements on a side) are not
+ * stored: they occur in all the trees.
+ *
+ * @see TreeTools::bipartitionOccurrences
+ */
+class BipartitionTable
+{
+public:
+  /**
+   * @brief Normalized bipartition, bit i for element i.
+   */
+  typedef std::vector<uint64_t> Split;
+
+private:
+  struct SplitHash
+  {
+    size_t operator()(const Split& split) const { return static_cast<size_t>(hash_(split)); }
+  };
+
+  struct Occurrences
+  {
+    size_t count;
+    size_t lastTree;     // To keep the order of the trees:
+    size_t lastPosition; // see toBipartitionList.
+  };
+
+  std::vector<std::string> elements_;
+  std::unordered_map<std::string, size_t> elementIndexes_;
+  std::unordered_map<Split, Occurrences, SplitHash> occurrences_;
+  size_t nbTrees_;
+
+public:
+  /**
+   * @param elements The leaf names of the trees (sorted in the table).
+   */
+  BipartitionTable(const std::vector<std::string>& elements);
+
+public:
+  size_t getNumberOfElements() const { return elements_.size(); }
+
+  const std::vector<std::string>& getElementNames() const { return elements_; }
+
+  size_t getNumberOfTrees() const { return nbTrees_; }
+
+  /**
+   * @return The number of distinct non trivial bipartitions.
+   */
+  size_t getNumberOfBipartitions() const { return occurrences_.size(); }
+
+  /**
+   * @brief Count the bipartitions of a tree.
+   *
+   * @throw Exception If the leaves of the tree are not the elements.
+   */
+  void addTree(const Tree& tree);
+
+  /**
+   * @brief Add the counts of another table, as if its trees were
+   * added after the trees of this one.
+   *
+   * @throw Exception If the tables have different elements.
+   */
+  void merge(const BipartitionTable& table);
+
+  /**
+   * @brief Normalized bipartition i of a BipartitionList on the
+   * same elements.
+   */
+  Split getSplit(const BipartitionList& bipartitions, size_t i) const;
+
+  /**
+   * @return The number of trees with this bipartition.
+   */
+  size_t getNumberOfOccurrences(const Split& split) const;
+
+  /**
+   * @brief The distinct non trivial bipartitions, and their number of
+   * occurrences in bipScore.
+   *
+   * They are ordered by last occurrence in the trees (in the order
+   * of addition), as TreeTools::bipartitionOccurrences did.
+   */
+  BipartitionList* toBipartitionList(std::vector<size_t>& bipScore) const;
+
+  /**
+   * @brief The 64 bits hashes of the non trivial bipartitions of a
+   * tree, in increasing order, and the lengths of their branches if
+   * lengths is not null.
+   *
+   * This signature takes O(n) memory for n leaves: two trees can be
+   * compared by a merge of their hashes (see
+   * TreeTools::robinsonFouldsDistances). The tree is not added to
+   * the table.
+   *
+   * @throw Exception If the leaves of the tree are not the elements.
+   */
+  void getSplitHashes(const Tree& tree, std::vector<uint64_t>& hashes, std::vector<double>* lengths = 0) const;
+
+private:
+  size_t getNumberOfWords_() const { return (elements_.size() + 63) / 64; }
+
+  static uint64_t hash_(const Split& split);
+
+  void normalize_(Split& split) const;
+
+  bool isTrivial_(const Split& split) const;
+
+  /**
+   * @brief Split of the leaves under a node, the splits of the edges
+   * below being added to splits, in the order of BipartitionList,
+   * and their lower nodes to nodes if not null.
+   */
+  Split buildSplits_(const Node* node, std::vector<Split>& splits, std::vector<const Node*>* nodes = 0) const;
+
+  /**
+   * @brief Splits of a tree, checked against the elements.
+   */
+  void getSplits_(const Tree& tree, std::vector<Split>& splits, std::vector<double>* lengths) const;
+};
+} // end of namespace bpp.
+#endif // BPP_PHYL_TREE_BIPARTITIONTABLE_H
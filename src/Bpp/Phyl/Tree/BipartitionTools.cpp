@@ -129,9 +129,6 @@ BipartitionList* BipartitionTools::buildBipartitionPair(
   const BipartitionList& bipartL2, size_t i2,
   bool checkElements)
 {
-  vector<int*> bitBipL1, bitBipL2, twoBitBipL;
-  vector<string> elements;
-
   if (i1 >= bipartL1.getNumberOfBipartitions())
     throw Exception("Bipartition index exceeds BipartitionList size");
   if (i2 >= bipartL2.getNumberOfBipartitions())
@@ -140,38 +137,22 @@ BipartitionList* BipartitionTools::buildBipartitionPair(
   if (checkElements && !VectorTools::haveSameElements(bipartL1.getElementNames(), bipartL2.getElementNames()))
     throw Exception("Distinct bipartition element sets");
 
-  /* get sorted bit bipartition lists */
+  /* get sorted split matrices */
   /* (if input is sorted: easy; otherwise: first copy, then sort) */
 
-  if (bipartL1.isSorted())
-  {
-    elements = bipartL1.getElementNames();
-    bitBipL1 = bipartL1.getBitBipartitionList();
-  }
-  else
-  {
-    BipartitionList provBipartL(bipartL1.getElementNames(), bipartL1.getBitBipartitionList());
-    provBipartL.sortElements();
-    elements = provBipartL.getElementNames();
-    bitBipL1 = provBipartL.getBitBipartitionList();
-  }
-
-  if (bipartL2.isSorted())
-  {
-    bitBipL2 = bipartL2.getBitBipartitionList();
-  }
-  else
-  {
-    BipartitionList provBipartL(bipartL2.getElementNames(), bipartL2.getBitBipartitionList());
-    provBipartL.sortElements();
-    bitBipL2 = provBipartL.getBitBipartitionList();
-  }
+  BipartitionList sortedBipartL1(bipartL1);
+  if (!sortedBipartL1.isSorted())
+    sortedBipartL1.sortElements();
+  BipartitionList sortedBipartL2(bipartL2);
+  if (!sortedBipartL2.isSorted())
+    sortedBipartL2.sortElements();
 
   /* create a new BipartitionList with just the two focal bipartitions */
 
-  twoBitBipL.push_back(bitBipL1[i1]);
-  twoBitBipL.push_back(bitBipL2[i2]);
-  BipartitionList* twoBipL = new BipartitionList(elements, twoBitBipL);
+  SplitMatrix twoBitBipL(sortedBipartL1.getNumberOfElements());
+  twoBitBipL.addRow(sortedBipartL1.getSplitMatrix(), i1);
+  twoBitBipL.addRow(sortedBipartL2.getSplitMatrix(), i2);
+  BipartitionList* twoBipL = new BipartitionList(sortedBipartL1.getElementNames(), twoBitBipL);
   return twoBipL;
 }
 
@@ -182,6 +163,15 @@ bool BipartitionTools::areIdentical(
   const BipartitionList& bipartL2, size_t i2,
   bool checkElements)
 {
+  if (bipartL1.getElementNames() == bipartL2.getElementNames())
+  {
+    // Same element order: compare the rows directly.
+    if (i1 >= bipartL1.getNumberOfBipartitions())
+      throw Exception("Bipartition index exceeds BipartitionList size");
+    if (i2 >= bipartL2.getNumberOfBipartitions())
+      throw Exception("Bipartition index exceeds BipartitionList size");
+    return bipartL1.getSplitMatrix().areIdentical(i1, bipartL2.getSplitMatrix(), i2);
+  }
   BipartitionList* twoBipL = buildBipartitionPair(bipartL1, i1, bipartL2, i2, checkElements);
   bool test = twoBipL->areIdentical(0, 1);
   delete twoBipL;
@@ -195,6 +185,15 @@ bool BipartitionTools::areCompatible(
   const BipartitionList& bipartL2, size_t i2,
   bool checkElements)
 {
+  if (bipartL1.getElementNames() == bipartL2.getElementNames())
+  {
+    // Same element order: compare the rows directly.
+    if (i1 >= bipartL1.getNumberOfBipartitions())
+      throw Exception("Bipartition index exceeds BipartitionList size");
+    if (i2 >= bipartL2.getNumberOfBipartitions())
+      throw Exception("Bipartition index exceeds BipartitionList size");
+    return bipartL1.getSplitMatrix().areCompatible(i1, bipartL2.getSplitMatrix(), i2);
+  }
   BipartitionList* twoBipL = buildBipartitionPair(bipartL1, i1, bipartL2, i2, checkElements);
   bool test = twoBipL->areCompatible(0, 1);
   delete twoBipL;
@@ -208,9 +207,6 @@ BipartitionList* BipartitionTools::mergeBipartitionLists(
   bool checkElements)
 {
   vector<string> elements;
-  vector<int*> mergedBitBipL;
-  int* provBitBip;
-  BipartitionList* mergedBipL;
 
   if (vecBipartL.size() == 0)
     throw Exception("Empty vector passed");
@@ -219,47 +215,39 @@ BipartitionList* BipartitionTools::mergeBipartitionLists(
   {
     for (size_t i = 1; i < vecBipartL.size(); ++i)
     {
-      if (!VectorTools::haveSameElements(vecBipartL[0]->getElementNames(), vecBipartL[0]->getElementNames()))
+      if (!VectorTools::haveSameElements(vecBipartL[0]->getElementNames(), vecBipartL[i]->getElementNames()))
         throw Exception("BipartitionTools::mergeBipartitionLists. Distinct bipartition element sets");
     }
   }
 
-  size_t lword  = static_cast<size_t>(BipartitionTools::LWORD);
-  size_t nbword = (vecBipartL[0]->getElementNames().size() + lword - 1) / lword;
-  size_t nbint  = nbword * lword / (CHAR_BIT * sizeof(int));
-
   elements = vecBipartL[0]->getElementNames();
   if (!vecBipartL[0]->isSorted())
     std::sort(elements.begin(), elements.end());
 
+  SplitMatrix mergedBitBipL(elements.size());
   for (size_t i = 0; i < vecBipartL.size(); i++)
   {
-    vector<int*> bitBipL;
     if (vecBipartL[i]->isSorted())
     {
-      bitBipL = vecBipartL[i]->getBitBipartitionList();
+      const SplitMatrix& bitBipL = vecBipartL[i]->getSplitMatrix();
+      for (size_t j = 0; j < bitBipL.getNumberOfRows(); j++)
+      {
+        mergedBitBipL.addRow(bitBipL, j);
+      }
     }
     else
     {
-      // We don't need the extra recopy here, do we?
-      // BipartitionList provBipartL(BipartitionList(vecBipartL[i]->getElementNames(), vecBipartL[i]->getBitBipartitionList()));
-      BipartitionList provBipartL(vecBipartL[i]->getElementNames(), vecBipartL[i]->getBitBipartitionList());
+      BipartitionList provBipartL(*vecBipartL[i]);
       provBipartL.sortElements();
-      bitBipL = provBipartL.getBitBipartitionList();
-    }
-    for (size_t j = 0; j < bitBipL.size(); j++)
-    {
-      provBitBip = new int[nbint];
-      for (size_t k = 0; k < nbint; k++)
+      const SplitMatrix& bitBipL = provBipartL.getSplitMatrix();
+      for (size_t j = 0; j < bitBipL.getNumberOfRows(); j++)
       {
-        provBitBip[k] = bitBipL[j][k];
+        mergedBitBipL.addRow(bitBipL, j);
       }
-      mergedBitBipL.push_back(provBitBip);
     }
   }
 
-  mergedBipL = new BipartitionList(elements, mergedBitBipL);
-  return mergedBipL;
+  return new BipartitionList(elements, mergedBitBipL);
 }
 
 /******************************************************************************/
@@ -268,8 +256,6 @@ VectorSiteContainer* BipartitionTools::MRPEncode(
   const vector<BipartitionList*>& vecBipartL)
 {
   vector<string> all_elements;
-  map<string, bool> bip;
-  vector<string> bip_elements;
   const DNA* alpha = &AlphabetTools::DNA_ALPHABET;
   vector<string> sequences;
 
@@ -277,34 +263,43 @@ VectorSiteContainer* BipartitionTools::MRPEncode(
     throw Exception("Empty vector passed");
 
   vector< vector<string> > vecElementLists;
+  size_t nbBipartitions = 0;
   for (size_t i = 0; i < vecBipartL.size(); i++)
   {
     vecElementLists.push_back(vecBipartL[i]->getElementNames());
+    nbBipartitions += vecBipartL[i]->getNumberOfBipartitions();
   }
 
   all_elements = VectorTools::vectorUnion(vecElementLists);
 
-  sequences.resize(all_elements.size());
+  map<string, size_t> allElementIndexes;
+  for (size_t k = 0; k < all_elements.size(); k++)
+  {
+    allElementIndexes[all_elements[k]] = k;
+  }
+
+  // Elements missing from a list are coded as unknown; the others are then
+  // read directly from the split matrix rows.
+  sequences.assign(all_elements.size(), string(nbBipartitions, 'N'));
 
+  size_t site = 0;
   for (size_t i = 0; i < vecBipartL.size(); i++)
   {
-    for (size_t j = 0; j < vecBipartL[i]->getNumberOfBipartitions(); j++)
+    const vector<string>& elements = vecBipartL[i]->getElementNames();
+    const SplitMatrix& bitBipL = vecBipartL[i]->getSplitMatrix();
+    vector<size_t> positions(elements.size());
+    for (size_t k = 0; k < elements.size(); k++)
     {
-      bip = vecBipartL[i]->getBipartition(j);
-      bip_elements = MapTools::getKeys(bip);
+      positions[k] = allElementIndexes[elements[k]];
+    }
 
-      for (size_t k = 0; k < all_elements.size(); k++)
+    for (size_t j = 0; j < bitBipL.getNumberOfRows(); j++)
+    {
+      for (size_t k = 0; k < elements.size(); k++)
       {
-        if (VectorTools::contains(bip_elements, all_elements[k]))
-        {
-          if (bip[all_elements[k]])
-            sequences[k].push_back('C');
-          else
-            sequences[k].push_back('A');
-        }
-        else
-          sequences[k].push_back('N');
+        sequences[positions[k]][site] = bitBipL.testBit(j, k) ? 'C' : 'A';
       }
+      site++;
     }
   }
 
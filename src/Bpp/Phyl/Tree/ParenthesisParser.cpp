@@ -0,0 +1,207 @@
+//
+// File: ParenthesisParser.cpp
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Exceptions.h>
+#include <Bpp/Text/TextTools.h>
+
+#include "ParenthesisParser.h"
+
+using namespace bpp;
+using namespace std;
+
+namespace
+{
+bool isBlank(char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+string strip(const string& s)
+{
+  size_t first = 0;
+  while (first < s.size() && isBlank(s[first]))
+  {
+    first++;
+  }
+  size_t last = s.size();
+  while (last > first && isBlank(s[last - 1]))
+  {
+    last--;
+  }
+  return s.substr(first, last - first);
+}
+} // namespace
+
+/******************************************************************************/
+
+const char* ParenthesisParser::skipBrackets_(const char* p, const char* end)
+{
+  while (p < end && *p != ']')
+  {
+    p++;
+  }
+  if (p == end)
+    throw IOException("ParenthesisParser. Unclosed bracket in tree description.");
+  return p;
+}
+
+/******************************************************************************/
+
+const char* ParenthesisParser::findEnd(const char* begin, const char* end) const
+{
+  for (const char* p = begin; p < end; p++)
+  {
+    if (*p == ';')
+      return p;
+    if (*p == '[' && skipComments_)
+    {
+      for (p++; p < end && *p != ']'; p++)
+      {}
+      if (p == end)
+        return end;
+    }
+  }
+  return end;
+}
+
+/******************************************************************************/
+
+bool ParenthesisParser::readDescription(istream& in, string& description) const
+{
+  description.clear();
+  string part;
+  while (getline(in, part, ';'))
+  {
+    description += part;
+    if (in.eof())
+      return false; // No semicolon.
+    description += ';';
+    // A semicolon in a comment does not end the description:
+    if (!skipComments_ || findEnd(description.data(), description.data() + description.size()) < description.data() + description.size())
+      return true;
+  }
+  return false;
+}
+
+/******************************************************************************/
+
+const char* ParenthesisParser::readTail_(const char* p, const char* end, string& label, string& length, string& annotation) const
+{
+  static const string nhxTag = "&&NHX:";
+  string text;
+  annotation.clear();
+  for ( ; p < end && *p != ',' && *p != ')' && *p != ';' && *p != '('; p++)
+  {
+    if (*p == '[' && skipComments_)
+    {
+      const char* closing = skipBrackets_(p, end);
+      if (readAnnotations_ && static_cast<size_t>(closing - p - 1) >= nhxTag.size() && nhxTag.compare(0, nhxTag.size(), p + 1, nhxTag.size()) == 0)
+        annotation.assign(p + 1 + nhxTag.size(), closing);
+      p = closing;
+    }
+    else if (*p != '\n' && *p != '\r')
+      text += *p;
+  }
+
+  size_t colon = text.rfind(':');
+  if (colon == string::npos)
+  {
+    label = strip(text);
+    length.clear();
+  }
+  else
+  {
+    label = strip(text.substr(0, colon));
+    length = strip(text.substr(colon + 1));
+  }
+  annotation = strip(annotation);
+  return p;
+}
+
+/******************************************************************************/
+
+const char* ParenthesisParser::parse(const char* begin, const char* end, Handler& handler) const
+{
+  string label, length, annotation;
+  size_t depth = 0; // Number of started internal nodes which are not complete.
+  const char* p = begin;
+  while (true)
+  {
+    // A new node, internal or leaf:
+    handler.startNode();
+    for ( ; p < end && (isBlank(*p) || (*p == '[' && skipComments_)); p++)
+    {
+      if (*p == '[')
+        p = skipBrackets_(p, end);
+    }
+    if (p < end && *p == '(')
+    {
+      depth++;
+      p++;
+      continue; // Its first son.
+    }
+    p = readTail_(p, end, label, length, annotation);
+    handler.endNode(label, length, annotation, true);
+
+    // Complete the internal nodes, until the next son or the end of the tree:
+    while (true)
+    {
+      for ( ; p < end && isBlank(*p); p++)
+      {}
+      if (p == end)
+        throw IOException("ParenthesisParser::parse. Bad format: no semi-colon found.");
+      if (*p == ',' && depth > 0)
+      {
+        p++;
+        break;
+      }
+      else if (*p == ')' && depth > 0)
+      {
+        depth--;
+        p = readTail_(p + 1, end, label, length, annotation);
+        handler.endNode(label, length, annotation, false);
+      }
+      else if (*p == ';' && depth == 0)
+        return p + 1;
+      else
+        throw IOException("ParenthesisParser::parse. Bad format: unexpected '" + string(1, *p) + "' at position " + TextTools::toString(p - begin) + ".");
+    }
+  }
+}
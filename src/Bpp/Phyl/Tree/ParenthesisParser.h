@@ -0,0 +1,163 @@
+//
+// File: ParenthesisParser.h
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef BPP_PHYL_TREE_PARENTHESISPARSER_H
+#define BPP_PHYL_TREE_PARENTHESISPARSER_H
+
+#include <iostream>
+#include <string>
+
+namespace bpp
+{
+/**
+ * @brief Single pass parser of tree descriptions in the parenthesis format.
+ *
+ * A node is described as
+ * @code
+ * (son1,son2,...)label:length[&&NHX:annotation]
+ * @endcode
+ * for internal nodes, and as name:length[&&NHX:annotation] for
+ * leaves, each part being optional. The description of a tree ends
+ * with a semicolon.
+ *
+ * The text is read once from left to right, without recursion and
+ * without copying the subtrees, so that deep trees (caterpillars)
+ * are read in linear time too. The text can be in any buffer, from
+ * a string or a memory-mapped file.
+ *
+ * The parser does not build the nodes itself: it tells a Handler
+ * when a node starts (in prefix order, sons after their father) and
+ * when it is complete (in postfix order), so that TreeTemplate and
+ * PhyloTree objects are both built directly.
+ *
+ * Line breaks are ignored. Text between brackets is either skipped
+ * (comments), read as annotation ([&&NHX:...]) or kept as part of
+ * the labels, depending on the options.
+ */
+class ParenthesisParser
+{
+public:
+  class Handler
+  {
+public:
+    virtual ~Handler() {}
+
+    /**
+     * @brief A new node, son of the last started and not complete
+     * node, or root of the tree if there is none.
+     */
+    virtual void startNode() = 0;
+
+    /**
+     * @brief The last started node is complete.
+     *
+     * @param label The name of a leaf, or the text after the closing
+     * parenthesis of an internal node (bootstrap value, id...).
+     * @param length The text of the branch length.
+     * @param annotation The text of the NHX annotation, without its
+     * '[&&NHX:' and ']' delimiters.
+     * @param isLeaf Tells if the node has no son.
+     *
+     * All texts are stripped of surrounding white spaces, and empty
+     * when they are absent.
+     */
+    virtual void endNode(const std::string& label, const std::string& length, const std::string& annotation, bool isLeaf) = 0;
+  };
+
+private:
+  bool skipComments_;
+  bool readAnnotations_;
+
+public:
+  /**
+   * @param skipComments Tells if text between brackets should be ignored.
+   * @param readAnnotations Tells if [&&NHX:...] annotations should be read
+   * (other bracketed texts are then comments).
+   */
+  ParenthesisParser(bool skipComments = false, bool readAnnotations = false) :
+    skipComments_(skipComments || readAnnotations),
+    readAnnotations_(readAnnotations) {}
+
+public:
+  /**
+   * @brief Parse the description of one tree.
+   *
+   * @param begin The beginning of the description.
+   * @param end The end of the buffer.
+   * @param handler The handler building the tree.
+   * @return A pointer to the character after the semicolon ending the description.
+   * @throw IOException If the description is not well formed, or has no semicolon.
+   */
+  const char* parse(const char* begin, const char* end, Handler& handler) const;
+
+  /**
+   * @brief Find the end of the next tree description.
+   *
+   * Skipped comments are taken into account, so that a semicolon
+   * within a comment does not end a description.
+   *
+   * @return A pointer to the next semicolon ending a description, or end if there is none.
+   */
+  const char* findEnd(const char* begin, const char* end) const;
+
+  /**
+   * @brief Read the next tree description from a stream.
+   *
+   * Characters are read up to the semicolon ending the description,
+   * which is included in description.
+   *
+   * @return false if the stream ends before a semicolon.
+   */
+  bool readDescription(std::istream& in, std::string& description) const;
+
+private:
+  /**
+   * @brief Read a label, length and annotation, until the next
+   * ',', ')' or ';' character.
+   */
+  const char* readTail_(const char* p, const char* end, std::string& label, std::string& length, std::string& annotation) const;
+
+  /**
+   * @return A pointer to the closing bracket of the bracketed text at p.
+   */
+  static const char* skipBrackets_(const char* p, const char* end);
+};
+} // end of namespace bpp.
+#endif // BPP_PHYL_TREE_PARENTHESISPARSER_H
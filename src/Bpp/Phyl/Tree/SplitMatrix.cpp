@@ -0,0 +1,208 @@
+//
+// File: SplitMatrix.cpp
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Exceptions.h>
+
+#include "SplitMatrix.h"
+
+// From the STL:
+#include <algorithm>
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+SplitMatrix::SplitMatrix(size_t nbElements, size_t nbRows) :
+  nbElements_(nbElements),
+  nbWords_(2 * ((nbElements + 127) / 128)),
+  nbRows_(nbRows),
+  words_(nbWords_ * nbRows, 0)
+{}
+
+/******************************************************************************/
+
+size_t SplitMatrix::addRow()
+{
+  words_.resize(words_.size() + nbWords_, 0);
+  return nbRows_++;
+}
+
+/******************************************************************************/
+
+size_t SplitMatrix::addRow(const SplitMatrix& matrix, size_t i)
+{
+  if (matrix.nbElements_ != nbElements_)
+    throw Exception("SplitMatrix::addRow. Distinct numbers of elements.");
+  words_.insert(words_.end(), matrix.getRow(i), matrix.getRow(i) + nbWords_);
+  return nbRows_++;
+}
+
+/******************************************************************************/
+
+void SplitMatrix::deleteRow(size_t i)
+{
+  if (i >= nbRows_)
+    throw Exception("SplitMatrix::deleteRow. Row index exceeds SplitMatrix size");
+  auto first = words_.begin() + static_cast<ptrdiff_t>(i * nbWords_);
+  words_.erase(first, first + static_cast<ptrdiff_t>(nbWords_));
+  nbRows_--;
+}
+
+/******************************************************************************/
+
+void SplitMatrix::permuteRows(const vector<size_t>& order)
+{
+  vector<uint64_t> words(order.size() * nbWords_);
+  for (size_t k = 0; k < order.size(); k++)
+  {
+    const uint64_t* row = getRow(order[k]);
+    std::copy(row, row + nbWords_, words.begin() + static_cast<ptrdiff_t>(k * nbWords_));
+  }
+  words_.swap(words);
+  nbRows_ = order.size();
+}
+
+/******************************************************************************/
+
+void SplitMatrix::flip(size_t i)
+{
+  uint64_t* row = getRow(i);
+  for (size_t w = 0; w < nbWords_; w++)
+  {
+    row[w] = ~row[w] & getMask_(w);
+  }
+}
+
+/******************************************************************************/
+
+size_t SplitMatrix::countBits(size_t i) const
+{
+  return countBits(getRow(i), nbWords_);
+}
+
+/******************************************************************************/
+
+bool SplitMatrix::isSubset(size_t i, const SplitMatrix& matrix, size_t k) const
+{
+  const uint64_t* row1 = getRow(i);
+  const uint64_t* row2 = matrix.getRow(k);
+  uint64_t outside = 0;
+  for (size_t w = 0; w < nbWords_; w++)
+  {
+    outside |= row1[w] & ~row2[w];
+  }
+  return outside == 0;
+}
+
+/******************************************************************************/
+
+bool SplitMatrix::areIdentical(size_t i, const SplitMatrix& matrix, size_t k) const
+{
+  const uint64_t* row1 = getRow(i);
+  const uint64_t* row2 = matrix.getRow(k);
+  uint64_t same = 0, complement = 0;
+  for (size_t w = 0; w < nbWords_; w++)
+  {
+    uint64_t diff = row1[w] ^ row2[w];
+    same |= diff;
+    complement |= diff ^ getMask_(w);
+  }
+  return same == 0 || complement == 0;
+}
+
+/******************************************************************************/
+
+bool SplitMatrix::areCompatible(size_t i, const SplitMatrix& matrix, size_t k) const
+{
+  const uint64_t* row1 = getRow(i);
+  const uint64_t* row2 = matrix.getRow(k);
+  uint64_t uu = 0, uz = 0, zu = 0, zz = 0;
+  for (size_t w = 0; w < nbWords_; w++)
+  {
+    uu |= row1[w] & row2[w];
+    uz |= row1[w] & ~row2[w];
+    zu |= ~row1[w] & row2[w];
+    zz |= ~(row1[w] | row2[w]) & getMask_(w);
+  }
+  return uu == 0 || uz == 0 || zu == 0 || zz == 0;
+}
+
+/******************************************************************************/
+
+void SplitMatrix::bitAnd(uint64_t* result, const uint64_t* words1, const uint64_t* words2, size_t nbWords)
+{
+  for (size_t w = 0; w < nbWords; w++)
+  {
+    result[w] = words1[w] & words2[w];
+  }
+}
+
+/******************************************************************************/
+
+void SplitMatrix::bitOr(uint64_t* result, const uint64_t* words1, const uint64_t* words2, size_t nbWords)
+{
+  for (size_t w = 0; w < nbWords; w++)
+  {
+    result[w] = words1[w] | words2[w];
+  }
+}
+
+/******************************************************************************/
+
+void SplitMatrix::bitXor(uint64_t* result, const uint64_t* words1, const uint64_t* words2, size_t nbWords)
+{
+  for (size_t w = 0; w < nbWords; w++)
+  {
+    result[w] = words1[w] ^ words2[w];
+  }
+}
+
+/******************************************************************************/
+
+size_t SplitMatrix::countBits(const uint64_t* words, size_t nbWords)
+{
+  size_t count = 0;
+  for (size_t w = 0; w < nbWords; w++)
+  {
+    count += popcount(words[w]);
+  }
+  return count;
+}
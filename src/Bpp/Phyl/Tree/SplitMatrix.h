@@ -0,0 +1,184 @@
+//
+// File: SplitMatrix.h
+// Authors:
+//   Bio++ Development Team
+// Created: 2026-10-17 00:00:00
+//
+
+/*
+  Copyright or ÃÂ© or Copr. Bio++ Development Team, (November 16, 2004)
+  
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+  
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+  
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+  
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+  
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef BPP_PHYL_TREE_SPLITMATRIX_H
+#define BPP_PHYL_TREE_SPLITMATRIX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bpp
+{
+/**
+ * @brief Bipartitions of a set of elements, as rows of bits.
+ *
+ * Bit j of row i tells on which side of bipartition i element j is.
+ * All the rows are stored in one contiguous array of 64-bit words.
+ * Rows are padded to an even number of words, so that they are all
+ * 16 bytes aligned, and the padding bits are always zero.
+ *
+ * The operations on rows are plain loops on words, without branches,
+ * that the compiler can vectorize.
+ *
+ * @see BipartitionList
+ */
+class SplitMatrix
+{
+private:
+  size_t nbElements_;
+  size_t nbWords_;
+  size_t nbRows_;
+  std::vector<uint64_t> words_;
+
+public:
+  explicit SplitMatrix(size_t nbElements = 0, size_t nbRows = 0);
+
+public:
+  size_t getNumberOfElements() const { return nbElements_; }
+
+  size_t getNumberOfRows() const { return nbRows_; }
+
+  /**
+   * @return The number of words of a row, including padding.
+   */
+  size_t getNumberOfWords() const { return nbWords_; }
+
+  uint64_t* getRow(size_t i) { return words_.data() + i * nbWords_; }
+
+  const uint64_t* getRow(size_t i) const { return words_.data() + i * nbWords_; }
+
+  bool testBit(size_t i, size_t j) const
+  {
+    return (getRow(i)[j / 64] >> (j % 64)) & 1;
+  }
+
+  void setBit(size_t i, size_t j, bool value = true)
+  {
+    uint64_t bit = uint64_t(1) << (j % 64);
+    if (value)
+      getRow(i)[j / 64] |= bit;
+    else
+      getRow(i)[j / 64] &= ~bit;
+  }
+
+  /**
+   * @brief Add a row, with all bits to zero.
+   *
+   * @return The index of the new row.
+   */
+  size_t addRow();
+
+  /**
+   * @brief Add a copy of a row of a matrix on the same elements.
+   */
+  size_t addRow(const SplitMatrix& matrix, size_t i);
+
+  void deleteRow(size_t i);
+
+  /**
+   * @brief Reorder the rows: new row k is old row order[k].
+   */
+  void permuteRows(const std::vector<size_t>& order);
+
+  /**
+   * @brief Swap the sides of bipartition i.
+   */
+  void flip(size_t i);
+
+  /**
+   * @return The number of elements set in row i.
+   */
+  size_t countBits(size_t i) const;
+
+  /**
+   * @brief Tells whether row i is a subset of row k of matrix.
+   */
+  bool isSubset(size_t i, const SplitMatrix& matrix, size_t k) const;
+
+  /**
+   * @brief Tells whether row i and row k of matrix define the same
+   * bipartition (equal or complementary rows).
+   */
+  bool areIdentical(size_t i, const SplitMatrix& matrix, size_t k) const;
+
+  /**
+   * @brief Tells whether row i and row k of matrix are compatible,
+   * ie one of the four intersections of their sides is empty.
+   */
+  bool areCompatible(size_t i, const SplitMatrix& matrix, size_t k) const;
+
+  /**
+   * @name Operations on arrays of words.
+   *
+   * @{
+   */
+  static void bitAnd(uint64_t* result, const uint64_t* words1, const uint64_t* words2, size_t nbWords);
+
+  static void bitOr(uint64_t* result, const uint64_t* words1, const uint64_t* words2, size_t nbWords);
+
+  static void bitXor(uint64_t* result, const uint64_t* words1, const uint64_t* words2, size_t nbWords);
+
+  static size_t popcount(uint64_t word)
+  {
+    word = word - ((word >> 1) & 0x5555555555555555ULL);
+    word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+    word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<size_t>((word * 0x0101010101010101ULL) >> 56);
+  }
+
+  static size_t countBits(const uint64_t* words, size_t nbWords);
+  /** @} */
+
+private:
+  /**
+   * @brief Mask of the bits of elements in word w of a row.
+   */
+  uint64_t getMask_(size_t w) const
+  {
+    if (w * 64 + 64 <= nbElements_)
+      return ~uint64_t(0);
+    if (w * 64 >= nbElements_)
+      return 0;
+    return (uint64_t(1) << (nbElements_ % 64)) - 1;
+  }
+};
+} // end of namespace bpp.
+#endif // BPP_PHYL_TREE_SPLITMATRIX_H
@@ -41,10 +41,10 @@
 #include <Bpp/BppString.h>
 #include <Bpp/Numeric/Number.h>
 #include <Bpp/Numeric/Random/RandomTools.h>
-#include <Bpp/Text/NestedStringTokenizer.h>
 #include <Bpp/Text/StringTokenizer.h>
 #include <Bpp/Text/TextTools.h>
 
+#include "ParenthesisParser.h"
 #include "TreeTemplate.h"
 #include "TreeTemplateTools.h"
 
@@ -238,83 +238,129 @@ TreeTemplateTools::Element TreeTemplateTools::getElement(const string& elt)
 /******************************************************************************/
 
 
-Node* TreeTemplateTools::parenthesisToNode(const string& description, unsigned int& nodeCounter, bool bootstrap, const string& propertyName, bool withId, bool verbose)
+namespace
+{
+/**
+ * @brief Build the nodes of a TreeTemplate from a ParenthesisParser.
+ */
+class NodeBuilder :
+  public ParenthesisParser::Handler
 {
-  // cout << "NODE: " << description << endl;
-  Element elt = getElement(description);
+private:
+  bool bootstrap_;
+  const string& propertyName_;
+  bool withId_;
+  bool verbose_;
+  unsigned int& nodeCounter_;
+  Node* root_;
+  vector<Node*> nodes_; // Started and not complete.
+
+public:
+  NodeBuilder(unsigned int& nodeCounter, bool bootstrap, const string& propertyName, bool withId, bool verbose) :
+    bootstrap_(bootstrap),
+    propertyName_(propertyName),
+    withId_(withId),
+    verbose_(verbose),
+    nodeCounter_(nodeCounter),
+    root_(0),
+    nodes_()
+  {}
+
+  ~NodeBuilder()
+  {
+    // Only if the parsing failed:
+    if (root_)
+    {
+      TreeTemplateTools::deleteSubtree(root_);
+      delete root_;
+    }
+  }
+
+  NodeBuilder(const NodeBuilder&) = delete;
+  NodeBuilder& operator=(const NodeBuilder&) = delete;
 
-  // New node:
-  Node* node = new Node();
-  if (!TextTools::isEmpty(elt.length))
+public:
+  Node* release()
   {
-    node->setDistanceToFather(TextTools::toDouble(elt.length));
-    // cout << "NODE: LENGTH: " << * elt.length << endl;
+    Node* root = root_;
+    root_ = 0;
+    return root;
   }
-  if (!TextTools::isEmpty(elt.bootstrap))
+
+  void startNode()
   {
-    if (withId)
-    {
-      node->setId(TextTools::toInt(elt.bootstrap));
-    }
+    Node* node = new Node();
+    if (nodes_.empty())
+      root_ = node;
     else
+      nodes_.back()->addSon(node);
+    nodes_.push_back(node);
+  }
+
+  void endNode(const string& label, const string& length, const string& annotation, bool isLeaf)
+  {
+    Node* node = nodes_.back();
+    nodes_.pop_back();
+    if (!TextTools::isEmpty(length))
+      node->setDistanceToFather(TextTools::toDouble(length));
+
+    if (isLeaf)
     {
-      if (bootstrap)
+      if (withId_)
       {
-        node->setBranchProperty(TreeTools::BOOTSTRAP, Number<double>(TextTools::toDouble(elt.bootstrap)));
-        // cout << "NODE: BOOTSTRAP: " << * elt.bootstrap << endl;
+        StringTokenizer st(label, "_", true, true);
+        ostringstream realName;
+        for (size_t i = 0; i < st.numberOfRemainingTokens() - 1; ++i)
+        {
+          if (i != 0)
+          {
+            realName << "_";
+          }
+          realName << st.getToken(i);
+        }
+        node->setName(realName.str());
+        node->setId(TextTools::toInt(st.getToken(st.numberOfRemainingTokens() - 1)));
       }
       else
       {
-        node->setBranchProperty(propertyName, BppString(elt.bootstrap));
+        node->setName(label);
       }
     }
-  }
-
-  NestedStringTokenizer nt(elt.content, "(", ")", ",");
-  vector<string> elements;
-  while (nt.hasMoreToken())
-  {
-    elements.push_back(nt.nextToken());
-  }
-
-  if (elt.isLeaf)
-  {
-    // This is a leaf:
-    string name = TextTools::removeSurroundingWhiteSpaces(elements[0]);
-    if (withId)
+    else if (!TextTools::isEmpty(label))
     {
-      StringTokenizer st(name, "_", true, true);
-      ostringstream realName;
-      for (size_t i = 0; i < st.numberOfRemainingTokens() - 1; ++i)
+      if (withId_)
       {
-        if (i != 0)
+        node->setId(TextTools::toInt(label));
+      }
+      else
+      {
+        if (bootstrap_)
+        {
+          node->setBranchProperty(TreeTools::BOOTSTRAP, Number<double>(TextTools::toDouble(label)));
+        }
+        else
         {
-          realName << "_";
+          node->setBranchProperty(propertyName_, BppString(label));
         }
-        realName << st.getToken(i);
       }
-      node->setName(realName.str());
-      node->setId(TextTools::toInt(st.getToken(st.numberOfRemainingTokens() - 1)));
-    }
-    else
-    {
-      node->setName(name);
-    }
-  }
-  else
-  {
-    // This is a node:
-    for (size_t i = 0; i < elements.size(); i++)
-    {
-      // cout << "NODE: SUBNODE: " << i << ", " << elements[i] << endl;
-      Node* son = parenthesisToNode(elements[i], nodeCounter, bootstrap, propertyName, withId, verbose);
-      node->addSon(son);
     }
+
+    nodeCounter_++;
+    if (verbose_)
+      ApplicationTools::displayUnlimitedGauge(nodeCounter_);
   }
-  nodeCounter++;
-  if (verbose)
-    ApplicationTools::displayUnlimitedGauge(nodeCounter);
-  return node;
+};
+} // namespace
+
+/******************************************************************************/
+
+Node* TreeTemplateTools::parenthesisToNode(const string& description, unsigned int& nodeCounter, bool bootstrap, const string& propertyName, bool withId, bool verbose)
+{
+  string text = description + ";";
+  ParenthesisParser parser;
+  NodeBuilder builder(nodeCounter, bootstrap, propertyName, withId, verbose);
+  parser.parse(text.data(), text.data() + text.size(), builder);
+  return builder.release();
 }
 
 /******************************************************************************/
@@ -324,11 +370,20 @@ TreeTemplate<Node>* TreeTemplateTools::parenthesisToTree(const string& descripti
   string::size_type semi = description.rfind(';');
   if (semi == string::npos)
     throw Exception("TreeTemplateTools::parenthesisToTree(). Bad format: no semi-colon found.");
-  string content = description.substr(0, semi);
+  const char* position = description.data();
+  ParenthesisParser parser;
+  return parenthesisToTree(parser, position, description.data() + semi + 1, bootstrap, propertyName, withId, verbose);
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* TreeTemplateTools::parenthesisToTree(const ParenthesisParser& parser, const char*& position, const char* end, bool bootstrap, const string& propertyName, bool withId, bool verbose)
+{
   unsigned int nodeCounter = 0;
-  Node* node = parenthesisToNode(content, nodeCounter, bootstrap, propertyName, withId, verbose);
+  NodeBuilder builder(nodeCounter, bootstrap, propertyName, withId, verbose);
+  position = parser.parse(position, end, builder);
   TreeTemplate<Node>* tree = new TreeTemplate<Node>();
-  tree->setRootNode(node);
+  tree->setRootNode(builder.release());
   if (!withId)
   {
     tree->resetNodesId();
@@ -52,6 +52,7 @@
 namespace bpp
 {
 template<class N> class TreeTemplate;
+class ParenthesisParser;
 
 
 /**
@@ -980,6 +981,22 @@ public:
    */
   static TreeTemplate<Node>* parenthesisToTree(const std::string& description, bool bootstrap = true, const std::string& propertyName = TreeTools::BOOTSTRAP, bool withId = false, bool verbose = true);
 
+  /**
+   * @brief Parse the next tree of a buffer in the parenthesis format.
+   *
+   * The description is read in a single pass by the parser, which
+   * tells how comments are handled. This allows to read trees from
+   * any buffer, for instance a memory-mapped file, without copy.
+   *
+   * @param parser The parser to use.
+   * @param position [in, out] The beginning of the description, set after its ending semicolon.
+   * @param end The end of the buffer.
+   * @param bootstrap, propertyName, withId, verbose See parenthesisToTree(const std::string&, bool, const std::string&, bool, bool).
+   * @return A pointer toward a dynamically created tree.
+   * @throw IOException in case of bad format.
+   */
+  static TreeTemplate<Node>* parenthesisToTree(const ParenthesisParser& parser, const char*& position, const char* end, bool bootstrap = true, const std::string& propertyName = TreeTools::BOOTSTRAP, bool withId = false, bool verbose = true);
+
   /**
    * @brief Get the parenthesis description of a subtree.
    *
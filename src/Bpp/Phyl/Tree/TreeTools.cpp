@@ -53,6 +53,7 @@
 // #include "../OptimizationTools.h"
 #include "../Parsimony/DRTreeParsimonyScore.h"
 #include "../Model/Nucleotide/JCnuc.h"
+#include "BipartitionTable.h"
 #include "BipartitionTools.h"
 #include "Tree.h"
 #include "TreeTools.h"
@@ -64,8 +65,12 @@
 using namespace bpp;
 
 // From the STL:
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <iostream>
 #include <sstream>
+#include <thread>
 
 using namespace std;
 
@@ -956,57 +961,108 @@ int TreeTools::robinsonFouldsDistance(const Tree& tr1, const Tree& tr2, bool che
 
 /******************************************************************************/
 
-BipartitionList* TreeTools::bipartitionOccurrences(const vector<Tree*>& vecTr, vector<size_t>& bipScore)
+DistanceMatrix* TreeTools::robinsonFouldsDistances(const vector<Tree*>& vecTr, bool weighted, bool normalized, size_t nbThreads)
 {
-  vector<BipartitionList*> vecBipL;
-  BipartitionList* mergedBipL;
-  vector<size_t> bipSize;
-  size_t nbBip;
+  if (vecTr.size() == 0)
+    throw Exception("TreeTools::robinsonFouldsDistances. Empty vector passed");
+
+  /* hash the bipartitions of each tree once */
+  size_t nbTrees = vecTr.size();
+  BipartitionTable table(vecTr[0]->getLeavesNames());
+  vector< vector<uint64_t> > hashes(nbTrees);
+  vector< vector<double> > lengths(weighted ? nbTrees : 0);
+  vector<double> totalLengths(nbTrees, 0.);
+  vector<string> names(nbTrees);
+  for (size_t i = 0; i < nbTrees; i++)
+  {
+    table.getSplitHashes(*vecTr[i], hashes[i], weighted ? &lengths[i] : 0);
+    if (weighted)
+      totalLengths[i] = VectorTools::sum(lengths[i]);
+    names[i] = vecTr[i]->getName();
+    if (names[i].empty())
+      names[i] = TextTools::toString(i + 1);
+  }
+
+  /* compare all pairs, by rows of the upper triangle */
+  DistanceMatrix* mat = new DistanceMatrix(names);
+  DistanceMatrix& dist = *mat;
+  atomic<size_t> nextRow(0);
+  auto computeRows = [&]() {
+      for (size_t i = nextRow++; i < nbTrees; i = nextRow++)
+      {
+        dist(i, i) = 0;
+        for (size_t j = i + 1; j < nbTrees; j++)
+        {
+          const vector<uint64_t>& h1 = hashes[i];
+          const vector<uint64_t>& h2 = hashes[j];
+          double d = 0;
+          size_t k1 = 0, k2 = 0;
+          while (k1 < h1.size() && k2 < h2.size())
+          {
+            if (h1[k1] < h2[k2])
+            {
+              d += weighted ? lengths[i][k1] : 1.;
+              k1++;
+            }
+            else if (h2[k2] < h1[k1])
+            {
+              d += weighted ? lengths[j][k2] : 1.;
+              k2++;
+            }
+            else
+            {
+              // Same bipartition in both trees.
+              if (weighted)
+                d += std::abs(lengths[i][k1] - lengths[j][k2]);
+              k1++;
+              k2++;
+            }
+          }
+          for ( ; k1 < h1.size(); k1++)
+          {
+            d += weighted ? lengths[i][k1] : 1.;
+          }
+          for ( ; k2 < h2.size(); k2++)
+          {
+            d += weighted ? lengths[j][k2] : 1.;
+          }
+          if (normalized)
+          {
+            double max = weighted ? totalLengths[i] + totalLengths[j] : static_cast<double>(h1.size() + h2.size());
+            d = max > 0 ? d / max : 0.;
+          }
+          dist(i, j) = dist(j, i) = d;
+        }
+      }
+    };
 
-  /*  build and merge bipartitions */
-  for (size_t i = 0; i < vecTr.size(); i++)
+  vector<thread> workers;
+  for (size_t t = 1; t < std::min(nbThreads, nbTrees); t++)
   {
-    vecBipL.push_back(new BipartitionList(*vecTr[i]));
+    workers.push_back(thread(computeRows));
   }
-  mergedBipL = BipartitionTools::mergeBipartitionLists(vecBipL);
-  for (size_t i = 0; i < vecTr.size(); i++)
+  computeRows();
+  for (auto& worker : workers)
   {
-    delete vecBipL[i];
+    worker.join();
   }
+  return mat;
+}
 
-  mergedBipL->removeTrivialBipartitions();
-  nbBip = mergedBipL->getNumberOfBipartitions();
-  bipScore.clear();
-  for (size_t i = 0; i < nbBip; i++)
-  {
-    bipSize.push_back(mergedBipL->getPartitionSize(i));
-    bipScore.push_back(1);
-  }
+/******************************************************************************/
 
-  /* compare bipartitions */
-  for (size_t i = nbBip; i > 0; i--)
-  {
-    if (bipScore[i - 1] == 0)
-      continue;
-    for (size_t j = i - 1; j > 0; j--)
-    {
-      if (bipScore[j - 1] && bipSize[i - 1] == bipSize[j - 1] && mergedBipL->areIdentical(i - 1, j - 1))
-      {
-        bipScore[i - 1]++;
-        bipScore[j - 1] = 0;
-      }
-    }
-  }
+BipartitionList* TreeTools::bipartitionOccurrences(const vector<Tree*>& vecTr, vector<size_t>& bipScore)
+{
+  if (vecTr.size() == 0)
+    throw Exception("TreeTools::bipartitionOccurrences. Empty vector passed");
 
-  /* keep only distinct bipartitions */
-  for (size_t i = nbBip; i > 0; i--)
+  /* count distinct bipartitions */
+  BipartitionTable table(vecTr[0]->getLeavesNames());
+  for (size_t i = 0; i < vecTr.size(); i++)
   {
-    if (bipScore[i - 1] == 0)
-    {
-      bipScore.erase(bipScore.begin() + static_cast<ptrdiff_t>(i - 1));
-      mergedBipL->deleteBipartition(i - 1);
-    }
+    table.addTree(*vecTr[i]);
   }
+  BipartitionList* mergedBipL = table.toBipartitionList(bipScore);
 
   /* add terminal branches */
   mergedBipL->addTrivialBipartitions(false);
@@ -1129,8 +1185,11 @@ void TreeTools::computeBootstrapValues(Tree& tree, const vector<Tree*>& vecTr, b
 {
   vector<int> index;
   BipartitionList bpTree(tree, true, &index);
-  vector<size_t> occurences;
-  BipartitionList* bpList = bipartitionOccurrences(vecTr, occurences);
+  BipartitionTable table(tree.getLeavesNames());
+  for (size_t i = 0; i < vecTr.size(); i++)
+  {
+    table.addTree(*vecTr[i]);
+  }
 
   vector< Number<double> > bootstrapValues(bpTree.getNumberOfBipartitions());
 
@@ -1138,14 +1197,9 @@ void TreeTools::computeBootstrapValues(Tree& tree, const vector<Tree*>& vecTr, b
   {
     if (verbose)
       ApplicationTools::displayGauge(i, bpTree.getNumberOfBipartitions() - 1, '=');
-    for (size_t j = 0; j < bpList->getNumberOfBipartitions(); j++)
-    {
-      if (BipartitionTools::areIdentical(bpTree, i, *bpList, j))
-      {
-        bootstrapValues[i] = format >= 0 ? round(static_cast<double>(occurences[j]) * std::pow(10., 2 + format) / static_cast<double>(vecTr.size())) / std::pow(10., format) : static_cast<double>(occurences[j]);
-        break;
-      }
-    }
+    size_t occurences = table.getNumberOfOccurrences(table.getSplit(bpTree, i));
+    if (occurences > 0)
+      bootstrapValues[i] = format >= 0 ? round(static_cast<double>(occurences) * std::pow(10., 2 + format) / static_cast<double>(vecTr.size())) / std::pow(10., format) : static_cast<double>(occurences);
   }
 
   for (size_t i = 0; i < index.size(); i++)
@@ -1153,8 +1207,6 @@ void TreeTools::computeBootstrapValues(Tree& tree, const vector<Tree*>& vecTr, b
     if (!tree.isLeaf(index[i]))
       tree.setBranchProperty(index[i], BOOTSTRAP, bootstrapValues[i]);
   }
-
-  delete bpList;
 }
 
 /******************************************************************************/
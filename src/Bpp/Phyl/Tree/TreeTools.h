@@ -596,11 +596,37 @@ public:
    */
   static int robinsonFouldsDistance(const Tree& tr1, const Tree& tr2, bool checkNames = true, int* missing_in_tr2 = NULL, int* missing_in_tr1 = NULL);
 
+  /**
+   * @brief Calculates the Robinson-Foulds distances between all the pairs of a set of trees
+   *
+   * The non trivial bipartitions of each tree are hashed once (see BipartitionTable::getSplitHashes),
+   * in O(n) memory per tree, and each pair of trees is compared by a merge of their sorted hashes.
+   * Pairs are distributed over nbThreads threads.
+   *
+   * With weighted, the distance is the sum over the bipartitions of the absolute differences
+   * of their branch lengths, a bipartition absent from a tree having length 0 (branch score).
+   * With normalized, the distance is divided by its maximum value for the two trees: the number
+   * of their non trivial bipartitions, or the sum of their lengths if weighted.
+   *
+   * Without weighted nor normalized, the distances are the ones of robinsonFouldsDistance.
+   * Bipartitions are identified by 64 bits hashes, so that two distinct bipartitions may
+   * be equal with a probability about 2^-64.
+   *
+   * @param vecTr Vector of input trees (must share a common set of leaves)
+   * @param weighted Tell whether the branch lengths should be used.
+   * @param normalized Tell whether the distances should be normalized.
+   * @param nbThreads The number of threads computing the distances.
+   * @return A DistanceMatrix on the names of the trees, or on their indices when the trees are not named.
+   * @throw Exception If the trees do not share the same leaves names.
+   */
+  static DistanceMatrix* robinsonFouldsDistances(const std::vector<Tree*>& vecTr, bool weighted = false, bool normalized = false, size_t nbThreads = 1);
+
   /**
    * @brief Counts the total number of occurrences of every bipartition from the input trees
    *
    * Returns the list of distinct bipartitions found at least once in the set of input trees,
    * and writes the number of occurrence of each of these bipartitions in vector bipScore.
+   * Bipartitions are counted in a BipartitionTable, in time linear in the number of trees.
    *
    * @author Nicolas Galtier
    * @param vecTr Vector of input trees (must share a common set of leaves - not checked in this function)
@@ -43,9 +43,17 @@
 #include "doctest.h"
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
 
 #include <Bpp/Exceptions.h>
 #include <Bpp/Phyl/Likelihood/DataFlow/DataFlowCWiseComputing.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/DataFlowOptimizer.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/MixedPrecisionLogLikelihood.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/RateCategoriesForward.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/Sequence_DF.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/SiteRepeats.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/SiteScaledForward.h>
 
 static bool enableDotOutput = false;
 using namespace bpp;
@@ -175,6 +183,688 @@ TEST_CASE("dataflow_node_basic_errors")
   CHECK_THROWS_AS(asNodeClass->derive(c, *asNodeClass), Exception&);
 }
 
+TEST_CASE("dataflow_parallel_evaluation")
+{
+  // Balanced binary sum of 64 leaves, computed with a pool of threads
+  Context c;
+  c.setNumberOfThreads(4);
+  CHECK(c.getNumberOfThreads() == 4);
+
+  std::vector<std::shared_ptr<NumericMutable<double>>> leaves;
+  NodeRefVec layer;
+  for (int i = 0; i < 64; ++i)
+  {
+    leaves.push_back(NumericMutable<double>::create(c, double(i)));
+    layer.push_back(leaves.back());
+  }
+  while (layer.size() > 1)
+  {
+    NodeRefVec nextLayer;
+    for (std::size_t i = 0; i + 1 < layer.size(); i += 2)
+      nextLayer.push_back(CWiseAdd<double, std::tuple<double, double>>::create(c, {layer[i], layer[i + 1]}, Dimension<double>()));
+    layer = nextLayer;
+  }
+  auto sum = convertRef<Value<double>>(layer[0]);
+  CHECK(sum->getTargetValue() == 63. * 64. / 2.);
+
+  // Only the path to the modified leaf is invalidated and recomputed
+  leaves[0]->setValue(100.);
+  CHECK_FALSE(sum->isValid());
+  CHECK(leaves[1]->isValid());
+  CHECK(sum->getTargetValue() == 63. * 64. / 2. + 100.);
+
+  // Back to sequential evaluation
+  c.setNumberOfThreads(1);
+  CHECK(c.getNumberOfThreads() == 1);
+  leaves[63]->setValue(0.);
+  CHECK(sum->getTargetValue() == 62. * 63. / 2. + 100.);
+
+  dotOutput("dataflow_parallel_evaluation", {sum.get()});
+}
+
+TEST_CASE("dataflow_shared_subexpressions")
+{
+  // Each level uses the previous one twice: the graph walks must visit
+  // shared nodes once, not once per path (2^60 paths here).
+  Context c;
+  auto x = NumericMutable<double>::create(c, 1.);
+  ValueRef<double> node = x;
+  for (int i = 0; i < 60; ++i)
+    node = CWiseAdd<double, std::tuple<double, double>>::create(c, {node, node}, Dimension<double>());
+  CHECK(node->getTargetValue() == std::ldexp(1., 60));
+
+  x->setValue(3.);
+  CHECK_FALSE(node->isValid());
+  CHECK(node->getTargetValue() == std::ldexp(3., 60));
+
+  c.setNumberOfThreads(2);
+  x->setValue(5.);
+  CHECK(node->getTargetValue() == std::ldexp(5., 60));
+
+  // Removal from the cache: an equal node is then a new one.
+  c.erase(node);
+  auto other = CWiseAdd<double, std::tuple<double, double>>::create(c, {node->dependency(0), node->dependency(0)}, Dimension<double>());
+  CHECK(other != node);
+}
+
+TEST_CASE("dataflow_graph_optimizer")
+{
+  using Add = CWiseAdd<double, std::tuple<double, double>>;
+  using Mul = CWiseMul<double, std::tuple<double, double>>;
+  Context c;
+  auto x = NumericMutable<double>::create(c, 2.);
+  auto k = Add::create(c, {NumericConstant<double>::create(c, 3.), NumericConstant<double>::create(c, 4.)}, Dimension<double>());
+  auto y = Mul::create(c, {k, x}, Dimension<double>());
+  auto i = Identity<double>::create(c, {y}, Dimension<double>());
+  // Equal once the Identity is collapsed.
+  auto s0 = Add::create(c, {i, x}, Dimension<double>());
+  auto s1 = Add::create(c, {y, x}, Dimension<double>());
+  ValueRef<double> root = Mul::create(c, {s0, s1}, Dimension<double>());
+  // Not needed by root.
+  Add::create(c, {x, k}, Dimension<double>());
+  CHECK(root->getTargetValue() == 256.);
+
+  auto report = DataFlowOptimizer::optimize(c, {root});
+  CHECK(report.nbCollapsed == 1);
+  CHECK(report.nbFolded == 1);
+  CHECK(report.nbMerged == 1);
+  CHECK(report.nbRemoved == 5); // 3, 4, k, i, x + k (s0 left the cache when merged)
+  CHECK(c.size() == 4); // 7, y, s1, root (x is not cached)
+  CHECK(root->dependency(0) == root->dependency(1));
+  CHECK(y->dependency(0) != k);
+  CHECK(root->getTargetValue() == 256.);
+
+  x->setValue(1.);
+  CHECK_FALSE(root->isValid());
+  CHECK(root->getTargetValue() == 64.);
+
+  // Nothing more to do.
+  report = DataFlowOptimizer::optimize(c, {root});
+  CHECK(report.nbCollapsed == 0);
+  CHECK(report.nbFolded == 0);
+  CHECK(report.nbMerged == 0);
+  CHECK(report.nbRemoved == 0);
+
+  // With the variables given, the other mutable leaves are constants.
+  auto z = NumericMutable<double>::create(c, 3.);
+  auto zz = Mul::create(c, {z, z}, Dimension<double>());
+  ValueRef<double> root2 = Add::create(c, {zz, x}, Dimension<double>());
+  DataFlowOptimizer::Report variablesReport;
+  DataFlowOptimizer::foldConstants(c, {root2}, {x}, variablesReport);
+  CHECK(variablesReport.nbFolded == 1);
+  CHECK(root2->dependency(0) != zz);
+  CHECK(root2->getTargetValue() == 10.);
+  x->setValue(2.);
+  CHECK(root2->getTargetValue() == 11.);
+}
+
+TEST_CASE("dataflow_site_blocks")
+{
+  // Conditional likelihood like nodes, computed by blocks of sites
+  // in parallel, must give the same values as sequential computation.
+  const Eigen::Index nbStates = 4;
+  const Eigen::Index nbSites = 1001;
+  const Eigen::MatrixXd transition = Eigen::MatrixXd::Random(nbStates, nbStates).cwiseAbs();
+  const MatrixLik lik0(Eigen::MatrixXd(Eigen::MatrixXd::Random(nbStates, nbSites).cwiseAbs() * 1e-200), 0);
+  const MatrixLik lik1(Eigen::MatrixXd(Eigen::MatrixXd::Random(nbStates, nbSites).cwiseAbs()), 0);
+  const MatrixLik lik2(Eigen::MatrixXd(Eigen::MatrixXd::Random(nbStates, nbSites).cwiseAbs() * 1e-100), 0);
+  const Dimension<MatrixLik> dim(nbStates, nbSites);
+
+  auto build = [&](Context& c) {
+    auto t = NumericConstant<Eigen::MatrixXd>::create(c, transition);
+    auto l0 = NumericConstant<MatrixLik>::create(c, lik0);
+    auto l1 = NumericConstant<MatrixLik>::create(c, lik1);
+    auto l2 = NumericConstant<MatrixLik>::create(c, lik2);
+    auto f0 = MatrixProduct<MatrixLik, Eigen::MatrixXd, MatrixLik>::create(c, {t, l0}, dim);
+    auto f1 = MatrixProduct<MatrixLik, Eigen::MatrixXd, MatrixLik>::create(c, {t, l1}, dim);
+    auto f2 = MatrixProduct<MatrixLik, Eigen::MatrixXd, MatrixLik>::create(c, {t, l2}, dim);
+    return std::make_pair(
+      CWiseMul<MatrixLik, ReductionOf<MatrixLik>>::create(c, {f0, f1}, dim),
+      CWiseMul<MatrixLik, ReductionOf<MatrixLik>>::create(c, {f0, f1, f2}, dim));
+  };
+
+  Context sequential;
+  auto expected = build(sequential);
+
+  Context parallel;
+  parallel.setNumberOfThreads(4);
+  parallel.setSiteBlockSize(1024);
+  CHECK(parallel.getSiteBlockSize() == 1024);
+  auto computed = build(parallel);
+
+  for (const auto& p : {std::make_pair(expected.first, computed.first), std::make_pair(expected.second, computed.second)})
+  {
+    const auto& e = p.first->getTargetValue();
+    const auto& r = p.second->getTargetValue();
+    CHECK(r.exponent_part() == e.exponent_part());
+    CHECK((r.float_part() - e.float_part()).cwiseAbs().maxCoeff() <= 1e-12 * e.float_part().cwiseAbs().maxCoeff());
+  }
+}
+
+TEST_CASE("dataflow_node_timings")
+{
+  const Eigen::Index nbStates = 4;
+  const Eigen::Index nbSites = 30;
+  const Dimension<MatrixLik> dim(nbStates, nbSites);
+  Context c;
+  auto t = NumericMutable<Eigen::MatrixXd>::create(c, Eigen::MatrixXd(Eigen::MatrixXd::Random(nbStates, nbStates).cwiseAbs()));
+  auto x = NumericConstant<MatrixLik>::create(c, MatrixLik(Eigen::MatrixXd(Eigen::MatrixXd::Random(nbStates, nbSites).cwiseAbs()), 0));
+  auto forward = MatrixProduct<MatrixLik, Eigen::MatrixXd, MatrixLik>::create(c, {t, x}, dim);
+  auto product = CWiseMul<MatrixLik, ReductionOf<MatrixLik>>::create(c, {forward, x}, dim);
+
+  NodeTimings::reset();
+  NodeTimings::enable(true);
+  product->getTargetValue();
+  t->setValue(Eigen::MatrixXd::Identity(nbStates, nbStates));
+  product->getTargetValue();
+  NodeTimings::enable(false);
+
+  // By description and by node, with flops and bytes estimates.
+  const auto entries = NodeTimings::getEntries();
+  REQUIRE(entries.count("Matrix Product") == 1);
+  const auto& productEntry = entries.at("Matrix Product");
+  CHECK(productEntry.nbComputations == 2);
+  CHECK(productEntry.flops == 2 * 2. * double(nbStates * nbSites * nbStates));
+  CHECK(productEntry.bytes == 2 * 2. * double(nbStates * nbSites) * sizeof(double));
+  const auto nodeEntries = NodeTimings::getNodeEntries();
+  REQUIRE(nodeEntries.count(forward.get()) == 1);
+  CHECK(nodeEntries.at(forward.get()).description == "Matrix Product");
+  CHECK(nodeEntries.at(product.get()).entry.nbComputations == 2);
+  CHECK(nodeEntries.count(t.get()) == 0);
+
+  std::ostringstream json;
+  NodeTimings::writeJson(json);
+  CHECK(json.str().find("{\"descriptions\":{") == 0);
+  CHECK(json.str().find("\"Matrix Product\":{\"computations\":2,") != std::string::npos);
+  CHECK(json.str().find("\"nodes\":[{\"id\":\"N") != std::string::npos);
+
+  // Costly nodes are coloured in the dot output.
+  std::ostringstream dot;
+  writeGraphToDot(dot, {product.get()}, DotOptions::ShowTimings);
+  CHECK(dot.str().find("n=2 t=") != std::string::npos);
+  CHECK(dot.str().find("fillcolor=\"#ffffff\"") != std::string::npos);
+
+  // Entries of destroyed nodes are removed.
+  {
+    Context other;
+    auto y = NumericConstant<MatrixLik>::create(other, MatrixLik(Eigen::MatrixXd(Eigen::MatrixXd::Random(nbStates, nbSites).cwiseAbs()), 0));
+    auto square = CWiseMul<MatrixLik, ReductionOf<MatrixLik>>::create(other, {y, y}, dim);
+    NodeTimings::enable(true);
+    square->getTargetValue();
+    NodeTimings::enable(false);
+    CHECK(NodeTimings::getNodeEntries().size() == nodeEntries.size() + 1);
+  }
+  CHECK(NodeTimings::getNodeEntries().size() == nodeEntries.size());
+
+  NodeTimings::reset();
+  CHECK(NodeTimings::getNodeEntries().empty());
+}
+
+TEST_CASE("dataflow_memory_budget")
+{
+  // Caterpillar of conditional likelihood like nodes: under a memory
+  // budget, released intermediate values are recomputed on demand and
+  // give the same likelihoods.
+  const Eigen::Index nbStates = 4;
+  const Eigen::Index nbSites = 50;
+  const std::size_t nbLevels = 8;
+  const Eigen::MatrixXd transition = Eigen::MatrixXd::Random(nbStates, nbStates).cwiseAbs();
+  std::vector<MatrixLik> tips;
+  for (std::size_t i = 0; i <= nbLevels; ++i)
+    tips.emplace_back(Eigen::MatrixXd(Eigen::MatrixXd::Random(nbStates, nbSites).cwiseAbs()), 0);
+  const Dimension<MatrixLik> dim(nbStates, nbSites);
+
+  struct Graph
+  {
+    std::shared_ptr<NumericMutable<Eigen::MatrixXd>> t;
+    std::vector<ValueRef<MatrixLik>> intermediates;
+    ValueRef<RowLik> root;
+  };
+  auto build = [&](Context& c) {
+    Graph g;
+    g.t = NumericMutable<Eigen::MatrixXd>::create(c, transition);
+    ValueRef<MatrixLik> node = NumericConstant<MatrixLik>::create(c, tips[0]);
+    for (std::size_t i = 1; i <= nbLevels; ++i)
+    {
+      auto forward = MatrixProduct<MatrixLik, Eigen::MatrixXd, MatrixLik>::create(c, {g.t, node}, dim);
+      node = CWiseMul<MatrixLik, ReductionOf<MatrixLik>>::create(c, {forward, NumericConstant<MatrixLik>::create(c, tips[i])}, dim);
+      g.intermediates.push_back(forward);
+      g.intermediates.push_back(node);
+    }
+    auto freqs = NumericConstant<Eigen::RowVectorXd>::create(c, Eigen::RowVectorXd::Constant(nbStates, 0.25));
+    g.root = MatrixProduct<RowLik, Eigen::RowVectorXd, MatrixLik>::create(c, {freqs, node}, RowVectorDimension(nbSites));
+    return g;
+  };
+  auto checkSame = [](const RowLik& e, const RowLik& r) {
+    CHECK(r.exponent_part() == e.exponent_part());
+    CHECK((r.float_part() - e.float_part()).cwiseAbs().maxCoeff() <= 1e-12 * e.float_part().cwiseAbs().maxCoeff());
+  };
+
+  Context unbounded;
+  auto expected = build(unbounded);
+  const RowLik expectedValue = expected.root->getTargetValue();
+  std::size_t allBytes = 0;
+  for (const auto& n : expected.intermediates)
+    allBytes += n->storageSize();
+  CHECK(unbounded.getStoredBytes() == 0);
+
+  for (std::size_t nbThreads : {1, 4})
+  {
+    Context c;
+    c.setNumberOfThreads(nbThreads);
+    c.setMemoryBudget(1);
+    CHECK(c.getMemoryBudget() == 1);
+    auto computed = build(c);
+    const RowLik computedValue = computed.root->getTargetValue();
+    checkSame(expectedValue, computedValue);
+
+    // Released values are invalid, but their dependents stay valid,
+    // and two adjacent values are never both released.
+    CHECK(c.getStoredBytes() < allBytes);
+    std::size_t nbReleased = 0;
+    for (std::size_t i = 0; i < computed.intermediates.size(); ++i)
+    {
+      if (!computed.intermediates[i]->isStorageReleased())
+        continue;
+      nbReleased++;
+      CHECK_FALSE(computed.intermediates[i]->isValid());
+      if (i + 1 < computed.intermediates.size())
+        CHECK_FALSE(computed.intermediates[i + 1]->isStorageReleased());
+    }
+    CHECK(nbReleased > 0);
+    CHECK(computed.root->isValid());
+
+    // Change of a leaf: released values are recomputed as needed.
+    const Eigen::MatrixXd newTransition = transition * 0.5;
+    expected.t->setValue(newTransition);
+    computed.t->setValue(newTransition);
+    CHECK_FALSE(computed.root->isValid());
+    const RowLik newExpectedValue = expected.root->getTargetValue();
+    const RowLik newComputedValue = computed.root->getTargetValue();
+    checkSame(newExpectedValue, newComputedValue);
+
+    // Explicit release of the last intermediate value.
+    auto last = computed.intermediates.back();
+    if (!last->isStorageReleased())
+      CHECK(last->releaseStorage());
+    CHECK(last->getTargetValue().float_part().cols() == nbSites);
+    CHECK(computed.root->isValid());
+
+    expected.t->setValue(transition);
+    expected.root->getTargetValue();
+  }
+}
+
+TEST_CASE("dataflow_tip_transition")
+{
+  // Leaf with 3 distinct columns (2 states and a gap) over 6 sites
+  Context c;
+  TipLikelihood tip;
+  tip.codeLikelihoods = Eigen::MatrixXd(3, 3);
+  tip.codeLikelihoods << 1, 0, 1,
+                         0, 1, 1,
+                         0, 0, 1;
+  tip.siteCodes = Eigen::RowVectorXi(6);
+  tip.siteCodes << 0, 1, 1, 2, 0, 1;
+  const Dimension<MatrixLik> dim(3, 6);
+
+  Eigen::MatrixXd expanded(3, 6);
+  for (Eigen::Index site = 0; site < 6; ++site)
+    expanded.col(site) = tip.codeLikelihoods.col(tip.siteCodes(site));
+
+  auto sequence = TipSequence_DF::create(c, TipLikelihood(tip), "leaf");
+  auto leaf = TipConditionalLikelihood::create(c, {sequence}, dim);
+  CHECK(leaf->getTargetValue().float_part() == expanded);
+
+  Eigen::MatrixXd transition(3, 3);
+  transition << 0.8, 0.1, 0.1,
+                0.2, 0.7, 0.1,
+                0.3, 0.3, 0.4;
+  auto p = NumericMutable<Eigen::MatrixXd>::create(c, transition);
+  auto forward = TipTransition::create(c, {p, sequence}, dim);
+  auto dense = MatrixProduct<MatrixLik, Eigen::MatrixXd, MatrixLik>::create(c, {p, leaf}, dim);
+  CHECK(forward->getTargetValue().float_part().isApprox(dense->getTargetValue().float_part()));
+  CHECK(forward->getTargetValue().exponent_part() == dense->getTargetValue().exponent_part());
+
+  // Derivation only goes through the transition matrix
+  auto dforward = forward->deriveAsValue(c, *p);
+  auto ddense = dense->deriveAsValue(c, *p);
+  CHECK(dforward->getTargetValue().float_part().isApprox(ddense->getTargetValue().float_part()));
+
+  // Identity transition is the leaf itself
+  auto identity = NumericConstant<Eigen::MatrixXd>::create(c, Eigen::MatrixXd::Identity(3, 3));
+  CHECK(TipTransition::create(c, {identity, sequence}, dim) == leaf);
+
+  dotOutput("dataflow_tip_transition", {forward.get(), leaf.get()});
+}
+
+TEST_CASE("dataflow_rate_categories")
+{
+  // Two rate categories over a cherry (leaf, inner node)
+  Context c;
+  TipLikelihood tip;
+  tip.codeLikelihoods = Eigen::MatrixXd(2, 3);
+  tip.codeLikelihoods << 1, 0, 1,
+                         0, 1, 1;
+  tip.siteCodes = Eigen::RowVectorXi(4);
+  tip.siteCodes << 0, 2, 1, 0;
+  const Dimension<MatrixLik> dim(2, 4);
+  const Dimension<MatrixLik> stackedDim(2, 8);
+
+  auto sequence = TipSequence_DF::create(c, std::move(tip), "leaf");
+  Eigen::MatrixXd transition(2, 2);
+  transition << 0.9, 0.1,
+                0.3, 0.7;
+  auto p0 = NumericMutable<Eigen::MatrixXd>::create(c, transition);
+  auto p1 = NumericMutable<Eigen::MatrixXd>::create(c, Eigen::MatrixXd(transition * transition));
+  Eigen::MatrixXd below(2, 4);
+  below << 0.1, 0.5, 0.3, 1.,
+           0.2, 0.5, 0.8, 0.;
+  auto x0 = NumericMutable<MatrixLik>::create(c, MatrixLik(below));
+  auto x1 = NumericMutable<MatrixLik>::create(c, MatrixLik(below.cwiseProduct(below)));
+  auto prob0 = NumericMutable<double>::create(c, 0.25);
+  auto prob1 = NumericMutable<double>::create(c, 0.75);
+  auto freqs = NumericConstant<Eigen::RowVectorXd>::create(c, Eigen::RowVectorXd::Constant(2, 0.5));
+
+  // Per category
+  NodeRefVec perCategory;
+  for (const auto& cat : std::vector<std::pair<NodeRef, NodeRef> >{{p0, x0}, {p1, x1}})
+  {
+    auto tipForward = TipTransition::create(c, {cat.first, sequence}, dim);
+    auto forward = MatrixProduct<MatrixLik, Eigen::MatrixXd, MatrixLik>::create(c, {cat.first, cat.second}, dim);
+    auto speciation = CWiseMul<MatrixLik, ReductionOf<MatrixLik> >::create(c, {tipForward, forward}, dim);
+    perCategory.push_back(MatrixProduct<RowLik, Eigen::RowVectorXd, MatrixLik>::create(c, {freqs, speciation}, RowVectorDimension(4)));
+  }
+  perCategory.push_back(prob0);
+  perCategory.push_back(prob1);
+  auto mean = CWiseMean<RowLik, ReductionOf<RowLik>, ReductionOf<double> >::create(c, std::move(perCategory), RowVectorDimension(4));
+
+  // Stacked
+  Eigen::MatrixXd stackedBelow(2, 8);
+  stackedBelow << below, below.cwiseProduct(below);
+  auto x = NumericMutable<MatrixLik>::create(c, MatrixLik(stackedBelow));
+  auto tipForward = RateCategoriesTipTransition::create(c, {p0, p1, sequence}, stackedDim);
+  auto forward = RateCategoriesTransition::create(c, {p0, p1, x}, stackedDim);
+  auto speciation = CWiseMul<MatrixLik, ReductionOf<MatrixLik> >::create(c, {tipForward, forward}, stackedDim);
+  auto stackedLik = MatrixProduct<RowLik, Eigen::RowVectorXd, MatrixLik>::create(c, {freqs, speciation}, RowVectorDimension(8));
+  auto stackedMean = RateCategoriesMean::create(c, {stackedLik, prob0, prob1}, RowVectorDimension(4));
+
+  const auto& meanValue = mean->getTargetValue();
+  const auto& stackedValue = stackedMean->getTargetValue();
+  for (Eigen::Index site = 0; site < 4; ++site)
+  {
+    CHECK(doctest::Approx(convert(stackedValue(site))) == convert(meanValue(site)));
+  }
+
+  // Derivatives with respect to a transition matrix and to a probability
+  for (const Node_DF* variable : std::vector<const Node_DF*>{p1.get(), prob0.get()})
+  {
+    auto dmean = mean->deriveAsValue(c, *variable);
+    auto dstacked = stackedMean->deriveAsValue(c, *variable);
+    for (Eigen::Index site = 0; site < 4; ++site)
+    {
+      CHECK(doctest::Approx(convert(dstacked->getTargetValue()(site))) == convert(dmean->getTargetValue()(site)));
+    }
+  }
+
+  dotOutput("dataflow_rate_categories", {stackedMean.get()});
+}
+
+TEST_CASE("dataflow_site_repeats")
+{
+  // ((leaf0, leaf1), leaf2) over 8 sites, with repeated sub-patterns
+  Context c;
+  std::vector<NodeRef> sequences;
+  for (const auto& codes : std::vector<std::vector<int> >{{0, 1, 0, 1, 0, 2, 0, 1}, {1, 1, 1, 1, 0, 0, 1, 1}, {0, 0, 1, 1, 1, 0, 0, 1}})
+  {
+    TipLikelihood tip;
+    tip.codeLikelihoods = Eigen::MatrixXd(2, 3);
+    tip.codeLikelihoods << 1, 0, 1,
+                           0, 1, 1;
+    tip.siteCodes = Eigen::RowVectorXi(8);
+    for (Eigen::Index site = 0; site < 8; ++site)
+      tip.siteCodes(site) = codes[size_t(site)];
+    sequences.push_back(TipSequence_DF::create(c, std::move(tip), "leaf" + std::to_string(sequences.size())));
+  }
+  const Dimension<MatrixLik> dim(2, 8);
+
+  std::vector<std::shared_ptr<NumericMutable<Eigen::MatrixXd> > > p;
+  for (double t : {0.1, 0.2, 0.3, 0.4})
+  {
+    Eigen::MatrixXd transition(2, 2);
+    transition << 1 - t, t,
+                  t / 2, 1 - t / 2;
+    p.push_back(NumericMutable<Eigen::MatrixXd>::create(c, transition));
+  }
+
+  auto inner = SpeciationSiteRepeats::create(c, {p[0], sequences[0], p[1], sequences[1]}, dim);
+  auto root = SpeciationSiteRepeats::create(c, {p[2], inner, p[3], sequences[2]}, dim);
+  const auto& innerRepeats = dynamic_cast<const SpeciationSiteRepeats&>(*inner);
+  const auto& rootRepeats = dynamic_cast<const SpeciationSiteRepeats&>(*root);
+  CHECK(innerRepeats.getNumberOfClasses() == 4);
+  CHECK(rootRepeats.getNumberOfClasses() == 6);
+
+  using ForwardProduct = MatrixProduct<MatrixLik, Eigen::MatrixXd, MatrixLik>;
+  auto innerRef = CWiseMul<MatrixLik, ReductionOf<MatrixLik> >::create(
+    c, {TipTransition::create(c, {p[0], sequences[0]}, dim), TipTransition::create(c, {p[1], sequences[1]}, dim)}, dim);
+  auto rootRef = CWiseMul<MatrixLik, ReductionOf<MatrixLik> >::create(
+    c, {ForwardProduct::create(c, {p[2], innerRef}, dim), TipTransition::create(c, {p[3], sequences[2]}, dim)}, dim);
+  CHECK(root->getTargetValue().float_part().isApprox(rootRef->getTargetValue().float_part()));
+  CHECK(root->getTargetValue().exponent_part() == rootRef->getTargetValue().exponent_part());
+
+  // Derivative with respect to a transition matrix below the inner node
+  auto droot = root->deriveAsValue(c, *p[0]);
+  auto drootRef = rootRef->deriveAsValue(c, *p[0]);
+  CHECK(droot->getTargetValue().float_part().isApprox(drootRef->getTargetValue().float_part()));
+
+  // Two rate categories, stacked
+  const Dimension<MatrixLik> stackedDim(2, 16);
+  auto stackedInner = SpeciationSiteRepeats::create(c, {p[0], p[1], sequences[0], p[1], p[2], sequences[1]}, stackedDim, 2);
+  auto stackedRoot = SpeciationSiteRepeats::create(c, {p[2], p[3], stackedInner, p[3], p[0], sequences[2]}, stackedDim, 2);
+  auto stackedInnerRef = CWiseMul<MatrixLik, ReductionOf<MatrixLik> >::create(
+    c, {RateCategoriesTipTransition::create(c, {p[0], p[1], sequences[0]}, stackedDim),
+        RateCategoriesTipTransition::create(c, {p[1], p[2], sequences[1]}, stackedDim)}, stackedDim);
+  auto stackedRootRef = CWiseMul<MatrixLik, ReductionOf<MatrixLik> >::create(
+    c, {RateCategoriesTransition::create(c, {p[2], p[3], stackedInnerRef}, stackedDim),
+        RateCategoriesTipTransition::create(c, {p[3], p[0], sequences[2]}, stackedDim)}, stackedDim);
+  CHECK(stackedRoot->getTargetValue().float_part().isApprox(stackedRootRef->getTargetValue().float_part()));
+
+  // Recomputation after a change of a transition matrix
+  p[1]->setValue(Eigen::MatrixXd(Eigen::MatrixXd::Identity(2, 2)));
+  CHECK(root->getTargetValue().float_part().isApprox(rootRef->getTargetValue().float_part()));
+  CHECK(stackedRoot->getTargetValue().float_part().isApprox(stackedRootRef->getTargetValue().float_part()));
+
+  dotOutput("dataflow_site_repeats", {root.get(), stackedRoot.get()});
+}
+
+TEST_CASE("dataflow_site_repeats_trifurcation")
+{
+  // Trifurcating root over three deep caterpillars, whose conditional
+  // likelihoods would underflow if multiplied before normalization.
+  Context c;
+  TipLikelihood tip;
+  tip.codeLikelihoods = Eigen::MatrixXd(2, 3);
+  tip.codeLikelihoods << 1, 0, 1,
+                         0, 1, 1;
+  tip.siteCodes = Eigen::RowVectorXi(4);
+  tip.siteCodes << 0, 1, 1, 0;
+  auto leaf = TipSequence_DF::create(c, std::move(tip), "leaf");
+  const Dimension<MatrixLik> dim(2, 4);
+
+  Eigen::MatrixXd transition(2, 2);
+  transition << 0.6, 0.4,
+                0.3, 0.7;
+  auto p = NumericMutable<Eigen::MatrixXd>::create(c, transition);
+
+  NodeRefVec rootDeps;
+  NodeRefVec factors;
+  using ForwardProduct = MatrixProduct<MatrixLik, Eigen::MatrixXd, MatrixLik>;
+  for (int son = 0; son < 3; ++son)
+  {
+    NodeRef node = leaf;
+    for (int depth = 0; depth < 400 + 10 * son; ++depth)
+      node = SpeciationSiteRepeats::create(c, {p, node, p, leaf}, dim);
+    rootDeps.push_back(p);
+    rootDeps.push_back(node);
+    factors.push_back(ForwardProduct::create(c, {p, node}, dim));
+  }
+  auto root = SpeciationSiteRepeats::create(c, std::move(rootDeps), dim);
+  auto rootRef = CWiseMul<MatrixLik, ReductionOf<MatrixLik> >::create(c, std::move(factors), dim);
+
+  const auto& value = root->getTargetValue();
+  const auto& ref = rootRef->getTargetValue();
+  CHECK(value.float_part().minCoeff() > 0);
+  CHECK(value.exponent_part() < -1000);
+  CHECK(value.exponent_part() == ref.exponent_part());
+  CHECK(value.float_part().isApprox(ref.float_part()));
+}
+
+TEST_CASE("dataflow_site_scaled_forward")
+{
+  // ((leaf0, leaf1), leaf2) over 8 sites with two rate categories, as
+  // in dataflow_site_repeats, with one exponent per site.
+  Context c;
+  std::vector<NodeRef> sequences;
+  for (const auto& codes : std::vector<std::vector<int> >{{0, 1, 0, 1, 0, 2, 0, 1}, {1, 1, 1, 1, 0, 0, 1, 1}, {0, 0, 1, 1, 1, 0, 0, 1}})
+  {
+    TipLikelihood tip;
+    tip.codeLikelihoods = Eigen::MatrixXd(2, 3);
+    tip.codeLikelihoods << 1, 0, 1,
+                           0, 1, 1;
+    tip.siteCodes = Eigen::RowVectorXi(8);
+    for (Eigen::Index site = 0; site < 8; ++site)
+      tip.siteCodes(site) = codes[size_t(site)];
+    sequences.push_back(TipSequence_DF::create(c, std::move(tip), "leaf" + std::to_string(sequences.size())));
+  }
+  const Dimension<MatrixLik> stackedDim(2, 16);
+
+  std::vector<std::shared_ptr<NumericMutable<Eigen::MatrixXd> > > p;
+  for (double t : {0.1, 0.2, 0.3, 0.4})
+  {
+    Eigen::MatrixXd transition(2, 2);
+    transition << 1 - t, t,
+                  t / 2, 1 - t / 2;
+    p.push_back(NumericMutable<Eigen::MatrixXd>::create(c, transition));
+  }
+  auto prob0 = NumericMutable<double>::create(c, 0.25);
+  auto prob1 = NumericMutable<double>::create(c, 0.75);
+  auto freqs = NumericConstant<Eigen::RowVectorXd>::create(c, Eigen::RowVectorXd::Constant(2, 0.5));
+  Eigen::RowVectorXi siteWeights(8);
+  siteWeights << 1, 2, 1, 3, 1, 1, 2, 1;
+  auto weights = NumericConstant<Eigen::RowVectorXi>::create(c, siteWeights);
+
+  auto stackedInner = SpeciationSiteRepeats::create(c, {p[0], p[1], sequences[0], p[1], p[2], sequences[1]}, stackedDim, 2);
+  auto stackedRoot = SpeciationSiteRepeats::create(c, {p[2], p[3], stackedInner, p[3], p[0], sequences[2]}, stackedDim, 2);
+  auto stackedLik = MatrixProduct<RowLik, Eigen::RowVectorXd, MatrixLik>::create(c, {freqs, stackedRoot}, RowVectorDimension(16));
+  auto mean = RateCategoriesMean::create(c, {stackedLik, prob0, prob1}, RowVectorDimension(8));
+  auto val = SumOfLogarithms<RowLik>::create(c, {mean, weights}, RowVectorDimension(8));
+
+  auto inner = SiteScaledSpeciation::create(c, {p[0], p[1], sequences[0], p[1], p[2], sequences[1]}, stackedDim, 2);
+  auto root = SiteScaledSpeciation::create(c, {p[2], p[3], inner, p[3], p[0], sequences[2]}, stackedDim, 2);
+  auto lik = SiteScaledLogLikelihood::create(c, {freqs, root, prob0, prob1, weights}, val, 2);
+  CHECK(dynamic_cast<const SiteScaledSpeciation&>(*root).getNumberOfClasses() == 6);
+
+  const auto rootValue = root->getTargetValue().toExtendedFloatMatrix();
+  const auto& rootRef = stackedRoot->getTargetValue();
+  const double precision = 100 * std::numeric_limits<SiteScaledStorage>::epsilon();
+  CHECK((rootValue.float_part() * std::pow(2., rootValue.exponent_part() - rootRef.exponent_part()) - rootRef.float_part()).cwiseAbs().maxCoeff() <= precision);
+  CHECK(doctest::Approx(convert(lik->getTargetValue())) == convert(val->getTargetValue()));
+
+  // In single precision, accurate enough for the default tolerance.
+  const auto& mixed = dynamic_cast<const SiteScaledLogLikelihood&>(*lik).getMixedPrecision();
+  CHECK(mixed.getTolerance() == SiteScaledLogLikelihood::defaultTolerance());
+  CHECK(!mixed.isLastValueInDouble());
+  CHECK(mixed.getNumberOfDoubleEvaluations() == 0);
+
+  // Derivatives computed on the site scaled forward likelihoods
+  const auto derivativePrecision = 1000 * std::numeric_limits<SiteScaledStorage>::epsilon();
+  auto checkDerivatives = [&]() {
+      for (const Node_DF* variable : std::vector<const Node_DF*>{p[0].get(), p[3].get(), prob0.get()})
+      {
+        auto dlik = lik->deriveAsValue(c, *variable);
+        CHECK(dynamic_cast<const SiteScaledLogLikelihoodDerivative*>(dlik.get()) != nullptr);
+        CHECK(convert(dlik->getTargetValue()) == doctest::Approx(convert(val->deriveAsValue(c, *variable)->getTargetValue())).epsilon(derivativePrecision));
+      }
+    };
+  checkDerivatives();
+  CHECK(lik->deriveAsValue(c, *freqs)->hasNumericalProperty(NumericalProperty::ConstantZero) == false);
+  CHECK(lik->deriveAsValue(c, *weights)->hasNumericalProperty(NumericalProperty::ConstantZero));
+
+  // Recomputation after a change of a transition matrix or of a probability
+  p[1]->setValue(Eigen::MatrixXd(Eigen::MatrixXd::Identity(2, 2)));
+  prob0->setValue(0.5);
+  prob1->setValue(0.5);
+  CHECK(doctest::Approx(convert(lik->getTargetValue())) == convert(val->getTargetValue()));
+  checkDerivatives();
+
+  dotOutput("dataflow_site_scaled_forward", {lik.get()});
+}
+
+TEST_CASE("dataflow_site_scaled_forward_deep")
+{
+  // Deep caterpillar over a site without information (code 2), which
+  // keeps a likelihood of 1, and two informative sites, which become
+  // too small to share an exponent with it.
+  Context c;
+  auto makeLeaf = [&c](std::vector<int> codes, const std::string& name) {
+      TipLikelihood tip;
+      tip.codeLikelihoods = Eigen::MatrixXd(2, 3);
+      tip.codeLikelihoods << 1, 0, 1,
+                             0, 1, 1;
+      tip.siteCodes = Eigen::RowVectorXi(Eigen::Index(codes.size()));
+      for (size_t site = 0; site < codes.size(); ++site)
+        tip.siteCodes(Eigen::Index(site)) = codes[site];
+      return TipSequence_DF::create(c, std::move(tip), name);
+    };
+  auto leaf = makeLeaf({0, 1, 2}, "leaf");
+  auto informativeLeaf = makeLeaf({0, 1}, "informative");
+  auto uninformativeLeaf = makeLeaf({2}, "uninformative");
+
+  Eigen::MatrixXd transition(2, 2);
+  transition << 0.6, 0.4,
+                0.3, 0.7;
+  auto p = NumericMutable<Eigen::MatrixXd>::create(c, transition);
+  auto one = NumericConstant<double>::create(c, 1.);
+  auto freqs = NumericConstant<Eigen::RowVectorXd>::create(c, Eigen::RowVectorXd::Constant(2, 0.5));
+
+  NodeRef node = leaf;
+  NodeRef informative = informativeLeaf;
+  NodeRef uninformative = uninformativeLeaf;
+  NodeRef repeats = leaf;
+  for (int depth = 0; depth < 1500; ++depth)
+  {
+    node = SiteScaledSpeciation::create(c, {p, node, p, leaf}, Dimension<MatrixLik>(2, 3));
+    informative = SpeciationSiteRepeats::create(c, {p, informative, p, informativeLeaf}, Dimension<MatrixLik>(2, 2));
+    uninformative = SpeciationSiteRepeats::create(c, {p, uninformative, p, uninformativeLeaf}, Dimension<MatrixLik>(2, 1));
+    repeats = SpeciationSiteRepeats::create(c, {p, repeats, p, leaf}, Dimension<MatrixLik>(2, 3));
+  }
+
+  // The informative sites alone, the uninformative one alone, and all
+  // the sites in MatrixLik, where the informative ones underflow.
+  auto informativeVal = SumOfLogarithms<RowLik>::create(
+    c, {MatrixProduct<RowLik, Eigen::RowVectorXd, MatrixLik>::create(c, {freqs, informative}, RowVectorDimension(2))}, RowVectorDimension(2));
+  auto uninformativeVal = SumOfLogarithms<RowLik>::create(
+    c, {MatrixProduct<RowLik, Eigen::RowVectorXd, MatrixLik>::create(c, {freqs, uninformative}, RowVectorDimension(1))}, RowVectorDimension(1));
+  auto val = SumOfLogarithms<RowLik>::create(
+    c, {MatrixProduct<RowLik, Eigen::RowVectorXd, MatrixLik>::create(c, {freqs, repeats}, RowVectorDimension(3))}, RowVectorDimension(3));
+  auto lik = SiteScaledLogLikelihood::create(c, {freqs, node, one}, val, 1);
+
+  const auto logLikelihood = convert(lik->getTargetValue());
+  CHECK(std::isfinite(logLikelihood));
+  CHECK(logLikelihood < -1500);
+  CHECK(logLikelihood == doctest::Approx(convert(informativeVal->getTargetValue())));
+  CHECK(!std::isfinite(convert(val->getTargetValue())));
+
+  // The derivative does not underflow either.
+  const auto derivative = convert(lik->deriveAsValue(c, *p)->getTargetValue());
+  const auto derivativeRef = convert(informativeVal->deriveAsValue(c, *p)->getTargetValue()) +
+                             convert(uninformativeVal->deriveAsValue(c, *p)->getTargetValue());
+  CHECK(std::isfinite(derivative));
+  CHECK(derivative == doctest::Approx(derivativeRef).epsilon(1000 * std::numeric_limits<SiteScaledStorage>::epsilon()));
+  CHECK(!std::isfinite(convert(val->deriveAsValue(c, *p)->getTargetValue())));
+  CHECK(convert(lik->getTargetValue()) == logLikelihood);
+}
+
 /******************************************************************************
  * Test dataflow numerical nodes.
  */
@@ -561,6 +1251,116 @@ TEST_CASE("numerical_derivation")
   dotOutput("numerical_derivation", {f.get(), df_ddummy.get(), df_dx.get(), df_dy.get(), d2f_dx2.get()});
 }
 
+TEST_CASE("extended_float_colwise")
+{
+  // One exponent per site: a site much smaller than the others keeps
+  // its precision along a deep tree.
+  const Eigen::Index nbStates = 4;
+  const Eigen::MatrixXd transition = 0.7 * Eigen::MatrixXd::Identity(nbStates, nbStates) + Eigen::MatrixXd::Constant(nbStates, nbStates, 0.075);
+  Eigen::MatrixXd leaf = Eigen::MatrixXd::Zero(nbStates, 3);
+  leaf(0, 0) = 1.;
+  leaf(1, 1) = 0.5;
+  leaf(0, 2) = 1e-300;
+
+  const ExtendedFloatColwiseMatrixXd tip(leaf);
+  CHECK(tip(0, 2).float_part() * std::pow(2., tip(0, 2).exponent_part()) == doctest::Approx(1e-300));
+
+  ExtendedFloatColwiseMatrixXd toTip;
+  ExtendedFloatColwiseMatrixXd::product(transition, tip, toTip);
+  ExtendedFloatColwiseMatrixXd x(tip), forward;
+  const int depth = 2000;
+  for (int i = 0; i < depth; ++i)
+  {
+    ExtendedFloatColwiseMatrixXd::product(transition, x, forward);
+    ExtendedFloatColwiseMatrixXd::mul(forward, toTip, x);
+    if (i == 0)
+    {
+      const Eigen::MatrixXd expected = (transition * leaf).cwiseProduct(transition * leaf);
+      const auto single = x.toExtendedFloatMatrix();
+      CHECK((single.float_part() * std::pow(2., single.exponent_part()) - expected).cwiseAbs().maxCoeff() <= 1e-12);
+    }
+  }
+
+  const Eigen::RowVectorXd freqs = Eigen::RowVectorXd::Constant(nbStates, 1. / double(nbStates));
+  ExtendedFloatColwiseRowVectorXd sites;
+  ExtendedFloatColwiseRowVectorXd::product(freqs, x, sites);
+  const double log0 = std::log(sites(0, 0).float_part()) + sites(0, 0).exponent_part() * ExtendedFloat::ln_radix;
+  const double log2 = std::log(sites(0, 2).float_part()) + sites(0, 2).exponent_part() * ExtendedFloat::ln_radix;
+  CHECK(std::isfinite(log0));
+  CHECK(log2 - log0 == doctest::Approx((depth + 1) * std::log(1e-300)));
+
+  const Eigen::RowVectorXi weights = Eigen::RowVectorXi::Constant(3, 2);
+  CHECK(sites.sumOfLogarithms(weights) == doctest::Approx(2 * sites.sumOfLogarithms()));
+
+  // Null columns vanish in sums.
+  ExtendedFloatColwiseMatrixXd sum(nbStates, 3);
+  ExtendedFloatColwiseMatrixXd::add(sum, x, sum);
+  CHECK(sum.float_part() == x.float_part());
+  CHECK(sum.exponent_part() == x.exponent_part());
+}
+
+// Log-likelihood of a deep tree with per-site scaled likelihoods stored as T.
+template<typename T>
+static double deepTreeLogLikelihood(const Eigen::MatrixXd& transition, const Eigen::MatrixXd& leaf, const Eigen::RowVectorXd& freqs)
+{
+  using Matrix = ExtendedFloatColwiseMatrix<Eigen::Dynamic, Eigen::Dynamic, T>;
+  using Row = ExtendedFloatColwiseMatrix<1, Eigen::Dynamic, T>;
+  const Matrix tip(leaf);
+  Matrix toTip, forward;
+  Matrix::product(transition, tip, toTip);
+  Matrix x(tip);
+  for (int i = 0; i < 500; ++i)
+  {
+    Matrix::product(transition, x, forward);
+    Matrix::mul(forward, toTip, x);
+  }
+  Row sites;
+  Row::product(freqs, x, sites);
+  return sites.sumOfLogarithms();
+}
+
+TEST_CASE("extended_float_colwise_float32")
+{
+  // Same deep tree in single and double precision storage.
+  const Eigen::Index nbStates = 4;
+  const Eigen::Index nbSites = 100;
+  const Eigen::MatrixXd transition = 0.6 * Eigen::MatrixXd::Identity(nbStates, nbStates) + Eigen::MatrixXd::Constant(nbStates, nbStates, 0.1);
+  const Eigen::MatrixXd leaf = Eigen::MatrixXd::Random(nbStates, nbSites).cwiseAbs();
+  const Eigen::RowVectorXd freqs = Eigen::RowVectorXd::Constant(nbStates, 1. / double(nbStates));
+  auto logLikelihood = [&](bool inSingle) {
+    return inSingle ? deepTreeLogLikelihood<float>(transition, leaf, freqs) : deepTreeLogLikelihood<double>(transition, leaf, freqs);
+  };
+
+  const double inDouble = logLikelihood(false);
+  int nbSingleEvaluations = 0;
+  MixedPrecisionLogLikelihood mixed(
+    [&]() { nbSingleEvaluations++; return logLikelihood(true); },
+    [&]() { return logLikelihood(false); },
+    1000.);
+  const double bound = mixed.getErrorBound(inDouble);
+  CHECK(std::isfinite(inDouble));
+
+  // Without tolerance, only in double precision.
+  CHECK(mixed.getValue() == inDouble);
+  CHECK(mixed.isLastValueInDouble());
+  CHECK(nbSingleEvaluations == 0);
+
+  mixed.setTolerance(10 * bound);
+  const double inSingle = mixed.getValue();
+  CHECK(!mixed.isLastValueInDouble());
+  CHECK(std::abs(inSingle - inDouble) <= bound);
+
+  // Too accurate for single precision, or too close to a reference value.
+  mixed.setTolerance(bound / 10);
+  CHECK(mixed.getValue() == inDouble);
+  CHECK(mixed.isLastValueInDouble());
+  mixed.setTolerance(10 * bound);
+  CHECK(mixed.getValueComparedTo(inSingle + bound / 2) == inDouble);
+  CHECK(mixed.getValueComparedTo(inSingle + 2 * bound) == inSingle);
+  CHECK(mixed.getNumberOfDoubleEvaluations() == 3);
+  CHECK(nbSingleEvaluations == 4);
+}
+
 int main(int argc, char** argv)
 {
   const std::string keyword = "dot_output";
@@ -53,7 +53,11 @@
 #include <Bpp/Phyl/Likelihood/RateAcrossSitesSubstitutionProcess.h>
 
 #include <Bpp/Phyl/Likelihood/DataFlow/LikelihoodCalculationSingleProcess.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/LikelihoodSnapshot.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/SingleBranchLikelihood.h>
 
+#include <cstdio>
+#include <functional>
 #include <iostream>
 
 
@@ -206,6 +210,212 @@ void fitModelHSR(std::shared_ptr<SubstitutionModel> model, std::shared_ptr<Discr
 }
 
 
+std::shared_ptr<RateAcrossSitesSubstitutionProcess> makeProcess(std::shared_ptr<SubstitutionModel> model, std::shared_ptr<DiscreteDistribution> rdist,
+                                                                const ParametrizablePhyloTree& partree)
+{
+  return std::make_shared<RateAcrossSitesSubstitutionProcess>(std::shared_ptr<SubstitutionModel>(model->clone()), std::shared_ptr<DiscreteDistribution>(rdist->clone()), std::shared_ptr<ParametrizablePhyloTree>(partree.clone()));
+}
+
+// Adjoint derivatives vs derivation of the likelihood node
+void testAdjointDerivatives(std::shared_ptr<SubstitutionModel> model, std::shared_ptr<DiscreteDistribution> rdist,
+                            const ParametrizablePhyloTree& partree,
+                            const SiteContainer& sites)
+{
+  auto process = makeProcess(model, rdist, partree);
+  Context context;
+  auto lik = std::make_shared<LikelihoodCalculationSingleProcess>(context, sites, *process);
+  SingleProcessPhyloLikelihood llh(context, lik);
+  // On the stacked rate categories, until the adjoint derivatives
+  // need the per category trees.
+  double value = llh.getValue();
+
+  for (size_t i = 0; i < llh.getParameters().size(); ++i)
+  {
+    const auto name = llh.getParameters()[i].getName();
+    auto param = dynamic_cast<ConfiguredParameter*>(lik->getSharedParameter(name).get());
+    if (!param)
+      continue;
+    double direct = convert(lik->getLikelihoodNode()->deriveAsValue(context, *param->dependency(0))->getTargetValue());
+    double adjoint = -llh.getFirstOrderDerivative(name);
+    cout << "NewTL D1 " << name << ": " << setprecision(20) << adjoint << " (direct: " << direct << ")" << endl;
+    if (abs(adjoint - direct) > 1e-6 * max(1., abs(direct)))
+      throw Exception("Incorrect adjoint derivative for " + name);
+  }
+  if (abs(llh.getValue() - value) > 1e-9 * abs(value))
+    throw Exception("Incorrect value on the per category trees.");
+}
+
+// Single branch likelihoods vs the whole likelihood
+void testSingleBranchLikelihood(std::shared_ptr<SubstitutionModel> model, std::shared_ptr<DiscreteDistribution> rdist,
+                                const ParametrizablePhyloTree& partree,
+                                const SiteContainer& sites)
+{
+  auto process = makeProcess(model, rdist, partree);
+  Context context;
+  auto lik = std::make_shared<LikelihoodCalculationSingleProcess>(context, sites, *process);
+  SingleProcessPhyloLikelihood llh(context, lik);
+
+  for (auto edge : lik->getTreeNode(0)->getAllEdges())
+  {
+    uint edgeId = lik->getTreeNode(0)->getEdgeIndex(edge);
+    auto brlen = lik->getBranchLengthParameter(edgeId);
+    SingleBranchLikelihood sbl(*lik, edgeId);
+    double sbValue = -sbl.getLogLikelihood(brlen->getValue());
+    double sbD1 = -sbl.getFirstOrderDerivative(brlen->getValue());
+    cout << "Single branch " << brlen->getName() << ": " << setprecision(20) << sbValue << " D1: " << sbD1 << endl;
+    if (abs(sbValue - llh.getValue()) > 1e-6 * abs(llh.getValue()))
+      throw Exception("Incorrect single branch likelihood for " + brlen->getName());
+    if (abs(sbD1 - llh.getFirstOrderDerivative(brlen->getName())) > 1e-6 * max(1., abs(sbD1)))
+      throw Exception("Incorrect single branch derivative for " + brlen->getName());
+  }
+
+  double valueInit = llh.getValue();
+  SingleBranchLikelihood::optimizeAllBranches(*lik);
+  cout << "Single branch optimization: " << setprecision(20) << llh.getValue() << endl;
+  if (llh.getValue() > valueInit + 1e-6)
+    throw Exception("Single branch optimization decreased the likelihood.");
+}
+
+// Restart from a snapshot, without the alignment
+void testSnapshot(std::shared_ptr<SubstitutionModel> model, std::shared_ptr<DiscreteDistribution> rdist,
+                  const ParametrizablePhyloTree& partree,
+                  const SiteContainer& sites)
+{
+  auto process = makeProcess(model, rdist, partree);
+  Context context;
+  auto lik = std::make_shared<LikelihoodCalculationSingleProcess>(context, sites, *process);
+  SingleProcessPhyloLikelihood llh(context, lik);
+  llh.getValue();
+
+  LikelihoodSnapshot(*lik).write("test_likelihood.snapshot");
+  Context context2;
+  auto lik2 = std::make_shared<LikelihoodCalculationSingleProcess>(context2, *process);
+  LikelihoodSnapshot::read("test_likelihood.snapshot").restore(*lik2);
+  std::remove("test_likelihood.snapshot");
+  SingleProcessPhyloLikelihood llh2(context2, lik2);
+  cout << "Snapshot: " << setprecision(20) << llh2.getValue() << endl;
+  if (abs(llh2.getValue() - llh.getValue()) > 1e-9 * abs(llh.getValue()))
+    throw Exception("Incorrect value after snapshot.");
+}
+
+// Constant folding with only the branch lengths as variables: the
+// model and rates sub-graphs are computed once, and the branch
+// lengths still update the likelihood.
+void testConstantFolding(std::shared_ptr<SubstitutionModel> model, std::shared_ptr<DiscreteDistribution> rdist,
+                         const ParametrizablePhyloTree& partree,
+                         const SiteContainer& sites)
+{
+  auto process = makeProcess(model, rdist, partree);
+  Context context;
+  auto lik = std::make_shared<LikelihoodCalculationSingleProcess>(context, sites, *process);
+  SingleProcessPhyloLikelihood llh(context, lik);
+  // Reference, never folded.
+  Context context2;
+  auto lik2 = std::make_shared<LikelihoodCalculationSingleProcess>(context2, sites, *process);
+  SingleProcessPhyloLikelihood llh2(context2, lik2);
+
+  auto checkValue = [&llh, &llh2](const std::string& step) {
+                      if (abs(llh.getValue() - llh2.getValue()) > 1e-9 * abs(llh2.getValue()))
+                        throw Exception("Incorrect value " + step + ".");
+                    };
+  auto setValue = [](LikelihoodCalculationSingleProcess& l, const std::string& name, double value) {
+                    ParameterList pl;
+                    pl.addParameter(Parameter(name, value));
+                    l.matchParametersValues(pl);
+                  };
+
+  ParameterList brlens;
+  std::string kappa;
+  for (size_t i = 0; i < lik->getParameters().size(); ++i)
+  {
+    const auto& param = lik->getParameters()[i];
+    if (param.getName().substr(0, 5) == "BrLen")
+      brlens.addParameter(param);
+    else if (param.getName().substr(0, 9) == "T92.kappa")
+      kappa = param.getName();
+  }
+  if (kappa.empty())
+    throw Exception("No kappa parameter.");
+
+  // Nothing is folded at build: parameters aliased or changed
+  // afterwards are still followed.
+  checkValue("at build");
+  lik->aliasParameters("BrLen1", "BrLen2");
+  setValue(*lik, "BrLen1", 0.1);
+  setValue(*lik2, "BrLen1", 0.1);
+  setValue(*lik2, "BrLen2", 0.1);
+  checkValue("with branch lengths aliased after the build");
+  setValue(*lik, kappa, 2.);
+  setValue(*lik2, kappa, 2.);
+  checkValue("after a change of a model parameter");
+
+  // Explicit folding, on the branch lengths only.
+  auto report = lik->foldConstants(brlens);
+  cout << "Folded: " << report.nbFolded << endl;
+  if (report.nbFolded == 0)
+    throw Exception("No constant sub-graph folded.");
+  checkValue("after constant folding");
+  setValue(*lik, "BrLen1", 0.2);
+  setValue(*lik2, "BrLen1", 0.2);
+  setValue(*lik2, "BrLen2", 0.2);
+  checkValue("after constant folding and a change of aliased branch lengths");
+
+  // Folding with all the parameters as variables keeps them all.
+  Context context3;
+  auto lik3 = std::make_shared<LikelihoodCalculationSingleProcess>(context3, sites, *process);
+  SingleProcessPhyloLikelihood llh3(context3, lik3);
+  lik3->foldConstants(lik3->getParameters());
+  setValue(*lik3, "BrLen1", 0.2);
+  setValue(*lik3, "BrLen2", 0.2);
+  setValue(*lik3, kappa, 4.);
+  setValue(*lik2, kappa, 4.);
+  if (abs(llh3.getValue() - llh2.getValue()) > 1e-9 * abs(llh2.getValue()))
+    throw Exception("Incorrect value after constant folding and a change of a model parameter.");
+}
+
+// Log-likelihood and first order derivatives with one exponent per
+// site vs the default ones
+void testSiteScaledLikelihood(std::shared_ptr<SubstitutionModel> model, std::shared_ptr<DiscreteDistribution> rdist,
+                              const ParametrizablePhyloTree& partree,
+                              const SiteContainer& sites)
+{
+  auto process = makeProcess(model, rdist, partree);
+  Context context;
+  auto lik = std::make_shared<LikelihoodCalculationSingleProcess>(context, sites, *process);
+  SingleProcessPhyloLikelihood llh(context, lik);
+  Context context2;
+  auto lik2 = std::make_shared<LikelihoodCalculationSingleProcess>(context2, sites, *process);
+  lik2->setSiteScaledLikelihood(true);
+  SingleProcessPhyloLikelihood llh2(context2, lik2);
+
+  cout << "Site scaled: " << setprecision(20) << llh2.getValue() << endl;
+  if (abs(llh2.getValue() - llh.getValue()) > 1e-6 * abs(llh.getValue()))
+    throw Exception("Incorrect site scaled value.");
+  for (size_t i = 0; i < llh.getParameters().size(); ++i)
+  {
+    const auto name = llh.getParameters()[i].getName();
+    double d1 = llh.getFirstOrderDerivative(name);
+    double d1SiteScaled = llh2.getFirstOrderDerivative(name);
+    cout << "Site scaled D1 " << name << ": " << setprecision(20) << d1SiteScaled << " (default: " << d1 << ")" << endl;
+    if (abs(d1SiteScaled - d1) > 1e-5 * max(1., abs(d1)))
+      throw Exception("Incorrect site scaled derivative for " + name);
+  }
+}
+
+// Run a test, reporting its failure without stopping the others.
+bool runTest(const std::string& name, const std::function<void()>& test)
+{
+  try {
+    cout << "Testing " << name << "..." << endl;
+    test();
+  } catch (Exception& ex) {
+    cerr << name << ": " << ex.what() << endl;
+    return false;
+  }
+  return true;
+}
+
+
 int main() {
   unique_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::parenthesisToTree("((A:0.01, B:0.02):0.03,C:0.01,D:0.1);"));
   vector<string> seqNames= tree->getLeavesNames();
@@ -227,15 +437,15 @@ int main() {
 
   shared_ptr<SubstitutionModel> model(new T92(alphabet, 3.));
   std::shared_ptr<DiscreteDistribution> rdist(new GammaDiscreteRateDistribution(4, 1.0));
-  try {
-    cout << "Testing Single Tree Traversal likelihood class..." << endl;
-    fitModelHSR(model, rdist, *tree, paramphyloTree, sites, 228.6333642493463, 198.47216106233);
-  } catch (Exception& ex) {
-    cerr << ex.what() << endl;
-    return 1;
-  }  
-
-  return 0;
+  bool ok = true;
+  ok &= runTest("Single Tree Traversal likelihood class", [&]() { fitModelHSR(model, rdist, *tree, paramphyloTree, sites, 228.6333642493463, 198.47216106233); });
+  ok &= runTest("adjoint derivatives", [&]() { testAdjointDerivatives(model, rdist, paramphyloTree, sites); });
+  ok &= runTest("single branch likelihoods", [&]() { testSingleBranchLikelihood(model, rdist, paramphyloTree, sites); });
+  ok &= runTest("likelihood snapshot", [&]() { testSnapshot(model, rdist, paramphyloTree, sites); });
+  ok &= runTest("constant folding", [&]() { testConstantFolding(model, rdist, paramphyloTree, sites); });
+  ok &= runTest("site scaled likelihood", [&]() { testSiteScaledLikelihood(model, rdist, paramphyloTree, sites); });
+
+  return ok ? 0 : 1;
 }
 
 
@@ -37,10 +37,25 @@ The fact that you are presently reading this means that you have had
 knowledge of the CeCILL license and that you accept its terms.
 */
 
+#include <Bpp/Phyl/Model/Nucleotide/F81.h>
+#include <Bpp/Phyl/Model/Nucleotide/F84.h>
 #include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Model/Nucleotide/HKY85.h>
+#include <Bpp/Phyl/Model/Nucleotide/JCnuc.h>
+#include <Bpp/Phyl/Model/Nucleotide/K80.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/Nucleotide/TN93.h>
+#include <Bpp/Phyl/Model/Protein/JCprot.h>
 #include <Bpp/Phyl/Model/Codon/YN98.h>
+#include <Bpp/Phyl/Model/BinarySubstitutionModel.h>
+#include <Bpp/Phyl/Model/EquiprobableSubstitutionModel.h>
+#include <Bpp/Phyl/Model/RE08.h>
+#include <Bpp/Phyl/Model/StateMap.h>
+#include <Bpp/Phyl/Model/TwoParameterBinarySubstitutionModel.h>
+#include <Bpp/Phyl/Model/WordSubstitutionModel.h>
 #include <Bpp/Phyl/Model/FrequencySet/CodonFrequencySet.h>
 #include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Alphabet/BinaryAlphabet.h>
 #include <Bpp/Seq/Alphabet/CodonAlphabet.h>
 #include <Bpp/Seq/GeneticCode/StandardGeneticCode.h>
 #include <Bpp/Numeric/Function/Functions.h>
@@ -48,7 +63,10 @@ knowledge of the CeCILL license and that you accept its terms.
 #include <Bpp/Numeric/ParameterList.h>
 #include <Bpp/Numeric/AbstractParametrizable.h>
 #include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/Model.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/Parametrizable.h>
 #include <iostream>
+#include <thread>
 
 using namespace bpp;
 using namespace std;
@@ -109,11 +127,294 @@ bool testModel(SubstitutionModel& model) {
   return true;
 }
 
+//Check transition probabilities of a reversible model (diagonalized through its symmetric form):
+bool testReversibleTransitions(const SubstitutionModel& model) {
+  size_t n = model.getNumberOfStates();
+  const Vdouble& freq = model.getFrequencies();
+  RowMatrix<double> p1(model.getPij_t(1.));
+  RowMatrix<double> pHalf(model.getPij_t(0.5));
+  for (size_t i = 0; i < n; ++i) {
+    double rowSum = 0, stationary = 0;
+    for (size_t j = 0; j < n; ++j) {
+      rowSum += p1(i, j);
+      stationary += freq[j] * p1(j, i);
+      double half2 = 0;
+      for (size_t k = 0; k < n; ++k)
+        half2 += pHalf(i, k) * pHalf(k, j);
+      if (abs(half2 - p1(i, j)) > 1e-10 || abs(freq[i] * p1(i, j) - freq[j] * p1(j, i)) > 1e-10) {
+        cerr << "ERROR in transition probabilities " << i << "->" << j << endl;
+        return false;
+      }
+    }
+    if (abs(rowSum - 1) > 1e-10 || abs(stationary - freq[i]) > 1e-10) {
+      cerr << "ERROR in transition probabilities from state " << i << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+//Nucleotide model with the cycle A->C->G->T->A faster than the reverse
+//one, which has complex eigen values:
+class CyclicModel:
+  public AbstractNucleotideSubstitutionModel
+{
+  public:
+    CyclicModel(const NucleicAlphabet* alpha):
+      AbstractParameterAliasable("Cyclic."),
+      AbstractNucleotideSubstitutionModel(alpha, std::shared_ptr<const StateMap>(new CanonicalStateMap(alpha, false)), "Cyclic.")
+    {
+      computeFrequencies(false);
+      updateMatrices();
+    }
+
+    CyclicModel* clone() const { return new CyclicModel(*this); }
+
+    std::string getName() const { return "Cyclic"; }
+
+    void updateMatrices() {
+      for (size_t i = 0; i < 4; ++i) {
+        freq_[i] = 0.25;
+        for (size_t j = 0; j < 4; ++j)
+          generator_(i, j) = 0.;
+        generator_(i, (i + 1) % 4) = 1.;
+        generator_(i, (i + 3) % 4) = 0.2;
+        generator_(i, i) = -1.2;
+      }
+      AbstractSubstitutionModel::updateMatrices();
+    }
+};
+
+//Check the second order derivatives of the transition probabilities against finite differences of the first order ones:
+bool testSecondOrderTransitions(const SubstitutionModel& model) {
+  size_t n = model.getNumberOfStates();
+  double h = 1e-5;
+  for (double t : {0.1, 0.7, 2.}) {
+    RowMatrix<double> d2p(model.getd2Pij_dt2(t));
+    RowMatrix<double> dpPlus(model.getdPij_dt(t + h));
+    RowMatrix<double> dpMinus(model.getdPij_dt(t - h));
+    for (size_t i = 0; i < n; ++i)
+      for (size_t j = 0; j < n; ++j) {
+        if (abs((dpPlus(i, j) - dpMinus(i, j)) / (2 * h) - d2p(i, j)) > 1e-6) {
+          cerr << "ERROR in second order derivative of " << model.getName() << " " << i << "->" << j << " at " << t << endl;
+          return false;
+        }
+      }
+  }
+  return true;
+}
+
+//Check the computePij_t & co transition probabilities against getPij_t & co, computed concurrently if reentrant:
+bool testReentrantTransitions(const SubstitutionModel& model) {
+  size_t n = model.getNumberOfStates();
+  vector<double> lengths = {0., 0.01, 0.2, 0.9, 3.};
+  vector<Eigen::MatrixXd> pij(lengths.size() * 3, Eigen::MatrixXd(n, n));
+  auto compute = [&model, &lengths, &pij](size_t k) {
+    model.computePij_t(lengths[k], pij[3 * k]);
+    model.computedPij_dt(lengths[k], pij[3 * k + 1]);
+    model.computed2Pij_dt2(lengths[k], pij[3 * k + 2]);
+  };
+  if (model.hasReentrantPij_t()) {
+    vector<thread> threads;
+    for (size_t k = 0; k < lengths.size(); ++k)
+      threads.emplace_back(compute, k);
+    for (auto& th : threads)
+      th.join();
+  } else {
+    for (size_t k = 0; k < lengths.size(); ++k)
+      compute(k);
+  }
+
+  for (size_t k = 0; k < lengths.size(); ++k) {
+    RowMatrix<double> p(model.getPij_t(lengths[k]));
+    RowMatrix<double> dp(model.getdPij_dt(lengths[k]));
+    RowMatrix<double> d2p(model.getd2Pij_dt2(lengths[k]));
+    for (size_t i = 0; i < n; ++i)
+      for (size_t j = 0; j < n; ++j) {
+        auto ei = Eigen::Index(i), ej = Eigen::Index(j);
+        if (abs(pij[3 * k](ei, ej) - p(i, j)) > 1e-10
+            || abs(pij[3 * k + 1](ei, ej) - dp(i, j)) > 1e-8
+            || abs(pij[3 * k + 2](ei, ej) - d2p(i, j)) > 1e-8) {
+          cerr << "ERROR in reentrant transition probabilities of " << model.getName() << " " << i << "->" << j << " at " << lengths[k] << endl;
+          return false;
+        }
+      }
+  }
+  return true;
+}
+
+//Check transition matrices (and derivatives) computed from the shared eigen decomposition in the dataflow:
+bool testDecomposedTransitions(const SubstitutionModel& model) {
+  Context context;
+  size_t n = model.getNumberOfStates();
+  auto configuredModel = ConfiguredParametrizable::createConfigured<BranchModel, ConfiguredModel>(
+    context, std::unique_ptr<BranchModel>(model.clone()));
+  vector<double> lengths = {0., 0.05, 0.3, 1.2};
+  vector<NodeRef> brlens;
+  vector<ValueRef<Eigen::MatrixXd>> matrices;
+  auto zero = NumericConstant<size_t>::create(context, size_t(0));
+  for (auto t : lengths) {
+    brlens.push_back(ConfiguredParameter::create(context, Parameter("BrLen", t)));
+    auto decomposition = EigenDecompositionFromModel::create(context, {configuredModel, nullptr}, n);
+    matrices.push_back(ConfiguredParametrizable::createMatrix<ConfiguredModel, TransitionMatrixFromModel, Eigen::MatrixXd>(
+      context, {configuredModel, brlens.back(), zero, nullptr, decomposition}, transitionMatrixDimension(n)));
+  }
+  if (matrices[0]->dependency(4) != matrices[1]->dependency(4)) {
+    cerr << "ERROR, eigen decomposition not shared for " << model.getName() << endl;
+    return false;
+  }
+
+  auto check = [&model, n](const Eigen::MatrixXd& eigenMatrix, const Matrix<double>& bppMatrix) {
+    for (size_t i = 0; i < n; ++i)
+      for (size_t j = 0; j < n; ++j)
+        if (abs(eigenMatrix(Eigen::Index(i), Eigen::Index(j)) - bppMatrix(i, j)) > 1e-10) {
+          cerr << "ERROR in decomposed transition matrix of " << model.getName() << " " << i << "->" << j << endl;
+          return false;
+        }
+    return true;
+  };
+
+  for (size_t k = 0; k < lengths.size(); ++k) {
+    if (!check(matrices[k]->getTargetValue(), model.getPij_t(lengths[k])))
+      return false;
+    auto dP = matrices[k]->deriveAsValue(context, *brlens[k]->dependency(0));
+    if (!check(dP->getTargetValue(), model.getdPij_dt(lengths[k])))
+      return false;
+    auto d2P = dP->deriveAsValue(context, *brlens[k]->dependency(0));
+    if (!check(d2P->getTargetValue(), model.getd2Pij_dt2(lengths[k])))
+      return false;
+  }
+
+  //Only one branch length changed, only its matrix is invalidated:
+  lengths[2] = 0.7;
+  dynamic_cast<ConfiguredParameter&>(*brlens[2]).setValue(lengths[2]);
+  for (size_t k = 0; k < lengths.size(); ++k)
+    if (matrices[k]->isValid() == (k == 2)) {
+      cerr << "ERROR in the invalidation of the transition matrix of branch " << k << endl;
+      return false;
+    }
+  for (size_t k = 0; k < lengths.size(); ++k)
+    if (!check(matrices[k]->getTargetValue(), model.getPij_t(lengths[k])))
+      return false;
+  return true;
+}
+
+//Check the derivatives of the generator and of the transition matrices wrt the model parameters against finite differences:
+bool testParameterDerivatives(const SubstitutionModel& model) {
+  size_t n = model.getNumberOfStates();
+  double t = 0.4, h = 1e-6;
+  ParameterList pl = model.getParameters();
+
+  Context context;
+  auto configuredModel = ConfiguredParametrizable::createConfigured<BranchModel, ConfiguredModel>(
+    context, std::unique_ptr<BranchModel>(model.clone()));
+  configuredModel->config.delta = NumericConstant<double>::create(context, 1e-6);
+  configuredModel->config.type = NumericalDerivativeType::ThreePoints;
+  auto brlen = ConfiguredParameter::create(context, Parameter("BrLen", t));
+  auto decomposition = EigenDecompositionFromModel::create(context, {configuredModel, nullptr}, n);
+  auto matrix = ConfiguredParametrizable::createMatrix<ConfiguredModel, TransitionMatrixFromModel, Eigen::MatrixXd>(
+    context, {configuredModel, brlen, NumericConstant<size_t>::create(context, size_t(0)), nullptr, decomposition}, transitionMatrixDimension(n));
+
+  auto generator = [n](const SubstitutionModel& m) {
+    Eigen::MatrixXd g(n, n);
+    for (size_t i = 0; i < n; ++i)
+      for (size_t j = 0; j < n; ++j)
+        g(Eigen::Index(i), Eigen::Index(j)) = m.getRate() * m.getGenerator()(i, j);
+    return g;
+  };
+
+  for (size_t k = 0; k < pl.size(); ++k) {
+    const string name = pl[k].getName();
+    unique_ptr<SubstitutionModel> mp(model.clone()), mm(model.clone());
+    ParameterList plp = pl, plm = pl;
+    plp.setParameterValue(name, pl[k].getValue() + h);
+    plm.setParameterValue(name, pl[k].getValue() - h);
+    mp->matchParametersValues(plp);
+    mm->matchParametersValues(plm);
+
+    Eigen::MatrixXd dG = (generator(*mp) - generator(*mm)) / (2 * h);
+    if (model.hasdGenerator_dParameter(name)) {
+      Eigen::MatrixXd dGa(n, n);
+      model.computedGenerator_dParameter(name, dGa);
+      if ((dGa - dG).cwiseAbs().maxCoeff() > 1e-6) {
+        cerr << "ERROR in generator derivative of " << model.getName() << " wrt " << name << endl;
+        return false;
+      }
+      dG = dGa;
+    }
+
+    Eigen::MatrixXd pp(n, n), pm(n, n), dP(n, n);
+    mp->computePij_t(t, pp);
+    mm->computePij_t(t, pm);
+    model.computedPij_dGenerator(t, dG, dP);
+    Eigen::MatrixXd dPfd = (pp - pm) / (2 * h);
+    if ((dP - dPfd).cwiseAbs().maxCoeff() > 1e-6) {
+      cerr << "ERROR in transition matrix derivative of " << model.getName() << " wrt " << name << endl;
+      return false;
+    }
+
+    auto dPdf = matrix->deriveAsValue(context, *configuredModel->getConfiguredParameter(name).dependency(0));
+    if ((dPdf->getTargetValue() - dPfd).cwiseAbs().maxCoeff() > 1e-6) {
+      cerr << "ERROR in dataflow transition matrix derivative of " << model.getName() << " wrt " << name << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
 int main() {
   //Nucleotide models:
   GTR gtr(&AlphabetTools::DNA_ALPHABET);
 
   if (!testModel(gtr)) return 1;
+  if (!testReversibleTransitions(gtr)) return 1;
+  if (!testDecomposedTransitions(gtr)) return 1;
+  if (!testReentrantTransitions(gtr)) return 1;
+  if (!testParameterDerivatives(gtr)) return 1;
+
+  K80 k80(&AlphabetTools::DNA_ALPHABET, 3.);
+  if (!testParameterDerivatives(k80)) return 1;
+
+  T92 t92(&AlphabetTools::DNA_ALPHABET, 3., 0.3);
+  if (!testParameterDerivatives(t92)) return 1;
+
+  //Complex eigen values:
+  CyclicModel cyclic(&AlphabetTools::DNA_ALPHABET);
+  if (!cyclic.isNonSingular() || cyclic.isDiagonalizable()) return 1;
+  if (!testSecondOrderTransitions(cyclic)) return 1;
+  if (!testReentrantTransitions(cyclic)) return 1;
+
+  //Closed form models, which computePij_t & co are their getPij_t & co:
+  BinaryAlphabet binary;
+  vector<shared_ptr<SubstitutionModel>> closedForms = {
+    make_shared<K80>(k80),
+    make_shared<T92>(t92),
+    make_shared<F81>(&AlphabetTools::DNA_ALPHABET, 0.1, 0.2, 0.3, 0.4),
+    make_shared<F84>(&AlphabetTools::DNA_ALPHABET, 2., 0.1, 0.2, 0.3, 0.4),
+    make_shared<HKY85>(&AlphabetTools::DNA_ALPHABET, 2., 0.1, 0.2, 0.3, 0.4),
+    make_shared<TN93>(&AlphabetTools::DNA_ALPHABET, 2., 4., 0.1, 0.2, 0.3, 0.4),
+    make_shared<JCnuc>(&AlphabetTools::DNA_ALPHABET),
+    make_shared<JCprot>(&AlphabetTools::PROTEIN_ALPHABET),
+    make_shared<RE08Nucleotide>(new GTR(&AlphabetTools::DNA_ALPHABET), 0.1, 0.2),
+    make_shared<EquiprobableSubstitutionModel>(&AlphabetTools::DNA_ALPHABET),
+    make_shared<BinarySubstitutionModel>(&binary, 2.),
+    make_shared<TwoParameterBinarySubstitutionModel>(&binary, 2., 0.3)
+  };
+  for (const auto& model : closedForms) {
+    if (model->hasReentrantPij_t()) {
+      cerr << "ERROR: " << model->getName() << " does not compute its closed form getPij_t." << endl;
+      return 1;
+    }
+    if (!testReentrantTransitions(*model)) return 1;
+  }
+
+  //Word model, with products of the matrices of its positions:
+  WordSubstitutionModel word(new GTR(&AlphabetTools::DNA_ALPHABET, 2., 0.5, 0.3, 0.8, 1.2), 2);
+  if (!word.hasReentrantPij_t()) return 1;
+  if (!testReentrantTransitions(word)) return 1;
+  WordSubstitutionModel k80Word(new K80(&AlphabetTools::DNA_ALPHABET, 2.), 2);
+  if (k80Word.hasReentrantPij_t()) return 1;
+  if (!testReentrantTransitions(k80Word)) return 1;
 
   //Codon models:
   StandardGeneticCode gc(AlphabetTools::DNA_ALPHABET);
@@ -121,6 +422,10 @@ int main() {
   YN98 yn98(&gc, fset);
   
   if (!testModel(yn98)) return 1;
+  if (!testReversibleTransitions(yn98)) return 1;
+  if (!testDecomposedTransitions(yn98)) return 1;
+  if (!testReentrantTransitions(yn98)) return 1;
+  if (!testParameterDerivatives(yn98)) return 1;
 
   return 0;
 }
@@ -40,7 +40,9 @@ knowledge of the CeCILL license and that you accept its terms.
 #include <Bpp/Phyl/Tree/TreeTemplate.h>
 #include <Bpp/Phyl/Tree/TreeTemplateTools.h>
 #include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Io/IndexedTreeFile.h>
 #include <string>
+#include <sstream>
 #include <vector>
 #include <iostream>
 
@@ -156,6 +158,24 @@ int main() {
   }
   cout << "Newick multiple I/O ok." << endl;
 
+  //Indexed random access, the second time with the saved index:
+  for (unsigned int k = 0; k < 2; ++k) {
+    IndexedTreeFile indexedFile("tmp_trees.dnd", tReader, "tmp_trees.idx");
+    vector<Tree *> trees3;
+    indexedFile.readTrees(trees3, 10, 3, 2);
+    if (indexedFile.getNumberOfTrees() != 100 || trees3.size() != 30)
+      return 1;
+    for (unsigned int i = 0; i < trees3.size(); ++i) {
+      if (!TreeTools::haveSameTopology(*trees[10 + 3 * i], *trees3[i]))
+      {
+        cerr << "Tree " << 10 + 3 * i << " failed to be read from index!" << endl;
+        return 1;
+      }
+      delete trees3[i];
+    }
+  }
+  cout << "Indexed multiple I/O ok." << endl;
+
   for (unsigned int i = 0; i < 100; ++i) {
     delete trees[i];
     delete trees2[i];
@@ -249,6 +269,33 @@ int main() {
   }
   cout << TreeTemplateTools::treeToParenthesis(*weird6) << endl;
   delete weird6;
+
+  cout << "Testing a deep caterpillar tree:" << endl;
+  string caterpillar;
+  for (size_t i = 0; i < 5000; ++i)
+    caterpillar += "(l" + TextTools::toString(i) + ":1,";
+  caterpillar += "x";
+  for (size_t i = 0; i < 5000; ++i)
+    caterpillar += "):1";
+  caterpillar += ";";
+  TreeTemplate<Node>* deep = TreeTemplateTools::parenthesisToTree(caterpillar);
+  if (deep->getNumberOfLeaves() != 5001) {
+    cout << "Error, tree has " << deep->getNumberOfLeaves() << " leaves instead of 5001!" << endl;
+    return 1;
+  }
+  delete deep;
+
+  cout << "Testing trees with comments:" << endl;
+  Newick commentReader(true);
+  istringstream commented("[first; tree] ((A:1,\nB:2)[x]:3,C:4);\n(D,E);\n");
+  vector<Tree*> commentedTrees;
+  commentReader.readTrees(commented, commentedTrees);
+  if (commentedTrees.size() != 2 || commentedTrees[0]->getNumberOfLeaves() != 3) {
+    cout << "Error, read " << commentedTrees.size() << " tree(s)!" << endl;
+    return 1;
+  }
+  for (auto tree : commentedTrees)
+    delete tree;
  
   return 0;
 }
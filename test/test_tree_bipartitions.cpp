@@ -0,0 +1,158 @@
+//
+// File: test_tree_bipartitions.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Text/TextTools.h>
+#include <Bpp/Phyl/Tree/BipartitionTable.h>
+#include <Bpp/Phyl/Tree/BipartitionTools.h>
+#include <Bpp/Phyl/Tree/TreeTemplate.h>
+#include <Bpp/Phyl/Tree/TreeTemplateTools.h>
+#include <Bpp/Phyl/Tree/TreeTools.h>
+#include <string>
+#include <vector>
+#include <iostream>
+
+using namespace bpp;
+using namespace std;
+
+int main() {
+  //Get some leaf names:
+  vector<string> leaves(70);
+  for (size_t i = 0; i < leaves.size(); ++i)
+    leaves[i] = "leaf" + TextTools::toString(i);
+
+  //Random trees, some of them repeated:
+  vector<Tree*> trees;
+  for (unsigned int j = 0; j < 50; ++j) {
+    trees.push_back(TreeTemplateTools::getRandomTree(leaves, j % 2 == 0));
+    if (j % 10 == 0)
+      trees.push_back(new TreeTemplate<Node>(*dynamic_cast<TreeTemplate<Node>*>(trees.back())));
+  }
+
+  //Counts of the table vs comparison with all the bipartitions of all the trees:
+  BipartitionTable table(leaves);
+  for (auto tree : trees)
+    table.addTree(*tree);
+  vector<size_t> scores;
+  BipartitionList* bipL = table.toBipartitionList(scores);
+  if (bipL->getNumberOfBipartitions() != table.getNumberOfBipartitions())
+    return 1; //Error!!!
+  for (size_t i = 0; i < bipL->getNumberOfBipartitions(); ++i) {
+    size_t count = 0;
+    for (auto tree : trees) {
+      BipartitionList treeBipL(*tree);
+      for (size_t k = 0; k < treeBipL.getNumberOfBipartitions(); ++k) {
+        if (BipartitionTools::areIdentical(*bipL, i, treeBipL, k)) {
+          count++;
+          break;
+        }
+      }
+    }
+    if (count != scores[i] || count != table.getNumberOfOccurrences(table.getSplit(*bipL, i))) {
+      cerr << "Bipartition " << i << ": " << scores[i] << " occurrences, expected " << count << endl;
+      return 1; //Error!!!
+    }
+  }
+  delete bipL;
+  cout << table.getNumberOfBipartitions() << " distinct bipartitions." << endl;
+
+  //Merge of partial tables:
+  BipartitionTable table1(leaves), table2(leaves);
+  for (size_t i = 0; i < trees.size(); ++i)
+    (i < trees.size() / 2 ? table1 : table2).addTree(*trees[i]);
+  table1.merge(table2);
+  vector<size_t> scores1;
+  bipL = table.toBipartitionList(scores);
+  BipartitionList* bipL1 = table1.toBipartitionList(scores1);
+  if (scores1 != scores || table1.getNumberOfTrees() != trees.size())
+    return 1; //Error!!!
+  for (size_t i = 0; i < bipL->getNumberOfBipartitions(); ++i) {
+    if (!BipartitionTools::areIdentical(*bipL, i, *bipL1, i))
+      return 1; //Error!!!
+  }
+  delete bipL;
+  delete bipL1;
+
+  //Compatibility on the split matrices, with same and distinct element orders:
+  BipartitionList sortedBipL0(*trees[0]), sortedBipL1(*trees[1]);
+  BipartitionList unsortedBipL1(*trees[1], false);
+  if (!sortedBipL0.areAllCompatible())
+    return 1; //Error!!!
+  for (size_t i = 0; i < sortedBipL0.getNumberOfBipartitions(); ++i) {
+    for (size_t k = 0; k < sortedBipL1.getNumberOfBipartitions(); ++k) {
+      if (BipartitionTools::areCompatible(sortedBipL0, i, sortedBipL1, k) != BipartitionTools::areCompatible(sortedBipL0, i, unsortedBipL1, k))
+        return 1; //Error!!!
+    }
+  }
+
+  //All-pairs Robinson-Foulds distances vs the pairwise ones:
+  vector<Tree*> someTrees(trees.begin(), trees.begin() + 12);
+  DistanceMatrix* rf = TreeTools::robinsonFouldsDistances(someTrees, false, false, 3);
+  DistanceMatrix* nrf = TreeTools::robinsonFouldsDistances(someTrees, false, true, 2);
+  for (size_t i = 0; i < someTrees.size(); ++i) {
+    for (size_t j = 0; j < someTrees.size(); ++j) {
+      int d = TreeTools::robinsonFouldsDistance(*someTrees[i], *someTrees[j]);
+      if ((*rf)(i, j) != d || (*nrf)(i, j) != d / (2. * static_cast<double>(leaves.size() - 3))) {
+        cerr << "RF(" << i << ", " << j << ") = " << (*rf)(i, j) << ", expected " << d << endl;
+        return 1; //Error!!!
+      }
+    }
+  }
+  delete rf;
+  delete nrf;
+
+  //Round trip through the deprecated int arrays:
+  BipartitionList intBipL(sortedBipL0.getElementNames(), sortedBipL0.getBitBipartitionList());
+  if (intBipL.getNumberOfBipartitions() != sortedBipL0.getNumberOfBipartitions())
+    return 1; //Error!!!
+  for (size_t i = 0; i < intBipL.getNumberOfBipartitions(); ++i) {
+    if (!BipartitionTools::areIdentical(intBipL, i, sortedBipL0, i))
+      return 1; //Error!!!
+  }
+
+  //Consensus of a tree with itself:
+  vector<Tree*> sameTrees(10, trees[1]);
+  TreeTemplate<Node>* consensus = TreeTools::majorityConsensus(sameTrees);
+  if (TreeTools::robinsonFouldsDistance(*consensus, *trees[1]) != 0)
+    return 1; //Error!!!
+  delete consensus;
+
+  for (auto tree : trees)
+    delete tree;
+  return 0;
+}